@@ -0,0 +1,324 @@
+#include "stdafx.h"
+#include "AssetRegistry.h"
+#include "Hash.h"
+#include "ImageLoader.h"
+#include "Mips.h"
+#include "Parallel.h"
+#include <cmath>
+
+AssetRegistry::AssetRegistry() :
+    m_compression(UNCOMPRESSED),
+    m_quality(Bc::NORMAL),
+    m_sharedRequests(0),
+    m_savedBytes(0) {}
+
+// Defined here, where ImageLoader is complete
+AssetRegistry::~AssetRegistry() {}
+
+AssetRegistry::Handle AssetRegistry::Find(const Key& key) {
+    auto found = m_assets.find(key);
+    if (found == m_assets.end()) {
+        return nullptr;
+    }
+    Handle asset = found->second.lock();
+    if (asset) {
+        m_sharedRequests++;
+        m_savedBytes += asset->bytes;
+    }
+    return asset;
+}
+
+AssetRegistry::Handle AssetRegistry::Insert(const Key& key, ComPtr<ID3D12Resource>& resource, UINT64 bytes) {
+    std::shared_ptr<Asset> asset = std::make_shared<Asset>();
+    asset->resource = resource;
+    asset->bytes = bytes;
+    // Replaces the entry of an asset that has since been released
+    m_assets[key] = asset;
+    return asset;
+}
+
+AssetRegistry::Handle AssetRegistry::AcquireBuffer(const ComPtr<ID3D12Device>& device, BufferKind kind, const void* keyData, size_t keyBytes, UINT bufferBytes,
+    const std::function<void(void*)>& fill, UINT64 seed) {
+    const Key key = { Hash::Hash64(keyData, keyBytes, seed), keyBytes, static_cast<UINT>(kind) };
+    Handle asset = Find(key);
+    if (asset) {
+        return asset;
+    }
+
+    // Note: using upload heaps to transfer static data like vert buffers is not
+    // recommended. Every time the GPU needs it, the upload heap will be marshalled
+    // over. Please read up on Default Heap usage. An upload heap is used here for
+    // code simplicity.
+    ComPtr<ID3D12Resource> buffer;
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(bufferBytes),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&buffer)
+    ));
+
+    UINT8* pDataBegin;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(buffer->Map(0, &readRange, reinterpret_cast<void**>(&pDataBegin)));
+    fill(pDataBegin);
+    buffer->Unmap(0, nullptr);
+
+    return Insert(key, buffer, bufferBytes);
+}
+
+void AssetRegistry::SetTextureCompression(TextureCompression compression, Bc::Quality quality) {
+    if (compression == m_compression && quality == m_quality) {
+        return;
+    }
+    m_compression = compression;
+    m_quality = quality;
+
+    // Known paths lead to keys, and decoded images to blocks, made with the
+    // old settings
+    m_texturePaths.clear();
+    m_decoded.clear();
+}
+
+UINT64 AssetRegistry::TextureSeed(UINT width, UINT height) const {
+    // Sides that aren't multiples of 4 are never compressed, and the quality
+    // only matters when they are
+    const bool compressed = m_compression != UNCOMPRESSED && width % 4 == 0 && height % 4 == 0;
+    const UINT64 settings[] = { width, height, UINT64(compressed ? m_compression : UNCOMPRESSED), UINT64(compressed ? m_quality : 0) };
+    return Hash::Hash64(settings, sizeof(settings));
+}
+
+void AssetRegistry::Prepare(const std::wstring& path, DecodedTexture& texture, unsigned threadCount) const {
+    texture.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    ImageLoader& image = *texture.image;
+    if (!image.isLoaded()) {
+        return;
+    }
+    image.generateMipChain(threadCount);
+
+    MipMap mip0(image.getMipMap(0));
+    if (m_compression == UNCOMPRESSED || mip0.width % 4 != 0 || mip0.height % 4 != 0) {
+        return;
+    }
+
+    LARGE_INTEGER start, end, frequency;
+    QueryPerformanceCounter(&start);
+
+    Bc::Format format = Bc::BC7;
+    texture.format = DXGI_FORMAT_BC7_UNORM;
+    if (m_compression == BC1_BC3) {
+        const bool opaque = Bc::IsOpaque(mip0.bytes, size_t(mip0.width) * mip0.height);
+        format = opaque ? Bc::BC1 : Bc::BC3;
+        texture.format = opaque ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+    }
+
+    const int levels = image.mipLevelCount();
+    size_t bytes = 0;
+    for (int level = 0; level < levels; ++level) {
+        const MipMap mip(image.getMipMap(level));
+        bytes += Bc::EncodedBytes(format, mip.width, mip.height);
+    }
+    texture.blocks.resize(bytes);
+    size_t offset = 0;
+    for (int level = 0; level < levels; ++level) {
+        const MipMap mip(image.getMipMap(level));
+        Bc::Encode(format, m_quality, mip.bytes, mip.width, mip.height, &texture.blocks[offset], threadCount);
+        offset += Bc::EncodedBytes(format, mip.width, mip.height);
+    }
+
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&frequency);
+    char report[MAX_PATH + 128];
+    sprintf_s(report, "%ls: %s (%s) in %.2f ms\n", path.c_str(), Bc::Name(format), Bc::Name(m_quality),
+        double(end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+    OutputDebugStringA(report);
+
+#if defined(_DEBUG)
+    // What compression costs the top level, over every channel
+    std::vector<uint8_t> decoded(size_t(mip0.width) * mip0.height * 4);
+    Bc::Decode(format, texture.blocks.data(), mip0.width, mip0.height, decoded.data());
+    double squaredError = 0;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        const double d = double(decoded[i]) - mip0.bytes[i];
+        squaredError += d * d;
+    }
+    const double meanSquaredError = squaredError / decoded.size();
+    sprintf_s(report, "%ls: level 0 PSNR %.2f dB\n", path.c_str(), meanSquaredError > 0 ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : 99.0);
+    OutputDebugStringA(report);
+#endif
+}
+
+void AssetRegistry::DecodeTextures(const std::vector<std::wstring>& paths, unsigned threadCount) {
+    std::vector<std::wstring> pending;
+    for (const std::wstring& path : paths) {
+        if (m_decoded.count(path) || std::find(pending.begin(), pending.end(), path) != pending.end()) {
+            continue;
+        }
+        auto known = m_texturePaths.find(path);
+        if (known != m_texturePaths.end()) {
+            auto found = m_assets.find(known->second);
+            if (found != m_assets.end() && !found->second.expired()) {
+                continue;
+            }
+        }
+        pending.push_back(path);
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    LARGE_INTEGER start, end, frequency;
+    QueryPerformanceCounter(&start);
+
+    if (threadCount == 0) {
+        threadCount = Parallel::DefaultThreadCount();
+    }
+    const unsigned bandThreads = std::max(1u, threadCount / static_cast<unsigned>(pending.size()));
+
+    std::vector<DecodedTexture> textures(pending.size());
+    Parallel::For(pending.size(), threadCount, [&](size_t i) {
+        textures[i].image = std::make_unique<ImageLoader>(pending[i].c_str());
+        Prepare(pending[i], textures[i], bandThreads);
+    });
+    for (size_t i = 0; i < pending.size(); ++i) {
+        m_decoded[pending[i]] = std::move(textures[i]);
+    }
+
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&frequency);
+    char report[128];
+    sprintf_s(report, "Textures: decoded %u images with mips and compression in %.2f ms on up to %u threads\n", static_cast<UINT>(pending.size()),
+        double(end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart, threadCount);
+    OutputDebugStringA(report);
+}
+
+AssetRegistry::Handle AssetRegistry::AcquireTexture(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, const std::wstring& path) {
+    // A path seen before needn't be decoded again to find its key
+    auto known = m_texturePaths.find(path);
+    if (known != m_texturePaths.end()) {
+        Handle asset = Find(known->second);
+        if (asset) {
+            return asset;
+        }
+    }
+
+    DecodedTexture decoded;
+    auto pending = m_decoded.find(path);
+    const bool prepared = pending != m_decoded.end();
+    if (prepared) {
+        decoded = std::move(pending->second);
+        m_decoded.erase(pending);
+    } else {
+        decoded.image = std::make_unique<ImageLoader>(path.c_str());
+    }
+    if (!decoded.image->isLoaded()) {
+        OutputDebugStringW((L"Failed to load texture " + path + L"\n").c_str());
+        return nullptr;
+    }
+    MipMap mip0(decoded.image->getMipMap(0));
+
+    // Seed with the dimensions and compression so images with the same pixels
+    // in a different shape, or stored differently, stay apart
+    const UINT64 pixelBytes = UINT64(mip0.width) * mip0.height * sizeof(MipMap::Pixel);
+    const Key key = { Hash::Hash64(mip0.bytes, static_cast<size_t>(pixelBytes), TextureSeed(mip0.width, mip0.height)), pixelBytes, TEXTURE };
+    m_texturePaths[path] = key;
+
+    Handle asset = Find(key);
+    if (asset) {
+        return asset;
+    }
+
+    // Batched images arrive with their chains compressed; the rest are
+    // prepared here
+    if (!prepared) {
+        Prepare(path, decoded, 0);
+    }
+    const UINT levels = static_cast<UINT>(decoded.image->mipLevelCount());
+
+    D3D12_RESOURCE_DESC textureDesc = {};
+    textureDesc.MipLevels = static_cast<UINT16>(levels);
+    textureDesc.Format = decoded.format;
+    textureDesc.Width = mip0.width;
+    textureDesc.Height = mip0.height;
+    textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    textureDesc.DepthOrArraySize = 1;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+    ComPtr<ID3D12Resource> texture;
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &textureDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&texture)));
+
+    // One staging buffer holds the whole chain, each level placed and its
+    // rows pitched the way the copies require
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(levels);
+    std::vector<UINT> rowCounts(levels);
+    std::vector<UINT64> rowBytes(levels);
+    UINT64 uploadBufferSize;
+    device->GetCopyableFootprints(&textureDesc, 0, levels, 0, footprints.data(), rowCounts.data(), rowBytes.data(), &uploadBufferSize);
+
+    ComPtr<ID3D12Resource> uploadHeap;
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&uploadHeap)));
+    m_uploads.push_back(uploadHeap);
+
+    // Copy every level into the staging buffer and schedule its copy into
+    // the texture. Rows, of pixels or of blocks, are tightly packed in the
+    // chain, so levels whose pitch needs no padding go over in one piece.
+    UINT8* staging;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(uploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&staging)));
+    size_t blockOffset = 0;
+    for (UINT level = 0; level < levels; ++level) {
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = footprints[level];
+        const size_t bytesPerRow = static_cast<size_t>(rowBytes[level]);
+        const uint8_t* data = decoded.blocks.empty() ? decoded.image->getMipMap(level).bytes : &decoded.blocks[blockOffset];
+        blockOffset += bytesPerRow * rowCounts[level];
+        if (footprint.Footprint.RowPitch == bytesPerRow) {
+            memcpy(staging + footprint.Offset, data, bytesPerRow * rowCounts[level]);
+        } else {
+            for (UINT row = 0; row < rowCounts[level]; ++row) {
+                memcpy(staging + footprint.Offset + size_t(footprint.Footprint.RowPitch) * row, data + bytesPerRow * row, bytesPerRow);
+            }
+        }
+
+        const CD3DX12_TEXTURE_COPY_LOCATION destination(texture.Get(), level);
+        const CD3DX12_TEXTURE_COPY_LOCATION source(uploadHeap.Get(), footprint);
+        commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+    }
+    uploadHeap->Unmap(0, nullptr);
+    commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+    const UINT64 chainBytes = decoded.blocks.empty() ? UINT64(Mips::ChainPixels(mip0.width, mip0.height)) * sizeof(MipMap::Pixel) : decoded.blocks.size();
+    return Insert(key, texture, chainBytes);
+}
+
+void AssetRegistry::ReleaseUploads() {
+    m_uploads.clear();
+}
+
+AssetRegistry::Stats AssetRegistry::GetStats() const {
+    Stats stats = {};
+    for (const auto& entry : m_assets) {
+        Handle asset = entry.second.lock();
+        if (asset) {
+            stats.resources++;
+            stats.bytes += asset->bytes;
+        }
+    }
+    stats.sharedRequests = m_sharedRequests;
+    stats.savedBytes = m_savedBytes;
+    return stats;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "stdafx.h"
+#include "Bc.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+class ImageLoader;
+
+// Hands out GPU resources shared by every SceneObject whose data is the same.
+// Resources are keyed by a 64-bit content hash of the data they hold (plus its
+// size and kind), so objects built from one file, from copies of one Mesh or
+// from byte-identical files all get one resource. Callers hold Handles; a
+// resource is released with its last Handle, and a later request for the same
+// data creates it again.
+//
+// Keys trust the hash: two different inputs of the same size and kind that
+// collide in 64 bits would share a resource.
+class AssetRegistry
+{
+public:
+    struct Asset {
+        ComPtr<ID3D12Resource> resource;
+        // Size of the data the resource holds
+        UINT64 bytes;
+    };
+    typedef std::shared_ptr<const Asset> Handle;
+
+    // What a buffer's bytes mean; identical bytes of different kinds aren't
+    // shared
+    enum BufferKind {
+        VERTICES,
+        PACKED_VERTICES,
+        INDICES_16,
+        INDICES_32,
+    };
+
+    // How textures are stored on the GPU
+    enum TextureCompression {
+        // RGBA8
+        UNCOMPRESSED,
+        // BC1 for opaque images, BC3 for the rest
+        BC1_BC3,
+        // BC7 for every image
+        BC7,
+    };
+
+    struct Stats {
+        // Live resources and their total size
+        UINT resources;
+        UINT64 bytes;
+        // Requests answered with an existing resource, and the bytes they
+        // would otherwise have allocated
+        UINT sharedRequests;
+        UINT64 savedBytes;
+    };
+
+    AssetRegistry();
+    ~AssetRegistry();
+
+    // Upload-heap buffer of bufferBytes bytes shared by every request with the
+    // same kind, key data and seed. keyData is what determines the contents,
+    // e.g. the source vertices of a packed vertex buffer, and seed folds in
+    // anything else they depend on; fill writes the contents into the mapped
+    // buffer and only runs when the buffer is created.
+    Handle AcquireBuffer(const ComPtr<ID3D12Device>& device, BufferKind kind, const void* keyData, size_t keyBytes, UINT bufferBytes,
+        const std::function<void(void*)>& fill, UINT64 seed = 0);
+
+    // Applies to textures created afterwards; existing textures stay alive but
+    // aren't shared with requests made under different settings. Images whose
+    // sides aren't multiples of 4 stay RGBA8, as D3D requires of
+    // block-compressed textures. Textures start out uncompressed.
+    void SetTextureCompression(TextureCompression compression, Bc::Quality quality);
+
+    // Decodes the images at paths, generates their mip chains and compresses
+    // them ahead of AcquireTexture, on up to threadCount threads (0 = one per
+    // hardware thread). Images are processed concurrently, and the threads
+    // left over when there are fewer images than threads split each image's
+    // levels into bands of rows. Paths already decoded, or whose texture is
+    // alive, are skipped.
+    void DecodeTextures(const std::vector<std::wstring>& paths, unsigned threadCount = 0);
+
+    // Default-heap texture holding the image's full mip chain, compressed as
+    // set by SetTextureCompression, or null if the image can't be loaded.
+    // Textures are keyed by their decoded pixels, so identical images under
+    // different paths share one; a path already decoded isn't decoded again
+    // while its texture is alive. Images from DecodeTextures are used, and
+    // released, here. The copy is recorded on commandList.
+    Handle AcquireTexture(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, const std::wstring& path);
+
+    // Frees the staging buffers of recorded texture copies. Only call once the
+    // command lists holding those copies have finished executing.
+    void ReleaseUploads();
+
+    Stats GetStats() const;
+
+private:
+    struct Key {
+        UINT64 hash;
+        UINT64 bytes;
+        UINT kind;
+
+        bool operator<(const Key& other) const {
+            if (hash != other.hash) return hash < other.hash;
+            if (bytes != other.bytes) return bytes < other.bytes;
+            return kind < other.kind;
+        }
+    };
+
+    // Texture keys follow the buffer kinds
+    static const UINT TEXTURE = INDICES_32 + 1;
+
+    // An image decoded ahead of its upload
+    struct DecodedTexture {
+        std::unique_ptr<ImageLoader> image;
+        DXGI_FORMAT format;
+        // Every level's blocks, level 0 first; empty for RGBA8
+        std::vector<uint8_t> blocks;
+    };
+
+    // Generates a loaded image's mip chain and compresses it, on up to
+    // threadCount threads
+    void Prepare(const std::wstring& path, DecodedTexture& texture, unsigned threadCount) const;
+
+    // Key seed for a width x height texture: its shape and how the current
+    // settings store it
+    UINT64 TextureSeed(UINT width, UINT height) const;
+
+    // Returns the live asset for key, counting the request as shared
+    Handle Find(const Key& key);
+    Handle Insert(const Key& key, ComPtr<ID3D12Resource>& resource, UINT64 bytes);
+
+    std::map<Key, std::weak_ptr<const Asset>> m_assets;
+    std::map<std::wstring, Key> m_texturePaths;
+    // Images from DecodeTextures waiting for AcquireTexture, including ones
+    // that failed to load
+    std::map<std::wstring, DecodedTexture> m_decoded;
+    TextureCompression m_compression;
+    Bc::Quality m_quality;
+    std::vector<ComPtr<ID3D12Resource>> m_uploads;
+    UINT m_sharedRequests;
+    UINT64 m_savedBytes;
+};
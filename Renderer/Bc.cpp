@@ -0,0 +1,760 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Bc.h"
+#include "Cpu.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // BC7's 4-bit interpolation weights, out of 64
+    const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // How far along from the first endpoint to the second each BC1 index is
+    const float BC1_FRACTIONS[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+    // Power iterations spent finding a block's principal axis
+    const int AXIS_ITERATIONS = 8;
+
+    // A block's pixels one channel at a time, pixel i being row i / 4 and
+    // column i % 4
+    struct Block {
+        alignas(32) float channels[4][16];
+    };
+
+    // Entries hold the decoded values, so every error is a sum of squared
+    // integers and exact in a float
+    struct Palette {
+        float entries[16][4];
+        int count;
+    };
+
+    // Repeats the edge pixels for blocks hanging over the image
+    void LoadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block) {
+        if (blockX * 4 + 4 <= width && blockY * 4 + 4 <= height) {
+            for (uint32_t y = 0; y < 4; ++y) {
+                const uint8_t* pixel = pixels + (size_t(blockY * 4 + y) * width + blockX * 4) * 4;
+                for (uint32_t x = 0; x < 4; ++x, pixel += 4) {
+                    for (int c = 0; c < 4; ++c) {
+                        block.channels[c][y * 4 + x] = pixel[c];
+                    }
+                }
+            }
+            return;
+        }
+
+        for (uint32_t y = 0; y < 4; ++y) {
+            const uint32_t row = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; ++x) {
+                const uint32_t column = std::min(blockX * 4 + x, width - 1);
+                const uint8_t* pixel = pixels + (size_t(row) * width + column) * 4;
+                for (int c = 0; c < 4; ++c) {
+                    block.channels[c][y * 4 + x] = pixel[c];
+                }
+            }
+        }
+    }
+
+    // The index selectors choose, for each pixel, the palette entry nearest
+    // in channels [first, last), preferring the lowest index on ties, and
+    // return the block's total squared error
+    float SelectIndicesScalar(const Block& block, const Palette& palette, int first, int last, uint8_t* indices) {
+        float total = 0;
+        for (int i = 0; i < 16; ++i) {
+            float best = FLT_MAX;
+            int bestIndex = 0;
+            for (int e = 0; e < palette.count; ++e) {
+                float error = 0;
+                for (int c = first; c < last; ++c) {
+                    const float d = block.channels[c][i] - palette.entries[e][c];
+                    error += d * d;
+                }
+                if (error < best) {
+                    best = error;
+                    bestIndex = e;
+                }
+            }
+            indices[i] = static_cast<uint8_t>(bestIndex);
+            total += best;
+        }
+        return total;
+    }
+
+#if CPU_X86
+    CPU_TARGET("sse2")
+    float SelectIndicesSse2(const Block& block, const Palette& palette, int first, int last, uint8_t* indices) {
+        float total = 0;
+        for (int group = 0; group < 16; group += 4) {
+            __m128 best = _mm_set1_ps(FLT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int e = 0; e < palette.count; ++e) {
+                __m128 error = _mm_setzero_ps();
+                for (int c = first; c < last; ++c) {
+                    const __m128 d = _mm_sub_ps(_mm_load_ps(&block.channels[c][group]), _mm_set1_ps(palette.entries[e][c]));
+                    error = _mm_add_ps(error, _mm_mul_ps(d, d));
+                }
+                const __m128i less = _mm_castps_si128(_mm_cmplt_ps(error, best));
+                best = _mm_min_ps(error, best);
+                bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(e)), _mm_andnot_si128(less, bestIndex));
+            }
+
+            alignas(16) int32_t lanes[4];
+            alignas(16) float errors[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+            _mm_store_ps(errors, best);
+            for (int k = 0; k < 4; ++k) {
+                indices[group + k] = static_cast<uint8_t>(lanes[k]);
+                total += errors[k];
+            }
+        }
+        return total;
+    }
+
+    CPU_TARGET("avx2")
+    float SelectIndicesAvx2(const Block& block, const Palette& palette, int first, int last, uint8_t* indices) {
+        float total = 0;
+        for (int group = 0; group < 16; group += 8) {
+            __m256 best = _mm256_set1_ps(FLT_MAX);
+            __m256 bestIndex = _mm256_setzero_ps();
+            for (int e = 0; e < palette.count; ++e) {
+                __m256 error = _mm256_setzero_ps();
+                for (int c = first; c < last; ++c) {
+                    const __m256 d = _mm256_sub_ps(_mm256_load_ps(&block.channels[c][group]), _mm256_set1_ps(palette.entries[e][c]));
+                    error = _mm256_add_ps(error, _mm256_mul_ps(d, d));
+                }
+                const __m256 less = _mm256_cmp_ps(error, best, _CMP_LT_OQ);
+                best = _mm256_min_ps(error, best);
+                bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(float(e)), less);
+            }
+
+            alignas(32) int32_t lanes[8];
+            alignas(32) float errors[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_cvtps_epi32(bestIndex));
+            _mm256_store_ps(errors, best);
+            for (int k = 0; k < 8; ++k) {
+                indices[group + k] = static_cast<uint8_t>(lanes[k]);
+                total += errors[k];
+            }
+        }
+        return total;
+    }
+#endif
+
+    float SelectIndices(Bc::Implementation implementation, const Block& block, const Palette& palette, int first, int last, uint8_t* indices) {
+#if CPU_X86
+        if (implementation == Bc::AVX2) {
+            return SelectIndicesAvx2(block, palette, first, last, indices);
+        }
+        if (implementation == Bc::SSE2) {
+            return SelectIndicesSse2(block, palette, first, last, indices);
+        }
+#else
+        (void)implementation;
+#endif
+        return SelectIndicesScalar(block, palette, first, last, indices);
+    }
+
+    // Mean of the first CHANNELS channels and the unit direction they vary
+    // most along, which is zero for a block of one color. The loops run
+    // along the 16 pixels of a channel, which compilers vectorize.
+    template <int CHANNELS>
+    void PrincipalAxis(const Block& block, float* mean, float* axis) {
+        float centered[CHANNELS][16];
+        for (int c = 0; c < CHANNELS; ++c) {
+            float sum = 0;
+            for (int i = 0; i < 16; ++i) {
+                sum += block.channels[c][i];
+            }
+            mean[c] = sum / 16;
+            for (int i = 0; i < 16; ++i) {
+                centered[c][i] = block.channels[c][i] - mean[c];
+            }
+        }
+
+        float covariance[CHANNELS][CHANNELS];
+        for (int a = 0; a < CHANNELS; ++a) {
+            for (int b = a; b < CHANNELS; ++b) {
+                float sum = 0;
+                for (int i = 0; i < 16; ++i) {
+                    sum += centered[a][i] * centered[b][i];
+                }
+                covariance[a][b] = covariance[b][a] = sum;
+            }
+        }
+
+        // Power iteration, starting from the column of the channel that
+        // varies most
+        int widest = 0;
+        for (int c = 1; c < CHANNELS; ++c) {
+            if (covariance[c][c] > covariance[widest][widest]) {
+                widest = c;
+            }
+        }
+        if (covariance[widest][widest] == 0) {
+            std::fill(axis, axis + CHANNELS, 0.f);
+            return;
+        }
+        for (int c = 0; c < CHANNELS; ++c) {
+            axis[c] = covariance[c][widest];
+        }
+        for (int iteration = 0; iteration < AXIS_ITERATIONS; ++iteration) {
+            float next[CHANNELS] = {};
+            float scale = 0;
+            for (int a = 0; a < CHANNELS; ++a) {
+                for (int b = 0; b < CHANNELS; ++b) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                scale = std::max(scale, std::fabs(next[a]));
+            }
+            if (scale == 0) {
+                std::fill(axis, axis + CHANNELS, 0.f);
+                return;
+            }
+            for (int c = 0; c < CHANNELS; ++c) {
+                axis[c] = next[c] / scale;
+            }
+        }
+
+        float length = 0;
+        for (int c = 0; c < CHANNELS; ++c) {
+            length += axis[c] * axis[c];
+        }
+        length = std::sqrt(length);
+        for (int c = 0; c < CHANNELS; ++c) {
+            axis[c] /= length;
+        }
+    }
+
+    float Clamp255(float value) {
+        return std::min(std::max(value, 0.f), 255.f);
+    }
+
+    // The block's extremes along axis
+    template <int CHANNELS>
+    void AxisEndpoints(const Block& block, const float* mean, const float* axis, float* e0, float* e1) {
+        float low = FLT_MAX;
+        float high = -FLT_MAX;
+        for (int i = 0; i < 16; ++i) {
+            float t = 0;
+            for (int c = 0; c < CHANNELS; ++c) {
+                t += (block.channels[c][i] - mean[c]) * axis[c];
+            }
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+        for (int c = 0; c < CHANNELS; ++c) {
+            e0[c] = Clamp255(mean[c] + low * axis[c]);
+            e1[c] = Clamp255(mean[c] + high * axis[c]);
+        }
+    }
+
+    // Least squares endpoints for the first CHANNELS channels given each
+    // pixel's index and how far along from e0 to e1 each index is. False if
+    // the indices don't pin down both endpoints.
+    template <int CHANNELS>
+    bool FitEndpoints(const Block& block, const float* fractions, const uint8_t* indices, float* e0, float* e1) {
+        float aa = 0, ab = 0, bb = 0;
+        float ap[4] = {}, bp[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            const float t = fractions[indices[i]];
+            const float s = 1 - t;
+            aa += s * s;
+            ab += s * t;
+            bb += t * t;
+            for (int c = 0; c < CHANNELS; ++c) {
+                ap[c] += s * block.channels[c][i];
+                bp[c] += t * block.channels[c][i];
+            }
+        }
+
+        const float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f) {
+            return false;
+        }
+        for (int c = 0; c < CHANNELS; ++c) {
+            e0[c] = Clamp255((ap[c] * bb - bp[c] * ab) / determinant);
+            e1[c] = Clamp255((bp[c] * aa - ap[c] * ab) / determinant);
+        }
+        return true;
+    }
+
+    int Refinements(Bc::Quality quality) {
+        return quality == Bc::HIGH ? 2 : quality == Bc::NORMAL ? 1 : 0;
+    }
+
+    void Write16(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    uint32_t Read16(const uint8_t* in) {
+        return uint32_t(in[0]) | (uint32_t(in[1]) << 8);
+    }
+
+    // BC1 color, also BC3's color half
+
+    uint16_t Quantize565(const float* color) {
+        const int r = int(color[0] * 31 / 255 + 0.5f);
+        const int g = int(color[1] * 63 / 255 + 0.5f);
+        const int b = int(color[2] * 31 / 255 + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void Expand565(uint32_t packed, int* rgb) {
+        const int r = (packed >> 11) & 31;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // The 4-color palette, which the encoder always uses
+    void ColorPalette(uint32_t c0, uint32_t c1, Palette& palette) {
+        int a[3], b[3];
+        Expand565(c0, a);
+        Expand565(c1, b);
+        for (int c = 0; c < 3; ++c) {
+            palette.entries[0][c] = float(a[c]);
+            palette.entries[1][c] = float(b[c]);
+            palette.entries[2][c] = float((2 * a[c] + b[c]) / 3);
+            palette.entries[3][c] = float((a[c] + 2 * b[c]) / 3);
+        }
+        palette.count = 4;
+    }
+
+    struct ColorFit {
+        uint16_t c0, c1;
+        uint8_t indices[16];
+        float error;
+    };
+
+    void TryColor(Bc::Implementation implementation, const Block& block, const float* e0, const float* e1, ColorFit& best) {
+        ColorFit fit;
+        fit.c0 = Quantize565(e0);
+        fit.c1 = Quantize565(e1);
+        Palette palette;
+        ColorPalette(fit.c0, fit.c1, palette);
+        fit.error = SelectIndices(implementation, block, palette, 0, 3, fit.indices);
+        if (fit.error < best.error) {
+            best = fit;
+        }
+    }
+
+    void EncodeColor(Bc::Implementation implementation, Bc::Quality quality, const Block& block, uint8_t* out) {
+        float mean[4], axis[4], e0[4], e1[4];
+        PrincipalAxis<3>(block, mean, axis);
+        AxisEndpoints<3>(block, mean, axis, e0, e1);
+
+        ColorFit best;
+        best.error = FLT_MAX;
+        TryColor(implementation, block, e0, e1, best);
+        for (int r = 0; r < Refinements(quality) && best.error > 0; ++r) {
+            if (!FitEndpoints<3>(block, BC1_FRACTIONS, best.indices, e0, e1)) {
+                break;
+            }
+            TryColor(implementation, block, e0, e1, best);
+        }
+
+        // The 4-color mode needs c0 > c1. Swapping the endpoints swaps indices
+        // 0 with 1 and 2 with 3. Equal endpoints select the 3-color mode, where
+        // index 0 is still c0.
+        uint32_t c0 = best.c0;
+        uint32_t c1 = best.c1;
+        uint32_t bits = 0;
+        if (c0 != c1) {
+            const uint32_t flip = c0 < c1 ? 1 : 0;
+            if (flip) {
+                std::swap(c0, c1);
+            }
+            for (int i = 0; i < 16; ++i) {
+                bits |= uint32_t(best.indices[i] ^ flip) << (2 * i);
+            }
+        }
+        Write16(out, c0);
+        Write16(out + 2, c1);
+        Write16(out + 4, bits & 0xFFFF);
+        Write16(out + 6, bits >> 16);
+    }
+
+    void DecodeColor(const uint8_t* in, bool fourColorsOnly, uint8_t* pixels) {
+        const uint32_t c0 = Read16(in);
+        const uint32_t c1 = Read16(in + 2);
+        const uint32_t bits = Read16(in + 4) | (Read16(in + 6) << 16);
+
+        int a[3], b[3];
+        Expand565(c0, a);
+        Expand565(c1, b);
+        uint8_t palette[4][4];
+        for (int c = 0; c < 3; ++c) {
+            palette[0][c] = static_cast<uint8_t>(a[c]);
+            palette[1][c] = static_cast<uint8_t>(b[c]);
+            if (c0 > c1 || fourColorsOnly) {
+                palette[2][c] = static_cast<uint8_t>((2 * a[c] + b[c]) / 3);
+                palette[3][c] = static_cast<uint8_t>((a[c] + 2 * b[c]) / 3);
+            } else {
+                palette[2][c] = static_cast<uint8_t>((a[c] + b[c]) / 2);
+                palette[3][c] = 0;
+            }
+        }
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        palette[3][3] = c0 > c1 || fourColorsOnly ? 255 : 0;
+
+        for (int i = 0; i < 16; ++i) {
+            memcpy(pixels + 4 * i, palette[(bits >> (2 * i)) & 3], 4);
+        }
+    }
+
+    // BC3 alpha, which is BC4
+
+    // a0 > a1 interpolates 8 levels; otherwise 6, plus 0 and 255
+    void AlphaPalette(int a0, int a1, Palette& palette) {
+        palette.entries[0][3] = float(a0);
+        palette.entries[1][3] = float(a1);
+        if (a0 > a1) {
+            for (int i = 2; i < 8; ++i) {
+                palette.entries[i][3] = float(((8 - i) * a0 + (i - 1) * a1) / 7);
+            }
+        } else {
+            for (int i = 2; i < 6; ++i) {
+                palette.entries[i][3] = float(((6 - i) * a0 + (i - 1) * a1) / 5);
+            }
+            palette.entries[6][3] = 0;
+            palette.entries[7][3] = 255;
+        }
+        palette.count = 8;
+    }
+
+    void EncodeAlpha(Bc::Implementation implementation, Bc::Quality quality, const Block& block, uint8_t* out) {
+        int low = 255, high = 0;
+        int innerLow = 255, innerHigh = 0;
+        for (int i = 0; i < 16; ++i) {
+            const int a = int(block.channels[3][i]);
+            low = std::min(low, a);
+            high = std::max(high, a);
+            if (a != 0 && a != 255) {
+                innerLow = std::min(innerLow, a);
+                innerHigh = std::max(innerHigh, a);
+            }
+        }
+
+        int a0 = high;
+        int a1 = low;
+        uint8_t indices[16];
+        Palette palette;
+        AlphaPalette(a0, a1, palette);
+        float error = SelectIndices(implementation, block, palette, 3, 4, indices);
+
+        // Cutouts mix exact 0 and 255 with a few values between, which the
+        // 6-level mode covers without spending its range on the extremes
+        if (quality != Bc::FAST && error > 0) {
+            if (innerLow > innerHigh) {
+                innerLow = innerHigh = 0;
+            }
+            uint8_t sixIndices[16];
+            AlphaPalette(innerLow, innerHigh, palette);
+            const float sixError = SelectIndices(implementation, block, palette, 3, 4, sixIndices);
+            if (sixError < error) {
+                a0 = innerLow;
+                a1 = innerHigh;
+                memcpy(indices, sixIndices, sizeof(indices));
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(a0);
+        out[1] = static_cast<uint8_t>(a1);
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i) {
+            bits |= uint64_t(indices[i]) << (3 * i);
+        }
+        for (int b = 0; b < 6; ++b) {
+            out[2 + b] = static_cast<uint8_t>(bits >> (8 * b));
+        }
+    }
+
+    void DecodeAlpha(const uint8_t* in, uint8_t* pixels) {
+        Palette palette;
+        AlphaPalette(in[0], in[1], palette);
+        uint64_t bits = 0;
+        for (int b = 0; b < 6; ++b) {
+            bits |= uint64_t(in[2 + b]) << (8 * b);
+        }
+        for (int i = 0; i < 16; ++i) {
+            pixels[4 * i + 3] = static_cast<uint8_t>(palette.entries[(bits >> (3 * i)) & 7][3]);
+        }
+    }
+
+    // BC7 mode 6
+
+    // Appends bits least significant first, as BC7 lays out its fields
+    struct BitWriter {
+        uint8_t* out;
+        int position;
+
+        void Put(uint32_t value, int bits) {
+            for (int b = 0; b < bits; ++b, ++position) {
+                if ((value >> b) & 1) {
+                    out[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+                }
+            }
+        }
+    };
+
+    struct BitReader {
+        const uint8_t* in;
+        int position;
+
+        uint32_t Get(int bits) {
+            uint32_t value = 0;
+            for (int b = 0; b < bits; ++b, ++position) {
+                value |= uint32_t((in[position >> 3] >> (position & 7)) & 1) << b;
+            }
+            return value;
+        }
+    };
+
+    struct Bc7Fit {
+        int q0[4], q1[4];
+        int p0, p1;
+        uint8_t indices[16];
+        float error;
+    };
+
+    // The 7-bit values nearest an endpoint stored with p-bit p
+    void QuantizeBc7(const float* endpoint, int p, int* q) {
+        for (int c = 0; c < 4; ++c) {
+            q[c] = std::min(std::max(int(std::floor((endpoint[c] - p) * 0.5f + 0.5f)), 0), 127);
+        }
+    }
+
+    float Bc7EndpointError(const float* endpoint, int p) {
+        int q[4];
+        QuantizeBc7(endpoint, p, q);
+        float error = 0;
+        for (int c = 0; c < 4; ++c) {
+            const float d = float((q[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        return error;
+    }
+
+    void Bc7Palette(const int* q0, int p0, const int* q1, int p1, Palette& palette) {
+        for (int c = 0; c < 4; ++c) {
+            const int v0 = (q0[c] << 1) | p0;
+            const int v1 = (q1[c] << 1) | p1;
+            for (int i = 0; i < 16; ++i) {
+                palette.entries[i][c] = float(((64 - BC7_WEIGHTS[i]) * v0 + BC7_WEIGHTS[i] * v1 + 32) >> 6);
+            }
+        }
+        palette.count = 16;
+    }
+
+    void TryBc7(Bc::Implementation implementation, const Block& block, const float* e0, int p0, const float* e1, int p1, Bc7Fit& best) {
+        Bc7Fit fit;
+        fit.p0 = p0;
+        fit.p1 = p1;
+        QuantizeBc7(e0, p0, fit.q0);
+        QuantizeBc7(e1, p1, fit.q1);
+        Palette palette;
+        Bc7Palette(fit.q0, p0, fit.q1, p1, palette);
+        fit.error = SelectIndices(implementation, block, palette, 0, 4, fit.indices);
+        if (fit.error < best.error) {
+            best = fit;
+        }
+    }
+
+    void EncodeBc7(Bc::Implementation implementation, Bc::Quality quality, const Block& block, uint8_t* out) {
+        float mean[4], axis[4], e0[4], e1[4];
+        PrincipalAxis<4>(block, mean, axis);
+        AxisEndpoints<4>(block, mean, axis, e0, e1);
+
+        Bc7Fit best;
+        best.error = FLT_MAX;
+        auto tryEndpoints = [&]() {
+            if (quality == Bc::HIGH) {
+                for (int p = 0; p < 4; ++p) {
+                    TryBc7(implementation, block, e0, p & 1, e1, p >> 1, best);
+                }
+            } else {
+                const int p0 = Bc7EndpointError(e0, 1) < Bc7EndpointError(e0, 0) ? 1 : 0;
+                const int p1 = Bc7EndpointError(e1, 1) < Bc7EndpointError(e1, 0) ? 1 : 0;
+                TryBc7(implementation, block, e0, p0, e1, p1, best);
+            }
+        };
+        tryEndpoints();
+
+        float fractions[16];
+        for (int i = 0; i < 16; ++i) {
+            fractions[i] = BC7_WEIGHTS[i] / 64.f;
+        }
+        for (int r = 0; r < Refinements(quality) && best.error > 0; ++r) {
+            if (!FitEndpoints<4>(block, fractions, best.indices, e0, e1)) {
+                break;
+            }
+            tryEndpoints();
+        }
+
+        // The first index's top bit isn't stored, so it must be clear
+        if (best.indices[0] & 8) {
+            std::swap(best.q0, best.q1);
+            std::swap(best.p0, best.p1);
+            for (int i = 0; i < 16; ++i) {
+                best.indices[i] = static_cast<uint8_t>(15 - best.indices[i]);
+            }
+        }
+
+        memset(out, 0, 16);
+        BitWriter writer = { out, 0 };
+        writer.Put(1 << 6, 7);
+        for (int c = 0; c < 4; ++c) {
+            writer.Put(best.q0[c], 7);
+            writer.Put(best.q1[c], 7);
+        }
+        writer.Put(best.p0, 1);
+        writer.Put(best.p1, 1);
+        writer.Put(best.indices[0], 3);
+        for (int i = 1; i < 16; ++i) {
+            writer.Put(best.indices[i], 4);
+        }
+    }
+
+    // Other modes decode to transparent black, as invalid blocks do
+    void DecodeBc7(const uint8_t* in, uint8_t* pixels) {
+        if ((in[0] & 0x7F) != 0x40) {
+            memset(pixels, 0, 64);
+            return;
+        }
+
+        BitReader reader = { in, 7 };
+        int q0[4], q1[4];
+        for (int c = 0; c < 4; ++c) {
+            q0[c] = reader.Get(7);
+            q1[c] = reader.Get(7);
+        }
+        const int p0 = reader.Get(1);
+        const int p1 = reader.Get(1);
+        Palette palette;
+        Bc7Palette(q0, p0, q1, p1, palette);
+        for (int i = 0; i < 16; ++i) {
+            const uint32_t index = reader.Get(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; ++c) {
+                pixels[4 * i + c] = static_cast<uint8_t>(palette.entries[index][c]);
+            }
+        }
+    }
+
+    bool Supported(Bc::Implementation implementation) {
+        switch (implementation) {
+        case Bc::SCALAR: return true;
+        case Bc::SSE2: return CPU_X86 != 0;
+        case Bc::AVX2: return CPU_X86 && Cpu::GetFeatures().avx2;
+        default: return false;
+        }
+    }
+}
+
+namespace Bc {
+    Implementation Fastest() {
+#if CPU_X86
+        // Every CPU that runs D3D12 has SSE2
+        return Cpu::GetFeatures().avx2 ? AVX2 : SSE2;
+#else
+        return SCALAR;
+#endif
+    }
+
+    const char* Name(Implementation implementation) {
+        switch (implementation) {
+        case SSE2: return "SSE2";
+        case AVX2: return "AVX2";
+        default: return "scalar";
+        }
+    }
+
+    const char* Name(Format format) {
+        switch (format) {
+        case BC1: return "BC1";
+        case BC3: return "BC3";
+        default: return "BC7";
+        }
+    }
+
+    const char* Name(Quality quality) {
+        switch (quality) {
+        case FAST: return "fast";
+        case NORMAL: return "normal";
+        default: return "high";
+        }
+    }
+
+    size_t BlockBytes(Format format) {
+        return format == BC1 ? 8 : 16;
+    }
+
+    size_t EncodedBytes(Format format, uint32_t width, uint32_t height) {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    bool IsOpaque(const uint8_t* pixels, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (pixels[4 * i + 3] != 255) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Encode(Format format, Quality quality, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks, unsigned threadCount,
+        Implementation implementation) {
+        if (!Supported(implementation)) {
+            implementation = Fastest();
+        }
+
+        const uint32_t blocksWide = (width + 3) / 4;
+        const uint32_t blocksHigh = (height + 3) / 4;
+        const size_t blockBytes = BlockBytes(format);
+        Parallel::For(blocksHigh, threadCount, [&](size_t blockY) {
+            uint8_t* out = blocks + blockY * blocksWide * blockBytes;
+            Block block;
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX, out += blockBytes) {
+                LoadBlock(pixels, width, height, blockX, static_cast<uint32_t>(blockY), block);
+                if (format == BC1) {
+                    EncodeColor(implementation, quality, block, out);
+                } else if (format == BC3) {
+                    EncodeAlpha(implementation, quality, block, out);
+                    EncodeColor(implementation, quality, block, out + 8);
+                } else {
+                    EncodeBc7(implementation, quality, block, out);
+                }
+            }
+        });
+    }
+
+    void Decode(Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* pixels) {
+        const uint32_t blocksWide = (width + 3) / 4;
+        const uint32_t blocksHigh = (height + 3) / 4;
+        const size_t blockBytes = BlockBytes(format);
+        for (uint32_t blockY = 0; blockY < blocksHigh; ++blockY) {
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX, blocks += blockBytes) {
+                uint8_t decoded[64];
+                if (format == BC1) {
+                    DecodeColor(blocks, false, decoded);
+                } else if (format == BC3) {
+                    DecodeColor(blocks + 8, true, decoded);
+                    DecodeAlpha(blocks, decoded);
+                } else {
+                    DecodeBc7(blocks, decoded);
+                }
+
+                for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+                    for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+                        memcpy(pixels + ((size_t(blockY) * 4 + y) * width + blockX * 4 + x) * 4, decoded + (y * 4 + x) * 4, 4);
+                    }
+                }
+            }
+        }
+    }
+}
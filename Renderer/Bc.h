@@ -0,0 +1,74 @@
+#pragma once
+
+// Block compression of RGBA8 images to BC1, BC3 and BC7. Portable; no Windows
+// or D3D dependencies.
+//
+// Every format stores 4x4 pixel blocks; blocks hanging over the right or
+// bottom edge repeat the edge pixels. Color endpoints start at the extremes
+// of the block's principal axis, and each refinement solves for the
+// endpoints that best fit the chosen indices by least squares, keeping them
+// only if the block's error drops. Index selection, where most of the time
+// goes, compares pixels against every palette entry 4 or 8 at a time on CPUs
+// with SIMD.
+//
+// BC1 blocks always use the 4-color mode, so BC1 is only for opaque images.
+// BC3's alpha also tries the 6-level mode with exact 0 and 255, which suits
+// cutouts. BC7 blocks all use mode 6: one RGBA line with 16 levels and 7-bit
+// endpoints plus a p-bit each.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Bc {
+    enum Format {
+        // 8 bytes per block: two RGB565 endpoints, 2-bit indices
+        BC1,
+        // 16 bytes per block: BC1 color plus 8-bit alpha endpoints and 3-bit
+        // indices
+        BC3,
+        // 16 bytes per block, see above
+        BC7,
+    };
+
+    enum Quality {
+        // Principal axis extremes only
+        FAST,
+        // One refinement
+        NORMAL,
+        // Two refinements, and BC7 tries every pair of p-bits
+        HIGH,
+    };
+
+    enum Implementation {
+        SCALAR,
+        // 4 pixels at a time
+        SSE2,
+        // 8 pixels at a time
+        AVX2,
+    };
+
+    // The fastest implementation this CPU supports
+    Implementation Fastest();
+    const char* Name(Implementation implementation);
+    const char* Name(Format format);
+    const char* Name(Quality quality);
+
+    size_t BlockBytes(Format format);
+
+    // Size of a width x height image's blocks, row by row
+    size_t EncodedBytes(Format format, uint32_t width, uint32_t height);
+
+    // True if every one of count RGBA8 pixels has alpha 255
+    bool IsOpaque(const uint8_t* pixels, size_t count);
+
+    // Encodes pixels, width x height with rows tightly packed, into blocks,
+    // which holds EncodedBytes(format, width, height). Rows of blocks are
+    // encoded on up to threadCount threads (0 = one per hardware thread).
+    // Every implementation writes the same blocks.
+    void Encode(Format format, Quality quality, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks, unsigned threadCount = 0,
+        Implementation implementation = Fastest());
+
+    // Decodes blocks written by Encode back to RGBA8 pixels. Only BC7's mode
+    // 6 is understood.
+    void Decode(Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* pixels);
+}
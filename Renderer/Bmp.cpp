@@ -0,0 +1,355 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Bmp.h"
+#include "Cpu.h"
+#include "MappedFile.h"
+
+#include <cstring>
+
+namespace {
+    const uint32_t BI_RGB = 0;
+    const uint32_t BI_BITFIELDS = 3;
+
+    const size_t FILE_HEADER_SIZE = 14;
+    const uint32_t CORE_HEADER_SIZE = 12;
+    const uint32_t INFO_HEADER_SIZE = 40;
+
+    // The first header with an alpha mask after the color masks
+    const uint32_t V3_HEADER_SIZE = 56;
+
+    // D3D12's largest texture dimension
+    const int64_t MAX_DIMENSION = 16384;
+
+    uint16_t ReadU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t ReadU32(const uint8_t* p) {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    // Which byte of a 32-bit pixel the mask selects, or -1 if it isn't
+    // exactly one whole byte
+    int MaskByte(uint32_t mask) {
+        for (int b = 0; b < 4; ++b) {
+            if (mask == 0xFFu << (8 * b)) {
+                return b;
+            }
+        }
+        return -1;
+    }
+
+    struct Format {
+        uint32_t bits;
+
+        // 32-bit images: the byte of the source pixel holding each of R, G,
+        // B and A, with -1 for an opaque alpha
+        int channels[4];
+
+        // Palettized images: RGBA8 entries, opaque black past the file's own
+        uint32_t palette[256];
+    };
+
+    // Scalar converters handle the pixels [begin, width) of a row, so they
+    // also finish the rows the SIMD loops stop short of
+    void ConvertPaletteScalar(const uint8_t* in, uint32_t begin, uint32_t width, const Format& format, uint8_t* out) {
+        for (uint32_t x = begin; x < width; ++x) {
+            uint32_t index;
+            if (format.bits == 8) {
+                index = in[x];
+            } else if (format.bits == 4) {
+                index = (in[x >> 1] >> ((x & 1) ? 0 : 4)) & 0xF;
+            } else {
+                index = (in[x >> 3] >> (7 - (x & 7))) & 1;
+            }
+            memcpy(out + 4 * x, &format.palette[index], 4);
+        }
+    }
+
+    void Convert24Scalar(const uint8_t* in, uint32_t begin, uint32_t width, uint8_t* out) {
+        for (uint32_t x = begin; x < width; ++x) {
+            out[4 * x + 0] = in[3 * x + 2];
+            out[4 * x + 1] = in[3 * x + 1];
+            out[4 * x + 2] = in[3 * x + 0];
+            out[4 * x + 3] = 0xFF;
+        }
+    }
+
+    void Convert32Scalar(const uint8_t* in, uint32_t begin, uint32_t width, const Format& format, uint8_t* out) {
+        for (uint32_t x = begin; x < width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                out[4 * x + c] = format.channels[c] < 0 ? 0xFF : in[4 * x + format.channels[c]];
+            }
+        }
+    }
+
+#if CPU_X86
+    // Shuffle control moving each pixel's channels into RGBA order, and the
+    // alpha to OR in afterwards
+    CPU_TARGET("ssse3")
+    void Swizzle32Controls(const Format& format, __m128i& shuffle, __m128i& alpha) {
+        alignas(16) int8_t control[16];
+        for (int p = 0; p < 4; ++p) {
+            for (int c = 0; c < 4; ++c) {
+                control[4 * p + c] = format.channels[c] < 0 ? int8_t(-1) : int8_t(4 * p + format.channels[c]);
+            }
+        }
+        shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(control));
+        alpha = _mm_set1_epi32(format.channels[3] < 0 ? int(0xFF000000) : 0);
+    }
+
+    // Returns the number of pixels converted
+    CPU_TARGET("ssse3")
+    uint32_t Convert24Ssse3(const uint8_t* in, uint32_t width, uint8_t* out) {
+        const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+
+        // Each 16-byte load reads 4 bytes past its 4 pixels, so stop while the
+        // loads still end within the row
+        uint32_t x = 0;
+        for (; x + 6 <= width; x += 4) {
+            const __m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha));
+        }
+        return x;
+    }
+
+    CPU_TARGET("ssse3")
+    uint32_t Convert32Ssse3(const uint8_t* in, uint32_t width, const Format& format, uint8_t* out) {
+        __m128i shuffle, alpha;
+        Swizzle32Controls(format, shuffle, alpha);
+
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+        }
+        return x;
+    }
+
+    // Two overlapping loads put 4 pixels in each 128-bit lane, which
+    // VPSHUFB shuffles separately
+    CPU_TARGET("avx2")
+    uint32_t Convert24Avx2(const uint8_t* in, uint32_t width, uint8_t* out) {
+        const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+            2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m256i alpha = _mm256_set1_epi32(int(0xFF000000));
+
+        uint32_t x = 0;
+        for (; x + 10 <= width; x += 8) {
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * x));
+            const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * x + 12));
+            const __m256i bgr = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), _mm256_or_si256(_mm256_shuffle_epi8(bgr, shuffle), alpha));
+        }
+        return x;
+    }
+
+    CPU_TARGET("avx2")
+    uint32_t Convert32Avx2(const uint8_t* in, uint32_t width, const Format& format, uint8_t* out) {
+        __m128i shuffle128, alpha128;
+        Swizzle32Controls(format, shuffle128, alpha128);
+        const __m256i shuffle = _mm256_broadcastsi128_si256(shuffle128);
+        const __m256i alpha = _mm256_broadcastsi128_si256(alpha128);
+
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * x));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+        }
+        return x;
+    }
+
+    CPU_TARGET("avx2")
+    uint32_t ConvertPalette8Avx2(const uint8_t* in, uint32_t width, const Format& format, uint8_t* out) {
+        const int* palette = reinterpret_cast<const int*>(format.palette);
+
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + x)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), _mm256_i32gather_epi32(palette, indices, 4));
+        }
+        return x;
+    }
+#endif
+
+    void ConvertRow(Bmp::Implementation implementation, const Format& format, const uint8_t* in, uint32_t width, uint8_t* out) {
+        uint32_t done = 0;
+#if CPU_X86
+        if (implementation == Bmp::AVX2) {
+            if (format.bits == 24) {
+                done = Convert24Avx2(in, width, out);
+            } else if (format.bits == 32) {
+                done = Convert32Avx2(in, width, format, out);
+            } else if (format.bits == 8) {
+                done = ConvertPalette8Avx2(in, width, format, out);
+            }
+        } else if (implementation == Bmp::SSSE3) {
+            if (format.bits == 24) {
+                done = Convert24Ssse3(in, width, out);
+            } else if (format.bits == 32) {
+                done = Convert32Ssse3(in, width, format, out);
+            }
+        }
+#else
+        (void)implementation;
+#endif
+
+        if (format.bits == 24) {
+            Convert24Scalar(in, done, width, out);
+        } else if (format.bits == 32) {
+            Convert32Scalar(in, done, width, format, out);
+        } else {
+            ConvertPaletteScalar(in, done, width, format, out);
+        }
+    }
+}
+
+namespace Bmp {
+    Implementation Fastest() {
+        const Cpu::Features& features = Cpu::GetFeatures();
+        if (features.avx2) {
+            return AVX2;
+        }
+        // SSE4.2 implies SSSE3
+        return features.sse42 ? SSSE3 : SCALAR;
+    }
+
+    const char* Name(Implementation implementation) {
+        switch (implementation) {
+        case SSSE3: return "SSSE3";
+        case AVX2: return "AVX2";
+        default: return "scalar";
+        }
+    }
+
+    bool Decode(const void* data, size_t size, Image& image, Implementation implementation) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        if (size < FILE_HEADER_SIZE + CORE_HEADER_SIZE || bytes[0] != 'B' || bytes[1] != 'M') {
+            return false;
+        }
+
+        // The file header's size field is often wrong, so only the pixel
+        // offset is taken from it
+        const uint32_t pixelOffset = ReadU32(bytes + 10);
+        const uint8_t* header = bytes + FILE_HEADER_SIZE;
+        const uint32_t headerSize = ReadU32(header);
+        if (headerSize > size - FILE_HEADER_SIZE) {
+            return false;
+        }
+
+        Format format = {};
+        int64_t width, height;
+        uint32_t planes, compression, paletteCount;
+        size_t paletteEntrySize;
+        if (headerSize == CORE_HEADER_SIZE) {
+            width = ReadU16(header + 4);
+            height = ReadU16(header + 6);
+            planes = ReadU16(header + 8);
+            format.bits = ReadU16(header + 10);
+            compression = BI_RGB;
+            paletteCount = 0;
+            paletteEntrySize = 3;
+        } else if (headerSize >= INFO_HEADER_SIZE) {
+            width = static_cast<int32_t>(ReadU32(header + 4));
+            height = static_cast<int32_t>(ReadU32(header + 8));
+            planes = ReadU16(header + 12);
+            format.bits = ReadU16(header + 14);
+            compression = ReadU32(header + 16);
+            paletteCount = ReadU32(header + 32);
+            paletteEntrySize = 4;
+        } else {
+            return false;
+        }
+
+        // Negative heights store the top row first
+        const bool topDown = height < 0;
+        height = topDown ? -height : height;
+        if (planes != 1 || width <= 0 || height <= 0 || width > MAX_DIMENSION || height > MAX_DIMENSION) {
+            return false;
+        }
+
+        if (format.bits == 32) {
+            format.channels[0] = 2;
+            format.channels[1] = 1;
+            format.channels[2] = 0;
+            format.channels[3] = -1;
+
+            // The masks follow a BITMAPINFOHEADER, and later headers hold
+            // them in the same place
+            if (compression == BI_BITFIELDS) {
+                const size_t maskEnd = FILE_HEADER_SIZE + INFO_HEADER_SIZE + (headerSize >= V3_HEADER_SIZE ? 16 : 12);
+                if (maskEnd > size) {
+                    return false;
+                }
+                const uint8_t* masks = header + INFO_HEADER_SIZE;
+                for (int c = 0; c < 3; ++c) {
+                    format.channels[c] = MaskByte(ReadU32(masks + 4 * c));
+                }
+                const uint32_t alphaMask = headerSize >= V3_HEADER_SIZE ? ReadU32(masks + 12) : 0;
+                format.channels[3] = alphaMask ? MaskByte(alphaMask) : -1;
+
+                const bool distinct = format.channels[0] != format.channels[1] && format.channels[0] != format.channels[2] &&
+                    format.channels[1] != format.channels[2];
+                if (format.channels[0] < 0 || format.channels[1] < 0 || format.channels[2] < 0 || !distinct || (alphaMask && format.channels[3] < 0)) {
+                    return false;
+                }
+            } else if (compression != BI_RGB) {
+                return false;
+            }
+        } else if (format.bits == 24) {
+            if (compression != BI_RGB) {
+                return false;
+            }
+        } else if (format.bits == 1 || format.bits == 4 || format.bits == 8) {
+            if (compression != BI_RGB) {
+                return false;
+            }
+
+            const uint32_t maxEntries = 1u << format.bits;
+            const uint32_t entries = paletteCount == 0 || paletteCount > maxEntries ? maxEntries : paletteCount;
+            const size_t paletteOffset = FILE_HEADER_SIZE + headerSize;
+            if (paletteOffset + entries * paletteEntrySize > size) {
+                return false;
+            }
+
+            const uint8_t opaqueBlack[4] = { 0, 0, 0, 0xFF };
+            for (uint32_t i = 0; i < 256; ++i) {
+                memcpy(&format.palette[i], opaqueBlack, 4);
+            }
+            for (uint32_t i = 0; i < entries; ++i) {
+                const uint8_t* entry = bytes + paletteOffset + i * paletteEntrySize;
+                const uint8_t rgba[4] = { entry[2], entry[1], entry[0], 0xFF };
+                memcpy(&format.palette[i], rgba, 4);
+            }
+        } else {
+            return false;
+        }
+
+        // Rows are padded to 4 bytes, except that the last one needn't be
+        const uint64_t rowBytes = (uint64_t(width) * format.bits + 7) / 8;
+        const uint64_t stride = (uint64_t(width) * format.bits + 31) / 32 * 4;
+        if (pixelOffset > size || stride * (height - 1) + rowBytes > size - pixelOffset) {
+            return false;
+        }
+
+        if (implementation > Fastest()) {
+            implementation = Fastest();
+        }
+
+        image.width = static_cast<uint32_t>(width);
+        image.height = static_cast<uint32_t>(height);
+        image.pixels.resize(size_t(width) * height * 4);
+        for (int64_t row = 0; row < height; ++row) {
+            const uint8_t* in = bytes + pixelOffset + stride * row;
+            const int64_t y = topDown ? row : height - 1 - row;
+            ConvertRow(implementation, format, in, image.width, &image.pixels[size_t(y) * image.width * 4]);
+        }
+        return true;
+    }
+
+    bool Load(const std::string& fname, Image& image, Implementation implementation) {
+        MappedFile file;
+        return file.Open(fname) && Decode(file.Data(), file.Size(), image, implementation);
+    }
+}
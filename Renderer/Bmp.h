@@ -0,0 +1,48 @@
+#pragma once
+
+// Decoder for uncompressed Windows bitmaps (.bmp). Portable; no Windows or
+// D3D dependencies.
+//
+// Handles what image editors write without compression: 1, 4 and 8-bit
+// palettized, 24-bit BGR and 32-bit BGRX or BGRA images, bottom-up or
+// top-down, with BITMAPCOREHEADER through BITMAPV5HEADER headers. 32-bit
+// images may use BI_BITFIELDS as long as every mask covers one whole byte.
+// Whole rows are converted to RGBA8 at a time, with byte shuffles on CPUs
+// that have them.
+//
+// Alpha follows GDI+: only a 32-bit image whose header gives an alpha mask
+// has alpha, and every other pixel is opaque.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bmp {
+    enum Implementation {
+        SCALAR,
+        // PSHUFB swizzles 4 pixels at a time
+        SSSE3,
+        // As SSSE3, 8 pixels at a time, and palette lookups are gathered
+        AVX2,
+    };
+
+    // The fastest implementation this CPU supports
+    Implementation Fastest();
+    const char* Name(Implementation implementation);
+
+    struct Image {
+        uint32_t width;
+        uint32_t height;
+
+        // width * 4 bytes per row, top row first
+        std::vector<uint8_t> pixels;
+    };
+
+    // Returns false if the data isn't a bitmap in one of the formats above or
+    // is too short for the pixels its header describes
+    bool Decode(const void* data, size_t size, Image& image, Implementation implementation = Fastest());
+
+    // Maps the file and decodes it
+    bool Load(const std::string& fname, Image& image, Implementation implementation = Fastest());
+}
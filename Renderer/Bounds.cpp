@@ -0,0 +1,287 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Bounds.h"
+#include "Cpu.h"
+
+#include <cmath>
+
+namespace {
+    // Position i of a plain array
+    struct Sequential {
+        const char* positions;
+        size_t stride;
+
+        const float* operator()(size_t i) const {
+            return reinterpret_cast<const float*>(positions + i * stride);
+        }
+    };
+
+    // Position of index i
+    template <typename Index>
+    struct Indexed {
+        const Index* indices;
+        const char* positions;
+        size_t stride;
+
+        const float* operator()(size_t i) const {
+            return reinterpret_cast<const float*>(positions + indices[i] * stride);
+        }
+    };
+
+    float DistanceSquared(const float* p, const float center[3]) {
+        const float dx = p[0] - center[0];
+        const float dy = p[1] - center[1];
+        const float dz = p[2] - center[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Moves and widens the sphere just enough to take in p as well as all of
+    // the old sphere
+    void Enclose(const float* p, float center[3], float& radius) {
+        const float distance = sqrtf(DistanceSquared(p, center));
+        if (distance > radius) {
+            const float grown = (radius + distance) * 0.5f;
+            const float t = (grown - radius) / distance;
+            for (int axis = 0; axis < 3; ++axis) {
+                center[axis] += (p[axis] - center[axis]) * t;
+            }
+            radius = grown;
+        }
+    }
+
+#if CPU_X86
+    // SSE2 is part of x64, so these need no feature check
+
+    // x, y and z in the low lanes. Needs only float alignment and never reads
+    // past z, so the last position of a tightly packed array is safe to load
+    inline __m128 Load3(const float* p) {
+        const __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+        return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+    }
+
+    inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    // Squared distances of four transposed points from a center
+    inline __m128 DistanceSquared4(__m128 x, __m128 y, __m128 z, __m128 cx, __m128 cy, __m128 cz) {
+        const __m128 dx = _mm_sub_ps(x, cx);
+        const __m128 dy = _mm_sub_ps(y, cy);
+        const __m128 dz = _mm_sub_ps(z, cz);
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    }
+
+    inline float HorizontalMax(__m128 v) {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+#endif
+
+    // Finds the box along with, per axis, the index of a point with the
+    // smallest and of one with the largest coordinate. count must be nonzero.
+    template <typename Fetch>
+    void FindExtremes(const Fetch& fetch, size_t count, float min[3], float max[3], size_t minPoint[3], size_t maxPoint[3]) {
+#if CPU_X86
+        // Each lane tracks one axis. Even and odd points go to separate
+        // accumulators so consecutive iterations don't wait on each other.
+        __m128 low[2], high[2];
+        __m128i lowIndex[2], highIndex[2];
+        for (int k = 0; k < 2; ++k) {
+            low[k] = high[k] = Load3(fetch(0));
+            lowIndex[k] = highIndex[k] = _mm_setzero_si128();
+        }
+
+        size_t i = 1;
+        for (; i + 2 <= count; i += 2) {
+            for (int k = 0; k < 2; ++k) {
+                const __m128 p = Load3(fetch(i + k));
+                const __m128i index = _mm_set1_epi32(static_cast<int>(i + k));
+                lowIndex[k] = Select(_mm_castps_si128(_mm_cmplt_ps(p, low[k])), index, lowIndex[k]);
+                highIndex[k] = Select(_mm_castps_si128(_mm_cmpgt_ps(p, high[k])), index, highIndex[k]);
+                low[k] = _mm_min_ps(low[k], p);
+                high[k] = _mm_max_ps(high[k], p);
+            }
+        }
+        if (i < count) {
+            const __m128 p = Load3(fetch(i));
+            const __m128i index = _mm_set1_epi32(static_cast<int>(i));
+            lowIndex[0] = Select(_mm_castps_si128(_mm_cmplt_ps(p, low[0])), index, lowIndex[0]);
+            highIndex[0] = Select(_mm_castps_si128(_mm_cmpgt_ps(p, high[0])), index, highIndex[0]);
+            low[0] = _mm_min_ps(low[0], p);
+            high[0] = _mm_max_ps(high[0], p);
+        }
+
+        lowIndex[0] = Select(_mm_castps_si128(_mm_cmplt_ps(low[1], low[0])), lowIndex[1], lowIndex[0]);
+        highIndex[0] = Select(_mm_castps_si128(_mm_cmpgt_ps(high[1], high[0])), highIndex[1], highIndex[0]);
+        low[0] = _mm_min_ps(low[0], low[1]);
+        high[0] = _mm_max_ps(high[0], high[1]);
+
+        float lows[4], highs[4];
+        int32_t lowIndices[4], highIndices[4];
+        _mm_storeu_ps(lows, low[0]);
+        _mm_storeu_ps(highs, high[0]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lowIndices), lowIndex[0]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(highIndices), highIndex[0]);
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = lows[axis];
+            max[axis] = highs[axis];
+            minPoint[axis] = static_cast<uint32_t>(lowIndices[axis]);
+            maxPoint[axis] = static_cast<uint32_t>(highIndices[axis]);
+        }
+#else
+        const float* first = fetch(0);
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = max[axis] = first[axis];
+            minPoint[axis] = maxPoint[axis] = 0;
+        }
+        for (size_t i = 1; i < count; ++i) {
+            const float* p = fetch(i);
+            for (int axis = 0; axis < 3; ++axis) {
+                if (p[axis] < min[axis]) {
+                    min[axis] = p[axis];
+                    minPoint[axis] = i;
+                }
+                if (p[axis] > max[axis]) {
+                    max[axis] = p[axis];
+                    maxPoint[axis] = i;
+                }
+            }
+        }
+#endif
+    }
+
+    // Grows the sphere until it holds every point
+    template <typename Fetch>
+    void GrowSphere(const Fetch& fetch, size_t count, float center[3], float& radius) {
+        size_t i = 0;
+#if CPU_X86
+        __m128 cx = _mm_set1_ps(center[0]);
+        __m128 cy = _mm_set1_ps(center[1]);
+        __m128 cz = _mm_set1_ps(center[2]);
+        __m128 radiusSquared = _mm_set1_ps(radius * radius);
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = Load3(fetch(i + 0));
+            __m128 y = Load3(fetch(i + 1));
+            __m128 z = Load3(fetch(i + 2));
+            __m128 w = Load3(fetch(i + 3));
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            const int outside = _mm_movemask_ps(_mm_cmpgt_ps(DistanceSquared4(x, y, z, cx, cy, cz), radiusSquared));
+            if (outside == 0) {
+                continue;
+            }
+
+            // The grown sphere contains the old one, so only the points found
+            // outside it need another look
+            for (int k = 0; k < 4; ++k) {
+                if (outside & (1 << k)) {
+                    Enclose(fetch(i + k), center, radius);
+                }
+            }
+            cx = _mm_set1_ps(center[0]);
+            cy = _mm_set1_ps(center[1]);
+            cz = _mm_set1_ps(center[2]);
+            radiusSquared = _mm_set1_ps(radius * radius);
+        }
+#endif
+        for (; i < count; ++i) {
+            Enclose(fetch(i), center, radius);
+        }
+    }
+
+    // Largest squared distance of any point from each of two centers
+    template <typename Fetch>
+    void FarthestFrom(const Fetch& fetch, size_t count, const float a[3], const float b[3], float& farthestA, float& farthestB) {
+        farthestA = 0.f;
+        farthestB = 0.f;
+        size_t i = 0;
+#if CPU_X86
+        const __m128 ax = _mm_set1_ps(a[0]), ay = _mm_set1_ps(a[1]), az = _mm_set1_ps(a[2]);
+        const __m128 bx = _mm_set1_ps(b[0]), by = _mm_set1_ps(b[1]), bz = _mm_set1_ps(b[2]);
+        __m128 maxA = _mm_setzero_ps();
+        __m128 maxB = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = Load3(fetch(i + 0));
+            __m128 y = Load3(fetch(i + 1));
+            __m128 z = Load3(fetch(i + 2));
+            __m128 w = Load3(fetch(i + 3));
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            maxA = _mm_max_ps(maxA, DistanceSquared4(x, y, z, ax, ay, az));
+            maxB = _mm_max_ps(maxB, DistanceSquared4(x, y, z, bx, by, bz));
+        }
+        farthestA = HorizontalMax(maxA);
+        farthestB = HorizontalMax(maxB);
+#endif
+        for (; i < count; ++i) {
+            const float* p = fetch(i);
+            const float distanceA = DistanceSquared(p, a);
+            const float distanceB = DistanceSquared(p, b);
+            farthestA = distanceA > farthestA ? distanceA : farthestA;
+            farthestB = distanceB > farthestB ? distanceB : farthestB;
+        }
+    }
+
+    template <typename Fetch>
+    void ComputeVolume(const Fetch& fetch, size_t count, Bounds::Volume& volume) {
+        volume = Bounds::Volume();
+        if (count == 0) {
+            return;
+        }
+
+        size_t minPoint[3], maxPoint[3];
+        FindExtremes(fetch, count, volume.min, volume.max, minPoint, maxPoint);
+
+        // Seed with the axis whose extreme points are farthest apart
+        int widest = 0;
+        float widestSquared = -1.f;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float* low = fetch(minPoint[axis]);
+            const float d = DistanceSquared(fetch(maxPoint[axis]), low);
+            if (d > widestSquared) {
+                widestSquared = d;
+                widest = axis;
+            }
+        }
+        const float* a = fetch(minPoint[widest]);
+        const float* b = fetch(maxPoint[widest]);
+        float center[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            center[axis] = (a[axis] + b[axis]) * 0.5f;
+        }
+        float radius = sqrtf(widestSquared) * 0.5f;
+        GrowSphere(fetch, count, center, radius);
+
+        // Ritter's radius only ever grows, so it can overshoot; the measured
+        // farthest point gives the tightest radius for its center
+        float boxCenter[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            boxCenter[axis] = (volume.min[axis] + volume.max[axis]) * 0.5f;
+        }
+        float grownSquared, boxSquared;
+        FarthestFrom(fetch, count, center, boxCenter, grownSquared, boxSquared);
+
+        const bool useBox = boxSquared < grownSquared;
+        for (int axis = 0; axis < 3; ++axis) {
+            volume.center[axis] = useBox ? boxCenter[axis] : center[axis];
+        }
+        volume.radius = sqrtf(useBox ? boxSquared : grownSquared);
+    }
+}
+
+namespace Bounds {
+    void Compute(const float* positions, size_t count, size_t positionStride, Volume& volume) {
+        const Sequential fetch = { reinterpret_cast<const char*>(positions), positionStride };
+        ComputeVolume(fetch, count, volume);
+    }
+
+    void Compute(const uint16_t* indices, size_t indexCount, const float* positions, size_t positionStride, Volume& volume) {
+        const Indexed<uint16_t> fetch = { indices, reinterpret_cast<const char*>(positions), positionStride };
+        ComputeVolume(fetch, indexCount, volume);
+    }
+
+    void Compute(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, Volume& volume) {
+        const Indexed<uint32_t> fetch = { indices, reinterpret_cast<const char*>(positions), positionStride };
+        ComputeVolume(fetch, indexCount, volume);
+    }
+}
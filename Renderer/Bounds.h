@@ -0,0 +1,33 @@
+#pragma once
+
+// Bounding volumes of point sets. Portable; no Windows or D3D dependencies.
+//
+// One pass finds the box along with the points that are extreme on each axis.
+// The widest of those pairs seeds a sphere that a second pass grows to take in
+// every point (Ritter's method). Most points already lie inside, so the SSE2
+// path tests four at a time and only grows for the rare ones outside. A last
+// pass measures the true farthest distance from that sphere's center and from
+// the box center and keeps whichever sphere is smaller, so the sphere is never
+// looser than the one around the box.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Bounds {
+    struct Volume {
+        float min[3];
+        float max[3];
+
+        // Bounding sphere
+        float center[3];
+        float radius;
+    };
+
+    // Bounds of count positions, positionStride bytes apart. An empty set gets
+    // an all-zero volume.
+    void Compute(const float* positions, size_t count, size_t positionStride, Volume& volume);
+
+    // Bounds of the positions referenced by indices[0, indexCount)
+    void Compute(const uint16_t* indices, size_t indexCount, const float* positions, size_t positionStride, Volume& volume);
+    void Compute(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, Volume& volume);
+}
@@ -0,0 +1,152 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Chunks.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    const float* LoadPosition(const float* positions, size_t stride, uint32_t index) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * stride);
+    }
+
+    // A run of the triangle order still to be split
+    struct Node {
+        size_t begin;
+        size_t end;
+    };
+}
+
+namespace Chunks {
+    void Partition(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t targetTriangles,
+        std::vector<uint32_t>& triangleChunks, std::vector<Chunk>& chunks) {
+        const size_t triangleCount = indexCount / 3;
+        triangleChunks.assign(triangleCount, 0);
+        chunks.clear();
+        if (triangleCount == 0) {
+            return;
+        }
+        targetTriangles = std::max(targetTriangles, static_cast<size_t>(1));
+
+        std::vector<float> centroids(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const float* a = LoadPosition(positions, positionStride, indices[3 * t + 0]);
+            const float* b = LoadPosition(positions, positionStride, indices[3 * t + 1]);
+            const float* c = LoadPosition(positions, positionStride, indices[3 * t + 2]);
+            for (int axis = 0; axis < 3; ++axis) {
+                centroids[3 * t + axis] = (a[axis] + b[axis] + c[axis]) * (1.f / 3.f);
+            }
+        }
+
+        std::vector<uint32_t> order(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            order[t] = static_cast<uint32_t>(t);
+        }
+
+        // Depth first, left child first, so chunks come out in tree order
+        std::vector<Node> stack;
+        stack.push_back({ 0, triangleCount });
+        while (!stack.empty()) {
+            const Node node = stack.back();
+            stack.pop_back();
+
+            if (node.end - node.begin <= targetTriangles) {
+                Chunk chunk;
+                for (int axis = 0; axis < 3; ++axis) {
+                    chunk.min[axis] = FLT_MAX;
+                    chunk.max[axis] = -FLT_MAX;
+                }
+                chunk.triangleCount = static_cast<uint32_t>(node.end - node.begin);
+
+                const uint32_t id = static_cast<uint32_t>(chunks.size());
+                for (size_t i = node.begin; i < node.end; ++i) {
+                    const uint32_t t = order[i];
+                    triangleChunks[t] = id;
+                    for (size_t k = 0; k < 3; ++k) {
+                        const float* p = LoadPosition(positions, positionStride, indices[3 * t + k]);
+                        for (int axis = 0; axis < 3; ++axis) {
+                            chunk.min[axis] = std::min(chunk.min[axis], p[axis]);
+                            chunk.max[axis] = std::max(chunk.max[axis], p[axis]);
+                        }
+                    }
+                }
+                chunks.push_back(chunk);
+                continue;
+            }
+
+            float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            for (size_t i = node.begin; i < node.end; ++i) {
+                const float* centroid = &centroids[3 * order[i]];
+                for (int axis = 0; axis < 3; ++axis) {
+                    low[axis] = std::min(low[axis], centroid[axis]);
+                    high[axis] = std::max(high[axis], centroid[axis]);
+                }
+            }
+
+            int axis = 0;
+            for (int a = 1; a < 3; ++a) {
+                if (high[a] - low[a] > high[axis] - low[axis]) {
+                    axis = a;
+                }
+            }
+
+            // Median split, so both halves shrink even when centroids coincide
+            const size_t middle = node.begin + (node.end - node.begin) / 2;
+            std::nth_element(order.begin() + node.begin, order.begin() + middle, order.begin() + node.end, [&](uint32_t lhs, uint32_t rhs) {
+                return centroids[3 * lhs + axis] < centroids[3 * rhs + axis];
+            });
+
+            stack.push_back({ middle, node.end });
+            stack.push_back({ node.begin, middle });
+        }
+    }
+
+    void Split(uint32_t* indices, const Range* ranges, size_t rangeCount, const std::vector<uint32_t>& triangleChunks, size_t chunkCount,
+        std::vector<Piece>& pieces) {
+        std::vector<uint32_t> counts(chunkCount);
+        std::vector<uint32_t> cursor(chunkCount);
+        std::vector<uint32_t> sorted;
+        for (size_t r = 0; r < rangeCount; ++r) {
+            const Range& range = ranges[r];
+            const uint32_t firstTriangle = range.indexStart / 3;
+            const uint32_t triangleCount = range.indexCount / 3;
+
+            // Counting sort of the range's triangles by chunk
+            std::fill(counts.begin(), counts.end(), 0);
+            for (uint32_t t = 0; t < triangleCount; ++t) {
+                counts[triangleChunks[firstTriangle + t]]++;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t c = 0; c < chunkCount; ++c) {
+                cursor[c] = offset;
+                if (counts[c] > 0) {
+                    pieces.push_back({ static_cast<uint32_t>(r), c, range.indexStart + 3 * offset, 3 * counts[c] });
+                }
+                offset += counts[c];
+            }
+
+            sorted.resize(range.indexCount);
+            for (uint32_t t = 0; t < triangleCount; ++t) {
+                const uint32_t destination = cursor[triangleChunks[firstTriangle + t]]++;
+                std::copy(&indices[range.indexStart + 3 * t], &indices[range.indexStart + 3 * t] + 3, &sorted[3 * destination]);
+            }
+            std::copy(sorted.begin(), sorted.end(), indices + range.indexStart);
+        }
+    }
+
+    bool IsVisible(const Chunk& chunk, const Meshlets::Frustum& frustum) {
+        for (int p = 0; p < 6; ++p) {
+            // The box corner furthest along the plane normal
+            const float* plane = frustum.planes[p];
+            const float x = plane[0] >= 0.f ? chunk.max[0] : chunk.min[0];
+            const float y = plane[1] >= 0.f ? chunk.max[1] : chunk.min[1];
+            const float z = plane[2] >= 0.f ? chunk.max[2] : chunk.min[2];
+            if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.f) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Spatial partitioning of large meshes into chunks for coarse culling.
+// Portable; no Windows or D3D dependencies.
+//
+// A mesh the size of a level is always at least partly in view, so culling it
+// as one object never helps. Chunking splits its triangles with a k-d tree
+// over their centroids, halving at the median along the longest axis until
+// each leaf has at most the target number of triangles. Leaves are numbered in
+// tree order, so neighbouring chunks are usually near each other.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Meshlets.h"
+
+namespace Chunks {
+    struct Chunk {
+        // Bounds of the chunk's triangles, not just their centroids
+        float min[3];
+        float max[3];
+        uint32_t triangleCount;
+    };
+
+    // Assigns each triangle of indices[0, indexCount) to a chunk, writing
+    // triangleChunks[t] for triangle t and replacing chunks. Meshes with at
+    // most targetTriangles triangles become a single chunk.
+    void Partition(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t targetTriangles,
+        std::vector<uint32_t>& triangleChunks, std::vector<Chunk>& chunks);
+
+    // A run of the index buffer, such as one material's submesh
+    struct Range {
+        uint32_t indexStart;
+        uint32_t indexCount;
+    };
+
+    // The triangles of one range that lie in one chunk
+    struct Piece {
+        uint32_t range;
+        uint32_t chunk;
+        uint32_t indexStart;
+        uint32_t indexCount;
+    };
+
+    // Sorts each range's triangles by chunk in place and appends a piece for
+    // every chunk a range has triangles in, in range order and then chunk
+    // order. Triangles never leave their range, so pieces never mix
+    // materials. triangleChunks is Partition's output for the whole index
+    // buffer, and ranges hold whole triangles.
+    void Split(uint32_t* indices, const Range* ranges, size_t rangeCount, const std::vector<uint32_t>& triangleChunks, size_t chunkCount,
+        std::vector<Piece>& pieces);
+
+    // Conservative: false only if the chunk's box is entirely outside one of
+    // the frustum planes
+    bool IsVisible(const Chunk& chunk, const Meshlets::Frustum& frustum);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Runtime CPU feature detection for code with SIMD variants. Portable; no
+// Windows dependencies.
+//
+// MSVC compiles any intrinsic regardless of /arch, so SIMD variants are only
+// ever run after checking the features here. GCC and Clang additionally need
+// each such function marked with CPU_TARGET.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#else
+#define CPU_X86 0
+#endif
+
+// NEON is part of AArch64, so it never needs detecting
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define CPU_ARM64 1
+#include <arm_neon.h>
+#else
+#define CPU_ARM64 0
+#endif
+
+#if defined(__GNUC__)
+#define CPU_TARGET(extensions) __attribute__((target(extensions)))
+#else
+#define CPU_TARGET(extensions)
+#endif
+
+namespace Cpu {
+    struct Features {
+        // SSE4.2 implies SSSE3 and SSE4.1
+        bool sse42;
+        // AVX2 with OS support for the YMM registers
+        bool avx2;
+    };
+
+    inline Features Detect() {
+        Features features = {};
+#if CPU_X86 && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        features.sse42 = (info[2] & (1 << 20)) != 0;
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        const bool avx = (info[2] & (1 << 28)) != 0 && osSavesYmm;
+
+        if (maxLeaf >= 7) {
+            __cpuidex(info, 7, 0);
+            features.avx2 = avx && (info[1] & (1 << 5)) != 0;
+        }
+#elif CPU_X86
+        features.sse42 = __builtin_cpu_supports("sse4.2") != 0;
+        features.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+        return features;
+    }
+
+    // Detected once, on first use
+    inline const Features& GetFeatures() {
+        static const Features features = Detect();
+        return features;
+    }
+}
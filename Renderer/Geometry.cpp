@@ -0,0 +1,580 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Geometry.h"
+#include "Cpu.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+    // Triangles or vertices a thread takes at a time; a multiple of every width
+    const size_t BLOCK = 4096;
+
+    // What the triangle kernels read. stride is in floats.
+    struct Triangles {
+        // Null for consecutive corners
+        const uint32_t* indices;
+        const float* positions;
+        const float* texCoords;
+        size_t stride;
+    };
+
+    // Vertex index of corner k of triangle t
+    inline size_t Corner(const Triangles& mesh, size_t t, size_t k) {
+        return mesh.indices ? mesh.indices[3 * t + k] : 3 * t + k;
+    }
+
+    template <typename Fn>
+    void ForBlocks(size_t count, unsigned threadCount, Fn fn) {
+        Parallel::For((count + BLOCK - 1) / BLOCK, threadCount, [&](size_t block) {
+            const size_t first = block * BLOCK;
+            fn(first, std::min(BLOCK, count - first));
+        });
+    }
+
+    // Triangles around each vertex: vertex v's are triangles[start[v], start[v + 1]),
+    // in increasing order
+    struct Adjacency {
+        std::vector<uint32_t> start;
+        std::vector<uint32_t> triangles;
+    };
+
+    void BuildAdjacency(const Triangles& mesh, size_t triangleCount, size_t vertexCount, Adjacency& adjacency) {
+        adjacency.start.assign(vertexCount + 1, 0);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                adjacency.start[Corner(mesh, t, k) + 1]++;
+            }
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacency.start[v + 1] += adjacency.start[v];
+        }
+
+        adjacency.triangles.resize(3 * triangleCount);
+        std::vector<uint32_t> cursor(adjacency.start.begin(), adjacency.start.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                adjacency.triangles[cursor[Corner(mesh, t, k)]++] = static_cast<uint32_t>(t);
+            }
+        }
+    }
+
+    // Sets each vertex in [first, first + count) to the sum of its triangles'
+    // values
+    void SumAroundVertices(const Adjacency& adjacency, const float* tx, const float* ty, const float* tz, size_t first, size_t count,
+        float* x, float* y, float* z) {
+        for (size_t v = first; v < first + count; ++v) {
+            float sumX = 0.f, sumY = 0.f, sumZ = 0.f;
+            for (uint32_t a = adjacency.start[v]; a < adjacency.start[v + 1]; ++a) {
+                const uint32_t t = adjacency.triangles[a];
+                sumX += tx[t];
+                sumY += ty[t];
+                sumZ += tz[t];
+            }
+            x[v] = sumX;
+            y[v] = sumY;
+            z[v] = sumZ;
+        }
+    }
+
+    // Scalar kernels; the SIMD ones finish their tails with these
+
+    void FaceNormalsScalar(const Triangles& mesh, size_t first, size_t count, float* nx, float* ny, float* nz) {
+        for (size_t t = first; t < first + count; ++t) {
+            const float* a = mesh.positions + Corner(mesh, t, 0) * mesh.stride;
+            const float* b = mesh.positions + Corner(mesh, t, 1) * mesh.stride;
+            const float* c = mesh.positions + Corner(mesh, t, 2) * mesh.stride;
+            const float s1x = a[0] - b[0], s1y = a[1] - b[1], s1z = a[2] - b[2];
+            const float s2x = c[0] - b[0], s2y = c[1] - b[1], s2z = c[2] - b[2];
+            nx[t] = s2y * s1z - s2z * s1y;
+            ny[t] = s2z * s1x - s2x * s1z;
+            nz[t] = s2x * s1y - s2y * s1x;
+        }
+    }
+
+    // Directions of increasing u (s) and v (t) across each triangle. Scaling
+    // by |det| instead of dividing by det weighs each triangle by its tex
+    // coord area and keeps degenerate mappings finite.
+    void TriangleTangentsScalar(const Triangles& mesh, size_t first, size_t count, float* sx, float* sy, float* sz, float* tx, float* ty, float* tz) {
+        for (size_t t = first; t < first + count; ++t) {
+            const size_t a = Corner(mesh, t, 0) * mesh.stride;
+            const size_t b = Corner(mesh, t, 1) * mesh.stride;
+            const size_t c = Corner(mesh, t, 2) * mesh.stride;
+            const float* pa = mesh.positions + a;
+            const float* pb = mesh.positions + b;
+            const float* pc = mesh.positions + c;
+            const float e1x = pb[0] - pa[0], e1y = pb[1] - pa[1], e1z = pb[2] - pa[2];
+            const float e2x = pc[0] - pa[0], e2y = pc[1] - pa[1], e2z = pc[2] - pa[2];
+            const float du1 = mesh.texCoords[b] - mesh.texCoords[a], dv1 = mesh.texCoords[b + 1] - mesh.texCoords[a + 1];
+            const float du2 = mesh.texCoords[c] - mesh.texCoords[a], dv2 = mesh.texCoords[c + 1] - mesh.texCoords[a + 1];
+            const float det = du1 * dv2 - du2 * dv1;
+            const float sign = std::signbit(det) ? -1.f : 1.f;
+            sx[t] = (e1x * dv2 - e2x * dv1) * sign;
+            sy[t] = (e1y * dv2 - e2y * dv1) * sign;
+            sz[t] = (e1z * dv2 - e2z * dv1) * sign;
+            tx[t] = (e2x * du1 - e1x * du2) * sign;
+            ty[t] = (e2y * du1 - e1y * du2) * sign;
+            tz[t] = (e2z * du1 - e1z * du2) * sign;
+        }
+    }
+
+    void NormalizeScalar(float* x, float* y, float* z, size_t first, size_t count) {
+        for (size_t i = first; i < first + count; ++i) {
+            const float lengthSquared = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+            if (lengthSquared > 0.f) {
+                const float length = sqrtf(lengthSquared);
+                x[i] = x[i] / length;
+                y[i] = y[i] / length;
+                z[i] = z[i] / length;
+            } else {
+                x[i] = y[i] = z[i] = 0.f;
+            }
+        }
+    }
+
+    // Turns the summed u directions in s into unit tangents orthogonal to the
+    // unit normals n, and sets w from the summed v directions in t
+    void OrthonormalizeScalar(const float* nx, const float* ny, const float* nz, float* sx, float* sy, float* sz, const float* tx, const float* ty, const float* tz,
+        float* w, size_t first, size_t count) {
+        for (size_t i = first; i < first + count; ++i) {
+            const float d = nx[i] * sx[i] + ny[i] * sy[i] + nz[i] * sz[i];
+            float ox = sx[i] - nx[i] * d;
+            float oy = sy[i] - ny[i] * d;
+            float oz = sz[i] - nz[i] * d;
+            float lengthSquared = ox * ox + oy * oy + oz * oz;
+            if (!(lengthSquared > 0.f)) {
+                // cross(n, x axis) unless n is near the x axis, else cross(n, y axis)
+                const bool aroundX = fabsf(nx[i]) < 0.5f;
+                ox = aroundX ? 0.f : -nz[i];
+                oy = aroundX ? nz[i] : 0.f;
+                oz = aroundX ? -ny[i] : nx[i];
+                lengthSquared = ox * ox + oy * oy + oz * oz;
+            }
+            if (lengthSquared > 0.f) {
+                const float length = sqrtf(lengthSquared);
+                ox = ox / length;
+                oy = oy / length;
+                oz = oz / length;
+            } else {
+                ox = oy = oz = 0.f;
+            }
+
+            const float bx = ny[i] * oz - nz[i] * oy;
+            const float by = nz[i] * ox - nx[i] * oz;
+            const float bz = nx[i] * oy - ny[i] * ox;
+            w[i] = bx * tx[i] + by * ty[i] + bz * tz[i] < 0.f ? -1.f : 1.f;
+            sx[i] = ox;
+            sy[i] = oy;
+            sz[i] = oz;
+        }
+    }
+
+#if CPU_X86
+    // SSE2 is part of x64, so these need no feature check
+
+    // x, y and z in the low lanes, without reading past z
+    inline __m128 Load3(const float* p) {
+        const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+        return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+    }
+
+    inline __m128 Load2(const float* p) {
+        return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+    }
+
+    // Position of corner k of triangles t to t + 3, one component per register
+    inline void LoadPositions4(const Triangles& mesh, size_t t, size_t k, __m128& x, __m128& y, __m128& z) {
+        __m128 p0 = Load3(mesh.positions + Corner(mesh, t + 0, k) * mesh.stride);
+        __m128 p1 = Load3(mesh.positions + Corner(mesh, t + 1, k) * mesh.stride);
+        __m128 p2 = Load3(mesh.positions + Corner(mesh, t + 2, k) * mesh.stride);
+        __m128 p3 = Load3(mesh.positions + Corner(mesh, t + 3, k) * mesh.stride);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        x = p0;
+        y = p1;
+        z = p2;
+    }
+
+    inline void LoadTexCoords4(const Triangles& mesh, size_t t, size_t k, __m128& u, __m128& v) {
+        const __m128 t0 = Load2(mesh.texCoords + Corner(mesh, t + 0, k) * mesh.stride);
+        const __m128 t1 = Load2(mesh.texCoords + Corner(mesh, t + 1, k) * mesh.stride);
+        const __m128 t2 = Load2(mesh.texCoords + Corner(mesh, t + 2, k) * mesh.stride);
+        const __m128 t3 = Load2(mesh.texCoords + Corner(mesh, t + 3, k) * mesh.stride);
+        const __m128 t01 = _mm_unpacklo_ps(t0, t1);
+        const __m128 t23 = _mm_unpacklo_ps(t2, t3);
+        u = _mm_movelh_ps(t01, t23);
+        v = _mm_movehl_ps(t23, t01);
+    }
+
+    inline __m128 LengthSquared4(__m128 x, __m128 y, __m128 z) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    }
+
+    inline __m128 Select4(__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    void FaceNormalsSse2(const Triangles& mesh, size_t first, size_t count, float* nx, float* ny, float* nz) {
+        const size_t end = first + count;
+        size_t t = first;
+        for (; t + 4 <= end; t += 4) {
+            __m128 ax, ay, az, bx, by, bz, cx, cy, cz;
+            LoadPositions4(mesh, t, 0, ax, ay, az);
+            LoadPositions4(mesh, t, 1, bx, by, bz);
+            LoadPositions4(mesh, t, 2, cx, cy, cz);
+            const __m128 s1x = _mm_sub_ps(ax, bx), s1y = _mm_sub_ps(ay, by), s1z = _mm_sub_ps(az, bz);
+            const __m128 s2x = _mm_sub_ps(cx, bx), s2y = _mm_sub_ps(cy, by), s2z = _mm_sub_ps(cz, bz);
+            _mm_storeu_ps(nx + t, _mm_sub_ps(_mm_mul_ps(s2y, s1z), _mm_mul_ps(s2z, s1y)));
+            _mm_storeu_ps(ny + t, _mm_sub_ps(_mm_mul_ps(s2z, s1x), _mm_mul_ps(s2x, s1z)));
+            _mm_storeu_ps(nz + t, _mm_sub_ps(_mm_mul_ps(s2x, s1y), _mm_mul_ps(s2y, s1x)));
+        }
+        FaceNormalsScalar(mesh, t, end - t, nx, ny, nz);
+    }
+
+    void TriangleTangentsSse2(const Triangles& mesh, size_t first, size_t count, float* sx, float* sy, float* sz, float* tx, float* ty, float* tz) {
+        const __m128 signBit = _mm_set1_ps(-0.f);
+        const __m128 one = _mm_set1_ps(1.f);
+        const size_t end = first + count;
+        size_t t = first;
+        for (; t + 4 <= end; t += 4) {
+            __m128 ax, ay, az, bx, by, bz, cx, cy, cz, ua, va, ub, vb, uc, vc;
+            LoadPositions4(mesh, t, 0, ax, ay, az);
+            LoadPositions4(mesh, t, 1, bx, by, bz);
+            LoadPositions4(mesh, t, 2, cx, cy, cz);
+            LoadTexCoords4(mesh, t, 0, ua, va);
+            LoadTexCoords4(mesh, t, 1, ub, vb);
+            LoadTexCoords4(mesh, t, 2, uc, vc);
+            const __m128 e1x = _mm_sub_ps(bx, ax), e1y = _mm_sub_ps(by, ay), e1z = _mm_sub_ps(bz, az);
+            const __m128 e2x = _mm_sub_ps(cx, ax), e2y = _mm_sub_ps(cy, ay), e2z = _mm_sub_ps(cz, az);
+            const __m128 du1 = _mm_sub_ps(ub, ua), dv1 = _mm_sub_ps(vb, va);
+            const __m128 du2 = _mm_sub_ps(uc, ua), dv2 = _mm_sub_ps(vc, va);
+            const __m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+            const __m128 sign = _mm_or_ps(_mm_and_ps(det, signBit), one);
+            _mm_storeu_ps(sx + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1x, dv2), _mm_mul_ps(e2x, dv1)), sign));
+            _mm_storeu_ps(sy + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1y, dv2), _mm_mul_ps(e2y, dv1)), sign));
+            _mm_storeu_ps(sz + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1z, dv2), _mm_mul_ps(e2z, dv1)), sign));
+            _mm_storeu_ps(tx + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2x, du1), _mm_mul_ps(e1x, du2)), sign));
+            _mm_storeu_ps(ty + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2y, du1), _mm_mul_ps(e1y, du2)), sign));
+            _mm_storeu_ps(tz + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2z, du1), _mm_mul_ps(e1z, du2)), sign));
+        }
+        TriangleTangentsScalar(mesh, t, end - t, sx, sy, sz, tx, ty, tz);
+    }
+
+    void NormalizeSse2(float* x, float* y, float* z, size_t first, size_t count) {
+        const size_t end = first + count;
+        size_t i = first;
+        for (; i + 4 <= end; i += 4) {
+            const __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+            const __m128 lengthSquared = LengthSquared4(vx, vy, vz);
+            const __m128 nonzero = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());
+            const __m128 length = _mm_sqrt_ps(lengthSquared);
+            _mm_storeu_ps(x + i, _mm_and_ps(nonzero, _mm_div_ps(vx, length)));
+            _mm_storeu_ps(y + i, _mm_and_ps(nonzero, _mm_div_ps(vy, length)));
+            _mm_storeu_ps(z + i, _mm_and_ps(nonzero, _mm_div_ps(vz, length)));
+        }
+        NormalizeScalar(x, y, z, i, end - i);
+    }
+
+    void OrthonormalizeSse2(const float* nx, const float* ny, const float* nz, float* sx, float* sy, float* sz, const float* tx, const float* ty, const float* tz,
+        float* w, size_t first, size_t count) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 minusOne = _mm_set1_ps(-1.f);
+        const size_t end = first + count;
+        size_t i = first;
+        for (; i + 4 <= end; i += 4) {
+            const __m128 vnx = _mm_loadu_ps(nx + i), vny = _mm_loadu_ps(ny + i), vnz = _mm_loadu_ps(nz + i);
+            const __m128 vsx = _mm_loadu_ps(sx + i), vsy = _mm_loadu_ps(sy + i), vsz = _mm_loadu_ps(sz + i);
+            const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vnx, vsx), _mm_mul_ps(vny, vsy)), _mm_mul_ps(vnz, vsz));
+            __m128 ox = _mm_sub_ps(vsx, _mm_mul_ps(vnx, dot));
+            __m128 oy = _mm_sub_ps(vsy, _mm_mul_ps(vny, dot));
+            __m128 oz = _mm_sub_ps(vsz, _mm_mul_ps(vnz, dot));
+
+            const __m128 usable = _mm_cmpgt_ps(LengthSquared4(ox, oy, oz), zero);
+            const __m128 aroundX = _mm_cmplt_ps(_mm_and_ps(vnx, absMask), half);
+            const __m128 negativeZ = _mm_sub_ps(zero, vnz);
+            ox = Select4(usable, ox, Select4(aroundX, zero, negativeZ));
+            oy = Select4(usable, oy, Select4(aroundX, vnz, zero));
+            oz = Select4(usable, oz, Select4(aroundX, _mm_sub_ps(zero, vny), vnx));
+
+            const __m128 lengthSquared = LengthSquared4(ox, oy, oz);
+            const __m128 nonzero = _mm_cmpgt_ps(lengthSquared, zero);
+            const __m128 length = _mm_sqrt_ps(lengthSquared);
+            ox = _mm_and_ps(nonzero, _mm_div_ps(ox, length));
+            oy = _mm_and_ps(nonzero, _mm_div_ps(oy, length));
+            oz = _mm_and_ps(nonzero, _mm_div_ps(oz, length));
+
+            const __m128 bx = _mm_sub_ps(_mm_mul_ps(vny, oz), _mm_mul_ps(vnz, oy));
+            const __m128 by = _mm_sub_ps(_mm_mul_ps(vnz, ox), _mm_mul_ps(vnx, oz));
+            const __m128 bz = _mm_sub_ps(_mm_mul_ps(vnx, oy), _mm_mul_ps(vny, ox));
+            const __m128 handedness = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, _mm_loadu_ps(tx + i)), _mm_mul_ps(by, _mm_loadu_ps(ty + i))), _mm_mul_ps(bz, _mm_loadu_ps(tz + i)));
+            _mm_storeu_ps(w + i, Select4(_mm_cmplt_ps(handedness, zero), minusOne, one));
+            _mm_storeu_ps(sx + i, ox);
+            _mm_storeu_ps(sy + i, oy);
+            _mm_storeu_ps(sz + i, oz);
+        }
+        OrthonormalizeScalar(nx, ny, nz, sx, sy, sz, tx, ty, tz, w, i, end - i);
+    }
+
+    // Vertex offsets, in floats, of corner k of triangles t to t + 7
+    CPU_TARGET("avx2")
+    inline __m256i CornerOffsets8(const Triangles& mesh, size_t t, size_t k) {
+        const __m256i lanes = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        const __m256i corners = mesh.indices ?
+            _mm256_i32gather_epi32(reinterpret_cast<const int*>(mesh.indices + 3 * t + k), lanes, 4) :
+            _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(3 * t + k)));
+        return _mm256_mullo_epi32(corners, _mm256_set1_epi32(static_cast<int>(mesh.stride)));
+    }
+
+    CPU_TARGET("avx2")
+    inline void LoadPositions8(const Triangles& mesh, __m256i offsets, __m256& x, __m256& y, __m256& z) {
+        x = _mm256_i32gather_ps(mesh.positions + 0, offsets, 4);
+        y = _mm256_i32gather_ps(mesh.positions + 1, offsets, 4);
+        z = _mm256_i32gather_ps(mesh.positions + 2, offsets, 4);
+    }
+
+    CPU_TARGET("avx2")
+    inline __m256 LengthSquared8(__m256 x, __m256 y, __m256 z) {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    }
+
+    CPU_TARGET("avx2")
+    void FaceNormalsAvx2(const Triangles& mesh, size_t first, size_t count, float* nx, float* ny, float* nz) {
+        const size_t end = first + count;
+        size_t t = first;
+        for (; t + 8 <= end; t += 8) {
+            __m256 ax, ay, az, bx, by, bz, cx, cy, cz;
+            LoadPositions8(mesh, CornerOffsets8(mesh, t, 0), ax, ay, az);
+            LoadPositions8(mesh, CornerOffsets8(mesh, t, 1), bx, by, bz);
+            LoadPositions8(mesh, CornerOffsets8(mesh, t, 2), cx, cy, cz);
+            const __m256 s1x = _mm256_sub_ps(ax, bx), s1y = _mm256_sub_ps(ay, by), s1z = _mm256_sub_ps(az, bz);
+            const __m256 s2x = _mm256_sub_ps(cx, bx), s2y = _mm256_sub_ps(cy, by), s2z = _mm256_sub_ps(cz, bz);
+            _mm256_storeu_ps(nx + t, _mm256_sub_ps(_mm256_mul_ps(s2y, s1z), _mm256_mul_ps(s2z, s1y)));
+            _mm256_storeu_ps(ny + t, _mm256_sub_ps(_mm256_mul_ps(s2z, s1x), _mm256_mul_ps(s2x, s1z)));
+            _mm256_storeu_ps(nz + t, _mm256_sub_ps(_mm256_mul_ps(s2x, s1y), _mm256_mul_ps(s2y, s1x)));
+        }
+        FaceNormalsScalar(mesh, t, end - t, nx, ny, nz);
+    }
+
+    CPU_TARGET("avx2")
+    void TriangleTangentsAvx2(const Triangles& mesh, size_t first, size_t count, float* sx, float* sy, float* sz, float* tx, float* ty, float* tz) {
+        const __m256 signBit = _mm256_set1_ps(-0.f);
+        const __m256 one = _mm256_set1_ps(1.f);
+        const size_t end = first + count;
+        size_t t = first;
+        for (; t + 8 <= end; t += 8) {
+            const __m256i a = CornerOffsets8(mesh, t, 0);
+            const __m256i b = CornerOffsets8(mesh, t, 1);
+            const __m256i c = CornerOffsets8(mesh, t, 2);
+            __m256 ax, ay, az, bx, by, bz, cx, cy, cz;
+            LoadPositions8(mesh, a, ax, ay, az);
+            LoadPositions8(mesh, b, bx, by, bz);
+            LoadPositions8(mesh, c, cx, cy, cz);
+            const __m256 ua = _mm256_i32gather_ps(mesh.texCoords + 0, a, 4), va = _mm256_i32gather_ps(mesh.texCoords + 1, a, 4);
+            const __m256 ub = _mm256_i32gather_ps(mesh.texCoords + 0, b, 4), vb = _mm256_i32gather_ps(mesh.texCoords + 1, b, 4);
+            const __m256 uc = _mm256_i32gather_ps(mesh.texCoords + 0, c, 4), vc = _mm256_i32gather_ps(mesh.texCoords + 1, c, 4);
+            const __m256 e1x = _mm256_sub_ps(bx, ax), e1y = _mm256_sub_ps(by, ay), e1z = _mm256_sub_ps(bz, az);
+            const __m256 e2x = _mm256_sub_ps(cx, ax), e2y = _mm256_sub_ps(cy, ay), e2z = _mm256_sub_ps(cz, az);
+            const __m256 du1 = _mm256_sub_ps(ub, ua), dv1 = _mm256_sub_ps(vb, va);
+            const __m256 du2 = _mm256_sub_ps(uc, ua), dv2 = _mm256_sub_ps(vc, va);
+            const __m256 det = _mm256_sub_ps(_mm256_mul_ps(du1, dv2), _mm256_mul_ps(du2, dv1));
+            const __m256 sign = _mm256_or_ps(_mm256_and_ps(det, signBit), one);
+            _mm256_storeu_ps(sx + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e1x, dv2), _mm256_mul_ps(e2x, dv1)), sign));
+            _mm256_storeu_ps(sy + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e1y, dv2), _mm256_mul_ps(e2y, dv1)), sign));
+            _mm256_storeu_ps(sz + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e1z, dv2), _mm256_mul_ps(e2z, dv1)), sign));
+            _mm256_storeu_ps(tx + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e2x, du1), _mm256_mul_ps(e1x, du2)), sign));
+            _mm256_storeu_ps(ty + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e2y, du1), _mm256_mul_ps(e1y, du2)), sign));
+            _mm256_storeu_ps(tz + t, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(e2z, du1), _mm256_mul_ps(e1z, du2)), sign));
+        }
+        TriangleTangentsScalar(mesh, t, end - t, sx, sy, sz, tx, ty, tz);
+    }
+
+    CPU_TARGET("avx2")
+    void NormalizeAvx2(float* x, float* y, float* z, size_t first, size_t count) {
+        const size_t end = first + count;
+        size_t i = first;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+            const __m256 lengthSquared = LengthSquared8(vx, vy, vz);
+            const __m256 nonzero = _mm256_cmp_ps(lengthSquared, _mm256_setzero_ps(), _CMP_GT_OQ);
+            const __m256 length = _mm256_sqrt_ps(lengthSquared);
+            _mm256_storeu_ps(x + i, _mm256_and_ps(nonzero, _mm256_div_ps(vx, length)));
+            _mm256_storeu_ps(y + i, _mm256_and_ps(nonzero, _mm256_div_ps(vy, length)));
+            _mm256_storeu_ps(z + i, _mm256_and_ps(nonzero, _mm256_div_ps(vz, length)));
+        }
+        NormalizeScalar(x, y, z, i, end - i);
+    }
+
+    CPU_TARGET("avx2")
+    void OrthonormalizeAvx2(const float* nx, const float* ny, const float* nz, float* sx, float* sy, float* sz, const float* tx, const float* ty, const float* tz,
+        float* w, size_t first, size_t count) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 minusOne = _mm256_set1_ps(-1.f);
+        const size_t end = first + count;
+        size_t i = first;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 vnx = _mm256_loadu_ps(nx + i), vny = _mm256_loadu_ps(ny + i), vnz = _mm256_loadu_ps(nz + i);
+            const __m256 vsx = _mm256_loadu_ps(sx + i), vsy = _mm256_loadu_ps(sy + i), vsz = _mm256_loadu_ps(sz + i);
+            const __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vnx, vsx), _mm256_mul_ps(vny, vsy)), _mm256_mul_ps(vnz, vsz));
+            __m256 ox = _mm256_sub_ps(vsx, _mm256_mul_ps(vnx, dot));
+            __m256 oy = _mm256_sub_ps(vsy, _mm256_mul_ps(vny, dot));
+            __m256 oz = _mm256_sub_ps(vsz, _mm256_mul_ps(vnz, dot));
+
+            const __m256 usable = _mm256_cmp_ps(LengthSquared8(ox, oy, oz), zero, _CMP_GT_OQ);
+            const __m256 aroundX = _mm256_cmp_ps(_mm256_and_ps(vnx, absMask), half, _CMP_LT_OQ);
+            ox = _mm256_blendv_ps(_mm256_blendv_ps(_mm256_sub_ps(zero, vnz), zero, aroundX), ox, usable);
+            oy = _mm256_blendv_ps(_mm256_blendv_ps(zero, vnz, aroundX), oy, usable);
+            oz = _mm256_blendv_ps(_mm256_blendv_ps(vnx, _mm256_sub_ps(zero, vny), aroundX), oz, usable);
+
+            const __m256 lengthSquared = LengthSquared8(ox, oy, oz);
+            const __m256 nonzero = _mm256_cmp_ps(lengthSquared, zero, _CMP_GT_OQ);
+            const __m256 length = _mm256_sqrt_ps(lengthSquared);
+            ox = _mm256_and_ps(nonzero, _mm256_div_ps(ox, length));
+            oy = _mm256_and_ps(nonzero, _mm256_div_ps(oy, length));
+            oz = _mm256_and_ps(nonzero, _mm256_div_ps(oz, length));
+
+            const __m256 bx = _mm256_sub_ps(_mm256_mul_ps(vny, oz), _mm256_mul_ps(vnz, oy));
+            const __m256 by = _mm256_sub_ps(_mm256_mul_ps(vnz, ox), _mm256_mul_ps(vnx, oz));
+            const __m256 bz = _mm256_sub_ps(_mm256_mul_ps(vnx, oy), _mm256_mul_ps(vny, ox));
+            const __m256 handedness = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bx, _mm256_loadu_ps(tx + i)), _mm256_mul_ps(by, _mm256_loadu_ps(ty + i))),
+                _mm256_mul_ps(bz, _mm256_loadu_ps(tz + i)));
+            _mm256_storeu_ps(w + i, _mm256_blendv_ps(one, minusOne, _mm256_cmp_ps(handedness, zero, _CMP_LT_OQ)));
+            _mm256_storeu_ps(sx + i, ox);
+            _mm256_storeu_ps(sy + i, oy);
+            _mm256_storeu_ps(sz + i, oz);
+        }
+        OrthonormalizeScalar(nx, ny, nz, sx, sy, sz, tx, ty, tz, w, i, end - i);
+    }
+#endif
+
+    struct Kernels {
+        void (*faceNormals)(const Triangles& mesh, size_t first, size_t count, float* nx, float* ny, float* nz);
+        void (*triangleTangents)(const Triangles& mesh, size_t first, size_t count, float* sx, float* sy, float* sz, float* tx, float* ty, float* tz);
+        void (*normalize)(float* x, float* y, float* z, size_t first, size_t count);
+        void (*orthonormalize)(const float* nx, const float* ny, const float* nz, float* sx, float* sy, float* sz, const float* tx, const float* ty, const float* tz,
+            float* w, size_t first, size_t count);
+    };
+
+    // The widest kernels no wider than width that the CPU runs. The AVX2
+    // gathers address vertices with 32-bit offsets in floats, which vertexCount
+    // vertices of stride floats must fit.
+    const Kernels& Select(Geometry::Width width, size_t vertexCount, size_t stride) {
+        static const Kernels scalar = { FaceNormalsScalar, TriangleTangentsScalar, NormalizeScalar, OrthonormalizeScalar };
+#if CPU_X86
+        static const Kernels sse2 = { FaceNormalsSse2, TriangleTangentsSse2, NormalizeSse2, OrthonormalizeSse2 };
+        static const Kernels avx2 = { FaceNormalsAvx2, TriangleTangentsAvx2, NormalizeAvx2, OrthonormalizeAvx2 };
+        if (width >= Geometry::AVX2 && Cpu::GetFeatures().avx2 && vertexCount * stride <= INT_MAX) {
+            return avx2;
+        }
+        if (width >= Geometry::SSE2) {
+            return sse2;
+        }
+#endif
+        return scalar;
+    }
+}
+
+namespace Geometry {
+    Width BestWidth() {
+#if CPU_X86
+        return Cpu::GetFeatures().avx2 ? AVX2 : SSE2;
+#else
+        return SCALAR;
+#endif
+    }
+
+    const char* Name(Width width) {
+        switch (width) {
+        case AVX2: return "AVX2";
+        case SSE2: return "SSE2";
+        default: return "scalar";
+        }
+    }
+
+    void FaceNormals(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+        Vectors& normals, Width width, unsigned threadCount) {
+        const size_t triangleCount = indexCount / 3;
+        normals.x.resize(triangleCount);
+        normals.y.resize(triangleCount);
+        normals.z.resize(triangleCount);
+
+        const Triangles mesh = { indices, positions, nullptr, positionStride / sizeof(float) };
+        const Kernels& kernels = Select(width, vertexCount, mesh.stride);
+        ForBlocks(triangleCount, threadCount, [&](size_t first, size_t count) {
+            kernels.faceNormals(mesh, first, count, normals.x.data(), normals.y.data(), normals.z.data());
+        });
+    }
+
+    void SmoothNormals(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+        Vectors& normals, Width width, unsigned threadCount) {
+        Vectors faceNormals;
+        FaceNormals(indices, indexCount, positions, vertexCount, positionStride, faceNormals, width, threadCount);
+
+        const Triangles mesh = { indices, positions, nullptr, positionStride / sizeof(float) };
+        Adjacency adjacency;
+        BuildAdjacency(mesh, indexCount / 3, vertexCount, adjacency);
+
+        normals.x.resize(vertexCount);
+        normals.y.resize(vertexCount);
+        normals.z.resize(vertexCount);
+        const Kernels& kernels = Select(width, vertexCount, mesh.stride);
+        ForBlocks(vertexCount, threadCount, [&](size_t first, size_t count) {
+            SumAroundVertices(adjacency, faceNormals.x.data(), faceNormals.y.data(), faceNormals.z.data(), first, count,
+                normals.x.data(), normals.y.data(), normals.z.data());
+            kernels.normalize(normals.x.data(), normals.y.data(), normals.z.data(), first, count);
+        });
+    }
+
+    void Tangents(const uint32_t* indices, size_t indexCount, const float* positions, const float* texCoords, size_t vertexCount, size_t vertexStride,
+        const Vectors& normals, Vectors& tangents, std::vector<float>& signs, Width width, unsigned threadCount) {
+        const size_t triangleCount = indexCount / 3;
+        const Triangles mesh = { indices, positions, texCoords, vertexStride / sizeof(float) };
+        const Kernels& kernels = Select(width, vertexCount, mesh.stride);
+
+        Vectors u, v;
+        for (Vectors* directions : { &u, &v }) {
+            directions->x.resize(triangleCount);
+            directions->y.resize(triangleCount);
+            directions->z.resize(triangleCount);
+        }
+        ForBlocks(triangleCount, threadCount, [&](size_t first, size_t count) {
+            kernels.triangleTangents(mesh, first, count, u.x.data(), u.y.data(), u.z.data(), v.x.data(), v.y.data(), v.z.data());
+        });
+
+        Adjacency adjacency;
+        BuildAdjacency(mesh, triangleCount, vertexCount, adjacency);
+
+        Vectors bitangents;
+        for (Vectors* vectors : { &tangents, &bitangents }) {
+            vectors->x.resize(vertexCount);
+            vectors->y.resize(vertexCount);
+            vectors->z.resize(vertexCount);
+        }
+        signs.resize(vertexCount);
+        ForBlocks(vertexCount, threadCount, [&](size_t first, size_t count) {
+            SumAroundVertices(adjacency, u.x.data(), u.y.data(), u.z.data(), first, count, tangents.x.data(), tangents.y.data(), tangents.z.data());
+            SumAroundVertices(adjacency, v.x.data(), v.y.data(), v.z.data(), first, count, bitangents.x.data(), bitangents.y.data(), bitangents.z.data());
+            kernels.orthonormalize(normals.x.data(), normals.y.data(), normals.z.data(), tangents.x.data(), tangents.y.data(), tangents.z.data(),
+                bitangents.x.data(), bitangents.y.data(), bitangents.z.data(), signs.data(), first, count);
+        });
+    }
+
+    float MaxDifference(const Vectors& a, const Vectors& b) {
+        if (a.x.size() != b.x.size()) {
+            return HUGE_VALF;
+        }
+        float difference = 0.f;
+        for (size_t i = 0; i < a.x.size(); ++i) {
+            difference = std::max(difference, fabsf(a.x[i] - b.x[i]));
+            difference = std::max(difference, fabsf(a.y[i] - b.y[i]));
+            difference = std::max(difference, fabsf(a.z[i] - b.z[i]));
+        }
+        return difference;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Batched normal and tangent generation. Portable; no Windows or D3D
+// dependencies.
+//
+// Kernels work on structure-of-arrays data: each register holds one component
+// of 4 (SSE2) or 8 (AVX2) triangles or vertices, so a cross product is six
+// multiplies and three subtracts with no shuffling. Triangle corners are
+// gathered from the caller's interleaved vertices; results come out as
+// separate x, y and z arrays. Every width does the same arithmetic in the same
+// order as the scalar kernels, without fused multiply-adds.
+//
+// Per-vertex sums walk each vertex's triangles through an adjacency table
+// rather than scattering from each triangle, so threads never write to the
+// same vertex, and a vertex always adds up its triangles in the same order.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Geometry {
+    // Triangles or vertices per kernel iteration
+    enum Width {
+        SCALAR = 1,
+        SSE2 = 4,
+        AVX2 = 8,
+    };
+
+    // Widest kernels the CPU supports
+    Width BestWidth();
+    const char* Name(Width width);
+
+    // Element i is (x[i], y[i], z[i])
+    struct Vectors {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+    };
+
+    // Inputs are a triangle list over vertexCount interleaved vertices. Triangle
+    // t's corners are indices[3t, 3t + 3), or vertices 3t to 3t + 2 when
+    // indices is null; indexCount counts corners either way. Strides are in
+    // bytes and must be multiples of 4. Work is split over up to threadCount
+    // threads (0 = one per hardware thread). Widths the CPU lacks fall back to
+    // the widest it has.
+
+    // Unnormalized normal of each triangle, cross(c - b, a - b) for corners a,
+    // b and c, which is twice as long as the triangle's area
+    void FaceNormals(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+        Vectors& normals, Width width = BestWidth(), unsigned threadCount = 1);
+
+    // Unit normal of each vertex: the direction of the sum of the face normals
+    // around it, so larger triangles weigh more. Meant for meshes welded by
+    // position, where neighbouring faces share vertices. Vertices no triangle
+    // uses, or whose faces cancel out, get a zero normal.
+    void SmoothNormals(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+        Vectors& normals, Width width = BestWidth(), unsigned threadCount = 1);
+
+    // Unit tangent of each vertex along increasing u, made orthogonal to its
+    // unit normal, and in signs whether the direction of increasing v is
+    // cross(normal, tangent) (+1) or its opposite (-1). Triangles weigh in by
+    // their tex coord area. Where the tex coords give no direction, the tangent
+    // is any unit vector orthogonal to the normal; vertices with a zero normal
+    // get a zero tangent.
+    void Tangents(const uint32_t* indices, size_t indexCount, const float* positions, const float* texCoords, size_t vertexCount, size_t vertexStride,
+        const Vectors& normals, Vectors& tangents, std::vector<float>& signs, Width width = BestWidth(), unsigned threadCount = 1);
+
+    // Largest componentwise difference between two equally long sets, for
+    // checking the kernels against each other
+    float MaxDifference(const Vectors& a, const Vectors& b);
+}
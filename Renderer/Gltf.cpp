@@ -0,0 +1,436 @@
+// Built without the precompiled header so the reader can run headless
+#include "Gltf.h"
+#include "Json.h"
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+    const uint32_t GLB_VERSION = 2;
+    const uint32_t CHUNK_JSON = 0x4E4F534A;     // "JSON"
+    const uint32_t CHUNK_BIN = 0x004E4942;      // "BIN\0"
+    const size_t GLB_HEADER_SIZE = 12;
+    const size_t CHUNK_HEADER_SIZE = 8;
+
+    const int MODE_TRIANGLES = 4;
+
+    // Guards the hierarchy walk against cyclic files
+    const size_t MAX_NODE_DEPTH = 1024;
+
+    struct BufferView {
+        const uint8_t* data;
+        size_t length;
+        size_t stride;
+    };
+
+    uint32_t ReadU32(const char* p) {
+        // GLB is little-endian, as is every target this builds for
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    int ComponentCount(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    // Undoes the percent-encoding URIs may use, e.g. "%20" for spaces
+    std::string DecodeUri(const std::string& uri) {
+        std::string decoded;
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+                isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+                decoded += static_cast<char>(strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+                i += 2;
+            } else {
+                decoded += uri[i];
+            }
+        }
+        return decoded;
+    }
+
+    void Identity(float* m) {
+        memset(m, 0, 16 * sizeof(float));
+        m[0] = m[5] = m[10] = m[15] = 1.f;
+    }
+
+    // out = a * b; out may not alias either input
+    void Multiply(const float* a, const float* b, float* out) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                out[4 * r + c] = a[4 * r + 0] * b[c] + a[4 * r + 1] * b[4 + c] + a[4 * r + 2] * b[8 + c] + a[4 * r + 3] * b[12 + c];
+            }
+        }
+    }
+
+    // A node's transform relative to its parent, in row-vector form. glTF
+    // stores column-vector matrices in column-major order, which is the same
+    // sequence of numbers as their row-vector transpose in row-major order.
+    void LocalTransform(const Json::Value& node, float* m) {
+        Identity(m);
+        if (node.GetNumbers("matrix", m, 16) == 16) {
+            return;
+        }
+
+        float t[3] = { 0.f, 0.f, 0.f };
+        float r[4] = { 0.f, 0.f, 0.f, 1.f };
+        float s[3] = { 1.f, 1.f, 1.f };
+        node.GetNumbers("translation", t, 3);
+        node.GetNumbers("rotation", r, 4);
+        node.GetNumbers("scale", s, 3);
+
+        // S * R * T in row-vector form; row i is axis i of the rotation
+        // scaled by s[i]
+        const float x = r[0], y = r[1], z = r[2], w = r[3];
+        m[0] = s[0] * (1.f - 2.f * (y * y + z * z));
+        m[1] = s[0] * (2.f * (x * y + z * w));
+        m[2] = s[0] * (2.f * (x * z - y * w));
+        m[4] = s[1] * (2.f * (x * y - z * w));
+        m[5] = s[1] * (1.f - 2.f * (x * x + z * z));
+        m[6] = s[1] * (2.f * (y * z + x * w));
+        m[8] = s[2] * (2.f * (x * z + y * w));
+        m[9] = s[2] * (2.f * (y * z - x * w));
+        m[10] = s[2] * (1.f - 2.f * (x * x + y * y));
+        m[12] = t[0];
+        m[13] = t[1];
+        m[14] = t[2];
+    }
+
+    void Append(std::string* text, const std::string& message) {
+        if (text) {
+            *text += message;
+            *text += "\n";
+        }
+    }
+}
+
+size_t Gltf::ComponentSize(int componentType) {
+    switch (componentType) {
+    case BYTE:
+    case UNSIGNED_BYTE:
+        return 1;
+    case SHORT:
+    case UNSIGNED_SHORT:
+        return 2;
+    case UNSIGNED_INT:
+    case FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+Gltf::Gltf() : m_stats() {}
+
+bool Gltf::Open(const std::string& fname, std::string* warn, std::string* err) {
+    m_accessors.clear();
+    m_meshes.clear();
+    m_materials.clear();
+    m_instances.clear();
+    m_stats = Stats();
+
+    if (!m_file.Open(fname)) {
+        Append(err, "Cannot open file [" + fname + "]");
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const char* file = m_file.Data();
+    const size_t size = m_file.Size();
+    m_stats.bytes = size;
+
+    if (size < GLB_HEADER_SIZE + CHUNK_HEADER_SIZE || ReadU32(file) != GLB_MAGIC) {
+        Append(err, fname + ": not a binary glTF file");
+        return false;
+    }
+    if (ReadU32(file + 4) != GLB_VERSION) {
+        Append(err, fname + ": only glTF 2.0 is supported");
+        return false;
+    }
+    const size_t length = ReadU32(file + 8) < size ? ReadU32(file + 8) : size;
+
+    // The JSON chunk comes first and the BIN chunk, if any, second. Unknown
+    // chunks are skipped as the spec requires.
+    const char* json = nullptr;
+    size_t jsonLength = 0;
+    const uint8_t* bin = nullptr;
+    size_t binLength = 0;
+    for (size_t offset = GLB_HEADER_SIZE; offset + CHUNK_HEADER_SIZE <= length;) {
+        const size_t chunkLength = ReadU32(file + offset);
+        const uint32_t chunkType = ReadU32(file + offset + 4);
+        const size_t chunkStart = offset + CHUNK_HEADER_SIZE;
+        if (chunkLength > length - chunkStart) {
+            Append(err, fname + ": chunk runs past the end of the file");
+            return false;
+        }
+        if (chunkType == CHUNK_JSON && !json) {
+            json = file + chunkStart;
+            jsonLength = chunkLength;
+        } else if (chunkType == CHUNK_BIN && !bin) {
+            bin = reinterpret_cast<const uint8_t*>(file + chunkStart);
+            binLength = chunkLength;
+        }
+        // Chunks are padded to 4 bytes
+        offset = chunkStart + ((chunkLength + 3) & ~static_cast<size_t>(3));
+    }
+    if (!json) {
+        Append(err, fname + ": missing JSON chunk");
+        return false;
+    }
+    m_stats.jsonBytes = jsonLength;
+    m_stats.binBytes = binLength;
+
+    Json::Value root;
+    std::string jsonError;
+    if (!Json::Parse(json, jsonLength, root, &jsonError)) {
+        Append(err, fname + ": " + jsonError);
+        return false;
+    }
+
+    const Json::Value* asset = root.Find("asset");
+    if (!asset || asset->GetString("version").compare(0, 2, "2.") != 0) {
+        Append(err, fname + ": only glTF 2.0 is supported");
+        return false;
+    }
+
+    // Textures and external buffers are relative to the file
+    const std::string baseDir = fname.substr(0, fname.find_last_of("\\/") + 1);
+
+    // Only the GLB-stored buffer has data; views of any other buffer resolve
+    // to nothing and whatever uses them is skipped
+    std::vector<bool> bufferIsBin;
+    if (const Json::Value* buffers = root.Find("buffers")) {
+        for (const Json::Value& buffer : buffers->elements) {
+            const bool isBin = bufferIsBin.empty() && !buffer.Find("uri") && bin;
+            if (!isBin) {
+                Append(warn, fname + ": only the GLB's BIN chunk is supported as a buffer");
+            }
+            bufferIsBin.push_back(isBin);
+        }
+    }
+
+    std::vector<BufferView> views;
+    if (const Json::Value* bufferViews = root.Find("bufferViews")) {
+        for (const Json::Value& view : bufferViews->elements) {
+            BufferView resolved = {};
+            const int buffer = view.GetInt("buffer", -1);
+            const double offset = view.GetNumber("byteOffset", 0.0);
+            const double viewLength = view.GetNumber("byteLength", 0.0);
+            if (buffer >= 0 && buffer < static_cast<int>(bufferIsBin.size()) && bufferIsBin[buffer] && offset >= 0.0 && viewLength >= 0.0 &&
+                offset + viewLength <= static_cast<double>(binLength)) {
+                resolved.data = bin + static_cast<size_t>(offset);
+                resolved.length = static_cast<size_t>(viewLength);
+                resolved.stride = static_cast<size_t>(view.GetNumber("byteStride", 0.0));
+            }
+            views.push_back(resolved);
+        }
+    }
+
+    // Accessors keep their file order, so indices into them stay valid.
+    // Unusable ones have no data.
+    if (const Json::Value* accessors = root.Find("accessors")) {
+        for (const Json::Value& source : accessors->elements) {
+            Accessor accessor = {};
+            accessor.bufferView = source.GetInt("bufferView", -1);
+            accessor.componentType = source.GetInt("componentType", 0);
+            accessor.components = ComponentCount(source.GetString("type"));
+            accessor.normalized = source.GetBool("normalized", false);
+            accessor.count = static_cast<size_t>(source.GetNumber("count", 0.0));
+            accessor.hasBounds = source.GetNumbers("min", accessor.min, 3) == 3 && source.GetNumbers("max", accessor.max, 3) == 3;
+
+            const size_t elementSize = accessor.ElementSize();
+            const size_t offset = static_cast<size_t>(source.GetNumber("byteOffset", 0.0));
+            if (source.Find("sparse")) {
+                Append(warn, fname + ": sparse accessors are not supported");
+            } else if (accessor.bufferView >= 0 && accessor.bufferView < static_cast<int>(views.size()) && views[accessor.bufferView].data && elementSize) {
+                const BufferView& view = views[accessor.bufferView];
+                accessor.stride = view.stride ? view.stride : elementSize;
+                if (accessor.count > 0 && offset <= view.length && elementSize <= view.length - offset &&
+                    accessor.count - 1 <= (view.length - offset - elementSize) / accessor.stride) {
+                    accessor.data = view.data + offset;
+                }
+            }
+            m_accessors.push_back(accessor);
+        }
+    }
+
+    auto usableAccessor = [&](int index) {
+        return index >= 0 && index < static_cast<int>(m_accessors.size()) && m_accessors[index].data;
+    };
+
+    std::vector<std::string> images;
+    if (const Json::Value* imageList = root.Find("images")) {
+        for (const Json::Value& image : imageList->elements) {
+            const std::string& uri = image.GetString("uri");
+            if (uri.empty() || uri.compare(0, 5, "data:") == 0) {
+                Append(warn, fname + ": embedded images are not supported");
+                images.push_back(std::string());
+            } else {
+                images.push_back(baseDir + DecodeUri(uri));
+            }
+        }
+    }
+
+    std::vector<int> textureImages;
+    if (const Json::Value* textures = root.Find("textures")) {
+        for (const Json::Value& texture : textures->elements) {
+            textureImages.push_back(texture.GetInt("source", -1));
+        }
+    }
+
+    if (const Json::Value* materials = root.Find("materials")) {
+        for (const Json::Value& source : materials->elements) {
+            Material material;
+            material.name = source.GetString("name");
+            material.baseColor[0] = material.baseColor[1] = material.baseColor[2] = material.baseColor[3] = 1.f;
+            if (const Json::Value* pbr = source.Find("pbrMetallicRoughness")) {
+                pbr->GetNumbers("baseColorFactor", material.baseColor, 4);
+                if (const Json::Value* baseColorTexture = pbr->Find("baseColorTexture")) {
+                    const int texture = baseColorTexture->GetInt("index", -1);
+                    if (texture >= 0 && texture < static_cast<int>(textureImages.size())) {
+                        const int image = textureImages[texture];
+                        if (image >= 0 && image < static_cast<int>(images.size())) {
+                            material.baseColorTexture = images[image];
+                        }
+                    }
+                }
+            }
+            m_materials.push_back(material);
+        }
+    }
+
+    if (const Json::Value* meshes = root.Find("meshes")) {
+        for (const Json::Value& source : meshes->elements) {
+            MeshDesc mesh;
+            mesh.name = source.GetString("name");
+            if (const Json::Value* primitives = source.Find("primitives")) {
+                for (const Json::Value& primitive : primitives->elements) {
+                    const Json::Value* attributes = primitive.Find("attributes");
+                    Primitive resolved;
+                    resolved.position = attributes ? attributes->GetInt("POSITION", -1) : -1;
+                    resolved.normal = attributes ? attributes->GetInt("NORMAL", -1) : -1;
+                    resolved.texCoord = attributes ? attributes->GetInt("TEXCOORD_0", -1) : -1;
+                    resolved.indices = primitive.GetInt("indices", -1);
+                    resolved.material = primitive.GetInt("material", -1);
+
+                    if (primitive.GetInt("mode", MODE_TRIANGLES) != MODE_TRIANGLES) {
+                        Append(warn, fname + ": mesh '" + mesh.name + "' has a primitive that isn't a triangle list");
+                        continue;
+                    }
+                    if (!usableAccessor(resolved.position) || m_accessors[resolved.position].components != 3 ||
+                        (resolved.indices >= 0 && (!usableAccessor(resolved.indices) || m_accessors[resolved.indices].components != 1))) {
+                        Append(warn, fname + ": mesh '" + mesh.name + "' has a primitive with unusable positions or indices");
+                        continue;
+                    }
+
+                    // Optional attributes that can't be read are regenerated
+                    // or defaulted
+                    if (!usableAccessor(resolved.normal) || m_accessors[resolved.normal].components != 3) {
+                        resolved.normal = -1;
+                    }
+                    if (!usableAccessor(resolved.texCoord) || m_accessors[resolved.texCoord].components != 2) {
+                        resolved.texCoord = -1;
+                    }
+                    if (resolved.material >= static_cast<int>(m_materials.size())) {
+                        resolved.material = -1;
+                    }
+                    mesh.primitives.push_back(resolved);
+                }
+            }
+            m_meshes.push_back(mesh);
+        }
+    }
+
+    // Walk the scene's hierarchy, composing each node's transform with its
+    // parent's. Without a scene list, every node no other node lists as a
+    // child is a root.
+    const Json::Value* nodes = root.Find("nodes");
+    const size_t nodeCount = nodes ? nodes->Size() : 0;
+    std::vector<int> roots;
+    const Json::Value* scenes = root.Find("scenes");
+    if (const Json::Value* scene = scenes ? scenes->At(root.GetInt("scene", 0)) : nullptr) {
+        if (const Json::Value* sceneNodes = scene->Find("nodes")) {
+            for (const Json::Value& node : sceneNodes->elements) {
+                roots.push_back(static_cast<int>(node.number));
+            }
+        }
+    } else if (nodes) {
+        std::vector<bool> isChild(nodeCount, false);
+        for (const Json::Value& node : nodes->elements) {
+            if (const Json::Value* children = node.Find("children")) {
+                for (const Json::Value& child : children->elements) {
+                    if (child.number >= 0.0 && child.number < static_cast<double>(nodeCount)) {
+                        isChild[static_cast<size_t>(child.number)] = true;
+                    }
+                }
+            }
+        }
+        for (size_t n = 0; n < nodeCount; ++n) {
+            if (!isChild[n]) {
+                roots.push_back(static_cast<int>(n));
+            }
+        }
+    }
+
+    struct PendingNode {
+        int node;
+        size_t depth;
+        float parent[16];
+    };
+    std::vector<PendingNode> stack;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+        PendingNode pending;
+        pending.node = *it;
+        pending.depth = 0;
+        Identity(pending.parent);
+        stack.push_back(pending);
+    }
+
+    while (!stack.empty()) {
+        const PendingNode pending = stack.back();
+        stack.pop_back();
+        const Json::Value* node = nodes ? nodes->At(pending.node) : nullptr;
+        if (!node) {
+            continue;
+        }
+        if (pending.depth > MAX_NODE_DEPTH) {
+            Append(warn, fname + ": node hierarchy is too deep or cyclic");
+            continue;
+        }
+
+        float local[16];
+        LocalTransform(*node, local);
+        float world[16];
+        Multiply(local, pending.parent, world);
+
+        const int mesh = node->GetInt("mesh", -1);
+        if (mesh >= 0 && mesh < static_cast<int>(m_meshes.size())) {
+            Instance instance;
+            instance.mesh = mesh;
+            memcpy(instance.model, world, sizeof(world));
+            m_instances.push_back(instance);
+        }
+
+        if (const Json::Value* children = node->Find("children")) {
+            for (auto it = children->elements.rbegin(); it != children->elements.rend(); ++it) {
+                PendingNode child;
+                child.node = static_cast<int>(it->number);
+                child.depth = pending.depth + 1;
+                memcpy(child.parent, world, sizeof(world));
+                stack.push_back(child);
+            }
+        }
+    }
+
+    m_stats.jsonSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
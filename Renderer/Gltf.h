@@ -0,0 +1,118 @@
+#pragma once
+
+// Reader for binary glTF 2.0 (.glb) files. Portable; no Windows or D3D
+// dependencies.
+//
+// The file is memory-mapped and stays mapped for the lifetime of the object:
+// accessors are resolved to typed views straight into the BIN chunk, so
+// nothing is copied or converted here. Only what the renderer draws is read:
+// triangle primitives with POSITION, NORMAL and TEXCOORD_0, base color
+// materials and the node hierarchy of one scene. Buffers other than the BIN
+// chunk, sparse accessors and embedded images are reported as unsupported.
+//
+// Like the OBJ path, geometry is taken in the file's coordinate system as is.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+class Gltf
+{
+public:
+    enum ComponentType {
+        BYTE = 5120,
+        UNSIGNED_BYTE = 5121,
+        SHORT = 5122,
+        UNSIGNED_SHORT = 5123,
+        UNSIGNED_INT = 5125,
+        FLOAT = 5126,
+    };
+
+    // A typed, strided view of part of the BIN chunk. Every element lies
+    // within its buffer view.
+    struct Accessor {
+        const uint8_t* data;
+        size_t count;
+        // Bytes from one element to the next
+        size_t stride;
+        int componentType;
+        // 1 for SCALAR up to 4 for VEC4, 16 for MAT4
+        int components;
+        bool normalized;
+        int bufferView;
+
+        // From the accessor's min and max, which glTF requires for POSITION
+        bool hasBounds;
+        float min[3];
+        float max[3];
+
+        size_t ElementSize() const { return components * ComponentSize(componentType); }
+    };
+
+    // Indices into Accessors() and Materials(); -1 when absent
+    struct Primitive {
+        int position;
+        int normal;
+        int texCoord;
+        int indices;
+        int material;
+    };
+
+    struct MeshDesc {
+        std::string name;
+        // Triangle list primitives with a usable POSITION; others are dropped
+        // with a warning
+        std::vector<Primitive> primitives;
+    };
+
+    struct Material {
+        std::string name;
+        float baseColor[4];
+        // The image's URI prefixed with the file's directory, or empty for none
+        std::string baseColorTexture;
+    };
+
+    // One node of the scene that carries a mesh
+    struct Instance {
+        int mesh;
+        // World transform in row-vector form, row-major: positions transform
+        // as p * model, as with DirectXMath
+        float model[16];
+    };
+
+    struct Stats {
+        size_t bytes;
+        size_t jsonBytes;
+        size_t binBytes;
+        // Spent parsing and resolving the JSON chunk; the BIN chunk is never
+        // touched
+        double jsonSeconds;
+    };
+
+    static size_t ComponentSize(int componentType);
+
+    Gltf();
+
+    // Maps the file and resolves its scene. Returns false if the file can't be
+    // read or isn't a valid GLB; warn collects anything that was skipped.
+    bool Open(const std::string& fname, std::string* warn, std::string* err);
+
+    const std::vector<Accessor>& Accessors() const { return m_accessors; }
+    const std::vector<MeshDesc>& Meshes() const { return m_meshes; }
+    const std::vector<Material>& Materials() const { return m_materials; }
+    const std::vector<Instance>& Instances() const { return m_instances; }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    Gltf(const Gltf&);
+    Gltf& operator=(const Gltf&);
+
+    MappedFile m_file;
+    std::vector<Accessor> m_accessors;
+    std::vector<MeshDesc> m_meshes;
+    std::vector<Material> m_materials;
+    std::vector<Instance> m_instances;
+    Stats m_stats;
+};
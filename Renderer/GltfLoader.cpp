@@ -0,0 +1,352 @@
+#include "stdafx.h"
+#include "GltfLoader.h"
+#include "Gltf.h"
+#include "MeshWelder.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+    double MillisecondsSince(const LARGE_INTEGER& start) {
+        LARGE_INTEGER frequency, now;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&now);
+        return double(now.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+    }
+
+    // Component c of element e as a float, with glTF's rules for normalized
+    // integers
+    float ReadComponent(const Gltf::Accessor& accessor, size_t e, int c) {
+        const uint8_t* p = accessor.data + e * accessor.stride + c * Gltf::ComponentSize(accessor.componentType);
+        switch (accessor.componentType) {
+        case Gltf::FLOAT: {
+            float value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case Gltf::BYTE: {
+            const int8_t value = static_cast<int8_t>(*p);
+            return accessor.normalized ? fmaxf(value / 127.f, -1.f) : value;
+        }
+        case Gltf::UNSIGNED_BYTE:
+            return accessor.normalized ? *p / 255.f : *p;
+        case Gltf::SHORT: {
+            int16_t value;
+            memcpy(&value, p, sizeof(value));
+            return accessor.normalized ? fmaxf(value / 32767.f, -1.f) : value;
+        }
+        case Gltf::UNSIGNED_SHORT: {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return accessor.normalized ? value / 65535.f : value;
+        }
+        case Gltf::UNSIGNED_INT: {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value);
+        }
+        default:
+            return 0.f;
+        }
+    }
+
+    // The first count components of element e
+    void ReadFloats(const Gltf::Accessor& accessor, size_t e, float* values, int count) {
+        if (accessor.componentType == Gltf::FLOAT) {
+            memcpy(values, accessor.data + e * accessor.stride, count * sizeof(float));
+            return;
+        }
+        for (int c = 0; c < count; ++c) {
+            values[c] = ReadComponent(accessor, e, c);
+        }
+    }
+
+    uint32_t ReadIndex(const Gltf::Accessor& accessor, size_t i) {
+        const uint8_t* p = accessor.data + i * accessor.stride;
+        switch (accessor.componentType) {
+        case Gltf::UNSIGNED_BYTE:
+            return *p;
+        case Gltf::UNSIGNED_SHORT: {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case Gltf::UNSIGNED_INT: {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    Material ConvertMaterial(const Gltf::Material& source) {
+        Material material = {};
+        strncpy_s(material.name, source.name.c_str(), _TRUNCATE);
+        material.diffuse = XMFLOAT3(source.baseColor[0], source.baseColor[1], source.baseColor[2]);
+        material.dissolve = source.baseColor[3];
+        strncpy_s(material.diffuseTexture, source.baseColorTexture.c_str(), _TRUNCATE);
+        return material;
+    }
+
+    // Whether the primitive's attributes are interleaved exactly as Vertex
+    bool HasVertexLayout(const std::vector<Gltf::Accessor>& accessors, const Gltf::Primitive& primitive) {
+        if (primitive.normal < 0 || primitive.texCoord < 0) {
+            return false;
+        }
+        const Gltf::Accessor& position = accessors[primitive.position];
+        const Gltf::Accessor& normal = accessors[primitive.normal];
+        const Gltf::Accessor& texCoord = accessors[primitive.texCoord];
+        const auto isFloats = [](const Gltf::Accessor& accessor) {
+            return accessor.componentType == Gltf::FLOAT && accessor.stride == sizeof(Vertex);
+        };
+        return isFloats(position) && isFloats(normal) && isFloats(texCoord) &&
+            reinterpret_cast<uintptr_t>(position.data) % alignof(Vertex) == 0 &&
+            normal.data == position.data + offsetof(Vertex, normal) && normal.count == position.count &&
+            texCoord.data == position.data + offsetof(Vertex, texCoord) && texCoord.count == position.count;
+    }
+
+    // Points mesh straight at the mapped file when every primitive draws from
+    // the same Vertex-layout array and their indices are tightly packed
+    // values of one type within one buffer view. The index buffer then spans
+    // all the primitives' ranges, including anything between them.
+    bool MapDirect(const std::shared_ptr<const Gltf>& file, const Gltf::MeshDesc& desc, const std::vector<UINT>& order, Mesh& mesh) {
+        const std::vector<Gltf::Accessor>& accessors = file->Accessors();
+        const Gltf::Primitive& first = desc.primitives[0];
+        if (!HasVertexLayout(accessors, first) || first.indices < 0) {
+            return false;
+        }
+
+        const Gltf::Accessor& firstIndices = accessors[first.indices];
+        const int indexType = firstIndices.componentType;
+        if (indexType != Gltf::UNSIGNED_SHORT && indexType != Gltf::UNSIGNED_INT) {
+            return false;
+        }
+        const size_t indexSize = Gltf::ComponentSize(indexType);
+
+        const uint8_t* begin = firstIndices.data;
+        const uint8_t* end = firstIndices.data;
+        for (const Gltf::Primitive& primitive : desc.primitives) {
+            if (primitive.position != first.position || primitive.normal != first.normal || primitive.texCoord != first.texCoord || primitive.indices < 0) {
+                return false;
+            }
+            const Gltf::Accessor& indices = accessors[primitive.indices];
+            if (indices.componentType != indexType || indices.bufferView != firstIndices.bufferView || indices.stride != indexSize ||
+                reinterpret_cast<uintptr_t>(indices.data) % indexSize != 0) {
+                return false;
+            }
+            begin = std::min(begin, indices.data);
+            end = std::max(end, indices.data + indices.count * indexSize);
+        }
+
+        const Gltf::Accessor& positions = accessors[first.position];
+        mesh.vertices = reinterpret_cast<const Vertex*>(positions.data);
+        mesh.vertexCount = (UINT)positions.count;
+        mesh.indices = begin;
+        mesh.indexCount = (UINT)((end - begin) / indexSize);
+        mesh.indexFormat = indexType == Gltf::UNSIGNED_SHORT ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        mesh.storage = file;
+
+        for (UINT p : order) {
+            const Gltf::Accessor& indices = accessors[desc.primitives[p].indices];
+            Submesh submesh = {};
+            submesh.indexStart = (UINT)((indices.data - begin) / indexSize);
+            submesh.chunk = Submesh::NO_CHUNK;
+            submesh.indexCount = (UINT)indices.count;
+            mesh.submeshes.push_back(submesh);
+        }
+        return true;
+    }
+
+    // Reads every primitive into Vertex form, concatenating them into one
+    // owned vertex and index buffer. Primitives sharing their attribute
+    // accessors share vertices.
+    void Convert(const Gltf& file, const Gltf::MeshDesc& desc, const std::vector<UINT>& order, Mesh& mesh) {
+        const std::vector<Gltf::Accessor>& accessors = file.Accessors();
+
+        struct SharedVertices {
+            int position, normal, texCoord;
+            uint32_t base;
+        };
+        std::vector<SharedVertices> shared;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        for (UINT p : order) {
+            const Gltf::Primitive& primitive = desc.primitives[p];
+            const Gltf::Accessor& positions = accessors[primitive.position];
+            const Gltf::Accessor* normals = primitive.normal >= 0 ? &accessors[primitive.normal] : nullptr;
+            const Gltf::Accessor* texCoords = primitive.texCoord >= 0 ? &accessors[primitive.texCoord] : nullptr;
+            const Gltf::Accessor* primitiveIndices = primitive.indices >= 0 ? &accessors[primitive.indices] : nullptr;
+            const size_t cornerCount = primitiveIndices ? primitiveIndices->count : positions.count;
+
+            // Indices past the end of the attributes are invalid; they are
+            // redirected to the first vertex rather than read out of bounds
+            const auto corner = [&](size_t i) {
+                const uint32_t index = primitiveIndices ? ReadIndex(*primitiveIndices, i) : (uint32_t)i;
+                return index < positions.count ? index : 0;
+            };
+            const auto readVertex = [&](uint32_t v, Vertex& vertex) {
+                ReadFloats(positions, v, &vertex.position.x, 3);
+                vertex.texCoord = XMFLOAT2(0.f, 0.f);
+                if (texCoords && v < texCoords->count) {
+                    ReadFloats(*texCoords, v, &vertex.texCoord.x, 2);
+                }
+            };
+
+            Submesh submesh = {};
+            submesh.indexStart = (UINT)indices.size();
+            submesh.chunk = Submesh::NO_CHUNK;
+
+            if (!normals) {
+                // Face normals, computed as ObjLoader does, need a vertex per
+                // corner
+                for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+                    Vertex face[3];
+                    for (size_t k = 0; k < 3; ++k) {
+                        readVertex(corner(i + k), face[k]);
+                    }
+
+                    XMVECTOR v1 = XMLoadFloat3(&face[0].position);
+                    XMVECTOR v2 = XMLoadFloat3(&face[1].position);
+                    XMVECTOR v3 = XMLoadFloat3(&face[2].position);
+                    XMVECTOR normal = XMVector3Cross(v3 - v2, v1 - v2);
+
+                    for (Vertex& vertex : face) {
+                        XMStoreFloat3(&vertex.normal, normal);
+                        indices.push_back((uint32_t)vertices.size());
+                        vertices.push_back(vertex);
+                    }
+                }
+            } else {
+                auto match = std::find_if(shared.begin(), shared.end(), [&](const SharedVertices& s) {
+                    return s.position == primitive.position && s.normal == primitive.normal && s.texCoord == primitive.texCoord;
+                });
+                uint32_t base;
+                if (match != shared.end()) {
+                    base = match->base;
+                } else {
+                    base = (uint32_t)vertices.size();
+                    shared.push_back({ primitive.position, primitive.normal, primitive.texCoord, base });
+
+                    vertices.resize(base + positions.count);
+                    for (uint32_t v = 0; v < positions.count; ++v) {
+                        Vertex& vertex = vertices[base + v];
+                        readVertex(v, vertex);
+                        vertex.normal = XMFLOAT3(0.f, 0.f, 0.f);
+                        if (v < normals->count) {
+                            ReadFloats(*normals, v, &vertex.normal.x, 3);
+                        }
+                    }
+                }
+
+                for (size_t i = 0; i < cornerCount; ++i) {
+                    indices.push_back(base + corner(i));
+                }
+            }
+
+            submesh.indexCount = (UINT)indices.size() - submesh.indexStart;
+            mesh.submeshes.push_back(submesh);
+        }
+
+        const bool use16BitIndices = MeshWelder::FitsIn16BitIndices(vertices.size());
+        Vertex* vb;
+        BYTE* ib;
+        mesh.Allocate((UINT)vertices.size(), (UINT)indices.size(), use16BitIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, &vb, &ib);
+
+        memcpy(vb, vertices.data(), vertices.size() * sizeof(Vertex));
+        if (use16BitIndices) {
+            MeshWelder::NarrowIndices(indices, reinterpret_cast<UINT16*>(ib));
+        } else {
+            memcpy(ib, indices.data(), indices.size() * sizeof(UINT32));
+        }
+    }
+}
+
+bool GltfLoader::Load(const std::string& fname, std::vector<Mesh>& meshes, std::vector<Instance>& instances) {
+    meshes.clear();
+    instances.clear();
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    // Shared with every directly mapped Mesh, which keeps the mapping alive
+    auto file = std::make_shared<Gltf>();
+    std::string warn;
+    std::string err;
+    if (!file->Open(fname, &warn, &err)) {
+        OutputDebugStringA(err.c_str());
+        return false;
+    }
+    if (!warn.empty()) {
+        OutputDebugStringA(warn.c_str());
+    }
+
+    // Every mesh gets the file's materials plus a default one, appended
+    // after them, for primitives without a material
+    std::vector<Material> materials;
+    for (const Gltf::Material& material : file->Materials()) {
+        materials.push_back(ConvertMaterial(material));
+    }
+    const UINT defaultMaterial = (UINT)materials.size();
+    Material fallback = {};
+    strcpy_s(fallback.name, "default");
+    fallback.diffuse = XMFLOAT3(1.f, 1.f, 1.f);
+    fallback.dissolve = 1.f;
+    materials.push_back(fallback);
+
+    UINT directCount = 0;
+    size_t uploadBytes = 0;
+    for (const Gltf::MeshDesc& desc : file->Meshes()) {
+        meshes.push_back(Mesh());
+        Mesh& mesh = meshes.back();
+        if (desc.primitives.empty()) {
+            continue;
+        }
+
+        // Primitives become submeshes, ordered so that materials sharing a
+        // diffuse texture are adjacent
+        auto primitiveMaterial = [&](UINT p) {
+            const int material = desc.primitives[p].material;
+            return material >= 0 ? (UINT)material : defaultMaterial;
+        };
+        std::vector<UINT> order(desc.primitives.size());
+        for (UINT p = 0; p < order.size(); ++p) {
+            order[p] = p;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](UINT lhs, UINT rhs) {
+            return strcmp(materials[primitiveMaterial(lhs)].diffuseTexture, materials[primitiveMaterial(rhs)].diffuseTexture) < 0;
+        });
+
+        if (MapDirect(file, desc, order, mesh)) {
+            directCount++;
+        } else {
+            Convert(*file, desc, order, mesh);
+        }
+        for (size_t s = 0; s < order.size(); ++s) {
+            mesh.submeshes[s].material = primitiveMaterial(order[s]);
+        }
+        mesh.materials = materials;
+
+        // POSITION accessors' min/max would give the boxes, but the spheres
+        // need a pass over the vertices anyway
+        mesh.ComputeBounds();
+        uploadBytes += mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * mesh.IndexSize();
+    }
+
+    for (const Gltf::Instance& source : file->Instances()) {
+        Instance instance;
+        instance.mesh = (UINT)source.mesh;
+        memcpy(instance.model.m, source.model, sizeof(instance.model.m));
+        instances.push_back(instance);
+    }
+
+    const Gltf::Stats& stats = file->GetStats();
+    char report[256];
+    sprintf_s(report, "%s: mapped %.2f MB (%.2f MB of buffers), JSON in %.2f ms; %u of %u meshes used in place, %.2f MB to upload, %u instances in %.2f ms\n",
+        fname.c_str(), stats.bytes / (1024.0 * 1024.0), stats.binBytes / (1024.0 * 1024.0), stats.jsonSeconds * 1000.0, directCount, (UINT)meshes.size(),
+        uploadBytes / (1024.0 * 1024.0), (UINT)instances.size(), MillisecondsSince(start));
+    OutputDebugStringA(report);
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+// Builds Meshes from a binary glTF (.glb) file. Unlike OBJ, glTF already
+// stores GPU-ready vertex and index arrays, so there's nothing to parse, weld
+// or optimize. When a mesh's accessors are laid out exactly like Vertex and
+// its primitives share one vertex array and one index buffer view, the Mesh
+// points straight into the mapped file and the upload copies from there.
+// Other layouts are converted element by element into an owned allocation.
+//
+// glTF meshes become one Mesh each, with one submesh per primitive; they have
+// no meshlets or LODs. Primitives without normals get face normals, as OBJ
+// faces do.
+class GltfLoader
+{
+public:
+    // One placement of meshes[mesh] in the scene
+    struct Instance {
+        UINT mesh;
+        XMFLOAT4X4 model;
+    };
+
+    // Loads every mesh in the file and the scene's node hierarchy, flattened
+    // into instances with world matrices. Returns false, leaving the outputs
+    // empty, if the file can't be read.
+    static bool Load(const std::string& fname, std::vector<Mesh>& meshes, std::vector<Instance>& instances);
+
+private:
+    GltfLoader();
+};
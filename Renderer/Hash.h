@@ -0,0 +1,53 @@
+#pragma once
+
+// Fast non-cryptographic 64-bit hash for content fingerprints (cache validation,
+// deduplication). Portable; no Windows dependencies.
+
+#include <cstdint>
+#include <cstring>
+
+namespace Hash {
+    inline uint64_t Mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Four independent 64-bit lanes keep the multiplies pipelined, so large
+    // inputs hash at several bytes per cycle.
+    inline uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0) {
+        static const uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+        static const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        const uint8_t* end = bytes + size;
+        uint64_t lanes[4] = { seed + PRIME1, seed + PRIME2, seed, seed - PRIME1 };
+
+        while (end - bytes >= 32) {
+            for (int i = 0; i < 4; ++i) {
+                uint64_t word;
+                memcpy(&word, bytes + i * 8, 8);
+                lanes[i] = (lanes[i] ^ (word * PRIME2)) * PRIME1;
+                lanes[i] = (lanes[i] << 31) | (lanes[i] >> 33);
+            }
+            bytes += 32;
+        }
+
+        uint64_t h = Mix(lanes[0]) ^ (Mix(lanes[1]) * PRIME1) ^ (Mix(lanes[2]) * PRIME2) ^ Mix(lanes[3] + size);
+
+        while (end - bytes >= 8) {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            h = Mix(h ^ (word * PRIME2)) * PRIME1;
+            bytes += 8;
+        }
+        while (bytes < end) {
+            h = (h ^ *bytes++) * PRIME1;
+        }
+
+        return Mix(h);
+    }
+}
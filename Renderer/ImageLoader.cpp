@@ -1,34 +1,92 @@
 #include "stdafx.h"
 #include "ImageLoader.h"
+#include "Bmp.h"
+#include "Mips.h"
 using Gdiplus::Bitmap;
 
 ImageLoader::ImageLoader(const wchar_t* f) : fname(f)
 {
     mipMaps = vector<MipMap>();
-    Bitmap *tp = Bitmap::FromFile(fname, false);
-    Bitmap &t = *tp;
-    const int h = t.GetHeight();
-    const int w = t.GetWidth();
-
-    BYTE* textureBytes = new BYTE[h*w * 4];
-    for (int i = 0; i < h; i++)
-    {
-        for (int j = 0; j < w; j++)
-        {
-            Gdiplus::Color c;
-            t.GetPixel(j, i, &c);
-            textureBytes[i*w * 4 + j * 4] = c.GetR();
-            textureBytes[i*w * 4 + j * 4 + 1] = c.GetG();
-            textureBytes[i*w * 4 + j * 4 + 2] = c.GetB();
-            textureBytes[i*w * 4 + j * 4 + 3] = c.GetA();
-        }
+
+    LARGE_INTEGER start, end, frequency;
+    QueryPerformanceCounter(&start);
+
+    // Bmp opens files through the ANSI APIs. Characters the code page lacks
+    // become '?', which can't appear in a file name, so such paths fall back
+    // to GDI+ and the wide path rather than best-fit onto another file.
+    std::string path(WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, fname, -1, nullptr, 0, nullptr, nullptr), '\0');
+    if (!path.empty()) {
+        WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, fname, -1, &path[0], static_cast<int>(path.size()), nullptr, nullptr);
+        path.pop_back();
     }
 
-    MipMap m(textureBytes, w, h, 0);
-    mipMaps.push_back(m);
+    UINT width, height;
+    const char* decoder = Bmp::Name(Bmp::Fastest());
+    Bmp::Image image;
+    if (Bmp::Load(path, image)) {
+        width = image.width;
+        height = image.height;
+        pixels.swap(image.pixels);
+    } else if (loadWithGdiplus(width, height)) {
+        decoder = "GDI+";
+    } else {
+        return;
+    }
+    pixels.resize(Mips::ChainPixels(width, height) * 4);
+    mipMaps.push_back(MipMap(pixels.data(), width, height, 0));
+
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&frequency);
+    char report[MAX_PATH + 128];
+    sprintf_s(report, "%s: decoded %ux%u in %.2f ms (%s)\n", path.c_str(), width, height,
+        double(end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart, decoder);
+    OutputDebugStringA(report);
+}
+
+// Copies the pixels out with one LockBits call into the start of pixels,
+// which is sized for the whole chain up front
+bool ImageLoader::loadWithGdiplus(UINT& width, UINT& height) {
+    Bitmap* bitmap = Bitmap::FromFile(fname, false);
+    if (!bitmap || bitmap->GetLastStatus() != Gdiplus::Ok) {
+        delete bitmap;
+        return false;
+    }
+
+    width = bitmap->GetWidth();
+    height = bitmap->GetHeight();
+    pixels.resize(Mips::ChainPixels(width, height) * 4);
+
+    Gdiplus::Rect rect(0, 0, width, height);
+    Gdiplus::BitmapData data = {};
+    data.Width = width;
+    data.Height = height;
+    data.Stride = width * 4;
+    data.PixelFormat = PixelFormat32bppARGB;
+    data.Scan0 = pixels.data();
+    const bool locked = bitmap->LockBits(&rect, Gdiplus::ImageLockModeRead | Gdiplus::ImageLockModeUserInputBuf, PixelFormat32bppARGB, &data) == Gdiplus::Ok;
+    if (locked) {
+        bitmap->UnlockBits(&data);
+    }
+    delete bitmap;
+    if (!locked) {
+        pixels.clear();
+        return false;
+    }
+
+    // GDI+ writes BGRA
+    const size_t baseBytes = size_t(width) * height * 4;
+    for (size_t i = 0; i < baseBytes; i += 4) {
+        std::swap(pixels[i], pixels[i + 2]);
+    }
+    return true;
+}
+
+int ImageLoader::mipLevelCount() const {
+    return isLoaded() ? Mips::LevelCount(mipMaps[0].width, mipMaps[0].height) : 0;
 }
 
 MipMap ImageLoader::getMipMap(int level) {
+    assert(level < mipLevelCount());
     if (level >= mipMaps.size()) {
         generateMipMap(level);
     }
@@ -36,32 +94,31 @@ MipMap ImageLoader::getMipMap(int level) {
     return mipMaps[level];
 }
 
+void ImageLoader::generateMipChain(unsigned threadCount) {
+    if (!isLoaded()) {
+        return;
+    }
+    const int levels = mipLevelCount();
+    for (int level = static_cast<int>(mipMaps.size()); level < levels; ++level) {
+        generateMipMap(level, threadCount);
+    }
+}
+
 
-void ImageLoader::generateMipMap(int level) {
+void ImageLoader::generateMipMap(int level, unsigned threadCount) {
     if (level < mipMaps.size()) {
         // Mip map has already been generated
         return;
     }
     if (mipMaps.size() < level) {
         // Previous level hasn't been generated yet, so do that
-        generateMipMap(level - 1);
+        generateMipMap(level - 1, threadCount);
     }
 
     MipMap lastLevel(mipMaps[level - 1]);
     MipMap nextLevel(lastLevel.next());
 
-    for (int i = 0; i < nextLevel.height; ++i) {
-        for (int j = 0; j < nextLevel.width; ++j) {
-            MipMap::Pixel p1 = lastLevel.getPixel(i * 2, j * 2);
-            MipMap::Pixel p2 = lastLevel.getPixel(i * 2 + 1, j * 2);
-            MipMap::Pixel p3 = lastLevel.getPixel(i * 2, j * 2 + 1);
-            MipMap::Pixel p4 = lastLevel.getPixel(i * 2 + 1, j * 2 + 1);
-
-            MipMap::Pixel result = MipMap::Pixel::avg(p1, p2, p3, p4);
-
-            nextLevel.setPixel(i, j, result);
-        }
-    }
+    Mips::DownsampleBanded(lastLevel.bytes, lastLevel.width, lastLevel.height, nextLevel.bytes, threadCount);
 
     assert(mipMaps.size() == level);
 
@@ -73,9 +130,9 @@ ImageLoader::~ImageLoader()
 }
 
 MipMap MipMap::next() {
-    int nextWidth = width / 2;
-    int nextHeight = height / 2;
-    BYTE* nextBytes = new BYTE[nextWidth * nextHeight * 4];
+    int nextWidth = Mips::Next(width);
+    int nextHeight = Mips::Next(height);
+    BYTE* nextBytes = bytes + size_t(width) * height * 4;
     int nextLevel = level + 1;
     return MipMap(nextBytes, nextWidth, nextHeight, nextLevel);
 }
@@ -99,12 +156,3 @@ void MipMap::setPixel(int i, int j, Pixel p) {
 inline int MipMap::getByteIndex(int i, int j, MipMap::Channel c) {
     return i * width * 4 + j * 4 + c;
 }
-
-MipMap::Pixel MipMap::Pixel::avg(Pixel p1, Pixel p2, Pixel p3, Pixel p4) {
-    return MipMap::Pixel(
-        (BYTE)((p1.r + p2.r + p3.r + p4.r) / 4.0),
-        (BYTE)((p1.g + p2.g + p3.g + p4.g) / 4.0),
-        (BYTE)((p1.b + p2.b + p3.b + p4.b) / 4.0),
-        (BYTE)((p1.a + p2.a + p3.a + p4.a) / 4.0)
-    );
-}
\ No newline at end of file
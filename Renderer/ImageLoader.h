@@ -12,10 +12,10 @@ struct MipMap {
         BYTE r, g, b, a;
 
         Pixel(BYTE r, BYTE g, BYTE b, BYTE a) : r(r), g(g), b(b), a(a) {};
-        static Pixel avg(Pixel p1, Pixel p2, Pixel p3, Pixel p4);
     };
 
     MipMap(BYTE* b, int w, int h, int l) : bytes(b), width(w), height(h), level(l) {};
+    // The level below, whose pixels directly follow these in a chain
     MipMap next();
     Pixel getPixel(int i, int j);
     void setPixel(int i, int j, Pixel p);
@@ -29,13 +29,31 @@ struct MipMap {
 class ImageLoader
 {
 public:
+    // Bitmaps are decoded by Bmp; anything else goes through GDI+
     ImageLoader(const wchar_t* fname);
     ~ImageLoader();
+    // False if the file is missing or in a format neither can decode
+    bool isLoaded() const { return !mipMaps.empty(); }
+    // Levels in the full chain down to 1x1
+    int mipLevelCount() const;
     // Mip level == 0 retrieves the base image
     MipMap getMipMap(int mipLevel);
+    // Generates every level down to 1x1 ahead of getMipMap. Each level is
+    // split into bands of rows filtered on up to threadCount threads (0 = one
+    // per hardware thread).
+    void generateMipChain(unsigned threadCount = 0);
 
 private:
-    void generateMipMap(int level);
+    ImageLoader(const ImageLoader&);
+    ImageLoader& operator=(const ImageLoader&);
+
+    bool loadWithGdiplus(UINT& width, UINT& height);
+    void generateMipMap(int level, unsigned threadCount = 1);
     const wchar_t* fname;
+    // The levels generated so far
     vector<MipMap> mipMaps;
+    // Every level's pixels, level 0 first, each level's rows tightly packed
+    // and directly followed by the next level's. Sized for the full chain on
+    // load, so the MipMaps pointing into it stay valid.
+    vector<BYTE> pixels;
 };
\ No newline at end of file
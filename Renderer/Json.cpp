@@ -0,0 +1,361 @@
+// Built without the precompiled header so the reader can run headless
+#include "Json.h"
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+    // Deeper documents are rejected rather than risking the stack
+    const int MAX_DEPTH = 256;
+
+    const std::string EMPTY_STRING;
+
+    struct Reader {
+        const char* p;
+        const char* end;
+        const char* begin;
+        std::string error;
+
+        bool Fail(const char* message) {
+            if (error.empty()) {
+                std::stringstream ss;
+                ss << "JSON: " << message << " at byte " << (p - begin) << "\n";
+                error = ss.str();
+            }
+            return false;
+        }
+
+        void SkipSpace() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+                ++p;
+            }
+        }
+
+        bool Literal(const char* word) {
+            const size_t length = strlen(word);
+            if (static_cast<size_t>(end - p) < length || memcmp(p, word, length) != 0) {
+                return Fail("unexpected token");
+            }
+            p += length;
+            return true;
+        }
+
+        bool Hex4(unsigned* value) {
+            if (end - p < 4) {
+                return Fail("truncated escape");
+            }
+            *value = 0;
+            for (int i = 0; i < 4; ++i) {
+                const char c = *p++;
+                *value <<= 4;
+                if (c >= '0' && c <= '9') {
+                    *value |= c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    *value |= c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    *value |= c - 'A' + 10;
+                } else {
+                    return Fail("bad \\u escape");
+                }
+            }
+            return true;
+        }
+
+        static void AppendUtf8(unsigned codePoint, std::string& out) {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        bool String(std::string& out) {
+            // Caller has checked for the opening quote
+            ++p;
+            out.clear();
+            for (;;) {
+                // Copy runs of plain characters at once
+                const char* run = p;
+                while (p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) {
+                    ++p;
+                }
+                out.append(run, p);
+
+                if (p >= end) {
+                    return Fail("unterminated string");
+                }
+                if (*p == '"') {
+                    ++p;
+                    return true;
+                }
+                if (*p != '\\') {
+                    return Fail("control character in string");
+                }
+
+                ++p;
+                if (p >= end) {
+                    return Fail("unterminated string");
+                }
+                const char escape = *p++;
+                switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned codePoint = 0;
+                    if (!Hex4(&codePoint)) {
+                        return false;
+                    }
+                    // Surrogate pairs encode code points past the BMP
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                        unsigned low = 0;
+                        if (end - p < 2 || p[0] != '\\' || p[1] != 'u') {
+                            return Fail("unpaired surrogate");
+                        }
+                        p += 2;
+                        if (!Hex4(&low)) {
+                            return false;
+                        }
+                        if (low < 0xDC00 || low >= 0xE000) {
+                            return Fail("unpaired surrogate");
+                        }
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(codePoint, out);
+                    break;
+                }
+                default:
+                    return Fail("bad escape");
+                }
+            }
+        }
+
+        bool Number(double& out) {
+            // Validate the JSON grammar, then let strtod convert. The run is
+            // copied out since the text needn't be NUL terminated.
+            const char* start = p;
+            if (p < end && *p == '-') {
+                ++p;
+            }
+            if (p >= end || *p < '0' || *p > '9') {
+                return Fail("bad number");
+            }
+            if (*p == '0') {
+                ++p;
+            } else {
+                while (p < end && *p >= '0' && *p <= '9') {
+                    ++p;
+                }
+            }
+            if (p < end && *p == '.') {
+                ++p;
+                if (p >= end || *p < '0' || *p > '9') {
+                    return Fail("bad number");
+                }
+                while (p < end && *p >= '0' && *p <= '9') {
+                    ++p;
+                }
+            }
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                ++p;
+                if (p < end && (*p == '+' || *p == '-')) {
+                    ++p;
+                }
+                if (p >= end || *p < '0' || *p > '9') {
+                    return Fail("bad number");
+                }
+                while (p < end && *p >= '0' && *p <= '9') {
+                    ++p;
+                }
+            }
+
+            char buffer[64];
+            const size_t length = p - start;
+            if (length < sizeof(buffer)) {
+                memcpy(buffer, start, length);
+                buffer[length] = '\0';
+                out = strtod(buffer, nullptr);
+            } else {
+                out = strtod(std::string(start, p).c_str(), nullptr);
+            }
+            return true;
+        }
+
+        bool Parse(Json::Value& value, int depth) {
+            if (depth > MAX_DEPTH) {
+                return Fail("nesting too deep");
+            }
+
+            SkipSpace();
+            if (p >= end) {
+                return Fail("unexpected end of text");
+            }
+
+            switch (*p) {
+            case '{': {
+                ++p;
+                value.type = Json::OBJECT;
+                SkipSpace();
+                if (p < end && *p == '}') {
+                    ++p;
+                    return true;
+                }
+                for (;;) {
+                    SkipSpace();
+                    if (p >= end || *p != '"') {
+                        return Fail("expected member name");
+                    }
+                    value.members.push_back(std::make_pair(std::string(), Json::Value()));
+                    if (!String(value.members.back().first)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (p >= end || *p != ':') {
+                        return Fail("expected ':'");
+                    }
+                    ++p;
+                    if (!Parse(value.members.back().second, depth + 1)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (p < end && *p == ',') {
+                        ++p;
+                    } else if (p < end && *p == '}') {
+                        ++p;
+                        return true;
+                    } else {
+                        return Fail("expected ',' or '}'");
+                    }
+                }
+            }
+            case '[': {
+                ++p;
+                value.type = Json::ARRAY;
+                SkipSpace();
+                if (p < end && *p == ']') {
+                    ++p;
+                    return true;
+                }
+                for (;;) {
+                    value.elements.push_back(Json::Value());
+                    if (!Parse(value.elements.back(), depth + 1)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (p < end && *p == ',') {
+                        ++p;
+                    } else if (p < end && *p == ']') {
+                        ++p;
+                        return true;
+                    } else {
+                        return Fail("expected ',' or ']'");
+                    }
+                }
+            }
+            case '"':
+                value.type = Json::STRING;
+                return String(value.string);
+            case 't':
+                value.type = Json::BOOLEAN;
+                value.boolean = true;
+                return Literal("true");
+            case 'f':
+                value.type = Json::BOOLEAN;
+                value.boolean = false;
+                return Literal("false");
+            case 'n':
+                value.type = Json::NUL;
+                return Literal("null");
+            default:
+                if (*p != '-' && (*p < '0' || *p > '9')) {
+                    return Fail("unexpected character");
+                }
+                value.type = Json::NUMBER;
+                return Number(value.number);
+            }
+        }
+    };
+}
+
+const Json::Value* Json::Value::Find(const char* key) const {
+    if (type != OBJECT) {
+        return nullptr;
+    }
+    for (const auto& member : members) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+const Json::Value* Json::Value::At(size_t i) const {
+    return type == ARRAY && i < elements.size() ? &elements[i] : nullptr;
+}
+
+double Json::Value::GetNumber(const char* key, double fallback) const {
+    const Value* member = Find(key);
+    return member && member->type == NUMBER ? member->number : fallback;
+}
+
+int Json::Value::GetInt(const char* key, int fallback) const {
+    const Value* member = Find(key);
+    return member && member->type == NUMBER ? static_cast<int>(member->number) : fallback;
+}
+
+bool Json::Value::GetBool(const char* key, bool fallback) const {
+    const Value* member = Find(key);
+    return member && member->type == BOOLEAN ? member->boolean : fallback;
+}
+
+const std::string& Json::Value::GetString(const char* key) const {
+    const Value* member = Find(key);
+    return member && member->type == STRING ? member->string : EMPTY_STRING;
+}
+
+size_t Json::Value::GetNumbers(const char* key, float* values, size_t count) const {
+    const Value* member = Find(key);
+    if (!member || member->type != ARRAY) {
+        return 0;
+    }
+    size_t read = 0;
+    while (read < count && read < member->elements.size() && member->elements[read].type == NUMBER) {
+        values[read] = static_cast<float>(member->elements[read].number);
+        read++;
+    }
+    return read;
+}
+
+bool Json::Parse(const char* text, size_t length, Value& root, std::string* err) {
+    Reader reader;
+    reader.begin = reader.p = text;
+    reader.end = text + length;
+
+    root = Value();
+    bool parsed = reader.Parse(root, 0);
+    if (parsed) {
+        reader.SkipSpace();
+        if (reader.p != reader.end) {
+            parsed = reader.Fail("trailing characters");
+        }
+    }
+    if (!parsed && err) {
+        *err = reader.error;
+    }
+    return parsed;
+}
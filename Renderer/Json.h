@@ -0,0 +1,64 @@
+#pragma once
+
+// Minimal JSON reader for asset manifests such as glTF's JSON chunk. Parses
+// the whole text into a tree of values; there is no writer. Portable; no
+// Windows or D3D dependencies.
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Json {
+    enum Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT,
+    };
+
+    struct Value {
+        Value() : type(NUL), boolean(false), number(0.0) {}
+
+        // Member with the given key, or nullptr if this isn't an object or has
+        // no such member
+        const Value* Find(const char* key) const;
+
+        // Element i, or nullptr if this isn't an array or is too short
+        const Value* At(size_t i) const;
+
+        size_t Size() const { return type == ARRAY ? elements.size() : type == OBJECT ? members.size() : 0; }
+
+        bool IsNumber() const { return type == NUMBER; }
+        bool IsString() const { return type == STRING; }
+        bool IsArray() const { return type == ARRAY; }
+        bool IsObject() const { return type == OBJECT; }
+
+        // Typed lookups of a member that fall back when it is missing or of
+        // another type
+        double GetNumber(const char* key, double fallback) const;
+        int GetInt(const char* key, int fallback) const;
+        bool GetBool(const char* key, bool fallback) const;
+        const std::string& GetString(const char* key) const;
+
+        // Reads up to count numbers from the array member key into values.
+        // Returns how many were read; values past that are left untouched.
+        size_t GetNumbers(const char* key, float* values, size_t count) const;
+
+        Type type;
+        bool boolean;
+        double number;
+        // UTF-8
+        std::string string;
+        std::vector<Value> elements;
+        // In document order; lookups are linear, which suits the handful of
+        // keys glTF objects have
+        std::vector<std::pair<std::string, Value>> members;
+    };
+
+    // Parses length bytes of text. On failure returns false and, if err is
+    // given, describes the first error and its byte offset.
+    bool Parse(const char* text, size_t length, Value& root, std::string* err);
+}
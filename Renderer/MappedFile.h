@@ -0,0 +1,38 @@
+#pragma once
+
+// Read-only memory mapping of a whole file. Portable: uses file mappings on
+// Windows and mmap elsewhere.
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Returns false if the file can't be opened or mapped. Empty files open
+    // successfully with Data() == nullptr.
+    bool Open(const std::string& fname);
+    void Close();
+
+    bool IsOpen() const { return m_isOpen; }
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* m_data;
+    size_t m_size;
+    bool m_isOpen;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+};
@@ -0,0 +1,228 @@
+#pragma once
+#include "stdafx.h"
+#include "Bounds.h"
+#include "Chunks.h"
+#include "Meshlets.h"
+#include "Occluders.h"
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+struct Vertex {
+    XMFLOAT3 position;
+    XMFLOAT3 normal;
+    XMFLOAT2 texCoord;
+};
+
+struct BoundingBox {
+    XMFLOAT3 min;
+    XMFLOAT3 max;
+};
+
+struct BoundingSphere {
+    XMFLOAT3 center;
+    float radius;
+};
+
+// Surface properties from the OBJ's material library
+struct Material {
+    char name[64];
+    XMFLOAT3 diffuse;
+    float dissolve;
+
+    // Path usable from the working directory, or empty for none
+    char diffuseTexture[MAX_PATH];
+};
+
+// A contiguous range of the index buffer drawn with one material
+struct Submesh {
+    UINT indexStart;
+    UINT indexCount;
+
+    // Index into Mesh::materials
+    UINT material;
+
+    // This submesh's meshlets; they cover exactly its index range
+    UINT meshletStart;
+    UINT meshletCount;
+
+    // Index into Mesh::chunks, or NO_CHUNK when the mesh isn't chunked
+    UINT chunk;
+
+    // Bounds of the vertices this submesh's indices reference
+    BoundingBox bounds;
+    BoundingSphere sphere;
+
+    static const UINT NO_CHUNK = 0xFFFFFFFF;
+};
+
+// A simplified version of the whole mesh. Its index range follows the
+// full-detail indices and holds the simplified submeshes back to back, in
+// submesh order; it indexes the same vertex buffer. Mesh::lodSubmeshes has the
+// per-submesh ranges.
+struct Lod {
+    UINT indexStart;
+    UINT indexCount;
+
+    // Requested triangle count relative to the full-detail mesh
+    float ratio;
+
+    // Estimated distance, in mesh units, between this LOD's surface and the
+    // full-detail one
+    float error;
+};
+
+// CPU-side geometry for a SceneObject. Vertex and index data are immutable once
+// built and live in storage, which is either an owned allocation or a
+// memory-mapped mesh cache. Copies share the storage.
+struct Mesh {
+    Mesh() : vertices(nullptr), vertexCount(0), indices(nullptr), indexCount(0), indexFormat(DXGI_FORMAT_R16_UINT) {
+        bounds.min = bounds.max = XMFLOAT3(0.f, 0.f, 0.f);
+        sphere.center = XMFLOAT3(0.f, 0.f, 0.f);
+        sphere.radius = 0.f;
+    }
+
+    // Number of indices in the full-detail mesh; LOD indices follow them
+    UINT BaseIndexCount() const {
+        return lods.empty() ? indexCount : lods[0].indexStart;
+    }
+
+    // Submesh ranges at the given LOD (0 is full detail); submeshes.size() entries
+    const Submesh* LodSubmeshes(UINT lod) const {
+        return lod == 0 ? submeshes.data() : &lodSubmeshes[(lod - 1) * submeshes.size()];
+    }
+
+    UINT IndexSize() const {
+        return indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(UINT16) : sizeof(UINT32);
+    }
+
+    // Allocates one owned block for both arrays and hands out writable pointers
+    // to fill it.
+    void Allocate(UINT numVertices, UINT numIndices, DXGI_FORMAT format, Vertex** outVertices, BYTE** outIndices) {
+        vertexCount = numVertices;
+        indexCount = numIndices;
+        indexFormat = format;
+
+        const size_t vertexBytes = numVertices * sizeof(Vertex);
+        auto buffer = std::make_shared<std::vector<BYTE>>(vertexBytes + numIndices * IndexSize());
+        *outVertices = reinterpret_cast<Vertex*>(buffer->data());
+        *outIndices = buffer->data() + vertexBytes;
+
+        vertices = *outVertices;
+        indices = *outIndices;
+        storage = buffer;
+    }
+
+    // Points the mesh at a built-in shape from Primitives, drawn as one
+    // submesh with a plain white material. The shape must outlive the mesh,
+    // which a static constexpr one does; nothing is copied.
+    template <typename TShape>
+    void SetPrimitive(const TShape& shape) {
+        static_assert(sizeof(shape.vertices[0]) == sizeof(Vertex), "Primitive vertices are laid out like Vertex");
+        static_assert(sizeof(shape.indices[0]) == sizeof(UINT16), "Primitives use 16-bit indices");
+
+        vertices = reinterpret_cast<const Vertex*>(shape.vertices);
+        vertexCount = (UINT)TShape::VERTEX_COUNT;
+        indices = reinterpret_cast<const BYTE*>(shape.indices);
+        indexCount = (UINT)TShape::INDEX_COUNT;
+        indexFormat = DXGI_FORMAT_R16_UINT;
+        storage.reset();
+
+        Material material = {};
+        strcpy_s(material.name, "default");
+        material.diffuse = XMFLOAT3(1.f, 1.f, 1.f);
+        material.dissolve = 1.f;
+        materials.assign(1, material);
+
+        Submesh submesh = {};
+        submesh.indexStart = 0;
+        submesh.indexCount = indexCount;
+        submesh.material = 0;
+        submesh.chunk = Submesh::NO_CHUNK;
+        submeshes.assign(1, submesh);
+
+        meshlets.clear();
+        chunks.clear();
+        lods.clear();
+        lodSubmeshes.clear();
+        occluders.clear();
+        occluderPositions.clear();
+        occluderIndices.clear();
+        ComputeBounds();
+    }
+
+    // Sets the box and sphere of the whole mesh and of every submesh and LOD
+    // submesh from the final vertex and index data
+    void ComputeBounds() {
+        Bounds::Volume volume;
+        const float* positions = vertexCount > 0 ? &vertices[0].position.x : nullptr;
+        Bounds::Compute(positions, vertexCount, sizeof(Vertex), volume);
+        SetBounds(volume, bounds, sphere);
+
+        auto computeSubmesh = [&](Submesh& submesh) {
+            if (indexFormat == DXGI_FORMAT_R16_UINT) {
+                Bounds::Compute(reinterpret_cast<const UINT16*>(indices) + submesh.indexStart, submesh.indexCount, positions, sizeof(Vertex), volume);
+            } else {
+                Bounds::Compute(reinterpret_cast<const UINT32*>(indices) + submesh.indexStart, submesh.indexCount, positions, sizeof(Vertex), volume);
+            }
+            SetBounds(volume, submesh.bounds, submesh.sphere);
+        };
+        for (Submesh& submesh : submeshes) {
+            computeSubmesh(submesh);
+        }
+        for (Submesh& submesh : lodSubmeshes) {
+            computeSubmesh(submesh);
+        }
+    }
+
+    static void SetBounds(const Bounds::Volume& volume, BoundingBox& outBox, BoundingSphere& outSphere) {
+        outBox.min = XMFLOAT3(volume.min[0], volume.min[1], volume.min[2]);
+        outBox.max = XMFLOAT3(volume.max[0], volume.max[1], volume.max[2]);
+        outSphere.center = XMFLOAT3(volume.center[0], volume.center[1], volume.center[2]);
+        outSphere.radius = volume.radius;
+    }
+
+    const Vertex* vertices;
+    UINT vertexCount;
+
+    // 16- or 32-bit indices depending on indexFormat
+    const BYTE* indices;
+    UINT indexCount;
+    DXGI_FORMAT indexFormat;
+
+    // Sorted so that submeshes sharing a diffuse texture are adjacent. In a
+    // chunked mesh each submesh holds one material's triangles within one
+    // chunk.
+    std::vector<Submesh> submeshes;
+    std::vector<Material> materials;
+    BoundingBox bounds;
+    BoundingSphere sphere;
+
+    // Contiguous index ranges with culling bounds, in index buffer order. Empty
+    // when the mesh was built without meshlets.
+    std::vector<Meshlets::Meshlet> meshlets;
+
+    // Spatial partitions with culling bounds, shared by the submeshes and LOD
+    // submeshes that reference them. Empty when the mesh isn't chunked.
+    std::vector<Chunks::Chunk> chunks;
+
+    // Progressively coarser versions of the mesh, finest first
+    std::vector<Lod> lods;
+
+    // Submeshes of each LOD, level-major: lods.size() * submeshes.size()
+    // entries, in the same order as submeshes. They have no meshlets.
+    std::vector<Submesh> lodSubmeshes;
+
+    // Conservative stand-ins for CPU occlusion culling: one per chunk, in chunk
+    // order, or a single one for an unchunked mesh. Empty when the mesh was
+    // built without them.
+    std::vector<Occluders::Occluder> occluders;
+
+    // The occluders' vertices, three floats each, and their triangles
+    std::vector<float> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
+
+    // Keeps vertices/indices alive
+    std::shared_ptr<const void> storage;
+};
@@ -0,0 +1,351 @@
+#include "stdafx.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+#include "Hash.h"
+
+namespace {
+    const char MESH_CACHE_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+
+    // Bump whenever the file layout or the loader's output changes, so that
+    // caches written by older builds are rebuilt.
+    const UINT32 MESH_CACHE_VERSION = 9;
+
+    const UINT64 MESH_CACHE_ALIGNMENT = 16;
+
+    struct SourceInfo {
+        UINT64 size;
+        UINT64 modifiedTime;
+    };
+
+    struct MeshCacheHeader {
+        char magic[4];
+        UINT32 version;
+
+        // Source file fingerprint
+        UINT64 sourceSize;
+        UINT64 sourceModifiedTime;
+        UINT64 sourceHash;
+
+        UINT32 vertexStride;
+        UINT32 vertexCount;
+        UINT32 indexSize;
+        UINT32 indexCount;
+        UINT32 submeshCount;
+        UINT32 buildFlags;
+        BoundingBox bounds;
+        BoundingSphere sphere;
+        UINT32 meshletCount;
+        UINT32 lodCount;
+        UINT32 materialCount;
+        UINT32 lodSubmeshCount;
+        UINT32 chunkCount;
+        UINT32 occluderCount;
+        UINT32 occluderPositionCount;
+        UINT32 occluderIndexCount;
+
+        // Byte offsets from the start of the file
+        UINT64 submeshOffset;
+        UINT64 meshletOffset;
+        UINT64 chunkOffset;
+        UINT64 occluderOffset;
+        UINT64 occluderPositionOffset;
+        UINT64 occluderIndexOffset;
+        UINT64 lodOffset;
+        UINT64 lodSubmeshOffset;
+        UINT64 materialOffset;
+        UINT64 vertexOffset;
+        UINT64 indexOffset;
+        UINT64 fileSize;
+
+        // Sizes of the MeshCodec streams holding the vertex and index arrays,
+        // or 0 when the arrays are stored as is
+        UINT64 vertexEncodedBytes;
+        UINT64 indexEncodedBytes;
+    };
+
+    UINT64 AlignUp(UINT64 value) {
+        return (value + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+    }
+
+    bool GetSourceInfo(const std::string& fname, SourceInfo& info) {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(fname.c_str(), GetFileExInfoStandard, &attributes)) {
+            return false;
+        }
+
+        info.size = (UINT64(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+        info.modifiedTime = (UINT64(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    double MillisecondsSince(const LARGE_INTEGER& start) {
+        LARGE_INTEGER frequency, now;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&now);
+        return double(now.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+    }
+
+    bool HashSource(const std::string& fname, UINT64& hash) {
+        MappedFile source;
+        if (!source.Open(fname)) {
+            return false;
+        }
+
+        hash = Hash::Hash64(source.Data(), source.Size());
+        return true;
+    }
+
+    // Rewrites the source timestamp in the cache's header. The cache can't be
+    // mapped meanwhile, since the mapping only shares reads.
+    bool UpdateSourceModifiedTime(const std::string& cacheFname, UINT64 modifiedTime) {
+        std::fstream cache(cacheFname, std::ios::in | std::ios::out | std::ios::binary);
+        cache.seekp(offsetof(MeshCacheHeader, sourceModifiedTime));
+        cache.write(reinterpret_cast<const char*>(&modifiedTime), sizeof(modifiedTime));
+        return !cache.fail();
+    }
+}
+
+std::string MeshCache::CachePath(const std::string& sourceFname) {
+    return sourceFname + ".meshcache";
+}
+
+bool MeshCache::Load(const std::string& sourceFname, UINT buildFlags, Mesh& mesh) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(CachePath(sourceFname)) || file->Size() < sizeof(MeshCacheHeader)) {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, file->Data(), sizeof(header));
+
+    if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        header.buildFlags != buildFlags ||
+        header.vertexStride != sizeof(Vertex) ||
+        (header.indexSize != sizeof(UINT16) && header.indexSize != sizeof(UINT32)) ||
+        header.fileSize != file->Size() ||
+        header.submeshOffset + UINT64(header.submeshCount) * sizeof(Submesh) > header.fileSize ||
+        header.meshletOffset + UINT64(header.meshletCount) * sizeof(Meshlets::Meshlet) > header.fileSize ||
+        header.chunkOffset + UINT64(header.chunkCount) * sizeof(Chunks::Chunk) > header.fileSize ||
+        header.occluderOffset + UINT64(header.occluderCount) * sizeof(Occluders::Occluder) > header.fileSize ||
+        header.occluderPositionOffset + UINT64(header.occluderPositionCount) * sizeof(float) > header.fileSize ||
+        header.occluderIndexOffset + UINT64(header.occluderIndexCount) * sizeof(UINT32) > header.fileSize ||
+        header.lodOffset + UINT64(header.lodCount) * sizeof(Lod) > header.fileSize ||
+        header.lodSubmeshCount != UINT64(header.lodCount) * header.submeshCount ||
+        header.lodSubmeshOffset + UINT64(header.lodSubmeshCount) * sizeof(Submesh) > header.fileSize ||
+        header.materialOffset + UINT64(header.materialCount) * sizeof(Material) > header.fileSize ||
+        (header.vertexEncodedBytes == 0) != (header.indexEncodedBytes == 0) ||
+        header.vertexOffset + (header.vertexEncodedBytes ? header.vertexEncodedBytes : UINT64(header.vertexCount) * header.vertexStride) > header.fileSize ||
+        header.indexOffset + (header.indexEncodedBytes ? header.indexEncodedBytes : UINT64(header.indexCount) * header.indexSize) > header.fileSize) {
+        return false;
+    }
+
+    // Cheap check first; only hash the source if its timestamp or size moved
+    SourceInfo source;
+    if (GetSourceInfo(sourceFname, source)) {
+        bool unchanged = source.size == header.sourceSize && source.modifiedTime == header.sourceModifiedTime;
+
+        if (!unchanged) {
+            UINT64 hash;
+            if (source.size != header.sourceSize || !HashSource(sourceFname, hash) || hash != header.sourceHash) {
+                return false;
+            }
+
+            // Same content under a new timestamp, e.g. after a checkout.
+            // Record the timestamp so later loads skip the hash again; if the
+            // cache can't be written, they just keep hashing.
+            file->Close();
+            if (UpdateSourceModifiedTime(CachePath(sourceFname), source.modifiedTime)) {
+                OutputDebugStringA((CachePath(sourceFname) + ": source timestamp changed but content didn't, updated the header\n").c_str());
+            }
+            if (!file->Open(CachePath(sourceFname)) || file->Size() != header.fileSize) {
+                return false;
+            }
+        }
+    }
+
+    const char* data = file->Data();
+    const DXGI_FORMAT indexFormat = header.indexSize == sizeof(UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    if (header.vertexEncodedBytes) {
+        // Compressed arrays are decoded into an owned allocation, on every core
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+
+        Vertex* vertices;
+        BYTE* indices;
+        mesh.Allocate(header.vertexCount, header.indexCount, indexFormat, &vertices, &indices);
+        const UINT64 vertexBytes = UINT64(header.vertexCount) * header.vertexStride;
+        const UINT64 indexBytes = UINT64(header.indexCount) * header.indexSize;
+        const BYTE* vertexData = reinterpret_cast<const BYTE*>(data + header.vertexOffset);
+        const BYTE* indexData = reinterpret_cast<const BYTE*>(data + header.indexOffset);
+
+        if (!MeshCodec::Decode(vertexData, static_cast<size_t>(header.vertexEncodedBytes), vertices, header.vertexCount, header.vertexStride, 0) ||
+            !MeshCodec::Decode(indexData, static_cast<size_t>(header.indexEncodedBytes), indices, header.indexCount, header.indexSize, 0)) {
+            mesh = Mesh();
+            return false;
+        }
+
+        const double milliseconds = MillisecondsSince(start);
+        char report[256];
+        sprintf_s(report, "%s: decoded %.1f MB of vertices and indices from %.1f MB in %.2f ms (%.0f MB/s)\n", CachePath(sourceFname).c_str(),
+            (vertexBytes + indexBytes) / (1024.0 * 1024.0), (header.vertexEncodedBytes + header.indexEncodedBytes) / (1024.0 * 1024.0), milliseconds,
+            (vertexBytes + indexBytes) / (1024.0 * 1024.0) / (milliseconds / 1000.0));
+        OutputDebugStringA(report);
+    } else {
+        mesh.vertices = reinterpret_cast<const Vertex*>(data + header.vertexOffset);
+        mesh.vertexCount = header.vertexCount;
+        mesh.indices = reinterpret_cast<const BYTE*>(data + header.indexOffset);
+        mesh.indexCount = header.indexCount;
+        mesh.indexFormat = indexFormat;
+        mesh.storage = file;
+    }
+    mesh.bounds = header.bounds;
+    mesh.sphere = header.sphere;
+
+    const Submesh* submeshes = reinterpret_cast<const Submesh*>(data + header.submeshOffset);
+    mesh.submeshes.assign(submeshes, submeshes + header.submeshCount);
+
+    const Meshlets::Meshlet* meshlets = reinterpret_cast<const Meshlets::Meshlet*>(data + header.meshletOffset);
+    mesh.meshlets.assign(meshlets, meshlets + header.meshletCount);
+
+    const Chunks::Chunk* chunks = reinterpret_cast<const Chunks::Chunk*>(data + header.chunkOffset);
+    mesh.chunks.assign(chunks, chunks + header.chunkCount);
+
+    const Occluders::Occluder* occluders = reinterpret_cast<const Occluders::Occluder*>(data + header.occluderOffset);
+    mesh.occluders.assign(occluders, occluders + header.occluderCount);
+
+    const float* occluderPositions = reinterpret_cast<const float*>(data + header.occluderPositionOffset);
+    mesh.occluderPositions.assign(occluderPositions, occluderPositions + header.occluderPositionCount);
+
+    const UINT32* occluderIndices = reinterpret_cast<const UINT32*>(data + header.occluderIndexOffset);
+    mesh.occluderIndices.assign(occluderIndices, occluderIndices + header.occluderIndexCount);
+
+    const Lod* lods = reinterpret_cast<const Lod*>(data + header.lodOffset);
+    mesh.lods.assign(lods, lods + header.lodCount);
+
+    const Submesh* lodSubmeshes = reinterpret_cast<const Submesh*>(data + header.lodSubmeshOffset);
+    mesh.lodSubmeshes.assign(lodSubmeshes, lodSubmeshes + header.lodSubmeshCount);
+
+    const Material* materials = reinterpret_cast<const Material*>(data + header.materialOffset);
+    mesh.materials.assign(materials, materials + header.materialCount);
+    return true;
+}
+
+bool MeshCache::Save(const std::string& sourceFname, UINT buildFlags, const Mesh& mesh, bool compress) {
+    SourceInfo source;
+    MeshCacheHeader header = {};
+
+    if (!GetSourceInfo(sourceFname, source) || !HashSource(sourceFname, header.sourceHash)) {
+        return false;
+    }
+
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.sourceSize = source.size;
+    header.sourceModifiedTime = source.modifiedTime;
+    header.vertexStride = sizeof(Vertex);
+    header.vertexCount = mesh.vertexCount;
+    header.indexSize = mesh.IndexSize();
+    header.indexCount = mesh.indexCount;
+    header.submeshCount = static_cast<UINT32>(mesh.submeshes.size());
+    header.buildFlags = buildFlags;
+    header.meshletCount = static_cast<UINT32>(mesh.meshlets.size());
+    header.chunkCount = static_cast<UINT32>(mesh.chunks.size());
+    header.occluderCount = static_cast<UINT32>(mesh.occluders.size());
+    header.occluderPositionCount = static_cast<UINT32>(mesh.occluderPositions.size());
+    header.occluderIndexCount = static_cast<UINT32>(mesh.occluderIndices.size());
+    header.lodCount = static_cast<UINT32>(mesh.lods.size());
+    header.lodSubmeshCount = static_cast<UINT32>(mesh.lodSubmeshes.size());
+    header.materialCount = static_cast<UINT32>(mesh.materials.size());
+    header.bounds = mesh.bounds;
+    header.sphere = mesh.sphere;
+
+    header.submeshOffset = AlignUp(sizeof(MeshCacheHeader));
+    header.meshletOffset = AlignUp(header.submeshOffset + header.submeshCount * sizeof(Submesh));
+    header.chunkOffset = AlignUp(header.meshletOffset + header.meshletCount * sizeof(Meshlets::Meshlet));
+    header.occluderOffset = AlignUp(header.chunkOffset + header.chunkCount * sizeof(Chunks::Chunk));
+    header.occluderPositionOffset = AlignUp(header.occluderOffset + header.occluderCount * sizeof(Occluders::Occluder));
+    header.occluderIndexOffset = AlignUp(header.occluderPositionOffset + header.occluderPositionCount * sizeof(float));
+    header.lodOffset = AlignUp(header.occluderIndexOffset + header.occluderIndexCount * sizeof(UINT32));
+    header.lodSubmeshOffset = AlignUp(header.lodOffset + header.lodCount * sizeof(Lod));
+    header.materialOffset = AlignUp(header.lodSubmeshOffset + header.lodSubmeshCount * sizeof(Submesh));
+    const size_t vertexBytes = size_t(header.vertexCount) * header.vertexStride;
+    const size_t indexBytes = size_t(header.indexCount) * header.indexSize;
+    std::vector<uint8_t> encodedVertices;
+    std::vector<uint8_t> encodedIndices;
+    if (compress) {
+        MeshCodec::Encode(mesh.vertices, header.vertexCount, header.vertexStride, encodedVertices);
+        MeshCodec::Encode(mesh.indices, header.indexCount, header.indexSize, encodedIndices);
+        header.vertexEncodedBytes = encodedVertices.size();
+        header.indexEncodedBytes = encodedIndices.size();
+
+#if defined(_DEBUG)
+        std::vector<BYTE> decoded(vertexBytes > indexBytes ? vertexBytes : indexBytes);
+        assert(MeshCodec::Decode(encodedVertices.data(), encodedVertices.size(), decoded.data(), header.vertexCount, header.vertexStride) &&
+            memcmp(decoded.data(), mesh.vertices, vertexBytes) == 0 && "Encoded vertices don't round trip");
+        assert(MeshCodec::Decode(encodedIndices.data(), encodedIndices.size(), decoded.data(), header.indexCount, header.indexSize) &&
+            memcmp(decoded.data(), mesh.indices, indexBytes) == 0 && "Encoded indices don't round trip");
+#endif
+
+        char report[256];
+        sprintf_s(report, "%s: compressed vertices %.1f MB to %.1f MB (%.2fx), indices %.1f MB to %.1f MB (%.2fx)\n", CachePath(sourceFname).c_str(),
+            vertexBytes / (1024.0 * 1024.0), encodedVertices.size() / (1024.0 * 1024.0), double(vertexBytes) / encodedVertices.size(),
+            indexBytes / (1024.0 * 1024.0), encodedIndices.size() / (1024.0 * 1024.0), double(indexBytes) / encodedIndices.size());
+        OutputDebugStringA(report);
+    }
+
+    header.vertexOffset = AlignUp(header.materialOffset + header.materialCount * sizeof(Material));
+    header.indexOffset = AlignUp(header.vertexOffset + (compress ? header.vertexEncodedBytes : vertexBytes));
+    header.fileSize = header.indexOffset + (compress ? header.indexEncodedBytes : indexBytes);
+
+    std::vector<char> contents(static_cast<size_t>(header.fileSize), 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    if (!mesh.submeshes.empty()) {
+        memcpy(contents.data() + header.submeshOffset, mesh.submeshes.data(), header.submeshCount * sizeof(Submesh));
+    }
+    if (!mesh.meshlets.empty()) {
+        memcpy(contents.data() + header.meshletOffset, mesh.meshlets.data(), header.meshletCount * sizeof(Meshlets::Meshlet));
+    }
+    if (!mesh.chunks.empty()) {
+        memcpy(contents.data() + header.chunkOffset, mesh.chunks.data(), header.chunkCount * sizeof(Chunks::Chunk));
+    }
+    if (!mesh.occluders.empty()) {
+        memcpy(contents.data() + header.occluderOffset, mesh.occluders.data(), header.occluderCount * sizeof(Occluders::Occluder));
+    }
+    if (!mesh.occluderPositions.empty()) {
+        memcpy(contents.data() + header.occluderPositionOffset, mesh.occluderPositions.data(), header.occluderPositionCount * sizeof(float));
+    }
+    if (!mesh.occluderIndices.empty()) {
+        memcpy(contents.data() + header.occluderIndexOffset, mesh.occluderIndices.data(), header.occluderIndexCount * sizeof(UINT32));
+    }
+    if (!mesh.lods.empty()) {
+        memcpy(contents.data() + header.lodOffset, mesh.lods.data(), header.lodCount * sizeof(Lod));
+    }
+    if (!mesh.lodSubmeshes.empty()) {
+        memcpy(contents.data() + header.lodSubmeshOffset, mesh.lodSubmeshes.data(), header.lodSubmeshCount * sizeof(Submesh));
+    }
+    if (!mesh.materials.empty()) {
+        memcpy(contents.data() + header.materialOffset, mesh.materials.data(), header.materialCount * sizeof(Material));
+    }
+    if (compress) {
+        memcpy(contents.data() + header.vertexOffset, encodedVertices.data(), encodedVertices.size());
+        memcpy(contents.data() + header.indexOffset, encodedIndices.data(), encodedIndices.size());
+    } else {
+        memcpy(contents.data() + header.vertexOffset, mesh.vertices, vertexBytes);
+        memcpy(contents.data() + header.indexOffset, mesh.indices, indexBytes);
+    }
+
+    // Write to a temporary and swap it in, so a crash never leaves a torn cache
+    const std::string cachePath = CachePath(sourceFname);
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+        if (!out) {
+            return false;
+        }
+    }
+
+    return MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
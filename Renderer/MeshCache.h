@@ -0,0 +1,37 @@
+#pragma once
+#include "Mesh.h"
+#include <string>
+
+// Versioned binary container for loader output, stored next to the source file
+// as <source>.meshcache. Loading maps the file and points the Mesh straight at
+// the mapped vertex and index arrays, so nothing is parsed or copied until the
+// data is uploaded.
+//
+// Layout: header, submesh table, meshlet table, chunk table, LOD table, LOD
+// submesh table, material table, vertex array, index array. Arrays are 16-byte
+// aligned within the file.
+//
+// The vertex and index arrays may instead be stored as MeshCodec streams,
+// which are typically a half to a tenth of the size. Loading such a cache
+// decodes them into memory rather than mapping them, which is faster when the
+// file isn't already in the OS cache and storage is slower than the decoder.
+class MeshCache
+{
+public:
+    static std::string CachePath(const std::string& sourceFname);
+
+    // Returns false when there is no usable cache: missing, from another format
+    // version, built with different buildFlags, or stale relative to the source
+    // file. The source's size and modification time are checked first; if those
+    // changed, the source's content hash decides, and a cache whose content
+    // still matches has its recorded timestamp updated.
+    static bool Load(const std::string& sourceFname, UINT buildFlags, Mesh& mesh);
+
+    // buildFlags records the loader options the mesh was processed with.
+    // compress stores the vertex and index arrays with MeshCodec; Load reads
+    // either form.
+    static bool Save(const std::string& sourceFname, UINT buildFlags, const Mesh& mesh, bool compress = false);
+
+private:
+    MeshCache();
+};
@@ -0,0 +1,509 @@
+// Built without the precompiled header so the codec can run headless
+#include "MeshCodec.h"
+#include "Cpu.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+    const uint8_t MAGIC[2] = { 'M', 'C' };
+    const uint8_t VERSION = 1;
+
+    // Size a block's transformed bytes stay within, which also keeps every LZ
+    // offset within 16 bits
+    const size_t BLOCK_BYTES = 65536;
+
+    // Plane sizes with this bit set were stored without the LZ stage
+    const uint32_t STORED = 0x80000000u;
+
+    // A plane keeps its LZ coding only if that saves at least 1/KEEP_RATIO of
+    // its size. Mantissa planes are close to random, and decoding short
+    // matches out of them would cost more time than reading the bytes saved.
+    const size_t KEEP_RATIO = 8;
+
+    const size_t MIN_MATCH = 4;
+
+    // Shortest match the compressor emits. Each match costs the decoder a
+    // sequence; below this length that time outweighs the byte or two saved.
+    const size_t MIN_USEFUL_MATCH = 6;
+    const size_t MAX_HASH_BITS = 14;
+
+    // Matches stop this many bytes short of the end of a plane, which keeps
+    // the decoder's wide copies on their fast path until the final literals
+    const size_t END_LITERALS = 8;
+
+    struct StreamHeader {
+        uint8_t magic[2];
+        uint8_t version;
+        uint8_t laneBytes;
+        uint32_t stride;
+        uint32_t blockElements;
+        uint32_t blockCount;
+        uint64_t count;
+    };
+
+    size_t LaneBytes(size_t stride) {
+        return stride % 4 == 0 ? 4 : stride % 2 == 0 ? 2 : 1;
+    }
+
+    size_t BlockElements(size_t stride) {
+        return BLOCK_BYTES / stride;
+    }
+
+    uint32_t Read32(const uint8_t* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // Delta, zigzag and byte-plane split of elements [0, n) of one block.
+    // Byte b of lane l goes to plane l * sizeof(Lane) + b, which starts at
+    // planes + that index * n. Lane is the unsigned type of one lane.
+    template <typename Lane>
+    void Transform(const uint8_t* elements, size_t n, size_t stride, uint8_t* planes) {
+        const size_t lanes = stride / sizeof(Lane);
+        for (size_t l = 0; l < lanes; ++l) {
+            uint8_t* plane = planes + l * sizeof(Lane) * n;
+            Lane previous = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Lane value;
+                memcpy(&value, elements + i * stride + l * sizeof(Lane), sizeof(Lane));
+                const Lane delta = static_cast<Lane>(value - previous);
+                const Lane sign = static_cast<Lane>(0 - (delta >> (sizeof(Lane) * 8 - 1)));
+                const Lane zigzag = static_cast<Lane>((delta << 1) ^ sign);
+                previous = value;
+                for (size_t b = 0; b < sizeof(Lane); ++b) {
+                    plane[b * n + i] = static_cast<uint8_t>(zigzag >> (8 * b));
+                }
+            }
+        }
+    }
+
+    void TransformBlock(const uint8_t* elements, size_t n, size_t stride, size_t laneBytes, uint8_t* planes) {
+        switch (laneBytes) {
+        case 4: Transform<uint32_t>(elements, n, stride, planes); break;
+        case 2: Transform<uint16_t>(elements, n, stride, planes); break;
+        default: Transform<uint8_t>(elements, n, stride, planes); break;
+        }
+    }
+
+#if CPU_X86
+    // SSE2 is part of x64, so these need no feature check
+
+    // Undoes the zigzag of 32-bit lanes
+    inline __m128i Unzigzag32(__m128i value) {
+        return _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi32(1))));
+    }
+
+    // Running sum of four consecutive deltas, continuing from the last lane of
+    // previous
+    inline __m128i PrefixSum32(__m128i delta, __m128i previous) {
+        delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+        delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+        return _mm_add_epi32(delta, _mm_shuffle_epi32(previous, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+
+    // Decodes values [i, i + 16) of one 32-bit lane from its four byte planes,
+    // four values per register
+    inline void DecodeLane32(const uint8_t* const* planes, size_t i, __m128i& previous, __m128i values[4]) {
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+        const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+        const __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+        const __m128i b01lo = _mm_unpacklo_epi8(b0, b1);
+        const __m128i b01hi = _mm_unpackhi_epi8(b0, b1);
+        const __m128i b23lo = _mm_unpacklo_epi8(b2, b3);
+        const __m128i b23hi = _mm_unpackhi_epi8(b2, b3);
+        values[0] = previous = PrefixSum32(Unzigzag32(_mm_unpacklo_epi16(b01lo, b23lo)), previous);
+        values[1] = previous = PrefixSum32(Unzigzag32(_mm_unpackhi_epi16(b01lo, b23lo)), previous);
+        values[2] = previous = PrefixSum32(Unzigzag32(_mm_unpacklo_epi16(b01hi, b23hi)), previous);
+        values[3] = previous = PrefixSum32(Unzigzag32(_mm_unpackhi_epi16(b01hi, b23hi)), previous);
+    }
+
+    // Inverse transform of 32-bit lanes for strides that are a multiple of 16
+    // bytes, or 4 bytes (32-bit indices). Returns the number of elements
+    // decoded; the caller finishes the rest.
+    size_t Untransform32(const uint8_t* const* planes, size_t n, size_t stride, uint8_t* elements) {
+        const size_t whole = n & ~size_t(15);
+        if (stride == 4) {
+            __m128i previous = _mm_setzero_si128();
+            for (size_t i = 0; i < whole; i += 16) {
+                __m128i values[4];
+                DecodeLane32(planes, i, previous, values);
+                for (int q = 0; q < 4; ++q) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(elements + (i + 4 * q) * 4), values[q]);
+                }
+            }
+            return whole;
+        }
+        if (stride % 16 != 0) {
+            return 0;
+        }
+
+        // Four lanes at a time, transposed back to four elements at a time
+        for (size_t l = 0; l < stride / 4; l += 4) {
+            __m128i previous[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+            for (size_t i = 0; i < whole; i += 16) {
+                __m128i lanes[4][4];
+                for (int k = 0; k < 4; ++k) {
+                    DecodeLane32(planes + (l + k) * 4, i, previous[k], lanes[k]);
+                }
+                for (int q = 0; q < 4; ++q) {
+                    const __m128i t0 = _mm_unpacklo_epi32(lanes[0][q], lanes[1][q]);
+                    const __m128i t1 = _mm_unpacklo_epi32(lanes[2][q], lanes[3][q]);
+                    const __m128i t2 = _mm_unpackhi_epi32(lanes[0][q], lanes[1][q]);
+                    const __m128i t3 = _mm_unpackhi_epi32(lanes[2][q], lanes[3][q]);
+                    uint8_t* out = elements + (i + 4 * q) * stride + l * 4;
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi64(t0, t1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + stride), _mm_unpackhi_epi64(t0, t1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * stride), _mm_unpacklo_epi64(t2, t3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * stride), _mm_unpackhi_epi64(t2, t3));
+                }
+            }
+        }
+        return whole;
+    }
+
+    // Inverse transform of 16-bit indices. Returns the number of elements
+    // decoded.
+    size_t Untransform16(const uint8_t* const* planes, size_t n, size_t stride, uint8_t* elements) {
+        if (stride != 2) {
+            return 0;
+        }
+        const size_t whole = n & ~size_t(15);
+        __m128i previous = _mm_setzero_si128();
+        for (size_t i = 0; i < whole; i += 16) {
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+            const __m128i halves[2] = { _mm_unpacklo_epi8(b0, b1), _mm_unpackhi_epi8(b0, b1) };
+            for (int h = 0; h < 2; ++h) {
+                __m128i delta = _mm_xor_si128(_mm_srli_epi16(halves[h], 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(halves[h], _mm_set1_epi16(1))));
+                delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 2));
+                delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 4));
+                delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 8));
+                previous = _mm_add_epi16(delta, _mm_set1_epi16(static_cast<short>(_mm_extract_epi16(previous, 7))));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(elements + (i + 8 * h) * 2), previous);
+            }
+        }
+        return whole;
+    }
+#endif
+
+    // Inverse of Transform for elements [first, n), which continue from the
+    // already decoded elements before first. planes[p] points at plane p.
+    template <typename Lane>
+    void Untransform(const uint8_t* const* planes, size_t first, size_t n, size_t stride, uint8_t* elements) {
+        const size_t lanes = stride / sizeof(Lane);
+        for (size_t l = 0; l < lanes; ++l) {
+            const uint8_t* const* lanePlanes = planes + l * sizeof(Lane);
+            uint8_t* out = elements + l * sizeof(Lane);
+            Lane previous = 0;
+            if (first > 0) {
+                memcpy(&previous, out + (first - 1) * stride, sizeof(Lane));
+            }
+            for (size_t i = first; i < n; ++i) {
+                Lane zigzag = lanePlanes[0][i];
+                for (size_t b = 1; b < sizeof(Lane); ++b) {
+                    zigzag |= static_cast<Lane>(lanePlanes[b][i]) << (8 * b);
+                }
+                const Lane delta = static_cast<Lane>((zigzag >> 1) ^ (0 - (zigzag & 1)));
+                previous = static_cast<Lane>(previous + delta);
+                memcpy(out + i * stride, &previous, sizeof(Lane));
+            }
+        }
+    }
+
+    void UntransformBlock(const uint8_t* const* planes, size_t n, size_t stride, size_t laneBytes, uint8_t* elements) {
+        switch (laneBytes) {
+#if CPU_X86
+        case 4: Untransform<uint32_t>(planes, Untransform32(planes, n, stride, elements), n, stride, elements); break;
+        case 2: Untransform<uint16_t>(planes, Untransform16(planes, n, stride, elements), n, stride, elements); break;
+#else
+        case 4: Untransform<uint32_t>(planes, 0, n, stride, elements); break;
+        case 2: Untransform<uint16_t>(planes, 0, n, stride, elements); break;
+#endif
+        default: Untransform<uint8_t>(planes, 0, n, stride, elements); break;
+        }
+    }
+
+    void WriteLength(size_t length, std::vector<uint8_t>& out) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    // One LZ sequence: a token holding the literal count and match length in
+    // its high and low nibbles, extra length bytes for either if its nibble is
+    // 15, the literals, then a 16-bit offset. The last sequence is literals
+    // only.
+    void WriteSequence(const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, std::vector<uint8_t>& out) {
+        const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        out.push_back(static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalCount >= 15) {
+            WriteLength(literalCount - 15, out);
+        }
+        out.insert(out.end(), literals, literals + literalCount);
+        if (matchLength) {
+            out.push_back(static_cast<uint8_t>(offset));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (matchCode >= 15) {
+                WriteLength(matchCode - 15, out);
+            }
+        }
+    }
+
+    // Greedy single-probe LZ77 over one plane, appended to out
+    void Compress(const uint8_t* src, size_t size, std::vector<uint32_t>& table, std::vector<uint8_t>& out) {
+        size_t hashBits = 8;
+        while (hashBits < MAX_HASH_BITS && (size_t(1) << hashBits) < size) {
+            hashBits++;
+        }
+        // Positions are stored plus one so that zero means empty
+        table.assign(size_t(1) << hashBits, 0);
+
+        size_t anchor = 0;
+        size_t ip = 0;
+        const size_t matchLimit = size > END_LITERALS ? size - END_LITERALS : 0;
+        while (ip + MIN_MATCH <= matchLimit) {
+            const uint32_t word = Read32(src + ip);
+            const uint32_t hash = (word * 2654435761u) >> (32 - hashBits);
+            const size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > 0xFFFF || Read32(src + candidate - 1) != word) {
+                // Skip faster through data that isn't matching
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (ip + length < matchLimit && src[match + length] == src[ip + length]) {
+                length++;
+            }
+            if (length < MIN_USEFUL_MATCH) {
+                ip++;
+                continue;
+            }
+            while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+                ip--;
+                match--;
+                length++;
+            }
+
+            WriteSequence(src + anchor, ip - anchor, ip - match, length, out);
+            ip += length;
+            anchor = ip;
+        }
+        WriteSequence(src + anchor, size - anchor, 0, 0, out);
+    }
+
+    bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+        for (;;) {
+            if (ip >= end) {
+                return false;
+            }
+            const uint8_t byte = *ip++;
+            length += byte;
+            if (byte != 255) {
+                return true;
+            }
+        }
+    }
+
+    // Decodes one plane written by Compress into dst, which must come out at
+    // exactly dstSize bytes. Never writes past dst + dstSize.
+    bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+        const uint8_t* ip = src;
+        const uint8_t* const ipEnd = src + srcSize;
+        uint8_t* op = dst;
+        uint8_t* const opEnd = dst + dstSize;
+
+        for (;;) {
+            if (ip >= ipEnd) {
+                return false;
+            }
+            const uint8_t token = *ip++;
+
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !ReadLength(ip, ipEnd, literalCount)) {
+                return false;
+            }
+            if (literalCount > size_t(ipEnd - ip) || literalCount > size_t(opEnd - op)) {
+                return false;
+            }
+            // Short runs copy in one wide step when both buffers have room
+            if (literalCount <= 16 && ipEnd - ip >= 16 && opEnd - op >= 16) {
+                memcpy(op, ip, 16);
+            } else {
+                memcpy(op, ip, literalCount);
+            }
+            ip += literalCount;
+            op += literalCount;
+
+            if (ip == ipEnd) {
+                return op == opEnd;
+            }
+
+            if (ipEnd - ip < 2) {
+                return false;
+            }
+            const size_t offset = ip[0] | (size_t(ip[1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > size_t(op - dst)) {
+                return false;
+            }
+
+            size_t length = token & 15;
+            if (length == 15 && !ReadLength(ip, ipEnd, length)) {
+                return false;
+            }
+            length += MIN_MATCH;
+            if (length > size_t(opEnd - op)) {
+                return false;
+            }
+
+            // Copies in steps no wider than the offset read only bytes already
+            // written, and may run up to 15 bytes past the match, which later
+            // sequences overwrite
+            const uint8_t* match = op - offset;
+            const bool room = size_t(opEnd - op) >= length + 16;
+            if (offset >= 16 && room) {
+                for (size_t i = 0; i < length; i += 16) {
+                    memcpy(op + i, match + i, 16);
+                }
+            } else if (offset >= 8 && room) {
+                for (size_t i = 0; i < length; i += 8) {
+                    memcpy(op + i, match + i, 8);
+                }
+            } else if (offset == 1) {
+                memset(op, *match, length);
+            } else {
+                for (size_t i = 0; i < length; ++i) {
+                    op[i] = match[i];
+                }
+            }
+            op += length;
+        }
+    }
+}
+
+namespace MeshCodec {
+    // Stream layout: header, a table of block sizes, then the blocks. Each
+    // block is a table of its stride plane sizes followed by the planes, each
+    // either LZ coded or, with STORED set in its size, stored as is.
+    void Encode(const void* elements, size_t count, size_t stride, std::vector<uint8_t>& out) {
+        StreamHeader header = {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.laneBytes = static_cast<uint8_t>(LaneBytes(stride));
+        header.stride = static_cast<uint32_t>(stride);
+        header.blockElements = static_cast<uint32_t>(BlockElements(stride));
+        header.blockCount = static_cast<uint32_t>((count + header.blockElements - 1) / header.blockElements);
+        header.count = count;
+
+        const size_t headerOffset = out.size();
+        out.resize(headerOffset + sizeof(header) + header.blockCount * sizeof(uint32_t));
+        memcpy(out.data() + headerOffset, &header, sizeof(header));
+
+        const uint8_t* source = static_cast<const uint8_t*>(elements);
+        std::vector<uint8_t> planes(header.blockElements * stride);
+        std::vector<uint32_t> table;
+        for (uint32_t b = 0; b < header.blockCount; ++b) {
+            const size_t first = size_t(b) * header.blockElements;
+            const size_t n = std::min<size_t>(header.blockElements, count - first);
+            TransformBlock(source + first * stride, n, stride, header.laneBytes, planes.data());
+
+            const size_t blockStart = out.size();
+            out.resize(blockStart + stride * sizeof(uint32_t));
+            for (size_t p = 0; p < stride; ++p) {
+                const uint8_t* plane = planes.data() + p * n;
+                const size_t planeStart = out.size();
+                Compress(plane, n, table, out);
+
+                uint32_t planeSize = static_cast<uint32_t>(out.size() - planeStart);
+                if (planeSize > n - n / KEEP_RATIO) {
+                    out.resize(planeStart);
+                    out.insert(out.end(), plane, plane + n);
+                    planeSize = static_cast<uint32_t>(n) | STORED;
+                }
+                memcpy(out.data() + blockStart + p * sizeof(uint32_t), &planeSize, sizeof(planeSize));
+            }
+
+            const uint32_t blockSize = static_cast<uint32_t>(out.size() - blockStart);
+            memcpy(out.data() + headerOffset + sizeof(header) + b * sizeof(uint32_t), &blockSize, sizeof(blockSize));
+        }
+    }
+
+    bool Decode(const uint8_t* data, size_t size, void* elements, size_t count, size_t stride, unsigned threadCount) {
+        StreamHeader header;
+        if (size < sizeof(header) || stride == 0 || stride > MAX_STRIDE) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.laneBytes != LaneBytes(stride) ||
+            header.stride != stride || header.count != count || header.blockElements != BlockElements(stride) ||
+            header.blockCount != (count + header.blockElements - 1) / header.blockElements ||
+            header.blockCount > (size - sizeof(header)) / sizeof(uint32_t)) {
+            return false;
+        }
+
+        // Block offsets from the table, so blocks can be decoded in any order
+        const uint8_t* blockSizes = data + sizeof(header);
+        std::vector<size_t> offsets(header.blockCount + 1);
+        offsets[0] = sizeof(header) + header.blockCount * sizeof(uint32_t);
+        for (uint32_t b = 0; b < header.blockCount; ++b) {
+            offsets[b + 1] = offsets[b] + Read32(blockSizes + b * sizeof(uint32_t));
+            if (offsets[b + 1] > size) {
+                return false;
+            }
+        }
+
+        uint8_t* destination = static_cast<uint8_t*>(elements);
+        std::atomic<bool> valid(true);
+        Parallel::For(header.blockCount, threadCount, [&](size_t b) {
+            const size_t first = b * header.blockElements;
+            const size_t n = std::min<size_t>(header.blockElements, count - first);
+            const uint8_t* block = data + offsets[b];
+            const size_t blockSize = offsets[b + 1] - offsets[b];
+            if (blockSize < stride * sizeof(uint32_t)) {
+                valid = false;
+                return;
+            }
+
+            // Stored planes are read in place; the rest are decompressed into
+            // scratch
+            uint8_t scratch[BLOCK_BYTES];
+            const uint8_t* planes[MAX_STRIDE];
+            size_t planeOffset = stride * sizeof(uint32_t);
+            for (size_t p = 0; p < stride; ++p) {
+                const uint32_t planeSize = Read32(block + p * sizeof(uint32_t));
+                const size_t bytes = planeSize & ~STORED;
+                if (bytes > blockSize - planeOffset) {
+                    valid = false;
+                    return;
+                }
+                if (planeSize & STORED) {
+                    if (bytes != n) {
+                        valid = false;
+                        return;
+                    }
+                    planes[p] = block + planeOffset;
+                } else {
+                    if (!Decompress(block + planeOffset, bytes, scratch + p * n, n)) {
+                        valid = false;
+                        return;
+                    }
+                    planes[p] = scratch + p * n;
+                }
+                planeOffset += bytes;
+            }
+            UntransformBlock(planes, n, stride, header.laneBytes, destination + first * stride);
+        });
+        return valid.load();
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Lossless compression for vertex and index arrays on disk. Portable; no
+// Windows or D3D dependencies.
+//
+// Arrays are encoded in independent blocks of about 64 KB. Within a block,
+// each element is split into lanes of 4, 2 or 1 bytes (the widest that divides
+// the stride), each lane is replaced by the zigzagged difference from the same
+// lane of the previous element, and the result is stored byte plane by byte
+// plane: byte 0 of every element's first lane, then byte 1, and so on. After
+// vertex and index reordering, neighbouring elements are similar, so the high
+// planes are mostly zeros and the low planes repeat; a byte-oriented LZ stage
+// then squeezes each plane. Planes it can't shrink by much, like the low bytes
+// of float mantissas, are stored as is. Index arrays are the same scheme with
+// one lane per element, which is plain delta and zigzag coding.
+//
+// The LZ stage trades ratio for speed: decoding is table-free copying, so a
+// block decodes in the time it takes to read it from a fast SSD, and blocks
+// can be decoded on several threads.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshCodec {
+    // Largest supported element size
+    static const size_t MAX_STRIDE = 256;
+
+    // Appends the encoding of count elements of stride bytes to out
+    void Encode(const void* elements, size_t count, size_t stride, std::vector<uint8_t>& out);
+
+    // Decodes data written by Encode into elements, which has room for count
+    // elements of stride bytes. Returns false if data is truncated or corrupt
+    // or holds a different count or stride; elements is then partly written.
+    // Blocks are decoded on up to threadCount threads (0 = one per hardware
+    // thread).
+    bool Decode(const uint8_t* data, size_t size, void* elements, size_t count, size_t stride, unsigned threadCount = 1);
+}
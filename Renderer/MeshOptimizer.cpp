@@ -0,0 +1,563 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+    const uint32_t INVALID = 0xFFFFFFFFu;
+
+    // Scoring parameters from Forsyth's paper
+    const unsigned FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+    const unsigned VALENCE_TABLE_SIZE = 32;
+
+    // Overdraw estimator setup
+    const unsigned OVERDRAW_VIEW_COUNT = 16;
+    const unsigned OVERDRAW_RESOLUTION = 256;
+
+    // Clusterings OptimizeOverdraw tries before keeping the input order
+    const unsigned OVERDRAW_ATTEMPTS = 4;
+
+    class ForsythScore {
+    public:
+        ForsythScore() {
+            for (unsigned i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+                if (i < 3) {
+                    m_cache[i] = LAST_TRIANGLE_SCORE;
+                } else {
+                    const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    m_cache[i] = powf(1.0f - (i - 3) * scale, CACHE_DECAY_POWER);
+                }
+            }
+            for (unsigned i = 0; i < VALENCE_TABLE_SIZE; ++i) {
+                m_valence[i] = ValenceBoost(i);
+            }
+        }
+
+        float operator()(uint32_t cachePosition, uint32_t remainingTriangles) const {
+            // Vertices with nothing left to draw never attract triangles
+            if (remainingTriangles == 0) {
+                return -1.0f;
+            }
+
+            float score = cachePosition < FORSYTH_CACHE_SIZE ? m_cache[cachePosition] : 0.0f;
+            score += remainingTriangles < VALENCE_TABLE_SIZE ? m_valence[remainingTriangles] : ValenceBoost(remainingTriangles);
+            return score;
+        }
+
+    private:
+        static float ValenceBoost(uint32_t remainingTriangles) {
+            return remainingTriangles ? VALENCE_BOOST_SCALE * powf(float(remainingTriangles), -VALENCE_BOOST_POWER) : 0.0f;
+        }
+
+        float m_cache[FORSYTH_CACHE_SIZE];
+        float m_valence[VALENCE_TABLE_SIZE];
+    };
+
+    // Submeshes reference a window of the shared vertex buffer, so per-vertex
+    // state is sized to the referenced index range rather than the whole buffer.
+    void IndexRange(const uint32_t* indices, size_t indexCount, uint32_t& minIndex, uint32_t& maxIndex) {
+        minIndex = INVALID;
+        maxIndex = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            minIndex = std::min(minIndex, indices[i]);
+            maxIndex = std::max(maxIndex, indices[i]);
+        }
+    }
+
+    // FIFO post-transform cache simulation over vertices [0, vertexCount)
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, unsigned cacheSize) : m_loadedAt(vertexCount, 0), m_time(0), m_size(cacheSize) {}
+
+        // A vertex is resident while fewer than cacheSize misses have happened
+        // since it was loaded. Returns 1 on a miss.
+        unsigned Access(uint32_t vertex) {
+            size_t& timestamp = m_loadedAt[vertex];
+            if (timestamp == 0 || m_time + 1 - timestamp > m_size) {
+                timestamp = ++m_time;
+                return 1;
+            }
+            return 0;
+        }
+
+        // Evicts everything by advancing time past every resident entry
+        void Reset() {
+            m_time += m_size;
+        }
+
+    private:
+        std::vector<size_t> m_loadedAt;
+        size_t m_time;
+        unsigned m_size;
+    };
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 operator+(const Float3& a, const Float3& b) { Float3 r = { a.x + b.x, a.y + b.y, a.z + b.z }; return r; }
+    Float3 operator-(const Float3& a, const Float3& b) { Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+    Float3 operator*(const Float3& a, float s) { Float3 r = { a.x * s, a.y * s, a.z * s }; return r; }
+
+    float Dot(const Float3& a, const Float3& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b) {
+        Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        return r;
+    }
+
+    Float3 Normalize(const Float3& a) {
+        const float length = sqrtf(Dot(a, a));
+        return length > 0.0f ? a * (1.0f / length) : a;
+    }
+
+    Float3 LoadPosition(const float* positions, size_t stride, uint32_t index) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * stride);
+        Float3 r = { p[0], p[1], p[2] };
+        return r;
+    }
+
+    // Cuts the triangles into clusters whose ACMR is within threshold of their
+    // run's and writes them to output, outward-facing clusters first
+    void SortClusters(const uint32_t* indices, size_t triangleCount, const float* positions, size_t positionStride, float threshold, uint32_t* output) {
+        uint32_t minIndex, maxIndex;
+        IndexRange(indices, triangleCount * 3, minIndex, maxIndex);
+
+        FifoCache cache(maxIndex - minIndex + 1, MeshOptimizer::DEFAULT_CACHE_SIZE);
+        auto triangleMisses = [&](size_t t) {
+            return cache.Access(indices[t * 3 + 0] - minIndex) + cache.Access(indices[t * 3 + 1] - minIndex) + cache.Access(indices[t * 3 + 2] - minIndex);
+        };
+
+        // Hard boundaries: triangles with no cached vertex start a new run, so
+        // cutting there costs nothing
+        std::vector<size_t> hardBoundaries;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if (triangleMisses(t) == 3 || t == 0) {
+                hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // Soft boundaries: split each run wherever the part so far, simulated
+        // from a cold cache, is within threshold of the whole run's ACMR
+        std::vector<size_t> clusters;
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h) {
+            const size_t start = hardBoundaries[h];
+            const size_t end = hardBoundaries[h + 1];
+
+            cache.Reset();
+            size_t runMisses = 0;
+            for (size_t t = start; t < end; ++t) {
+                runMisses += triangleMisses(t);
+            }
+            const float limit = threshold * runMisses / (end - start);
+
+            cache.Reset();
+            clusters.push_back(start);
+            size_t misses = 0;
+            size_t triangles = 0;
+            for (size_t t = start; t < end; ++t) {
+                misses += triangleMisses(t);
+                ++triangles;
+
+                if (t + 1 < end && misses <= limit * triangles) {
+                    clusters.push_back(t + 1);
+                    cache.Reset();
+                    misses = 0;
+                    triangles = 0;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        const size_t clusterCount = clusters.size() - 1;
+
+        // Area-weighted centroids; the unnormalized face normals have length
+        // 2 * area, so summing them weights by area too
+        std::vector<Float3> clusterCentroid(clusterCount);
+        std::vector<Float3> clusterNormal(clusterCount);
+        Float3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+        float meshArea = 0.0f;
+
+        for (size_t c = 0; c < clusterCount; ++c) {
+            Float3 centroid = { 0.0f, 0.0f, 0.0f };
+            Float3 normal = { 0.0f, 0.0f, 0.0f };
+            float area = 0.0f;
+
+            for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+                const Float3 a = LoadPosition(positions, positionStride, indices[t * 3 + 0]);
+                const Float3 b = LoadPosition(positions, positionStride, indices[t * 3 + 1]);
+                const Float3 d = LoadPosition(positions, positionStride, indices[t * 3 + 2]);
+
+                const Float3 faceNormal = Cross(b - a, d - a);
+                const float faceArea = sqrtf(Dot(faceNormal, faceNormal));
+
+                centroid = centroid + (a + b + d) * (faceArea / 3.0f);
+                normal = normal + faceNormal;
+                area += faceArea;
+            }
+
+            meshCentroid = meshCentroid + centroid;
+            meshArea += area;
+
+            clusterCentroid[c] = area > 0.0f ? centroid * (1.0f / area) : centroid;
+            clusterNormal[c] = Normalize(normal);
+        }
+
+        if (meshArea > 0.0f) {
+            meshCentroid = meshCentroid * (1.0f / meshArea);
+        }
+
+        // Clusters whose faces point away from the center go first
+        std::vector<float> sortKey(clusterCount);
+        std::vector<uint32_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; ++c) {
+            sortKey[c] = Dot(clusterCentroid[c] - meshCentroid, clusterNormal[c]);
+            order[c] = uint32_t(c);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        size_t out = 0;
+        for (uint32_t c : order) {
+            const size_t first = clusters[c] * 3;
+            const size_t last = clusters[c + 1] * 3;
+            std::copy(indices + first, indices + last, output + out);
+            out += last - first;
+        }
+    }
+}
+
+namespace MeshOptimizer {
+    VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, unsigned cacheSize) {
+        VertexCacheStats stats = {};
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return stats;
+        }
+
+        uint32_t minIndex, maxIndex;
+        IndexRange(indices, triangleCount * 3, minIndex, maxIndex);
+
+        FifoCache cache(maxIndex - minIndex + 1, cacheSize);
+        std::vector<bool> seen(maxIndex - minIndex + 1, false);
+        size_t referenced = 0;
+
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            const uint32_t vertex = indices[i] - minIndex;
+
+            if (!seen[vertex]) {
+                seen[vertex] = true;
+                ++referenced;
+            }
+            stats.transformed += cache.Access(vertex);
+        }
+
+        stats.acmr = float(stats.transformed) / triangleCount;
+        stats.atvr = float(stats.transformed) / referenced;
+        return stats;
+    }
+
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount) {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        static const ForsythScore score;
+
+        uint32_t minIndex, maxIndex;
+        IndexRange(indices, triangleCount * 3, minIndex, maxIndex);
+        const size_t vertexCount = maxIndex - minIndex + 1;
+
+        std::vector<uint32_t> input(indices, indices + triangleCount * 3);
+        for (auto& index : input) {
+            index -= minIndex;
+        }
+
+        // Per-vertex lists of not-yet-emitted triangles. The live part of each list
+        // is [adjacencyOffset[v], adjacencyOffset[v] + remaining[v]).
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (auto index : input) {
+            ++remaining[index];
+        }
+
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < input.size(); ++i) {
+                adjacency[fill[input[i]]++] = uint32_t(i / 3);
+            }
+        }
+
+        std::vector<uint32_t> cachePosition(vertexCount, INVALID);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexScore[v] = score(INVALID, remaining[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        uint32_t bestTriangle = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const uint32_t* tri = &input[t * 3];
+            triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+            if (triangleScore[t] > triangleScore[bestTriangle]) {
+                bestTriangle = uint32_t(t);
+            }
+        }
+
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        size_t cacheCount = 0;
+
+        // Fallback when the cache has no candidates left: resume from the first
+        // triangle in input order that hasn't been emitted yet
+        size_t nextUnemitted = 0;
+
+        for (size_t out = 0; out < triangleCount; ++out) {
+            if (bestTriangle == INVALID) {
+                while (emitted[nextUnemitted]) {
+                    ++nextUnemitted;
+                }
+                bestTriangle = uint32_t(nextUnemitted);
+            }
+
+            const uint32_t* tri = &input[bestTriangle * 3];
+            indices[out * 3 + 0] = tri[0] + minIndex;
+            indices[out * 3 + 1] = tri[1] + minIndex;
+            indices[out * 3 + 2] = tri[2] + minIndex;
+            emitted[bestTriangle] = true;
+
+            // Drop the triangle from its vertices' live adjacency lists
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = tri[k];
+                uint32_t* list = &adjacency[adjacencyOffset[v]];
+                const uint32_t count = remaining[v];
+
+                for (uint32_t i = 0; i < count; ++i) {
+                    if (list[i] == bestTriangle) {
+                        list[i] = list[count - 1];
+                        list[count - 1] = bestTriangle;
+                        break;
+                    }
+                }
+                --remaining[v];
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache
+            size_t newCount = 0;
+            newCache[newCount++] = tri[0];
+            newCache[newCount++] = tri[1];
+            newCache[newCount++] = tri[2];
+            for (size_t i = 0; i < cacheCount; ++i) {
+                const uint32_t v = cache[i];
+                if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            // Entries past FORSYTH_CACHE_SIZE were evicted; they still get rescored
+            for (size_t i = 0; i < newCount; ++i) {
+                cachePosition[newCache[i]] = i < FORSYTH_CACHE_SIZE ? uint32_t(i) : INVALID;
+            }
+
+            for (size_t i = 0; i < newCount; ++i) {
+                const uint32_t v = newCache[i];
+                const float newScore = score(cachePosition[v], remaining[v]);
+                const float delta = newScore - vertexScore[v];
+                vertexScore[v] = newScore;
+
+                const uint32_t* list = &adjacency[adjacencyOffset[v]];
+                for (uint32_t j = 0; j < remaining[v]; ++j) {
+                    triangleScore[list[j]] += delta;
+                }
+            }
+
+            cacheCount = std::min<size_t>(newCount, FORSYTH_CACHE_SIZE);
+            std::copy(newCache, newCache + cacheCount, cache);
+
+            // Next triangle is the best one touching a cached vertex
+            bestTriangle = INVALID;
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < cacheCount; ++i) {
+                const uint32_t v = cache[i];
+                const uint32_t* list = &adjacency[adjacencyOffset[v]];
+
+                for (uint32_t j = 0; j < remaining[v]; ++j) {
+                    const uint32_t t = list[j];
+                    if (triangleScore[t] > bestScore || (triangleScore[t] == bestScore && t < bestTriangle)) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+        }
+    }
+
+    void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, float threshold) {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        // Each cluster meets threshold on its own, but drawn in a new order
+        // they lose the hits they had on each other's vertices. Tighter
+        // clusters are tried until the whole list meets it too; the input
+        // order always does.
+        const double budget = double(threshold) * AnalyzeVertexCache(indices, triangleCount * 3).transformed;
+        const std::vector<uint32_t> input(indices, indices + triangleCount * 3);
+        std::vector<uint32_t> sorted(input.size());
+        float clusterThreshold = threshold;
+        for (unsigned attempt = 0; attempt < OVERDRAW_ATTEMPTS; ++attempt) {
+            SortClusters(input.data(), triangleCount, positions, positionStride, clusterThreshold, sorted.data());
+            if (AnalyzeVertexCache(sorted.data(), sorted.size()).transformed <= budget) {
+                std::copy(sorted.begin(), sorted.end(), indices);
+                return;
+            }
+            if (clusterThreshold <= 1.0f) {
+                break;
+            }
+            clusterThreshold = 1.0f + (clusterThreshold - 1.0f) * 0.5f;
+        }
+    }
+
+    size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize) {
+        char* dst = static_cast<char*>(destination);
+        const char* src = static_cast<const char*>(vertices);
+
+        std::vector<uint32_t> remap(vertexCount, INVALID);
+        uint32_t next = 0;
+
+        for (size_t i = 0; i < indexCount; ++i) {
+            uint32_t& slot = remap[indices[i]];
+
+            if (slot == INVALID) {
+                memcpy(dst + size_t(next) * vertexSize, src + size_t(indices[i]) * vertexSize, vertexSize);
+                slot = next++;
+            }
+            indices[i] = slot;
+        }
+
+        return next;
+    }
+
+    OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride) {
+        OverdrawStats stats = {};
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return stats;
+        }
+
+        std::vector<Float3> projected(vertexCount);
+        std::vector<float> depth(OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+
+        for (unsigned view = 0; view < OVERDRAW_VIEW_COUNT; ++view) {
+            // Fibonacci sphere directions cover all sides of the mesh evenly
+            const float goldenAngle = 2.39996323f;
+            const float z = 1.0f - (2.0f * view + 1.0f) / OVERDRAW_VIEW_COUNT;
+            const float radius = sqrtf(1.0f - z * z);
+            const Float3 forward = { radius * cosf(view * goldenAngle), radius * sinf(view * goldenAngle), z };
+
+            Float3 up = { 0.0f, 1.0f, 0.0f };
+            if (fabsf(forward.y) > 0.99f) {
+                up.x = 1.0f;
+                up.y = 0.0f;
+            }
+            const Float3 right = Normalize(Cross(up, forward));
+            up = Cross(forward, right);
+
+            // Orthographic projection fitted to the referenced vertices
+            float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+            for (size_t i = 0; i < triangleCount * 3; ++i) {
+                const Float3 p = LoadPosition(positions, positionStride, indices[i]);
+                Float3& q = projected[indices[i]];
+                q.x = Dot(p, right);
+                q.y = Dot(p, up);
+                q.z = Dot(p, forward);
+
+                minX = std::min(minX, q.x);
+                minY = std::min(minY, q.y);
+                maxX = std::max(maxX, q.x);
+                maxY = std::max(maxY, q.y);
+            }
+
+            const float extent = std::max(maxX - minX, maxY - minY);
+            const float scale = extent > 0.0f ? OVERDRAW_RESOLUTION / extent : 0.0f;
+            std::fill(depth.begin(), depth.end(), FLT_MAX);
+
+            for (size_t t = 0; t < triangleCount; ++t) {
+                const uint32_t i0 = indices[t * 3 + 0];
+                const uint32_t i1 = indices[t * 3 + 1];
+                const uint32_t i2 = indices[t * 3 + 2];
+
+                // Back-face culling, matching the renderer's rasterizer state
+                const Float3 a = LoadPosition(positions, positionStride, i0);
+                const Float3 b = LoadPosition(positions, positionStride, i1);
+                const Float3 c = LoadPosition(positions, positionStride, i2);
+                if (Dot(Cross(b - a, c - a), forward) >= 0.0f) {
+                    continue;
+                }
+
+                const float x0 = (projected[i0].x - minX) * scale, y0 = (projected[i0].y - minY) * scale;
+                const float x1 = (projected[i1].x - minX) * scale, y1 = (projected[i1].y - minY) * scale;
+                const float x2 = (projected[i2].x - minX) * scale, y2 = (projected[i2].y - minY) * scale;
+
+                float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+                if (area == 0.0f) {
+                    continue;
+                }
+                const float sign = area > 0.0f ? 1.0f : -1.0f;
+                area *= sign;
+
+                const int left = std::max(0, int(floorf(std::min(x0, std::min(x1, x2)))));
+                const int top = std::max(0, int(floorf(std::min(y0, std::min(y1, y2)))));
+                const int rightEdge = std::min(int(OVERDRAW_RESOLUTION) - 1, int(ceilf(std::max(x0, std::max(x1, x2)))));
+                const int bottom = std::min(int(OVERDRAW_RESOLUTION) - 1, int(ceilf(std::max(y0, std::max(y1, y2)))));
+
+                for (int y = top; y <= bottom; ++y) {
+                    for (int x = left; x <= rightEdge; ++x) {
+                        const float px = x + 0.5f;
+                        const float py = y + 0.5f;
+
+                        const float w0 = sign * ((x2 - x1) * (py - y1) - (y2 - y1) * (px - x1));
+                        const float w1 = sign * ((x0 - x2) * (py - y2) - (y0 - y2) * (px - x2));
+                        const float w2 = sign * ((x1 - x0) * (py - y0) - (y1 - y0) * (px - x0));
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                            continue;
+                        }
+
+                        const float z = (w0 * projected[i0].z + w1 * projected[i1].z + w2 * projected[i2].z) / area;
+                        float& stored = depth[y * OVERDRAW_RESOLUTION + x];
+                        if (z < stored) {
+                            stored = z;
+                            ++stats.shaded;
+                        }
+                    }
+                }
+            }
+
+            for (float d : depth) {
+                stats.covered += d != FLT_MAX;
+            }
+        }
+
+        stats.overdraw = stats.covered ? float(stats.shaded) / stats.covered : 0.0f;
+        return stats;
+    }
+}
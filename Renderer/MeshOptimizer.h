@@ -0,0 +1,73 @@
+#pragma once
+
+// Index and vertex reordering passes for indexed triangle lists. Portable; no
+// Windows or D3D dependencies.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MeshOptimizer {
+    // Post-transform cache size used for reporting. Roughly what current GPUs
+    // behave like for a 32-byte vertex.
+    static const unsigned DEFAULT_CACHE_SIZE = 16;
+
+    struct VertexCacheStats {
+        size_t transformed;
+
+        // Average cache miss ratio: vertex shader invocations per triangle. 0.5 is
+        // the lower bound for large closed meshes, 3.0 means no reuse at all.
+        float acmr;
+
+        // Average transform to vertex ratio: invocations per referenced vertex.
+        // 1.0 is optimal.
+        float atvr;
+    };
+
+    // Simulates a FIFO post-transform cache of cacheSize entries over the
+    // triangle list.
+    VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, unsigned cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Reorders the triangles in place to improve post-transform cache reuse, using
+    // Forsyth's "Linear-Speed Vertex Cache Optimisation". Triangle winding is
+    // preserved and the output depends only on the input, so repeated runs
+    // produce identical index buffers.
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount);
+
+    // Reorders vertex-cache-optimized triangles to reduce overdraw (Sander et al.,
+    // "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). The
+    // triangle sequence is cut into clusters, and clusters facing away from the
+    // mesh center are drawn first, since they tend to occlude the rest. A cluster
+    // ends as soon as its ACMR is within threshold of the ACMR the unclustered
+    // order achieved, and clusters are made coarser until the reordered list's
+    // ACMR is within threshold of the input's too, keeping the input order if
+    // they can't be. 1.0 keeps the cache efficiency; larger values trade some
+    // of it for finer sorting.
+    //
+    // positions points at the first vertex's xyz; positionStride is the vertex
+    // size in bytes. Winding must be clockwise-front, which also makes
+    // cross(b - a, c - a) point out of the front face.
+    void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, float threshold);
+
+    // Rewrites the vertex buffer so vertices appear in the order the index buffer
+    // first references them, keeping vertex fetches local, and remaps indices to
+    // match. Unreferenced vertices are dropped. destination must not alias
+    // vertices and needs room for vertexCount vertices. Returns the number of
+    // vertices written.
+    size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize);
+
+    struct OverdrawStats {
+        // Pixels covered by at least one triangle, summed over all views
+        size_t covered;
+
+        // Pixels that passed the depth test, i.e. pixel shader invocations
+        size_t shaded;
+
+        // shaded / covered; 1.0 means every pixel was shaded once
+        float overdraw;
+    };
+
+    // Estimates overdraw by rasterizing the mesh in index order with a depth test
+    // and back-face culling, from a fixed set of orthographic view directions
+    // spread over the sphere.
+    OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride);
+}
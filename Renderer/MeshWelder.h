@@ -0,0 +1,94 @@
+#pragma once
+
+// Portable vertex welding: no Windows or D3D dependencies so it can be reused by
+// offline tools as well as the renderer.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace MeshWelder {
+    // Largest vertex count that can be addressed with 16-bit indices. 0xFFFF is
+    // left unused since it doubles as the strip-cut value.
+    static const size_t MAX_16BIT_VERTICES = 0xFFFF;
+
+    inline bool FitsIn16BitIndices(size_t vertexCount) {
+        return vertexCount <= MAX_16BIT_VERTICES;
+    }
+
+    // FNV-1a over 32-bit words followed by a final avalanche so that the low bits
+    // used for bucket selection depend on every word.
+    inline uint32_t HashBytes(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint32_t hash = 2166136261u;
+        size_t i = 0;
+
+        for (; i + 4 <= size; i += 4) {
+            uint32_t word;
+            memcpy(&word, bytes + i, 4);
+            hash = (hash ^ word) * 16777619u;
+        }
+        for (; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    // Collapses bit-identical vertices into a single entry and emits one index per
+    // input vertex. Output vertices keep the order in which they were first seen.
+    // TVertex must be trivially copyable and free of padding, since its bytes are
+    // what gets hashed and compared.
+    template <typename TVertex>
+    void Weld(const TVertex* vertices, size_t vertexCount, std::vector<TVertex>& outVertices, std::vector<uint32_t>& outIndices) {
+        static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+        outVertices.clear();
+        outIndices.resize(vertexCount);
+
+        // Open addressing table at <= 50% load
+        size_t tableSize = 16;
+        while (tableSize < vertexCount * 2) {
+            tableSize <<= 1;
+        }
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, EMPTY);
+
+        for (size_t i = 0; i < vertexCount; ++i) {
+            const TVertex& vert = vertices[i];
+            size_t bucket = HashBytes(&vert, sizeof(TVertex)) & mask;
+
+            for (;;) {
+                uint32_t slot = table[bucket];
+
+                if (slot == EMPTY) {
+                    slot = static_cast<uint32_t>(outVertices.size());
+                    table[bucket] = slot;
+                    outVertices.push_back(vert);
+                    outIndices[i] = slot;
+                    break;
+                }
+
+                if (memcmp(&outVertices[slot], &vert, sizeof(TVertex)) == 0) {
+                    outIndices[i] = slot;
+                    break;
+                }
+
+                bucket = (bucket + 1) & mask;
+            }
+        }
+    }
+
+    // Narrows indices to 16 bits. Only valid when FitsIn16BitIndices holds for the
+    // welded vertex count.
+    inline void NarrowIndices(const std::vector<uint32_t>& indices, uint16_t* out) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            out[i] = static_cast<uint16_t>(indices[i]);
+        }
+    }
+}
@@ -0,0 +1,422 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Widens each normal cone slightly so float rounding in the cone math can't
+    // make the back-face test cull a visible triangle
+    const float CONE_SLACK = 1e-3f;
+
+    const uint32_t INVALID_TRIANGLE = 0xFFFFFFFFu;
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 Subtract(const Float3& a, const Float3& b) {
+        Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z };
+        return r;
+    }
+
+    float Dot(const Float3& a, const Float3& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    float Length(const Float3& a) {
+        return sqrtf(Dot(a, a));
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b) {
+        Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        return r;
+    }
+
+    Float3 LoadPosition(const float* positions, size_t stride, uint32_t index) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * stride);
+        Float3 r = { p[0], p[1], p[2] };
+        return r;
+    }
+
+    // Ritter's bounding sphere: start from a sphere spanning two far-apart
+    // points, then grow it to take in any point left outside
+    void ComputeSphere(const uint32_t* indices, size_t indexCount, const float* positions, size_t stride, Float3& center, float& radius) {
+        const Float3 first = LoadPosition(positions, stride, indices[0]);
+
+        Float3 a = first;
+        float farthest = -1.f;
+        for (size_t i = 0; i < indexCount; ++i) {
+            const Float3 p = LoadPosition(positions, stride, indices[i]);
+            const float d = Length(Subtract(p, first));
+            if (d > farthest) {
+                farthest = d;
+                a = p;
+            }
+        }
+
+        Float3 b = a;
+        farthest = -1.f;
+        for (size_t i = 0; i < indexCount; ++i) {
+            const Float3 p = LoadPosition(positions, stride, indices[i]);
+            const float d = Length(Subtract(p, a));
+            if (d > farthest) {
+                farthest = d;
+                b = p;
+            }
+        }
+
+        center.x = (a.x + b.x) * 0.5f;
+        center.y = (a.y + b.y) * 0.5f;
+        center.z = (a.z + b.z) * 0.5f;
+        radius = farthest * 0.5f;
+
+        for (size_t i = 0; i < indexCount; ++i) {
+            const Float3 p = LoadPosition(positions, stride, indices[i]);
+            const float d = Length(Subtract(p, center));
+            if (d > radius) {
+                const float grown = (radius + d) * 0.5f;
+                const float t = (grown - radius) / d;
+                center.x += (p.x - center.x) * t;
+                center.y += (p.y - center.y) * t;
+                center.z += (p.z - center.z) * t;
+                radius = grown;
+            }
+        }
+    }
+
+    void ComputeCone(const uint32_t* indices, size_t indexCount, const float* positions, size_t stride, float axis[3], float& cutoff) {
+        Float3 sum = { 0.f, 0.f, 0.f };
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            const Float3 a = LoadPosition(positions, stride, indices[i + 0]);
+            const Float3 b = LoadPosition(positions, stride, indices[i + 1]);
+            const Float3 c = LoadPosition(positions, stride, indices[i + 2]);
+
+            const Float3 normal = Cross(Subtract(b, a), Subtract(c, a));
+            const float length = Length(normal);
+            if (length > 0.f) {
+                sum.x += normal.x / length;
+                sum.y += normal.y / length;
+                sum.z += normal.z / length;
+            }
+        }
+
+        axis[0] = axis[1] = axis[2] = 0.f;
+        cutoff = 1.f;
+
+        const float sumLength = Length(sum);
+        if (sumLength == 0.f) {
+            return;
+        }
+        const Float3 direction = { sum.x / sumLength, sum.y / sumLength, sum.z / sumLength };
+
+        float minDot = 1.f;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            const Float3 a = LoadPosition(positions, stride, indices[i + 0]);
+            const Float3 b = LoadPosition(positions, stride, indices[i + 1]);
+            const Float3 c = LoadPosition(positions, stride, indices[i + 2]);
+
+            const Float3 normal = Cross(Subtract(b, a), Subtract(c, a));
+            const float length = Length(normal);
+            if (length > 0.f) {
+                minDot = std::min(minDot, Dot(normal, direction) / length);
+            }
+        }
+
+        axis[0] = direction.x;
+        axis[1] = direction.y;
+        axis[2] = direction.z;
+
+        // Half angle of 90 degrees or more: some triangle faces every direction
+        minDot -= CONE_SLACK;
+        if (minDot > 0.f) {
+            cutoff = sqrtf(1.f - minDot * minDot);
+        }
+    }
+
+    struct TriangleInfo {
+        Float3 normal;
+        Float3 centroid;
+
+        // Longest edge, used to scale distances
+        float size;
+    };
+
+    TriangleInfo MakeTriangleInfo(const uint32_t* tri, const float* positions, size_t stride) {
+        const Float3 a = LoadPosition(positions, stride, tri[0]);
+        const Float3 b = LoadPosition(positions, stride, tri[1]);
+        const Float3 c = LoadPosition(positions, stride, tri[2]);
+
+        TriangleInfo info;
+        info.normal = Cross(Subtract(b, a), Subtract(c, a));
+        const float length = Length(info.normal);
+        if (length > 0.f) {
+            info.normal.x /= length;
+            info.normal.y /= length;
+            info.normal.z /= length;
+        }
+
+        info.centroid.x = (a.x + b.x + c.x) / 3.f;
+        info.centroid.y = (a.y + b.y + c.y) / 3.f;
+        info.centroid.z = (a.z + b.z + c.z) / 3.f;
+        info.size = std::max(Length(Subtract(b, a)), std::max(Length(Subtract(c, b)), Length(Subtract(a, c))));
+        return info;
+    }
+
+    void Emit(const uint32_t* indices, size_t indexStart, size_t indexEnd, uint32_t indexBase, const float* positions, size_t stride, std::vector<Meshlets::Meshlet>& out) {
+        Meshlets::Meshlet meshlet;
+        meshlet.indexStart = indexBase + uint32_t(indexStart);
+        meshlet.indexCount = uint32_t(indexEnd - indexStart);
+
+        Float3 center;
+        ComputeSphere(indices + indexStart, indexEnd - indexStart, positions, stride, center, meshlet.radius);
+        meshlet.center[0] = center.x;
+        meshlet.center[1] = center.y;
+        meshlet.center[2] = center.z;
+
+        ComputeCone(indices + indexStart, indexEnd - indexStart, positions, stride, meshlet.coneAxis, meshlet.coneCutoff);
+        out.push_back(meshlet);
+    }
+}
+
+namespace Meshlets {
+    void Build(uint32_t* indices, size_t indexCount, uint32_t indexBase, const float* positions, size_t positionStride, std::vector<Meshlet>& out) {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        uint32_t minIndex = indices[0];
+        uint32_t maxIndex = indices[0];
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            minIndex = std::min(minIndex, indices[i]);
+            maxIndex = std::max(maxIndex, indices[i]);
+        }
+        const size_t vertexCount = maxIndex - minIndex + 1;
+
+        std::vector<uint32_t> input(indices, indices + triangleCount * 3);
+
+        // Vertex to triangle adjacency
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (uint32_t index : input) {
+            ++adjacencyOffset[index - minIndex + 1];
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < input.size(); ++i) {
+                adjacency[fill[input[i] - minIndex]++] = uint32_t(i / 3);
+            }
+        }
+
+        std::vector<TriangleInfo> triangles(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            triangles[t] = MakeTriangleInfo(&input[t * 3], positions, positionStride);
+        }
+
+        // owner[v] holds the id of the last meshlet that used vertex v
+        std::vector<uint32_t> owner(vertexCount, 0);
+        std::vector<bool> used(triangleCount, false);
+
+        // candidateOf[t] holds the id of the last meshlet that listed triangle t
+        std::vector<uint32_t> candidateOf(triangleCount, 0);
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> members;
+        size_t nextSeed = 0;
+        size_t written = 0;
+
+        for (uint32_t meshletId = 1; written < triangleCount; ++meshletId) {
+            members.clear();
+            candidates.clear();
+            size_t meshletVertices = 0;
+            Float3 normalSum = { 0.f, 0.f, 0.f };
+            Float3 centroidSum = { 0.f, 0.f, 0.f };
+
+            auto newVertexCount = [&](uint32_t t) {
+                const uint32_t* tri = &input[t * 3];
+                size_t count = 0;
+                for (int k = 0; k < 3; ++k) {
+                    const bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+                    count += !repeated && owner[tri[k] - minIndex] != meshletId;
+                }
+                return count;
+            };
+
+            auto add = [&](uint32_t t) {
+                const uint32_t* tri = &input[t * 3];
+                meshletVertices += newVertexCount(t);
+                used[t] = true;
+                members.push_back(t);
+
+                const TriangleInfo& info = triangles[t];
+                normalSum.x += info.normal.x;
+                normalSum.y += info.normal.y;
+                normalSum.z += info.normal.z;
+                centroidSum.x += info.centroid.x;
+                centroidSum.y += info.centroid.y;
+                centroidSum.z += info.centroid.z;
+
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t v = tri[k] - minIndex;
+                    owner[v] = meshletId;
+                    for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; ++a) {
+                        const uint32_t neighbor = adjacency[a];
+                        if (!used[neighbor] && candidateOf[neighbor] != meshletId) {
+                            candidateOf[neighbor] = meshletId;
+                            candidates.push_back(neighbor);
+                        }
+                    }
+                }
+            };
+
+            // Seeds follow the incoming order, so meshlets come out roughly in the
+            // order the optimization passes left the triangles
+            while (used[nextSeed]) {
+                ++nextSeed;
+            }
+            add(uint32_t(nextSeed));
+
+            while (members.size() < MAX_TRIANGLES) {
+                const float invCount = 1.f / members.size();
+                const Float3 centroid = { centroidSum.x * invCount, centroidSum.y * invCount, centroidSum.z * invCount };
+                const float normalLength = Length(normalSum);
+
+                // Prefer triangles that add few vertices, then ones that keep the
+                // normal cone narrow, then ones close to the meshlet
+                uint32_t best = INVALID_TRIANGLE;
+                float bestScore = 0.f;
+                size_t live = 0;
+
+                for (size_t c = 0; c < candidates.size(); ++c) {
+                    const uint32_t t = candidates[c];
+                    if (used[t]) {
+                        continue;
+                    }
+                    candidates[live++] = t;
+
+                    const size_t added = newVertexCount(t);
+                    if (meshletVertices + added > MAX_VERTICES) {
+                        continue;
+                    }
+
+                    const TriangleInfo& info = triangles[t];
+                    const float spread = normalLength > 0.f ? 1.f - Dot(info.normal, normalSum) / normalLength : 1.f;
+                    const float distance = Length(Subtract(info.centroid, centroid));
+                    const float score = added + spread + distance / (distance + info.size);
+
+                    if (best == INVALID_TRIANGLE || score < bestScore || (score == bestScore && t < best)) {
+                        best = t;
+                        bestScore = score;
+                    }
+                }
+                candidates.resize(live);
+
+                // Disconnected pieces: fall back to the next triangle in order
+                if (best == INVALID_TRIANGLE && candidates.empty()) {
+                    while (nextSeed < triangleCount && used[nextSeed]) {
+                        ++nextSeed;
+                    }
+                    if (nextSeed < triangleCount && meshletVertices + newVertexCount(uint32_t(nextSeed)) <= MAX_VERTICES) {
+                        best = uint32_t(nextSeed);
+                    }
+                }
+
+                if (best == INVALID_TRIANGLE) {
+                    break;
+                }
+                add(best);
+            }
+
+            // Write the meshlet's triangles back contiguously and restore vertex
+            // cache order within it
+            uint32_t* meshletIndices = indices + written * 3;
+            for (size_t m = 0; m < members.size(); ++m) {
+                std::copy(&input[members[m] * 3], &input[members[m] * 3] + 3, meshletIndices + m * 3);
+            }
+            MeshOptimizer::OptimizeVertexCache(meshletIndices, members.size() * 3);
+
+            Emit(indices, written * 3, (written + members.size()) * 3, indexBase, positions, positionStride, out);
+            written += members.size();
+        }
+    }
+
+    void ExtractFrustum(const float matrix[16], Frustum& frustum) {
+        // Column j of a row-vector transform dotted with (x, y, z, 1) gives clip
+        // coordinate j (Gribb and Hartmann)
+        float columns[4][4];
+        for (int j = 0; j < 4; ++j) {
+            for (int i = 0; i < 4; ++i) {
+                columns[j][i] = matrix[i * 4 + j];
+            }
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            frustum.planes[0][i] = columns[3][i] + columns[0][i];   // left
+            frustum.planes[1][i] = columns[3][i] - columns[0][i];   // right
+            frustum.planes[2][i] = columns[3][i] + columns[1][i];   // bottom
+            frustum.planes[3][i] = columns[3][i] - columns[1][i];   // top
+            frustum.planes[4][i] = columns[2][i];                   // near
+            frustum.planes[5][i] = columns[3][i] - columns[2][i];   // far
+        }
+
+        for (int p = 0; p < 6; ++p) {
+            float* plane = frustum.planes[p];
+            const float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.f) {
+                for (int i = 0; i < 4; ++i) {
+                    plane[i] /= length;
+                }
+            }
+        }
+    }
+
+    bool IsVisible(const Meshlet& meshlet, const Frustum& frustum, const float cameraPosition[3]) {
+        const Float3 center = { meshlet.center[0], meshlet.center[1], meshlet.center[2] };
+
+        for (int p = 0; p < 6; ++p) {
+            const float* plane = frustum.planes[p];
+            if (plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3] < -meshlet.radius) {
+                return false;
+            }
+        }
+
+        // Every point p of the sphere and normal n of the cone satisfy
+        // dot(n, p - camera) >= dot(v, axis) * cos - |v| * sin - radius, where v
+        // runs from the camera to the center. If that is positive, every
+        // triangle faces away from the camera.
+        const Float3 camera = { cameraPosition[0], cameraPosition[1], cameraPosition[2] };
+        const Float3 axis = { meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2] };
+        const Float3 view = Subtract(center, camera);
+
+        const float sine = meshlet.coneCutoff;
+        const float cosine = sqrtf(std::max(0.f, 1.f - sine * sine));
+        return !(Dot(view, axis) * cosine - Length(view) * sine > meshlet.radius);
+    }
+
+    size_t Cull(const Meshlet* meshlets, size_t count, const Frustum& frustum, const float cameraPosition[3], std::vector<DrawRange>& ranges) {
+        const size_t firstRange = ranges.size();
+        size_t visible = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            const Meshlet& meshlet = meshlets[i];
+            if (!IsVisible(meshlet, frustum, cameraPosition)) {
+                continue;
+            }
+            ++visible;
+
+            if (ranges.size() > firstRange && ranges.back().indexStart + ranges.back().indexCount == meshlet.indexStart) {
+                ranges.back().indexCount += meshlet.indexCount;
+            } else {
+                DrawRange range = { meshlet.indexStart, meshlet.indexCount };
+                ranges.push_back(range);
+            }
+        }
+
+        return visible;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Meshlet partitioning and cluster culling. Portable; no Windows or D3D
+// dependencies.
+//
+// Meshlets are grown greedily over shared vertices, preferring triangles that
+// keep the normal cone narrow and the cluster compact. Each meshlet's triangles
+// are then written back as one contiguous index range, so drawing a subset of
+// meshlets needs nothing beyond DrawIndexedInstanced over the surviving ranges.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Meshlets {
+    static const size_t MAX_VERTICES = 64;
+    static const size_t MAX_TRIANGLES = 124;
+
+    struct Meshlet {
+        uint32_t indexStart;
+        uint32_t indexCount;
+
+        // Bounding sphere
+        float center[3];
+        float radius;
+
+        // Every triangle's front-face normal lies within the cone around coneAxis
+        // with sin(half angle) == coneCutoff. A cutoff of 1 means the normals are
+        // too spread out to ever cull the meshlet as back-facing.
+        float coneAxis[3];
+        float coneCutoff;
+    };
+
+    // Contiguous run of indices to draw
+    struct DrawRange {
+        uint32_t indexStart;
+        uint32_t indexCount;
+    };
+
+    // Planes are (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside, and are
+    // normalized so the left side is a signed distance
+    struct Frustum {
+        float planes[6][4];
+    };
+
+    // Partitions indices[0, indexCount) into meshlets, reordering the triangles in
+    // place so each meshlet is contiguous, and appends the meshlets to out. Seeds
+    // are taken in the incoming triangle order, so an overdraw-sorted order is
+    // roughly kept, and each meshlet is re-optimized for the vertex cache.
+    // indexBase is the offset of indices within the mesh's index buffer and is
+    // added to each meshlet's indexStart. Front faces are clockwise, i.e.
+    // cross(b - a, c - a) points out of the surface.
+    void Build(uint32_t* indices, size_t indexCount, uint32_t indexBase, const float* positions, size_t positionStride, std::vector<Meshlet>& out);
+
+    // Extracts the clip planes of a row-vector, D3D-style (0 <= z <= w) transform.
+    // Passing model * view * proj gives planes in the mesh's own space, so
+    // meshlet bounds can be tested without transforming them.
+    void ExtractFrustum(const float matrix[16], Frustum& frustum);
+
+    // Conservative: false only if the meshlet is entirely outside the frustum or
+    // entirely back-facing as seen from cameraPosition (in the same space)
+    bool IsVisible(const Meshlet& meshlet, const Frustum& frustum, const float cameraPosition[3]);
+
+    // Culls meshlets and appends the survivors to ranges, merged into as few
+    // contiguous ranges as possible. Returns the number of visible meshlets.
+    size_t Cull(const Meshlet* meshlets, size_t count, const Frustum& frustum, const float cameraPosition[3], std::vector<DrawRange>& ranges);
+}
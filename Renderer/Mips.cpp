@@ -0,0 +1,222 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Mips.h"
+#include "Cpu.h"
+#include "Parallel.h"
+
+namespace {
+    // Destination pixels per band when a level is split across threads:
+    // enough to outweigh handing the band out, few enough that a 4K
+    // texture's upper levels keep every thread busy
+    const uint32_t BAND_PIXELS = 1 << 16;
+
+    // Averages the source pixels [x0, x0 + columns) x [y0, y0 + rows) into
+    // one destination pixel. Handles every block size, so it also finishes
+    // the rows the SIMD loops stop short of and the 3-pixel edges of odd
+    // sides.
+    void AverageBlock(const uint8_t* source, uint32_t width, uint32_t x0, uint32_t columns, uint32_t y0, uint32_t rows, uint8_t* out) {
+        const uint32_t count = columns * rows;
+        for (int c = 0; c < 4; ++c) {
+            uint32_t sum = count / 2;
+            for (uint32_t y = y0; y < y0 + rows; ++y) {
+                const uint8_t* row = source + (size_t(y) * width + x0) * 4 + c;
+                for (uint32_t x = 0; x < columns; ++x) {
+                    sum += row[4 * x];
+                }
+            }
+            out[c] = static_cast<uint8_t>(sum / count);
+        }
+    }
+
+#if CPU_X86
+    // The SIMD row functions average the 2x2 blocks under destination
+    // pixels [0, count) of one row, given the two source rows, and return
+    // the number they did
+    CPU_TARGET("sse2")
+    uint32_t DownsampleRowSse2(const uint8_t* row0, const uint8_t* row1, uint32_t count, uint8_t* out) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+
+        uint32_t x = 0;
+        for (; x + 4 <= count; x += 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 8 * x));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 8 * x + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 8 * x));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 8 * x + 16));
+
+            // Column sums of source pixels 0-1, 2-3, 4-5 and 6-7, each pixel's
+            // channels in one 64-bit half
+            const __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero));
+            const __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero));
+            const __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(d, zero));
+            const __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(d, zero));
+
+            // Adding even pixels to odd ones gives destination pixels 0-1 and 2-3
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+            __m128i high = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+            low = _mm_srli_epi16(_mm_add_epi16(low, two), 2);
+            high = _mm_srli_epi16(_mm_add_epi16(high, two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(low, high));
+        }
+        return x;
+    }
+
+    // As SSE2, with each 128-bit lane holding half of the 8 pixels
+    CPU_TARGET("avx2")
+    uint32_t DownsampleRowAvx2(const uint8_t* row0, const uint8_t* row1, uint32_t count, uint8_t* out) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i two = _mm256_set1_epi16(2);
+
+        uint32_t x = 0;
+        for (; x + 8 <= count; x += 8) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 8 * x));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 8 * x + 32));
+            const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 8 * x));
+            const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 8 * x + 32));
+
+            const __m256i aLow = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(c, zero));
+            const __m256i aHigh = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(c, zero));
+            const __m256i bLow = _mm256_add_epi16(_mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(d, zero));
+            const __m256i bHigh = _mm256_add_epi16(_mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(d, zero));
+
+            // Destination pixels 0-1 and 2-3 in the lanes of first, 4-5 and
+            // 6-7 in those of second
+            __m256i first = _mm256_add_epi16(_mm256_unpacklo_epi64(aLow, aHigh), _mm256_unpackhi_epi64(aLow, aHigh));
+            __m256i second = _mm256_add_epi16(_mm256_unpacklo_epi64(bLow, bHigh), _mm256_unpackhi_epi64(bLow, bHigh));
+            first = _mm256_srli_epi16(_mm256_add_epi16(first, two), 2);
+            second = _mm256_srli_epi16(_mm256_add_epi16(second, two), 2);
+
+            // Packing leaves pixel pairs in the order 0-1, 4-5, 2-3, 6-7
+            const __m256i packed = _mm256_packus_epi16(first, second);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+        return x;
+    }
+#endif
+
+#if CPU_ARM64
+    // Pairwise widening adds sum horizontal neighbors within each channel,
+    // and the rounding narrow adds 2 before dividing by 4
+    uint32_t DownsampleRowNeon(const uint8_t* row0, const uint8_t* row1, uint32_t count, uint8_t* out) {
+        uint32_t x = 0;
+        for (; x + 8 <= count; x += 8) {
+            const uint8x16x4_t a = vld4q_u8(row0 + 8 * x);
+            const uint8x16x4_t b = vld4q_u8(row1 + 8 * x);
+            uint8x8x4_t result;
+            for (int c = 0; c < 4; ++c) {
+                result.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[c]), b.val[c]), 2);
+            }
+            vst4_u8(out + 4 * x, result);
+        }
+        return x;
+    }
+#endif
+
+    bool Supported(Mips::Implementation implementation) {
+        switch (implementation) {
+        case Mips::SCALAR: return true;
+        case Mips::SSE2: return CPU_X86 != 0;
+        case Mips::AVX2: return CPU_X86 && Cpu::GetFeatures().avx2;
+        case Mips::NEON: return CPU_ARM64 != 0;
+        default: return false;
+        }
+    }
+}
+
+namespace Mips {
+    Implementation Fastest() {
+#if CPU_X86
+        // Every CPU that runs D3D12 has SSE2
+        return Cpu::GetFeatures().avx2 ? AVX2 : SSE2;
+#elif CPU_ARM64
+        return NEON;
+#else
+        return SCALAR;
+#endif
+    }
+
+    const char* Name(Implementation implementation) {
+        switch (implementation) {
+        case SSE2: return "SSE2";
+        case AVX2: return "AVX2";
+        case NEON: return "NEON";
+        default: return "scalar";
+        }
+    }
+
+    uint32_t LevelCount(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        while (width > 1 || height > 1) {
+            width = Next(width);
+            height = Next(height);
+            ++levels;
+        }
+        return levels;
+    }
+
+    size_t ChainPixels(uint32_t width, uint32_t height) {
+        size_t pixels = size_t(width) * height;
+        while (width > 1 || height > 1) {
+            width = Next(width);
+            height = Next(height);
+            pixels += size_t(width) * height;
+        }
+        return pixels;
+    }
+
+    void Downsample(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, Implementation implementation) {
+        DownsampleRows(source, width, height, destination, 0, Next(height), implementation);
+    }
+
+    void DownsampleRows(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, uint32_t firstRow, uint32_t rowCount,
+        Implementation implementation) {
+        if (!Supported(implementation)) {
+            implementation = Fastest();
+        }
+
+        const uint32_t nextWidth = Next(width);
+        const uint32_t nextHeight = Next(height);
+
+        // Destination pixels covering exactly 2 source columns; an odd last
+        // one covers 3, and a single column covers itself
+        const uint32_t pairs = width < 2 ? 0 : (width & 1 ? nextWidth - 1 : nextWidth);
+
+        const uint32_t endRow = firstRow + rowCount < nextHeight ? firstRow + rowCount : nextHeight;
+        for (uint32_t y = firstRow; y < endRow; ++y) {
+            const uint32_t y0 = 2 * y;
+            const uint32_t rows = height < 2 ? 1 : (y + 1 == nextHeight && (height & 1) ? 3 : 2);
+            uint8_t* out = destination + size_t(y) * nextWidth * 4;
+
+            uint32_t done = 0;
+            if (rows == 2) {
+                const uint8_t* row0 = source + size_t(y0) * width * 4;
+                const uint8_t* row1 = row0 + size_t(width) * 4;
+#if CPU_X86
+                if (implementation == AVX2) {
+                    done = DownsampleRowAvx2(row0, row1, pairs, out);
+                } else if (implementation == SSE2) {
+                    done = DownsampleRowSse2(row0, row1, pairs, out);
+                }
+#elif CPU_ARM64
+                if (implementation == NEON) {
+                    done = DownsampleRowNeon(row0, row1, pairs, out);
+                }
+#endif
+            }
+
+            for (uint32_t x = done; x < nextWidth; ++x) {
+                const uint32_t columns = width < 2 ? 1 : (x < pairs ? 2 : 3);
+                AverageBlock(source, width, 2 * x, columns, y0, rows, out + 4 * x);
+            }
+        }
+    }
+
+    void DownsampleBanded(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, unsigned threadCount,
+        Implementation implementation) {
+        const uint32_t bandRows = std::max<uint32_t>(1, BAND_PIXELS / Next(width));
+        const uint32_t bands = (Next(height) + bandRows - 1) / bandRows;
+        Parallel::For(bands, threadCount, [&](size_t band) {
+            DownsampleRows(source, width, height, destination, static_cast<uint32_t>(band) * bandRows, bandRows, implementation);
+        });
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Box-filter mip generation for RGBA8 images. Portable; no Windows or D3D
+// dependencies.
+//
+// Each side of the next level is half the last, rounded down but never less
+// than 1, as D3D sizes mips. Every destination pixel is the mean of the
+// source pixels it covers, rounded to nearest with halves rounding up. That
+// is a 2x2 block almost everywhere; when a side is odd its last destination
+// pixel covers 3 source pixels instead, so no source row or column is ever
+// dropped, and a side of 1 stays 1. Whole rows of 2x2 blocks are averaged in
+// 16-bit integer lanes, which is exact, on CPUs with the instructions.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Mips {
+    enum Implementation {
+        SCALAR,
+        // 4 destination pixels at a time
+        SSE2,
+        // 8 destination pixels at a time
+        AVX2,
+        // 8 destination pixels at a time, with channels deinterleaved on load
+        NEON,
+    };
+
+    // The fastest implementation this CPU supports
+    Implementation Fastest();
+    const char* Name(Implementation implementation);
+
+    // The size of a side one level down
+    inline uint32_t Next(uint32_t size) {
+        return size > 1 ? size / 2 : 1;
+    }
+
+    // Levels in a full chain down to 1x1, counting the base level
+    uint32_t LevelCount(uint32_t width, uint32_t height);
+
+    // Pixels in a full chain, counting the base level
+    size_t ChainPixels(uint32_t width, uint32_t height);
+
+    // Filters source, width x height pixels with rows tightly packed, into
+    // destination, which holds Next(width) x Next(height) pixels
+    void Downsample(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, Implementation implementation = Fastest());
+
+    // As Downsample, writing only destination rows [firstRow, firstRow +
+    // rowCount), so separate threads can fill separate bands of one level
+    void DownsampleRows(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, uint32_t firstRow, uint32_t rowCount,
+        Implementation implementation = Fastest());
+
+    // As Downsample, split into bands of rows filled by up to threadCount
+    // threads (0 = one per hardware thread). The output is the same for any
+    // thread count.
+    void DownsampleBanded(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, unsigned threadCount,
+        Implementation implementation = Fastest());
+}
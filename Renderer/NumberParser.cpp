@@ -0,0 +1,287 @@
+// Built without the precompiled header so the parser can run headless
+#include "NumberParser.h"
+#include "Cpu.h"
+#include <cstdint>
+
+namespace {
+    // tinyobj's table of fraction digit weights. The fast paths stop at the
+    // last entry; beyond it tinyobj switches to std::pow.
+    const double POW_LUT[] = {
+        1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+    };
+    const int MAX_FRACTION_DIGITS = sizeof(POW_LUT) / sizeof(POW_LUT[0]) - 1;
+
+    // Integer parts up to this long are exact when accumulated in a double
+    const int MAX_INTEGER_DIGITS = 15;
+
+    // atoi results up to this long can't overflow an int
+    const int MAX_INT_DIGITS = 9;
+
+    const int MAX_VALUES_PER_BATCH = 4;
+
+    inline bool IsTerminator(char c) {
+        // tinyobj ends a value at space, tab, CR or the end of the line
+        return c == ' ' || c == '\t' || c == '\r' || c == '\0';
+    }
+
+    inline const char* SkipSpace(const char* p) {
+        while (*p == ' ' || *p == '\t') {
+            ++p;
+        }
+        return p;
+    }
+
+    inline float Assemble(bool negative, double mantissa) {
+        // Same expression as tinyobj's, including -0 for "-0"
+        return static_cast<float>((negative ? -1 : 1) * mantissa);
+    }
+
+#if CPU_X86
+    // A value in the fast-path form, split into its parts
+    struct Lexed {
+        bool negative;
+        uint64_t integer;
+        // Fraction digit values, zero past fractionLength
+        __m128i fraction;
+        int fractionLength;
+        const char* end;
+    };
+
+    // Value of the first length (at most 16) digits in text, which holds digit
+    // values rather than characters
+    CPU_TARGET("sse4.2")
+    inline uint64_t DigitsToInt(__m128i text, int length) {
+        // Right-align the digits. Lanes before them get a negative shuffle
+        // index, which zeroes them.
+        const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m128i digits = _mm_shuffle_epi8(text, _mm_add_epi8(lanes, _mm_set1_epi8(static_cast<char>(length - 16))));
+
+        // Combine neighbours into 2, 4 and then 8 digit groups
+        const __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+        const __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+        const __m128i octets = _mm_madd_epi16(_mm_packus_epi32(quads, quads), _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+        return static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(octets))) * 100000000u +
+            static_cast<uint32_t>(_mm_extract_epi32(octets, 1));
+    }
+
+    // Loads the 16 bytes at p as digit values and sets bit i of nonDigits for
+    // each byte that isn't an ASCII digit. Bit 16 is always set, so the lowest
+    // set bit gives the length of the leading digit run. The NUL ending the
+    // text is a non-digit, so bytes past it never count.
+    CPU_TARGET("sse4.2")
+    inline __m128i LoadDigits(const char* p, unsigned* nonDigits) {
+        const __m128i text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Unsigned range check: digits map to 0..9 and everything else above
+        const __m128i values = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+        *nonDigits = (~static_cast<unsigned>(_mm_movemask_epi8(isDigit)) & 0xFFFFu) | 0x10000u;
+        return values;
+    }
+
+    inline int LowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // Splits the value at p (leading space already skipped) if it's in the
+    // fast-path form and fully consumes its token
+    CPU_TARGET("sse4.2")
+    inline bool Lex(const char* p, Lexed& lexed) {
+        lexed.negative = false;
+        if (*p == '-' || *p == '+') {
+            lexed.negative = *p == '-';
+            ++p;
+        }
+
+        // One load covers the integer digits, the point and the fraction
+        // digits; values that don't fit are left to tinyobj
+        unsigned nonDigits;
+        const __m128i text = LoadDigits(p, &nonDigits);
+
+        // No integer digits (".5", "-.5") is legal but left to tinyobj
+        const int integerLength = LowestBit(nonDigits);
+        if (integerLength == 0 || integerLength > MAX_INTEGER_DIGITS) {
+            return false;
+        }
+
+        const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        lexed.integer = DigitsToInt(text, integerLength);
+        lexed.fraction = _mm_setzero_si128();
+        lexed.fractionLength = 0;
+        p += integerLength;
+
+        if (*p == '.') {
+            const int fractionLength = LowestBit(nonDigits >> (integerLength + 1));
+            if (fractionLength > MAX_FRACTION_DIGITS || integerLength + 1 + fractionLength >= 16) {
+                return false;
+            }
+
+            // Shift the fraction digits down to lane 0 and clear the rest
+            const __m128i shifted = _mm_shuffle_epi8(text, _mm_add_epi8(lanes, _mm_set1_epi8(static_cast<char>(integerLength + 1))));
+            const __m128i inFraction = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(fractionLength)), lanes);
+            lexed.fraction = _mm_and_si128(shifted, inFraction);
+            lexed.fractionLength = fractionLength;
+            p += 1 + fractionLength;
+        }
+
+        // Exponents and trailing garbage are left to tinyobj
+        if (!IsTerminator(*p)) {
+            return false;
+        }
+        lexed.end = p;
+        return true;
+    }
+
+    CPU_TARGET("sse4.2")
+    size_t ParseRealsSse42(const char** token, float* values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Lexed lexed;
+            if (!Lex(SkipSpace(*token), lexed)) {
+                return i;
+            }
+
+            alignas(16) uint8_t digits[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(digits), lexed.fraction);
+
+            // tinyobj's accumulation, one digit at a time
+            double mantissa = static_cast<double>(lexed.integer);
+            for (int k = 1; k <= lexed.fractionLength; ++k) {
+                mantissa += static_cast<int>(digits[k - 1]) * POW_LUT[k];
+            }
+            values[i] = Assemble(lexed.negative, mantissa);
+            *token = lexed.end;
+        }
+        return count;
+    }
+
+    // Lexes up to four values, then accumulates their fractions in parallel.
+    // Each lane sees exactly the sequence of multiplies and adds tinyobj would
+    // do for its value; lanes whose fraction has ended add zero, which leaves
+    // their non-negative mantissa unchanged.
+    CPU_TARGET("avx2")
+    size_t ParseRealsBatchAvx2(const char** token, float* values, size_t count) {
+        Lexed lexed[MAX_VALUES_PER_BATCH];
+        size_t lexedCount = 0;
+        int fractionLength = 0;
+        const char* p = *token;
+        while (lexedCount < count && Lex(SkipSpace(p), lexed[lexedCount])) {
+            fractionLength = lexed[lexedCount].fractionLength > fractionLength ? lexed[lexedCount].fractionLength : fractionLength;
+            p = lexed[lexedCount].end;
+            lexedCount++;
+        }
+        if (lexedCount == 0) {
+            return 0;
+        }
+
+        alignas(32) double integers[MAX_VALUES_PER_BATCH] = {};
+        __m128i rows[MAX_VALUES_PER_BATCH] = {};
+        for (size_t i = 0; i < lexedCount; ++i) {
+            integers[i] = static_cast<double>(lexed[i].integer);
+            rows[i] = lexed[i].fraction;
+        }
+
+        // Transpose so each 32-bit group holds one digit position of all four
+        // values
+        const __m128i rows01 = _mm_unpacklo_epi8(rows[0], rows[1]);
+        const __m128i rows23 = _mm_unpacklo_epi8(rows[2], rows[3]);
+        alignas(16) int32_t columns[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(columns), _mm_unpacklo_epi16(rows01, rows23));
+        _mm_store_si128(reinterpret_cast<__m128i*>(columns + 4), _mm_unpackhi_epi16(rows01, rows23));
+
+        __m256d mantissa = _mm256_load_pd(integers);
+        for (int k = 1; k <= fractionLength; ++k) {
+            const __m256d digit = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(columns[k - 1])));
+            mantissa = _mm256_add_pd(mantissa, _mm256_mul_pd(digit, _mm256_set1_pd(POW_LUT[k])));
+        }
+
+        alignas(32) double mantissas[MAX_VALUES_PER_BATCH];
+        _mm256_store_pd(mantissas, mantissa);
+        for (size_t i = 0; i < lexedCount; ++i) {
+            values[i] = Assemble(lexed[i].negative, mantissas[i]);
+        }
+        *token = p;
+        return lexedCount;
+    }
+
+    CPU_TARGET("avx2")
+    size_t ParseRealsAvx2(const char** token, float* values, size_t count) {
+        size_t parsed = 0;
+        while (parsed < count) {
+            const size_t batch = count - parsed < MAX_VALUES_PER_BATCH ? count - parsed : MAX_VALUES_PER_BATCH;
+            const size_t batchParsed = ParseRealsBatchAvx2(token, values + parsed, batch);
+            parsed += batchParsed;
+            if (batchParsed < batch) {
+                break;
+            }
+        }
+        return parsed;
+    }
+
+    CPU_TARGET("sse4.2")
+    bool ParseIntSse42(const char* token, int* value) {
+        bool negative = false;
+        if (*token == '-') {
+            negative = true;
+            ++token;
+        }
+
+        // Empty runs include atoi's leading whitespace and '+' cases
+        unsigned nonDigits;
+        const __m128i text = LoadDigits(token, &nonDigits);
+        const int length = LowestBit(nonDigits);
+        if (length == 0 || length > MAX_INT_DIGITS) {
+            return false;
+        }
+
+        const int magnitude = static_cast<int>(DigitsToInt(text, length));
+        *value = negative ? -magnitude : magnitude;
+        return true;
+    }
+#endif
+}
+
+NumberParser::Implementation NumberParser::Fastest() {
+    const Cpu::Features& features = Cpu::GetFeatures();
+    if (features.avx2 && features.sse42) {
+        return AVX2;
+    }
+    return features.sse42 ? SSE42 : SCALAR;
+}
+
+const char* NumberParser::Name(Implementation implementation) {
+    switch (implementation) {
+    case SSE42:
+        return "SSE4.2";
+    case AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+size_t NumberParser::ParseReals(Implementation implementation, const char** token, float* values, size_t count) {
+#if CPU_X86
+    if (implementation == AVX2) {
+        return ParseRealsAvx2(token, values, count);
+    }
+    if (implementation == SSE42) {
+        return ParseRealsSse42(token, values, count);
+    }
+#endif
+    return 0;
+}
+
+bool NumberParser::ParseInt(Implementation implementation, const char* token, int* value) {
+#if CPU_X86
+    if (implementation != SCALAR) {
+        return ParseIntSse42(token, value);
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// SIMD fast paths for the numbers in OBJ records. Portable; no Windows or D3D
+// dependencies.
+//
+// Results are bit-identical to tinyobj's parseReal and to atoi. Rather than
+// reimplementing every corner of tinyobj's grammar, the fast paths only accept
+// the forms exporters actually write, "[sign]digits[.digits]" with at most 15
+// integer and 7 fraction digits and no exponent, and report anything else so
+// the caller can fall back to tinyobj. Within that form tinyobj's arithmetic is
+// replayed exactly: the integer part is exact in a double, and the fraction is
+// accumulated digit by digit with the same powers of ten.
+//
+// Tokens are scanned 16 bytes at a time, so the text must stay readable for
+// PADDING bytes past the NUL that ends it.
+
+#include <cstddef>
+
+namespace NumberParser {
+    static const size_t PADDING = 32;
+
+    enum Implementation {
+        // No fast path: every call reports a fallback
+        SCALAR,
+        // SSE4.2 string compares find the digit runs and SSSE3 multiply-adds
+        // convert them; fraction digits are accumulated one value at a time
+        SSE42,
+        // As SSE42, but the fractions of a record's values are accumulated
+        // together in the lanes of one AVX register
+        AVX2,
+    };
+
+    // The fastest implementation this CPU supports
+    Implementation Fastest();
+    const char* Name(Implementation implementation);
+
+    // Parses up to count values the way count calls to tinyobj's
+    // parseReal(token) would, advancing *token past each one. Stops at the first
+    // value outside the fast path, leaving *token at it, and returns how many
+    // values were parsed.
+    size_t ParseReals(Implementation implementation, const char** token, float* values, size_t count);
+
+    // Same result as atoi(token) when it returns true; false means the caller
+    // has to use atoi
+    bool ParseInt(Implementation implementation, const char* token, int* value);
+}
@@ -1,20 +1,291 @@
 #include "stdafx.h"
 #include "ObjLoader.h"
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "Chunks.h"
+#include "Geometry.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshWelder.h"
+#include "Meshlets.h"
+#include "ObjParser.h"
+#include "ObjStream.h"
+#include "Occluders.h"
+#include "Parallel.h"
+#include "Simplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    // Allowed ACMR increase from overdraw ordering, relative to the cache
+    // optimized order
+    const float OVERDRAW_THRESHOLD = 1.05f;
+
+    // Upper bound on the triangles in one chunk. Leaves of the median split
+    // end up with between half of this and all of it.
+    const size_t CHUNK_TRIANGLES = 16384;
+
+    // Largest difference debug builds allow between the SIMD and scalar
+    // normals. The kernels do the same arithmetic, so this only leaves room for
+    // a compiler fusing the scalar code's multiplies and adds.
+    const float NORMAL_TOLERANCE = 1e-4f;
+
+    // Triangle budget of each occluder
+    const size_t OCCLUDER_TRIANGLES = 128;
+
+    // Farthest a surface may stray from flat and still become occluder quads,
+    // and the smallest quad kept, relative to the diagonal of the chunk's box
+    // and its square
+    const float OCCLUDER_TOLERANCE = 1e-4f;
+    const float OCCLUDER_MIN_AREA = 1e-4f;
+
+    double MillisecondsSince(const LARGE_INTEGER& start) {
+        LARGE_INTEGER frequency, now;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&now);
+        return double(now.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+    }
+
+    // What the simplifier treats as one vertex. Normals are left out: they are
+    // per face, so including them would make every edge an attribute seam.
+    struct PositionTexCoord {
+        XMFLOAT3 position;
+        XMFLOAT2 texCoord;
+    };
+
+    Material ConvertMaterial(const tinyobj::material_t& source, const std::string& baseDir) {
+        Material material = {};
+        strncpy_s(material.name, source.name.c_str(), _TRUNCATE);
+        material.diffuse = XMFLOAT3(source.diffuse[0], source.diffuse[1], source.diffuse[2]);
+        material.dissolve = source.dissolve;
+        if (!source.diffuse_texname.empty()) {
+            strncpy_s(material.diffuseTexture, (baseDir + source.diffuse_texname).c_str(), _TRUNCATE);
+        }
+        return material;
+    }
+
+    // Materials with corners, ordered so that those sharing a diffuse texture
+    // are adjacent, as back-to-back submeshes. cursor receives each
+    // material's first corner.
+    std::vector<Submesh> MaterialSubmeshes(const std::vector<Material>& materials, const std::vector<UINT>& cornerCounts, std::vector<UINT>& cursor) {
+        std::vector<UINT> materialOrder;
+        for (UINT m = 0; m < materials.size(); ++m) {
+            if (cornerCounts[m] > 0) {
+                materialOrder.push_back(m);
+            }
+        }
+        std::sort(materialOrder.begin(), materialOrder.end(), [&](UINT lhs, UINT rhs) {
+            const int order = strcmp(materials[lhs].diffuseTexture, materials[rhs].diffuseTexture);
+            return order < 0 || (order == 0 && lhs < rhs);
+        });
+
+        std::vector<Submesh> submeshes;
+        cursor.assign(materials.size(), 0);
+        UINT cornerCount = 0;
+        for (UINT m : materialOrder) {
+            Submesh submesh = {};
+            submesh.indexStart = cornerCount;
+            submesh.indexCount = cornerCounts[m];
+            submesh.material = m;
+            submesh.chunk = Submesh::NO_CHUNK;
+            submeshes.push_back(submesh);
+
+            cursor[m] = cornerCount;
+            cornerCount += cornerCounts[m];
+        }
+        return submeshes;
+    }
+
+    Material FallbackMaterial() {
+        Material fallback = {};
+        strcpy_s(fallback.name, "default");
+        fallback.diffuse = XMFLOAT3(1.f, 1.f, 1.f);
+        fallback.dissolve = 1.f;
+        return fallback;
+    }
+
+    // Keeps ObjStream's batches as one vertex array and an index list per
+    // material. Vertices are only welded within a batch, so corners shared
+    // across batches still need welding once the file is done.
+    class SubmeshSink : public ObjStream::Sink {
+    public:
+        void OnMaterials(const std::vector<tinyobj::material_t>& libraryMaterials) override {
+            materials = libraryMaterials;
+        }
+
+        void OnBatch(const ObjStream::Batch& batch) override {
+            const uint32_t base = (uint32_t)vertices.size();
+            for (size_t v = 0; v < batch.vertexCount; ++v) {
+                const ObjStream::Vertex& source = batch.vertices[v];
+                Vertex vertex;
+                vertex.position = XMFLOAT3(source.position);
+                XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(source.normal))));
+                vertex.texCoord = XMFLOAT2(source.texCoord);
+                vertices.push_back(vertex);
+            }
+
+            // Batches without a material go to the fallback
+            if (batch.material >= 0 && materialIndices.size() <= (size_t)batch.material) {
+                materialIndices.resize(batch.material + 1);
+            }
+            std::vector<uint32_t>& indices = batch.material >= 0 ? materialIndices[batch.material] : fallbackIndices;
+            for (size_t i = 0; i < batch.indexCount; ++i) {
+                indices.push_back(base + batch.indices[i]);
+            }
+        }
 
-void ObjLoader::Load(const std::string fname, Vertex** vb, UINT& vbSize) {
+        // Every material loaded so far; tinyobj passes each library's
+        // materials after the earlier ones'
+        std::vector<tinyobj::material_t> materials;
+        std::vector<Vertex> vertices;
+        std::vector<std::vector<uint32_t>> materialIndices;
+        std::vector<uint32_t> fallbackIndices;
+    };
+
+    // Simplified triangles reuse the vertices of whichever face a corner
+    // collapsed into. Among the vertices sharing the corner's position and tex
+    // coord, pick the one whose normal best matches the new triangle's.
+    void MatchFaceNormals(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& classOf,
+        const std::vector<uint32_t>& classStart, const std::vector<uint32_t>& classMembers) {
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            const XMVECTOR a = XMLoadFloat3(&vertices[indices[i + 0]].position);
+            const XMVECTOR b = XMLoadFloat3(&vertices[indices[i + 1]].position);
+            const XMVECTOR c = XMLoadFloat3(&vertices[indices[i + 2]].position);
+            const XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(b - a, c - a));
+
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t attributeClass = classOf[indices[i + k]];
+                float bestDot = -FLT_MAX;
+                for (uint32_t m = classStart[attributeClass]; m < classStart[attributeClass + 1]; ++m) {
+                    const uint32_t candidate = classMembers[m];
+                    const float d = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&vertices[candidate].normal)), faceNormal));
+                    if (d > bestDot) {
+                        bestDot = d;
+                        indices[i + k] = candidate;
+                    }
+                }
+            }
+        }
+    }
+}
+
+const std::vector<float>& ObjLoader::DefaultLodRatios() {
+    static const std::vector<float> ratios = { 0.5f, 0.25f, 0.125f };
+    return ratios;
+}
+
+void ObjLoader::Load(const std::string fname, Mesh& mesh, UINT flags, const std::vector<float>& lodRatios) {
+    // Parsing and storage options don't change the result, so they don't
+    // invalidate caches
+    const UINT buildFlags = flags & ~(SIMD_NUMBER_PARSING | COMPRESS_CACHE | STREAM_OBJ);
+    if (MeshCache::Load(fname, buildFlags, mesh) && (!(flags & BUILD_LODS) || HasLods(mesh, lodRatios))) {
+        char cacheReport[256];
+        sprintf_s(cacheReport, "%s: loaded %u vertices from %s\n", fname.c_str(), mesh.vertexCount, MeshCache::CachePath(fname).c_str());
+        OutputDebugStringA(cacheReport);
+        return;
+    }
+
+    std::vector<Material> meshMaterials;
+    std::vector<Submesh> submeshes;
+    std::vector<Vertex> welded;
+    std::vector<uint32_t> indices;
+    if (flags & STREAM_OBJ) {
+        Stream(fname, flags, meshMaterials, submeshes, welded, indices);
+    } else {
+        Parse(fname, flags, meshMaterials, submeshes, welded, indices);
+    }
+    const UINT cornerCount = (UINT)indices.size();
+
+    std::vector<Chunks::Chunk> chunks;
+    if (flags & BUILD_CHUNKS) {
+        SplitIntoChunks(fname, welded, indices, submeshes, chunks);
+    }
+
+    // Occluders copy their positions, so later passes reordering triangles and
+    // vertices don't affect them
+    std::vector<Occluders::Occluder> occluders;
+    std::vector<float> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
+    if (flags & BUILD_OCCLUDERS) {
+        BuildOccluders(fname, welded, indices, submeshes, chunks, occluders, occluderPositions, occluderIndices);
+    }
+
+    std::vector<Meshlets::Meshlet> meshlets;
+    Optimize(fname, flags, submeshes, welded, indices, meshlets);
+
+    std::vector<Lod> lods;
+    std::vector<Submesh> lodSubmeshes;
+    if (flags & BUILD_LODS) {
+        BuildLods(fname, lodRatios, submeshes, welded, indices, lods, lodSubmeshes);
+    }
+
+    // Runs last since it renumbers the vertices the other passes' output refers
+    // to. LOD indices only reference full-detail vertices, so the order is set
+    // by the full-detail mesh.
+    if (flags & OPTIMIZE_VERTEX_FETCH) {
+        std::vector<Vertex> reordered(welded.size());
+        reordered.resize(MeshOptimizer::OptimizeVertexFetch(reordered.data(), indices.data(), indices.size(), welded.data(), welded.size(), sizeof(Vertex)));
+        welded.swap(reordered);
+    }
+
+    const bool use16BitIndices = MeshWelder::FitsIn16BitIndices(welded.size());
+    Vertex* vb;
+    BYTE* ib;
+    mesh.Allocate((UINT)welded.size(), (UINT)indices.size(), use16BitIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, &vb, &ib);
+
+    memcpy(vb, welded.data(), welded.size() * sizeof(Vertex));
+    if (use16BitIndices) {
+        MeshWelder::NarrowIndices(indices, reinterpret_cast<UINT16*>(ib));
+    } else {
+        memcpy(ib, indices.data(), indices.size() * sizeof(UINT32));
+    }
+
+    mesh.submeshes = submeshes;
+    mesh.materials = meshMaterials;
+    mesh.meshlets = meshlets;
+    mesh.chunks = chunks;
+    mesh.occluders = occluders;
+    mesh.occluderPositions = occluderPositions;
+    mesh.occluderIndices = occluderIndices;
+    mesh.lods = lods;
+    mesh.lodSubmeshes = lodSubmeshes;
+    mesh.ComputeBounds();
+
+    if (!MeshCache::Save(fname, buildFlags, mesh, (flags & COMPRESS_CACHE) != 0)) {
+        OutputDebugStringA("Failed to write mesh cache\n");
+    }
+
+    char stats[256];
+    sprintf_s(stats, "%s: %u face corners welded to %u vertices, %u submeshes over %u materials and %u chunks\n", fname.c_str(), cornerCount,
+        mesh.vertexCount, (UINT)submeshes.size(), (UINT)meshMaterials.size() - 1, (UINT)chunks.size());
+    OutputDebugStringA(stats);
+}
+
+// Parses the whole file with ObjParser, then builds every face corner and
+// welds them
+void ObjLoader::Parse(const std::string& fname, UINT flags, std::vector<Material>& meshMaterials, std::vector<Submesh>& submeshes,
+    std::vector<Vertex>& welded, std::vector<uint32_t>& indices) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string warn;
     std::string err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, fname.c_str(), "", true)) {
+    // Material libraries and textures are relative to the OBJ
+    const std::string baseDir = fname.substr(0, fname.find_last_of("\\/") + 1);
+
+    ObjParser::Stats parseStats;
+    const NumberParser::Implementation numbers = (flags & SIMD_NUMBER_PARSING) ? NumberParser::Fastest() : NumberParser::SCALAR;
+    if (!ObjParser::Parse(fname, &attrib, &shapes, &materials, &warn, &err, baseDir.c_str(), true, 0, numbers, &parseStats)) {
         OutputDebugStringA("Failed to parse .obj file");
         exit(1);
     }
 
+    char parseReport[256];
+    sprintf_s(parseReport, "%s: parsed %.2f MB in %.2f ms (%.1f MB/s, %.1f M numbers/s with %s numbers, %u threads, %u chunks)\n", fname.c_str(),
+        parseStats.bytes / (1024.0 * 1024.0), parseStats.seconds * 1000.0, parseStats.MegabytesPerSecond(), parseStats.NumbersPerSecond() / 1e6,
+        NumberParser::Name(parseStats.numberParser), parseStats.threads, (UINT)parseStats.chunks);
+    OutputDebugStringA(parseReport);
+
     if (!err.empty()) {
         OutputDebugStringA(err.c_str());
         exit(1);
@@ -24,9 +295,35 @@ void ObjLoader::Load(const std::string fname, Vertex** vb, UINT& vbSize) {
         OutputDebugStringA(warn.c_str());
     }
 
-    // Pretty sure we can know up front how many vertices we need to allocate space for;
-    // could just build the raw array here instead of using a vector
-    std::vector<Vertex> vertices;
+    // Faces are grouped into one submesh per material, ordered so that
+    // materials sharing a diffuse texture are adjacent. Faces without a
+    // material use a default one appended after the MTL's.
+    meshMaterials.clear();
+    for (const tinyobj::material_t& material : materials) {
+        meshMaterials.push_back(ConvertMaterial(material, baseDir));
+    }
+    const UINT defaultMaterial = (UINT)materials.size();
+    meshMaterials.push_back(FallbackMaterial());
+
+    auto faceMaterial = [&](const tinyobj::shape_t& shape, size_t f) {
+        const int id = shape.mesh.material_ids[f];
+        return id >= 0 && id < (int)materials.size() ? (UINT)id : defaultMaterial;
+    };
+
+    std::vector<UINT> cornerCounts(meshMaterials.size(), 0);
+    for (const tinyobj::shape_t& shape : shapes) {
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
+            cornerCounts[faceMaterial(shape, f)] += shape.mesh.num_face_vertices[f];
+        }
+    }
+
+    // Welding keeps one index per face corner in order, so corner ranges map
+    // directly onto index ranges
+    std::vector<UINT> cursor;
+    submeshes = MaterialSubmeshes(meshMaterials, cornerCounts, cursor);
+    const UINT cornerCount = submeshes.empty() ? 0 : submeshes.back().indexStart + submeshes.back().indexCount;
+
+    std::vector<Vertex> vertices(cornerCount);
 
     // Iterate over shapes
     for (size_t s = 0; s < shapes.size(); ++s) {
@@ -35,47 +332,451 @@ void ObjLoader::Load(const std::string fname, Vertex** vb, UINT& vbSize) {
         // Iterate over faces
         for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); ++f) {
             int fv = shapes[s].mesh.num_face_vertices[f];
+            UINT& next = cursor[faceMaterial(shapes[s], f)];
+            Vertex* face = &vertices[next];
 
             // Iterate over face vertices
             for (size_t v = 0; v < fv; ++v) {
                 tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
 
-                Vertex vert;
+                Vertex& vert = face[v];
                 vert.position.x = attrib.vertices[3*idx.vertex_index+0];
                 vert.position.y = attrib.vertices[3*idx.vertex_index+1];
                 vert.position.z = attrib.vertices[3*idx.vertex_index+2];
                 //vert.normal.x = attrib.vertices[3*idx.normal_index+0];
                 //vert.normal.y = attrib.vertices[3*idx.normal_index+1];
                 //vert.normal.z = attrib.vertices[3*idx.normal_index+2];
-                vert.texCoord.x = attrib.texcoords[2*idx.texcoord_index+0];
-                vert.texCoord.y = attrib.texcoords[2*idx.texcoord_index+1];
-
-                vertices.push_back(vert);
+                if (idx.texcoord_index >= 0) {
+                    vert.texCoord.x = attrib.texcoords[2*idx.texcoord_index+0];
+                    vert.texCoord.y = attrib.texcoords[2*idx.texcoord_index+1];
+                } else {
+                    vert.texCoord = XMFLOAT2(0.f, 0.f);
+                }
             }
 
-            XMVECTOR v1 = XMLoadFloat3(&vertices[vertices.size() - 3].position);
-            XMVECTOR v2 = XMLoadFloat3(&vertices[vertices.size() - 2].position);
-            XMVECTOR v3 = XMLoadFloat3(&vertices[vertices.size() - 1].position);
+            next += fv;
+            index_offset += fv;
+        }
+    }
 
-            XMVECTOR side1 = v1 - v2;
-            XMVECTOR side2 = v3 - v2;
-            XMVECTOR normal = XMVector3Cross(side2, side1);
+    GenerateNormals(fname, flags, vertices);
 
-            XMStoreFloat3(&vertices[vertices.size() - 3].normal, normal);
-            XMStoreFloat3(&vertices[vertices.size() - 2].normal, normal);
-            XMStoreFloat3(&vertices[vertices.size() - 1].normal, normal);
+    // Face corners that share position, normal and tex coord collapse into one vertex
+    MeshWelder::Weld(vertices.data(), vertices.size(), welded, indices);
+}
 
-            index_offset += fv;
+// Reads the file through ObjStream, so only its v and vt arrays and one batch
+// are held besides the mesh being built. Batches arrive with face normals and
+// are welded within themselves; welding again at the end joins the corners
+// that batches share.
+void ObjLoader::Stream(const std::string& fname, UINT flags, std::vector<Material>& meshMaterials, std::vector<Submesh>& submeshes,
+    std::vector<Vertex>& welded, std::vector<uint32_t>& indices) {
+    std::string warn;
+    std::string err;
+    const std::string baseDir = fname.substr(0, fname.find_last_of("\\/") + 1);
+
+    SubmeshSink sink;
+    ObjStream::Stats streamStats;
+    if (!ObjStream::Stream(fname, sink, &warn, &err, baseDir.c_str(), ObjStream::DEFAULT_BATCH_VERTICES, &streamStats)) {
+        OutputDebugStringA(err.empty() ? "Failed to stream .obj file\n" : err.c_str());
+        exit(1);
+    }
+
+    char streamReport[256];
+    sprintf_s(streamReport, "%s: streamed %.2f MB in %.2f ms (%.1f MB/s, %u batches, %.2f MB of v and vt held)\n", fname.c_str(),
+        streamStats.bytes / (1024.0 * 1024.0), streamStats.seconds * 1000.0, streamStats.bytes / (1024.0 * 1024.0) / streamStats.seconds,
+        (UINT)streamStats.batches, streamStats.attributeBytes / (1024.0 * 1024.0));
+    OutputDebugStringA(streamReport);
+
+    if (!warn.empty()) {
+        OutputDebugStringA(warn.c_str());
+    }
+
+    meshMaterials.clear();
+    for (const tinyobj::material_t& material : sink.materials) {
+        meshMaterials.push_back(ConvertMaterial(material, baseDir));
+    }
+    meshMaterials.push_back(FallbackMaterial());
+
+    // Faces without a material use the default one, appended after the MTL's
+    std::vector<const std::vector<uint32_t>*> lists(meshMaterials.size(), &sink.fallbackIndices);
+    sink.materialIndices.resize(sink.materials.size());
+    for (size_t m = 0; m < sink.materials.size(); ++m) {
+        lists[m] = &sink.materialIndices[m];
+    }
+    std::vector<UINT> cornerCounts(meshMaterials.size());
+    for (size_t m = 0; m < lists.size(); ++m) {
+        cornerCounts[m] = (UINT)lists[m]->size();
+    }
+
+    std::vector<UINT> cursor;
+    submeshes = MaterialSubmeshes(meshMaterials, cornerCounts, cursor);
+    std::vector<uint32_t> corners(submeshes.empty() ? 0 : submeshes.back().indexStart + submeshes.back().indexCount);
+    for (size_t m = 0; m < lists.size(); ++m) {
+        std::copy(lists[m]->begin(), lists[m]->end(), corners.begin() + cursor[m]);
+    }
+
+    std::vector<Vertex>& vertices = sink.vertices;
+    if ((flags & SMOOTH_NORMALS) && !vertices.empty()) {
+        // The averaging GenerateNormals does, over the indexed vertices
+        std::vector<XMFLOAT3> vertexPositions(vertices.size());
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            vertexPositions[v] = vertices[v].position;
+        }
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> positionOf;
+        MeshWelder::Weld(vertexPositions.data(), vertexPositions.size(), positions, positionOf);
+
+        std::vector<uint32_t> positionIndices(corners.size());
+        for (size_t i = 0; i < corners.size(); ++i) {
+            positionIndices[i] = positionOf[corners[i]];
+        }
+        Geometry::Vectors normals;
+        Geometry::SmoothNormals(positionIndices.data(), positionIndices.size(), &positions[0].x, positions.size(), sizeof(XMFLOAT3), normals,
+            Geometry::BestWidth(), 0);
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            const uint32_t p = positionOf[v];
+            vertices[v].normal = XMFLOAT3(normals.x[p], normals.y[p], normals.z[p]);
         }
     }
 
-    *vb = new Vertex[vertices.size()];
+    // Joins corners that landed in different batches
+    std::vector<uint32_t> remap;
+    MeshWelder::Weld(vertices.data(), vertices.size(), welded, remap);
+    indices.resize(corners.size());
+    for (size_t i = 0; i < corners.size(); ++i) {
+        indices[i] = remap[corners[i]];
+    }
+}
 
-    for (int i = 0; i < vertices.size(); ++i) {
-        (*vb)[i] = vertices[i];
+// Gives every face corner a normal. Flat normals copy each triangle's normal to
+// its corners. Smooth normals average the faces around each position, with tex
+// coords left out of the weld so that UV seams don't show up as creases.
+void ObjLoader::GenerateNormals(const std::string& fname, UINT flags, std::vector<Vertex>& vertices) {
+    if (vertices.empty()) {
+        return;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    const Geometry::Width width = Geometry::BestWidth();
+    const bool smooth = (flags & SMOOTH_NORMALS) != 0;
+    Geometry::Vectors normals;
+    if (smooth) {
+        std::vector<XMFLOAT3> corners(vertices.size());
+        for (size_t c = 0; c < vertices.size(); ++c) {
+            corners[c] = vertices[c].position;
+        }
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> positionOf;
+        MeshWelder::Weld(corners.data(), corners.size(), positions, positionOf);
+
+        Geometry::SmoothNormals(positionOf.data(), positionOf.size(), &positions[0].x, positions.size(), sizeof(XMFLOAT3), normals, width, 0);
+#if defined(_DEBUG)
+        Geometry::Vectors reference;
+        Geometry::SmoothNormals(positionOf.data(), positionOf.size(), &positions[0].x, positions.size(), sizeof(XMFLOAT3), reference, Geometry::SCALAR);
+        assert(Geometry::MaxDifference(normals, reference) <= NORMAL_TOLERANCE && "ObjLoader: SIMD smooth normals differ from scalar ones");
+#endif
+
+        for (size_t c = 0; c < vertices.size(); ++c) {
+            const uint32_t p = positionOf[c];
+            vertices[c].normal = XMFLOAT3(normals.x[p], normals.y[p], normals.z[p]);
+        }
+    } else {
+        // Corners are in triangle order, so no index buffer is needed
+        Geometry::FaceNormals(nullptr, vertices.size(), &vertices[0].position.x, vertices.size(), sizeof(Vertex), normals, width, 0);
+#if defined(_DEBUG)
+        Geometry::Vectors reference;
+        Geometry::FaceNormals(nullptr, vertices.size(), &vertices[0].position.x, vertices.size(), sizeof(Vertex), reference, Geometry::SCALAR);
+        assert(Geometry::MaxDifference(normals, reference) <= NORMAL_TOLERANCE && "ObjLoader: SIMD face normals differ from scalar ones");
+#endif
+
+        for (size_t c = 0; c < vertices.size(); ++c) {
+            const size_t t = c / 3;
+            vertices[c].normal = XMFLOAT3(normals.x[t], normals.y[t], normals.z[t]);
+        }
+    }
+    const double milliseconds = MillisecondsSince(start);
+
+    const UINT triangleCount = (UINT)(vertices.size() / 3);
+    char report[256];
+    sprintf_s(report, "%s: %s normals for %u triangles in %.2f ms (%.1f M triangles/s, %s, %u threads)\n", fname.c_str(), smooth ? "smooth" : "flat",
+        triangleCount, milliseconds, triangleCount / (milliseconds * 1000.0), Geometry::Name(width), Parallel::DefaultThreadCount());
+    OutputDebugStringA(report);
+}
+
+// Partitions the whole mesh, across materials, so chunk bounds are spatially
+// tight, then splits each submesh by chunk. A submesh's triangles are
+// reordered within its range so that each chunk's share is contiguous; the
+// pieces keep the submesh's material and stay in material order, which keeps
+// texture changes between draws to a minimum.
+void ObjLoader::SplitIntoChunks(const std::string& fname, const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes,
+    std::vector<Chunks::Chunk>& chunks) {
+    chunks.clear();
+    if (indices.empty()) {
+        return;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    std::vector<uint32_t> triangleChunks;
+    Chunks::Partition(indices.data(), indices.size(), &vertices[0].position.x, sizeof(Vertex), CHUNK_TRIANGLES, triangleChunks, chunks);
+
+    std::vector<Chunks::Range> ranges;
+    for (const Submesh& submesh : submeshes) {
+        ranges.push_back({ submesh.indexStart, submesh.indexCount });
+    }
+    std::vector<Chunks::Piece> pieces;
+    Chunks::Split(indices.data(), ranges.data(), ranges.size(), triangleChunks, chunks.size(), pieces);
+
+    std::vector<Submesh> split;
+    for (const Chunks::Piece& piece : pieces) {
+        Submesh submesh = submeshes[piece.range];
+        submesh.indexStart = piece.indexStart;
+        submesh.indexCount = piece.indexCount;
+        submesh.chunk = piece.chunk;
+        split.push_back(submesh);
     }
 
-    vbSize = vertices.size();
+    char report[256];
+    sprintf_s(report, "%s: split into %u chunks of at most %u triangles in %.2f ms, %u submeshes -> %u\n", fname.c_str(), (UINT)chunks.size(),
+        (UINT)CHUNK_TRIANGLES, MillisecondsSince(start), (UINT)submeshes.size(), (UINT)split.size());
+    OutputDebugStringA(report);
+
+    submeshes.swap(split);
+}
+
+// Each chunk's occluder is built from the triangles of every submesh in it, as
+// an independent job. Debug builds check that every occluder lies on the
+// surface it stands in for.
+void ObjLoader::BuildOccluders(const std::string& fname, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+    const std::vector<Submesh>& submeshes, const std::vector<Chunks::Chunk>& chunks, std::vector<Occluders::Occluder>& occluders,
+    std::vector<float>& occluderPositions, std::vector<uint32_t>& occluderIndices) {
+    occluders.clear();
+    occluderPositions.clear();
+    occluderIndices.clear();
+    if (indices.empty()) {
+        return;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    const size_t occluderCount = chunks.empty() ? 1 : chunks.size();
+    std::vector<std::vector<uint32_t>> sources(occluderCount);
+    for (const Submesh& submesh : submeshes) {
+        std::vector<uint32_t>& source = sources[chunks.empty() ? 0 : submesh.chunk];
+        source.insert(source.end(), indices.begin() + submesh.indexStart, indices.begin() + submesh.indexStart + submesh.indexCount);
+    }
+
+    const float* positions = &vertices[0].position.x;
+    std::vector<std::vector<float>> jobPositions(occluderCount);
+    std::vector<std::vector<uint32_t>> jobIndices(occluderCount);
+    occluders.resize(occluderCount);
+    Parallel::For(occluderCount, 0, [&](size_t o) {
+        const std::vector<uint32_t>& source = sources[o];
+        Bounds::Volume volume;
+        Bounds::Compute(source.data(), source.size(), positions, sizeof(Vertex), volume);
+        const float dx = volume.max[0] - volume.min[0];
+        const float dy = volume.max[1] - volume.min[1];
+        const float dz = volume.max[2] - volume.min[2];
+        const float squaredDiagonal = dx * dx + dy * dy + dz * dz;
+        const float tolerance = sqrtf(squaredDiagonal) * OCCLUDER_TOLERANCE;
+
+        occluders[o] = Occluders::Build(source.data(), source.size(), positions, sizeof(Vertex), OCCLUDER_TRIANGLES, tolerance,
+            squaredDiagonal * OCCLUDER_MIN_AREA, chunks.empty() ? Occluders::Occluder::NO_CHUNK : (uint32_t)o, jobPositions[o], jobIndices[o]);
+
+#if defined(_DEBUG)
+        // Allows tolerance on top of the plane fitting error for rounding
+        assert(Occluders::IsConservative(occluders[o], jobPositions[o].data(), jobIndices[o].data(), source.data(), source.size(), positions,
+            sizeof(Vertex), occluders[o].error + tolerance) && "ObjLoader: occluder extends beyond the surface it was built from");
+#endif
+    });
+
+    UINT triangleCount = 0;
+    for (size_t o = 0; o < occluderCount; ++o) {
+        occluders[o].vertexStart = (uint32_t)occluderPositions.size() / 3;
+        occluders[o].indexStart = (uint32_t)occluderIndices.size();
+        occluderPositions.insert(occluderPositions.end(), jobPositions[o].begin(), jobPositions[o].end());
+        occluderIndices.insert(occluderIndices.end(), jobIndices[o].begin(), jobIndices[o].end());
+        triangleCount += occluders[o].indexCount / 3;
+    }
+
+    char report[256];
+    sprintf_s(report, "%s: built %u occluders with %u triangles standing in for %u in %.2f ms\n", fname.c_str(), (UINT)occluderCount, triangleCount,
+        (UINT)indices.size() / 3, MillisecondsSince(start));
+    OutputDebugStringA(report);
+}
+
+// Triangles only move within their submesh, so submesh ranges stay valid.
+// Fills in each submesh's meshlet range.
+void ObjLoader::Optimize(const std::string& fname, UINT flags, std::vector<Submesh>& submeshes, const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+    std::vector<Meshlets::Meshlet>& meshlets) {
+    if (indices.empty()) {
+        return;
+    }
+
+    const MeshOptimizer::VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size());
+#if defined(_DEBUG)
+    // Rasterizing the mesh from every view takes longer than optimizing it,
+    // so only debug builds measure overdraw
+    const MeshOptimizer::OverdrawStats overdrawBefore = MeshOptimizer::AnalyzeOverdraw(indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+#endif
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    // Submeshes touch disjoint index ranges, so they can be processed in parallel
+    std::vector<std::vector<Meshlets::Meshlet>> submeshMeshlets(submeshes.size());
+    Parallel::For(submeshes.size(), 0, [&](size_t s) {
+        const Submesh& submesh = submeshes[s];
+        uint32_t* submeshIndices = &indices[submesh.indexStart];
+
+        if (flags & OPTIMIZE_VERTEX_CACHE) {
+            MeshOptimizer::OptimizeVertexCache(submeshIndices, submesh.indexCount);
+        }
+        if (flags & OPTIMIZE_OVERDRAW) {
+            MeshOptimizer::OptimizeOverdraw(submeshIndices, submesh.indexCount, &vertices[0].position.x, sizeof(Vertex), OVERDRAW_THRESHOLD);
+        }
+        if (flags & BUILD_MESHLETS) {
+            Meshlets::Build(submeshIndices, submesh.indexCount, submesh.indexStart, &vertices[0].position.x, sizeof(Vertex), submeshMeshlets[s]);
+        }
+    });
+
+    meshlets.clear();
+    for (size_t s = 0; s < submeshes.size(); ++s) {
+        submeshes[s].meshletStart = (UINT)meshlets.size();
+        submeshes[s].meshletCount = (UINT)submeshMeshlets[s].size();
+        meshlets.insert(meshlets.end(), submeshMeshlets[s].begin(), submeshMeshlets[s].end());
+    }
+
+    const double milliseconds = MillisecondsSince(start);
+
+    const MeshOptimizer::VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size());
+    char overdraw[64] = "";
+#if defined(_DEBUG)
+    const MeshOptimizer::OverdrawStats overdrawAfter = MeshOptimizer::AnalyzeOverdraw(indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+    sprintf_s(overdraw, ", overdraw %.3f -> %.3f", overdrawBefore.overdraw, overdrawAfter.overdraw);
+#endif
+
+    char report[256];
+    sprintf_s(report, "%s: optimized in %.2f ms, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u-entry FIFO)%s, %u meshlets\n", fname.c_str(),
+        milliseconds, cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr, MeshOptimizer::DEFAULT_CACHE_SIZE, overdraw,
+        (UINT)meshlets.size());
+    OutputDebugStringA(report);
+}
+
+// Each LOD is simplified from the full-detail submeshes rather than from the
+// previous LOD, so its error is measured against the original surface. Every
+// (LOD, submesh) pair is an independent job.
+void ObjLoader::BuildLods(const std::string& fname, const std::vector<float>& ratios, const std::vector<Submesh>& submeshes, const std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices, std::vector<Lod>& lods, std::vector<Submesh>& lodSubmeshes) {
+    lods.clear();
+    lodSubmeshes.clear();
+    if (indices.empty() || ratios.empty()) {
+        return;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    // Group vertices that differ only in normal, and simplify with each group's
+    // first vertex standing in for the rest
+    std::vector<PositionTexCoord> keys(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        keys[v].position = vertices[v].position;
+        keys[v].texCoord = vertices[v].texCoord;
+    }
+    std::vector<PositionTexCoord> classes;
+    std::vector<uint32_t> classOf;
+    MeshWelder::Weld(keys.data(), keys.size(), classes, classOf);
+
+    std::vector<uint32_t> classStart(classes.size() + 1, 0);
+    for (uint32_t attributeClass : classOf) {
+        classStart[attributeClass + 1]++;
+    }
+    for (size_t c = 0; c < classes.size(); ++c) {
+        classStart[c + 1] += classStart[c];
+    }
+    std::vector<uint32_t> classMembers(vertices.size());
+    std::vector<uint32_t> fill(classStart.begin(), classStart.end() - 1);
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        classMembers[fill[classOf[v]]++] = v;
+    }
+
+    std::vector<uint32_t> canonical(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        canonical[i] = classMembers[classStart[classOf[indices[i]]]];
+    }
+
+    const size_t submeshCount = submeshes.size();
+    std::vector<std::vector<uint32_t>> results(ratios.size() * submeshCount);
+    std::vector<float> errors(results.size(), 0.f);
+
+    Parallel::For(results.size(), 0, [&](size_t job) {
+        const float ratio = ratios[job / submeshCount];
+        const Submesh& submesh = submeshes[job % submeshCount];
+        std::vector<uint32_t>& result = results[job];
+
+        const size_t target = static_cast<size_t>(submesh.indexCount / 3 * ratio) * 3;
+        result.resize(submesh.indexCount);
+        result.resize(Simplifier::Simplify(result.data(), &canonical[submesh.indexStart], submesh.indexCount, &vertices[0].position.x, sizeof(Vertex),
+            target, FLT_MAX, &errors[job]));
+
+        MatchFaceNormals(result.data(), result.size(), vertices, classOf, classStart, classMembers);
+        MeshOptimizer::OptimizeVertexCache(result.data(), result.size());
+    });
+
+    const double milliseconds = MillisecondsSince(start);
+    const UINT baseTriangles = (UINT)indices.size() / 3;
+
+    for (size_t level = 0; level < ratios.size(); ++level) {
+        Lod lod;
+        lod.indexStart = (UINT)indices.size();
+        lod.ratio = ratios[level];
+        lod.error = 0.f;
+
+        for (size_t s = 0; s < submeshCount; ++s) {
+            const std::vector<uint32_t>& result = results[level * submeshCount + s];
+
+            Submesh lodSubmesh = {};
+            lodSubmesh.indexStart = (UINT)indices.size();
+            lodSubmesh.indexCount = (UINT)result.size();
+            lodSubmesh.material = submeshes[s].material;
+            lodSubmesh.chunk = submeshes[s].chunk;
+            lodSubmeshes.push_back(lodSubmesh);
+
+            indices.insert(indices.end(), result.begin(), result.end());
+            lod.error = fmaxf(lod.error, errors[level * submeshCount + s]);
+        }
+
+        lod.indexCount = (UINT)indices.size() - lod.indexStart;
+        lods.push_back(lod);
+
+        char levelReport[256];
+        sprintf_s(levelReport, "%s: LOD %u, %u of %u triangles (requested %.3f), error %g\n", fname.c_str(),
+            (UINT)level + 1, lod.indexCount / 3, baseTriangles, lod.ratio, lod.error);
+        OutputDebugStringA(levelReport);
+    }
+
+    char report[256];
+    sprintf_s(report, "%s: simplified %u LODs in %.2f ms (%u jobs, %u threads)\n", fname.c_str(),
+        (UINT)ratios.size(), milliseconds, (UINT)results.size(), Parallel::DefaultThreadCount());
+    OutputDebugStringA(report);
+}
+
+bool ObjLoader::HasLods(const Mesh& mesh, const std::vector<float>& ratios) {
+    if (mesh.lods.size() != ratios.size()) {
+        return false;
+    }
+    for (size_t level = 0; level < ratios.size(); ++level) {
+        if (mesh.lods[level].ratio != ratios[level]) {
+            return false;
+        }
+    }
+    return true;
 }
 
 Vertex ObjLoader::vertBundleToVert(ObjVertBundle bundle) {
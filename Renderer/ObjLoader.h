@@ -28,8 +28,82 @@ struct ObjFace {
 class ObjLoader
 {
 public:
-    static void Load(const string fname, Vertex** vb, UINT& vbSize);
+    // Optional processing stages, combined as a bit mask
+    enum Flags : UINT {
+        NONE = 0,
+
+        // Reorder each submesh's triangles for post-transform vertex cache reuse
+        OPTIMIZE_VERTEX_CACHE = 1 << 0,
+
+        // Sort clusters of triangles within each submesh to reduce overdraw,
+        // giving up at most OVERDRAW_THRESHOLD of vertex cache efficiency
+        OPTIMIZE_OVERDRAW = 1 << 1,
+
+        // Renumber vertices into first-use order
+        OPTIMIZE_VERTEX_FETCH = 1 << 2,
+
+        // Partition each submesh into meshlets for cluster culling. Regroups
+        // triangles, keeping the overdraw order only approximately.
+        BUILD_MESHLETS = 1 << 3,
+
+        // Simplify each submesh into the LOD chain given by the LOD ratios
+        BUILD_LODS = 1 << 4,
+
+        // Parse numbers with the fastest SIMD path the CPU supports instead of
+        // tinyobj's scalar code. The parsed values are bit-identical.
+        SIMD_NUMBER_PARSING = 1 << 5,
+
+        // Partition the mesh into spatial chunks and split each submesh along
+        // them, so parts of a large mesh can be culled on their own bounds
+        BUILD_CHUNKS = 1 << 6,
+
+        // Write the cache's vertex and index arrays compressed with MeshCodec.
+        // Later loads decode them instead of mapping the cache, which is
+        // faster when the file has to come off the disk. Caches written either
+        // way satisfy loads with or without this flag.
+        COMPRESS_CACHE = 1 << 7,
+
+        // Average the face normals around each position instead of giving
+        // every face its own, for meshes meant to look curved
+        SMOOTH_NORMALS = 1 << 8,
+
+        // Build a conservative occluder for each chunk, or for the whole mesh
+        // when it isn't chunked, from its large flat surfaces
+        BUILD_OCCLUDERS = 1 << 9,
+
+        // Read the OBJ through ObjStream instead of ObjParser, holding the v
+        // and vt arrays and one batch of faces rather than the whole parse
+        // and a vertex per face corner. The v and vt arrays still grow with
+        // the file, at about 14% of its size. Parsing is single-threaded and
+        // ignores SIMD_NUMBER_PARSING.
+        STREAM_OBJ = 1 << 10,
+    };
+
+    static const UINT DEFAULT_FLAGS = OPTIMIZE_VERTEX_CACHE | OPTIMIZE_OVERDRAW | OPTIMIZE_VERTEX_FETCH | BUILD_MESHLETS | BUILD_LODS | SIMD_NUMBER_PARSING |
+        BUILD_CHUNKS | BUILD_OCCLUDERS;
+
+    // Triangle count of each LOD relative to the full-detail mesh, finest first
+    static const vector<float>& DefaultLodRatios();
+
+    // Produces a welded vertex buffer and a matching index buffer. Indices are
+    // 16-bit when the welded vertex count allows it, 32-bit otherwise. The result
+    // is cached next to the OBJ and later loads map the cache instead of parsing.
+    static void Load(const string fname, Mesh& mesh, UINT flags = DEFAULT_FLAGS, const vector<float>& lodRatios = DefaultLodRatios());
 private:
+    static void Parse(const string& fname, UINT flags, vector<Material>& materials, vector<Submesh>& submeshes, vector<Vertex>& vertices,
+        vector<uint32_t>& indices);
+    static void Stream(const string& fname, UINT flags, vector<Material>& materials, vector<Submesh>& submeshes, vector<Vertex>& vertices,
+        vector<uint32_t>& indices);
+    static void GenerateNormals(const string& fname, UINT flags, vector<Vertex>& vertices);
+    static void SplitIntoChunks(const string& fname, const vector<Vertex>& vertices, vector<uint32_t>& indices, vector<Submesh>& submeshes,
+        vector<Chunks::Chunk>& chunks);
+    static void BuildOccluders(const string& fname, const vector<Vertex>& vertices, const vector<uint32_t>& indices, const vector<Submesh>& submeshes,
+        const vector<Chunks::Chunk>& chunks, vector<Occluders::Occluder>& occluders, vector<float>& occluderPositions, vector<uint32_t>& occluderIndices);
+    static void Optimize(const string& fname, UINT flags, vector<Submesh>& submeshes, const vector<Vertex>& vertices, vector<uint32_t>& indices,
+        vector<Meshlets::Meshlet>& meshlets);
+    static void BuildLods(const string& fname, const vector<float>& ratios, const vector<Submesh>& submeshes, const vector<Vertex>& vertices, vector<uint32_t>& indices,
+        vector<Lod>& lods, vector<Submesh>& lodSubmeshes);
+    static bool HasLods(const Mesh& mesh, const vector<float>& ratios);
     static Vertex vertBundleToVert(ObjVertBundle bundle);
     static void objToBuffers(vector<ObjFace> faces, Vertex** vb, short** ib, UINT& vbSize, UINT& ibSize);
     static vector<ObjFace> parseOBJ(const wstring fname);
@@ -0,0 +1,653 @@
+// Built without the precompiled header so the parser can run headless. This is
+// also the translation unit that hosts the tinyobj implementation, which gives
+// the parallel parser access to tinyobj's internal parsing helpers.
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include <chrono>
+#include <type_traits>
+
+using namespace tinyobj;
+
+namespace {
+    // Chunks smaller than this aren't worth a hand-off to another thread
+    const size_t MIN_CHUNK_SIZE = 64 * 1024;
+    // More chunks than threads so that uneven chunks balance out
+    const size_t CHUNKS_PER_THREAD = 4;
+
+    enum RelativeIndexFlags {
+        RELATIVE_V = 1 << 0,
+        RELATIVE_VT = 1 << 1,
+        RELATIVE_VN = 1 << 2
+    };
+
+    // A face corner with its indices resolved as far as the chunk can on its own.
+    // Negative (relative) OBJ indices depend on how many elements precede the
+    // chunk, so they're stored relative to the chunk start and flagged for the
+    // stitch pass.
+    struct FaceCorner {
+        vertex_index_t index;
+        int relativeFlags;
+    };
+
+    // usemtl/mtllib/g/o/s lines, kept verbatim and replayed in file order once
+    // every chunk has been parsed.
+    struct Statement {
+        size_t faceOffset;  // Faces in the chunk that precede the statement
+        size_t line;        // Chunk-relative line number
+        std::string text;   // Line with leading whitespace stripped
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        std::vector<real_t> v;
+        std::vector<real_t> vn;
+        std::vector<real_t> vt;
+        std::vector<FaceCorner> corners;
+        std::vector<unsigned> faceSizes;
+        std::vector<Statement> statements;
+        size_t lineCount;
+        size_t numberCount;
+        bool failed;
+        NumberParser::Implementation numbers;
+
+        // Filled in by the prefix sum
+        size_t vBase, vnBase, vtBase, lineBase;
+        int greatestV, greatestVn, greatestVt;
+
+        Chunk() : begin(nullptr), end(nullptr), lineCount(0), numberCount(0), failed(false), numbers(NumberParser::SCALAR),
+            vBase(0), vnBase(0), vtBase(0), lineBase(0), greatestV(-1), greatestVn(-1), greatestVt(-1) {}
+    };
+
+    // Same as tinyobj's fixIndex, except relative indices are resolved against the
+    // element count seen so far in this chunk.
+    inline bool fixChunkIndex(int idx, size_t localCount, int* ret, int flag, int* relativeFlags) {
+        if (idx > 0) {
+            *ret = idx - 1;
+            return true;
+        }
+
+        if (idx == 0) {
+            // zero is not allowed according to the spec.
+            return false;
+        }
+
+        *ret = static_cast<int>(localCount) + idx;
+        *relativeFlags |= flag;
+        return true;
+    }
+
+    static_assert(std::is_same<real_t, float>::value, "NumberParser produces floats");
+
+    // count values, each read as tinyobj's parseReal would, through the
+    // chunk's fast path as far as it goes
+    void parseReals(const char** token, real_t* values, size_t count, Chunk& chunk) {
+#if defined(_DEBUG)
+        const char* expectedEnd = *token;
+#endif
+        for (size_t i = NumberParser::ParseReals(chunk.numbers, token, values, count); i < count; ++i) {
+            values[i] = parseReal(token);
+        }
+        chunk.numberCount += count;
+
+#if defined(_DEBUG)
+        for (size_t i = 0; i < count; ++i) {
+            const real_t expected = parseReal(&expectedEnd);
+            assert(memcmp(&expected, &values[i], sizeof(real_t)) == 0 && "NumberParser: value differs from tinyobj");
+        }
+        assert(expectedEnd == *token && "NumberParser: consumed different text than tinyobj");
+#endif
+    }
+
+    // atoi, through the chunk's fast path where it applies
+    int parseIndex(const char* token, Chunk& chunk) {
+        chunk.numberCount++;
+        int value;
+        if (!NumberParser::ParseInt(chunk.numbers, token, &value)) {
+            return atoi(token);
+        }
+        assert(value == atoi(token) && "NumberParser: index differs from atoi");
+        return value;
+    }
+
+    // Same grammar as tinyobj's parseTriple: i, i/j/k, i//k, i/j
+    bool parseCorner(const char** token, Chunk& chunk, FaceCorner* ret) {
+        FaceCorner corner;
+        corner.relativeFlags = 0;
+
+        if (!fixChunkIndex(parseIndex(*token, chunk), chunk.v.size() / 3, &corner.index.v_idx, RELATIVE_V, &corner.relativeFlags)) {
+            return false;
+        }
+
+        (*token) += strcspn((*token), "/ \t\r");
+        if ((*token)[0] != '/') {
+            *ret = corner;
+            return true;
+        }
+        (*token)++;
+
+        // i//k
+        if ((*token)[0] == '/') {
+            (*token)++;
+            if (!fixChunkIndex(parseIndex(*token, chunk), chunk.vn.size() / 3, &corner.index.vn_idx, RELATIVE_VN, &corner.relativeFlags)) {
+                return false;
+            }
+            (*token) += strcspn((*token), "/ \t\r");
+            *ret = corner;
+            return true;
+        }
+
+        // i/j/k or i/j
+        if (!fixChunkIndex(parseIndex(*token, chunk), chunk.vt.size() / 2, &corner.index.vt_idx, RELATIVE_VT, &corner.relativeFlags)) {
+            return false;
+        }
+
+        (*token) += strcspn((*token), "/ \t\r");
+        if ((*token)[0] != '/') {
+            *ret = corner;
+            return true;
+        }
+
+        // i/j/k
+        (*token)++;
+        if (!fixChunkIndex(parseIndex(*token, chunk), chunk.vn.size() / 3, &corner.index.vn_idx, RELATIVE_VN, &corner.relativeFlags)) {
+            return false;
+        }
+        (*token) += strcspn((*token), "/ \t\r");
+
+        *ret = corner;
+        return true;
+    }
+
+    // Tokenizes one chunk. Lines are copied into a NUL-terminated buffer first
+    // because tinyobj's helpers scan until NUL rather than to the end of the line;
+    // the buffer is padded for NumberParser's wide loads.
+    void parseChunk(Chunk& chunk) {
+        std::string linebuf;
+        const char* p = chunk.begin;
+
+        while (p < chunk.end) {
+            // Line endings follow tinyobj's safeGetline: \n, \r\n or a lone \r
+            const char* newline = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+            if (!newline) {
+                newline = chunk.end;
+            }
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\r', newline - p));
+            const char* next;
+            if (!lineEnd) {
+                lineEnd = newline;
+                next = newline + 1;
+            } else {
+                next = (lineEnd + 1 == newline) ? newline + 1 : lineEnd + 1;
+            }
+
+            linebuf.assign(p, lineEnd);
+            linebuf.append(NumberParser::PADDING, '\0');
+            p = next;
+            chunk.lineCount++;
+
+            const char* token = linebuf.c_str();
+            token += strspn(token, " \t");
+
+            if (token[0] == '\0' || token[0] == '#') {
+                continue;
+            }
+
+            // vertex
+            if (token[0] == 'v' && IS_SPACE((token[1]))) {
+                token += 2;
+                // Vertex colors are ignored, so only x, y and z are read
+                real_t xyz[3];
+                parseReals(&token, xyz, 3, chunk);
+                chunk.v.insert(chunk.v.end(), xyz, xyz + 3);
+                continue;
+            }
+
+            // normal
+            if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+                token += 3;
+                real_t xyz[3];
+                parseReals(&token, xyz, 3, chunk);
+                chunk.vn.insert(chunk.vn.end(), xyz, xyz + 3);
+                continue;
+            }
+
+            // texcoord
+            if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+                token += 3;
+                real_t xy[2];
+                parseReals(&token, xy, 2, chunk);
+                chunk.vt.insert(chunk.vt.end(), xy, xy + 2);
+                continue;
+            }
+
+            // face
+            if (token[0] == 'f' && IS_SPACE((token[1]))) {
+                token += 2;
+                token += strspn(token, " \t");
+
+                unsigned faceSize = 0;
+                while (!IS_NEW_LINE(token[0])) {
+                    FaceCorner corner;
+                    if (!parseCorner(&token, chunk, &corner)) {
+                        chunk.failed = true;
+                        return;
+                    }
+
+                    chunk.corners.push_back(corner);
+                    faceSize++;
+                    token += strspn(token, " \t\r");
+                }
+
+                chunk.faceSizes.push_back(faceSize);
+                continue;
+            }
+
+            // Statements that change grouping are replayed serially later
+            if (((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) ||
+                ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) ||
+                (token[0] == 'g' && IS_SPACE((token[1]))) ||
+                (token[0] == 'o' && IS_SPACE((token[1]))) ||
+                (token[0] == 's' && IS_SPACE((token[1])))) {
+                Statement statement;
+                statement.faceOffset = chunk.faceSizes.size();
+                statement.line = chunk.lineCount;
+                statement.text = token;
+                chunk.statements.push_back(statement);
+                continue;
+            }
+
+            // Ignore everything else (lines, points, tags, unknown commands)
+        }
+    }
+
+    // Applies the global element bases to a parsed chunk, moves its attributes into
+    // place and tracks the largest index referenced for the bounds warnings.
+    void stitchChunk(Chunk& chunk, attrib_t* attrib) {
+        std::copy(chunk.v.begin(), chunk.v.end(), attrib->vertices.begin() + chunk.vBase * 3);
+        std::copy(chunk.vn.begin(), chunk.vn.end(), attrib->normals.begin() + chunk.vnBase * 3);
+        std::copy(chunk.vt.begin(), chunk.vt.end(), attrib->texcoords.begin() + chunk.vtBase * 2);
+
+        for (size_t i = 0; i < chunk.corners.size(); ++i) {
+            FaceCorner& corner = chunk.corners[i];
+            if (corner.relativeFlags & RELATIVE_V) {
+                corner.index.v_idx += static_cast<int>(chunk.vBase);
+            }
+            if (corner.relativeFlags & RELATIVE_VT) {
+                corner.index.vt_idx += static_cast<int>(chunk.vtBase);
+            }
+            if (corner.relativeFlags & RELATIVE_VN) {
+                corner.index.vn_idx += static_cast<int>(chunk.vnBase);
+            }
+
+            chunk.greatestV = std::max(chunk.greatestV, corner.index.v_idx);
+            chunk.greatestVt = std::max(chunk.greatestVt, corner.index.vt_idx);
+            chunk.greatestVn = std::max(chunk.greatestVn, corner.index.vn_idx);
+        }
+
+        std::vector<real_t>().swap(chunk.v);
+        std::vector<real_t>().swap(chunk.vn);
+        std::vector<real_t>().swap(chunk.vt);
+    }
+
+    // Serial grouping state, mirroring the locals of tinyobj::LoadObj. Instead of
+    // collecting faces into a PrimGroup and converting them on flush, faces are
+    // appended to the shape as they're replayed; hasPendingFaces stands in for a
+    // non-empty PrimGroup.
+    struct GroupState {
+        shape_t shape;
+        std::string name;
+        std::map<std::string, int> materialMap;
+        int material;
+        unsigned int smoothingId;
+        std::vector<tag_t> tags;
+        bool triangulate;
+        bool hasPendingFaces;
+
+        GroupState() : material(-1), smoothingId(0), triangulate(true), hasPendingFaces(false) {}
+    };
+
+    // Equivalent of exportGroupsToShape for the faces appended since the last flush
+    bool flushGroup(GroupState& state) {
+        if (!state.hasPendingFaces) {
+            return false;
+        }
+
+        state.shape.name = state.name;
+        state.shape.mesh.tags = state.tags;
+        state.hasPendingFaces = false;
+        return true;
+    }
+
+    // Appends one face the way exportGroupsToShape would. Triangles (and all faces
+    // when not triangulating) pass through unchanged, so only larger polygons pay
+    // for tinyobj's ear clipping.
+    void appendFace(GroupState& state, const FaceCorner* corners, unsigned faceSize, const std::vector<real_t>& v) {
+        state.hasPendingFaces = true;
+
+        if (faceSize < 3) {
+            return;
+        }
+
+        mesh_t& mesh = state.shape.mesh;
+
+        if (faceSize == 3 || !state.triangulate) {
+            for (unsigned k = 0; k < faceSize; ++k) {
+                index_t idx;
+                idx.vertex_index = corners[k].index.v_idx;
+                idx.normal_index = corners[k].index.vn_idx;
+                idx.texcoord_index = corners[k].index.vt_idx;
+                mesh.indices.push_back(idx);
+            }
+            mesh.num_face_vertices.push_back(static_cast<unsigned char>(faceSize));
+            mesh.material_ids.push_back(state.material);
+            mesh.smoothing_group_ids.push_back(state.smoothingId);
+            return;
+        }
+
+        PrimGroup polygon;
+        polygon.faceGroup.resize(1);
+        face_t& face = polygon.faceGroup[0];
+        face.smoothing_group_id = state.smoothingId;
+        face.vertex_indices.resize(faceSize);
+        for (unsigned k = 0; k < faceSize; ++k) {
+            face.vertex_indices[k] = corners[k].index;
+        }
+
+        exportGroupsToShape(&state.shape, polygon, state.tags, state.material, state.name, true, v);
+    }
+
+    // Mirrors the usemtl/mtllib/g/o/s handling in tinyobj::LoadObj
+    void applyStatement(const Statement& statement, size_t lineNum, GroupState& state, std::vector<shape_t>* shapes,
+        std::vector<material_t>* materials, MaterialReader& readMat, std::string* warn, std::string* err) {
+        const char* token = statement.text.c_str();
+
+        // use mtl
+        if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
+            token += 7;
+            std::string namebuf(token);
+
+            int newMaterialId = -1;
+            if (state.materialMap.find(namebuf) != state.materialMap.end()) {
+                newMaterialId = state.materialMap[namebuf];
+            }
+
+            if (newMaterialId != state.material) {
+                flushGroup(state);
+                state.material = newMaterialId;
+            }
+            return;
+        }
+
+        // load mtl
+        if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+            token += 7;
+
+            std::vector<std::string> filenames;
+            SplitString(std::string(token), ' ', filenames);
+
+            if (filenames.empty()) {
+                if (warn) {
+                    std::stringstream ss;
+                    ss << "Looks like empty filename for mtllib. Use default material (line " << lineNum << ".)\n";
+                    (*warn) += ss.str();
+                }
+                return;
+            }
+
+            bool found = false;
+            for (size_t s = 0; s < filenames.size(); s++) {
+                std::string warnMtl;
+                std::string errMtl;
+                bool ok = readMat(filenames[s].c_str(), materials, &state.materialMap, &warnMtl, &errMtl);
+                if (warn && (!warnMtl.empty())) {
+                    (*warn) += warnMtl;
+                }
+                if (err && (!errMtl.empty())) {
+                    (*err) += errMtl;
+                }
+                if (ok) {
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found && warn) {
+                (*warn) += "Failed to load material file(s). Use default material.\n";
+            }
+            return;
+        }
+
+        // group name
+        if (token[0] == 'g' && IS_SPACE((token[1]))) {
+            flushGroup(state);
+
+            if (state.shape.mesh.indices.size() > 0) {
+                shapes->push_back(state.shape);
+            }
+
+            state.shape = shape_t();
+
+            std::vector<std::string> names;
+            while (!IS_NEW_LINE(token[0])) {
+                std::string str = parseString(&token);
+                names.push_back(str);
+                token += strspn(token, " \t\r");
+            }
+
+            if (names.size() < 2) {
+                if (warn) {
+                    std::stringstream ss;
+                    ss << "Empty group name. line: " << lineNum << "\n";
+                    (*warn) += ss.str();
+                    state.name = "";
+                }
+            } else {
+                std::stringstream ss;
+                ss << names[1];
+                for (size_t i = 2; i < names.size(); i++) {
+                    ss << " " << names[i];
+                }
+                state.name = ss.str();
+            }
+            return;
+        }
+
+        // object name
+        if (token[0] == 'o' && IS_SPACE((token[1]))) {
+            if (flushGroup(state)) {
+                shapes->push_back(state.shape);
+            }
+
+            state.shape = shape_t();
+
+            token += 2;
+            state.name = token;
+            return;
+        }
+
+        // smoothing group id
+        if (token[0] == 's' && IS_SPACE(token[1])) {
+            token += 2;
+            token += strspn(token, " \t");
+
+            if (token[0] == '\0') {
+                return;
+            }
+            if (token[0] == '\r' || token[1] == '\n') {
+                return;
+            }
+
+            if (strlen(token) >= 3) {
+                if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
+                    state.smoothingId = 0;
+                }
+            } else {
+                int smGroupId = parseInt(&token);
+                state.smoothingId = smGroupId < 0 ? 0 : static_cast<unsigned int>(smGroupId);
+            }
+        }
+    }
+}
+
+bool ObjParser::Parse(const std::string& fname, attrib_t* attrib, std::vector<shape_t>* shapes,
+    std::vector<material_t>* materials, std::string* warn, std::string* err,
+    const char* mtlBaseDir, bool triangulate, unsigned threadCount, NumberParser::Implementation numbers, Stats* stats) {
+    const auto start = std::chrono::steady_clock::now();
+
+    attrib->vertices.clear();
+    attrib->normals.clear();
+    attrib->texcoords.clear();
+    attrib->colors.clear();
+    shapes->clear();
+
+    MappedFile file;
+    if (!file.Open(fname)) {
+        if (err) {
+            std::stringstream ss;
+            ss << "Cannot open file [" << fname << "]" << std::endl;
+            (*err) = ss.str();
+        }
+        return false;
+    }
+
+    if (threadCount == 0) {
+        threadCount = Parallel::DefaultThreadCount();
+    }
+
+    // Split at line boundaries
+    const char* data = file.Data();
+    const char* dataEnd = data + file.Size();
+    const size_t targetChunkSize = std::max(MIN_CHUNK_SIZE, file.Size() / (threadCount * CHUNKS_PER_THREAD) + 1);
+
+    std::vector<Chunk> chunks;
+    for (const char* begin = data; begin < dataEnd;) {
+        const char* end = begin + std::min(targetChunkSize, static_cast<size_t>(dataEnd - begin));
+        if (end < dataEnd) {
+            const char* newline = static_cast<const char*>(memchr(end, '\n', dataEnd - end));
+            end = newline ? newline + 1 : dataEnd;
+        }
+
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunk.numbers = numbers;
+        chunks.push_back(chunk);
+        begin = end;
+    }
+
+    Parallel::For(chunks.size(), threadCount, [&](size_t i) {
+        parseChunk(chunks[i]);
+    });
+
+    // Exclusive prefix sums give each chunk its global element offsets
+    size_t vCount = 0, vnCount = 0, vtCount = 0, lineCount = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        Chunk& chunk = chunks[i];
+
+        if (chunk.failed) {
+            if (err) {
+                std::stringstream ss;
+                ss << "Failed parse `f' line(e.g. zero value for face index. line " << lineCount + chunk.lineCount << ".)\n";
+                (*err) += ss.str();
+            }
+            return false;
+        }
+
+        chunk.vBase = vCount;
+        chunk.vnBase = vnCount;
+        chunk.vtBase = vtCount;
+        chunk.lineBase = lineCount;
+        vCount += chunk.v.size() / 3;
+        vnCount += chunk.vn.size() / 3;
+        vtCount += chunk.vt.size() / 2;
+        lineCount += chunk.lineCount;
+    }
+
+    attrib->vertices.resize(vCount * 3);
+    attrib->normals.resize(vnCount * 3);
+    attrib->texcoords.resize(vtCount * 2);
+
+    Parallel::For(chunks.size(), threadCount, [&](size_t i) {
+        stitchChunk(chunks[i], attrib);
+    });
+
+    // Group faces into shapes in file order
+    std::string baseDir = mtlBaseDir ? mtlBaseDir : "";
+    if (!baseDir.empty()) {
+#ifndef _WIN32
+        const char dirsep = '/';
+#else
+        const char dirsep = '\\';
+#endif
+        if (baseDir[baseDir.length() - 1] != dirsep) baseDir += dirsep;
+    }
+    MaterialFileReader matFileReader(baseDir);
+
+    GroupState state;
+    state.triangulate = triangulate;
+    int greatestV = -1, greatestVn = -1, greatestVt = -1;
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk& chunk = chunks[i];
+        size_t corner = 0;
+        size_t statement = 0;
+
+        greatestV = std::max(greatestV, chunk.greatestV);
+        greatestVn = std::max(greatestVn, chunk.greatestVn);
+        greatestVt = std::max(greatestVt, chunk.greatestVt);
+
+        for (size_t f = 0; f <= chunk.faceSizes.size(); ++f) {
+            while (statement < chunk.statements.size() && chunk.statements[statement].faceOffset == f) {
+                const Statement& s = chunk.statements[statement++];
+                applyStatement(s, chunk.lineBase + s.line, state, shapes, materials, matFileReader, warn, err);
+            }
+
+            if (f == chunk.faceSizes.size()) {
+                break;
+            }
+
+            appendFace(state, &chunk.corners[corner], chunk.faceSizes[f], attrib->vertices);
+            corner += chunk.faceSizes[f];
+        }
+    }
+
+    if (warn) {
+        if (greatestV >= static_cast<int>(vCount)) {
+            std::stringstream ss;
+            ss << "Vertex indices out of bounds (line " << lineCount << ".)\n" << std::endl;
+            (*warn) += ss.str();
+        }
+        if (greatestVn >= static_cast<int>(vnCount)) {
+            std::stringstream ss;
+            ss << "Vertex normal indices out of bounds (line " << lineCount << ".)\n" << std::endl;
+            (*warn) += ss.str();
+        }
+        if (greatestVt >= static_cast<int>(vtCount)) {
+            std::stringstream ss;
+            ss << "Vertex texcoord indices out of bounds (line " << lineCount << ".)\n" << std::endl;
+            (*warn) += ss.str();
+        }
+    }
+
+    if (flushGroup(state) || state.shape.mesh.indices.size()) {
+        shapes->push_back(state.shape);
+    }
+
+    if (stats) {
+        stats->bytes = file.Size();
+        stats->chunks = chunks.size();
+        stats->numbers = 0;
+        for (const Chunk& chunk : chunks) {
+            stats->numbers += chunk.numberCount;
+        }
+        stats->numberParser = numbers;
+        stats->threads = threadCount;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return true;
+}
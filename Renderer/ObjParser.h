@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "NumberParser.h"
+#include "tiny_obj_loader.h"
+
+// Multi-threaded drop-in for tinyobj::LoadObj. The file is memory-mapped and cut
+// into chunks at line boundaries; each worker tokenizes its chunk's v/vt/vn/f
+// records with NumberParser, which falls back to tinyobj's own number parsing,
+// and a prefix sum over the per-chunk counts turns chunk-relative indices into
+// global ones. Shapes are then built with tinyobj's grouping and triangulation
+// code, so the face data matches LoadObj exactly.
+//
+// Not supported (ignored): line and point primitives, tags and vertex colors.
+class ObjParser
+{
+public:
+    struct Stats {
+        size_t bytes;
+        size_t chunks;
+        unsigned threads;
+        double seconds;
+
+        // Values read from v/vt/vn records plus face indices
+        size_t numbers;
+        NumberParser::Implementation numberParser;
+
+        double MegabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+        // Overall parse rate, not just time spent converting numbers
+        double NumbersPerSecond() const { return seconds > 0.0 ? numbers / seconds : 0.0; }
+    };
+
+    // threadCount == 0 uses one thread per hardware thread. Every numbers
+    // implementation gives bit-identical results; SCALAR uses tinyobj's parsing
+    // throughout. stats is optional.
+    static bool Parse(const std::string& fname, tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+        std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err,
+        const char* mtlBaseDir = nullptr, bool triangulate = true, unsigned threadCount = 0,
+        NumberParser::Implementation numbers = NumberParser::Fastest(), Stats* stats = nullptr);
+
+private:
+    ObjParser();
+};
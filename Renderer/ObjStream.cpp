@@ -0,0 +1,250 @@
+// Built without the precompiled header so the streamer can run headless. The
+// tinyobj implementation lives in ObjParser.cpp.
+#include "ObjStream.h"
+#include "MeshWelder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace tinyobj;
+
+namespace {
+    // Index capacity of a batch relative to its vertex capacity. Closed meshes
+    // average about six indices per vertex once corners are shared.
+    const size_t INDICES_PER_VERTEX = 6;
+
+    const uint32_t EMPTY = 0xFFFFFFFFu;
+
+    // Faces with more corners than this are resolved into a heap buffer
+    const int MAX_STACK_CORNERS = 16;
+
+    struct StreamState {
+        ObjStream::Sink* sink;
+        size_t batchVertices;
+        size_t batchIndices;
+
+        // Every v and vt seen so far; faces may reference any of them
+        std::vector<real_t> positions;
+        std::vector<real_t> texCoords;
+
+        int material;
+        size_t faceCount;
+
+        // 1-based number of the first face with a bad index, 0 if none
+        size_t failedFace;
+
+        // The batch being built, with an open-addressing table over its
+        // vertices so that corners shared within the batch are welded
+        std::vector<ObjStream::Vertex> vertices;
+        std::vector<uint16_t> indices;
+        std::vector<uint32_t> table;
+
+        ObjStream::Stats stats;
+    };
+
+    void Flush(StreamState& state) {
+        if (!state.indices.empty()) {
+            ObjStream::Batch batch;
+            batch.vertices = state.vertices.data();
+            batch.vertexCount = state.vertices.size();
+            batch.indices = state.indices.data();
+            batch.indexCount = state.indices.size();
+            batch.material = state.material;
+            state.sink->OnBatch(batch);
+
+            state.stats.batches++;
+            state.stats.vertices += batch.vertexCount;
+            state.stats.triangles += batch.indexCount / 3;
+        }
+
+        state.vertices.clear();
+        state.indices.clear();
+        std::fill(state.table.begin(), state.table.end(), EMPTY);
+    }
+
+    void AddCorner(StreamState& state, const ObjStream::Vertex& vertex) {
+        const size_t mask = state.table.size() - 1;
+        size_t bucket = MeshWelder::HashBytes(&vertex, sizeof(vertex)) & mask;
+        while (state.table[bucket] != EMPTY) {
+            const uint32_t candidate = state.table[bucket];
+            if (memcmp(&state.vertices[candidate], &vertex, sizeof(vertex)) == 0) {
+                state.indices.push_back(static_cast<uint16_t>(candidate));
+                return;
+            }
+            bucket = (bucket + 1) & mask;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(state.vertices.size());
+        state.table[bucket] = index;
+        state.vertices.push_back(vertex);
+        state.indices.push_back(static_cast<uint16_t>(index));
+    }
+
+    // Same convention as tinyobj's fixIndex, except that 0 (no index given)
+    // yields false
+    bool ResolveIndex(int idx, size_t count, size_t* ret) {
+        if (idx > 0 && static_cast<size_t>(idx) <= count) {
+            *ret = static_cast<size_t>(idx) - 1;
+            return true;
+        }
+        if (idx < 0 && static_cast<size_t>(-static_cast<ptrdiff_t>(idx)) <= count) {
+            *ret = count - static_cast<size_t>(-static_cast<ptrdiff_t>(idx));
+            return true;
+        }
+        return false;
+    }
+
+    void OnVertex(void* userData, real_t x, real_t y, real_t z, real_t /*w*/) {
+        StreamState& state = *static_cast<StreamState*>(userData);
+        state.positions.push_back(x);
+        state.positions.push_back(y);
+        state.positions.push_back(z);
+    }
+
+    void OnTexCoord(void* userData, real_t x, real_t y, real_t /*z*/) {
+        StreamState& state = *static_cast<StreamState*>(userData);
+        state.texCoords.push_back(x);
+        state.texCoords.push_back(y);
+    }
+
+    void OnFace(void* userData, index_t* corners, int cornerCount) {
+        StreamState& state = *static_cast<StreamState*>(userData);
+        state.faceCount++;
+        if (state.failedFace || cornerCount < 3) {
+            return;
+        }
+
+        // Resolve the whole face first so a bad index drops it entirely
+        const size_t positionCount = state.positions.size() / 3;
+        const size_t texCoordCount = state.texCoords.size() / 2;
+        ObjStream::Vertex polygon[MAX_STACK_CORNERS];
+        std::vector<ObjStream::Vertex> largePolygon;
+        ObjStream::Vertex* resolved = polygon;
+        if (cornerCount > MAX_STACK_CORNERS) {
+            largePolygon.resize(cornerCount);
+            resolved = largePolygon.data();
+        }
+
+        for (int i = 0; i < cornerCount; ++i) {
+            ObjStream::Vertex& vertex = resolved[i];
+            size_t v, vt;
+            if (!ResolveIndex(corners[i].vertex_index, positionCount, &v)) {
+                state.failedFace = state.faceCount;
+                return;
+            }
+            vertex.position[0] = state.positions[3 * v + 0];
+            vertex.position[1] = state.positions[3 * v + 1];
+            vertex.position[2] = state.positions[3 * v + 2];
+
+            if (ResolveIndex(corners[i].texcoord_index, texCoordCount, &vt)) {
+                vertex.texCoord[0] = state.texCoords[2 * vt + 0];
+                vertex.texCoord[1] = state.texCoords[2 * vt + 1];
+            } else {
+                vertex.texCoord[0] = 0.f;
+                vertex.texCoord[1] = 0.f;
+            }
+        }
+
+        for (int i = 1; i + 1 < cornerCount; ++i) {
+            ObjStream::Vertex triangle[3] = { resolved[0], resolved[i], resolved[i + 1] };
+
+            // Unnormalized face normal, computed as ObjLoader does
+            const float* p1 = triangle[0].position;
+            const float* p2 = triangle[1].position;
+            const float* p3 = triangle[2].position;
+            const float side1[3] = { p1[0] - p2[0], p1[1] - p2[1], p1[2] - p2[2] };
+            const float side2[3] = { p3[0] - p2[0], p3[1] - p2[1], p3[2] - p2[2] };
+            const float normal[3] = {
+                side2[1] * side1[2] - side2[2] * side1[1],
+                side2[2] * side1[0] - side2[0] * side1[2],
+                side2[0] * side1[1] - side2[1] * side1[0]
+            };
+
+            if (state.vertices.size() + 3 > state.batchVertices || state.indices.size() + 3 > state.batchIndices) {
+                Flush(state);
+            }
+            for (ObjStream::Vertex& vertex : triangle) {
+                memcpy(vertex.normal, normal, sizeof(normal));
+                AddCorner(state, vertex);
+            }
+        }
+    }
+
+    void OnUseMaterial(void* userData, const char* /*name*/, int materialId) {
+        StreamState& state = *static_cast<StreamState*>(userData);
+        if (materialId != state.material) {
+            Flush(state);
+            state.material = materialId;
+        }
+    }
+
+    void OnMaterialLibrary(void* userData, const material_t* materials, int materialCount) {
+        StreamState& state = *static_cast<StreamState*>(userData);
+        state.sink->OnMaterials(std::vector<material_t>(materials, materials + materialCount));
+    }
+}
+
+bool ObjStream::Stream(const std::string& fname, Sink& sink, std::string* warn, std::string* err,
+    const char* mtlBaseDir, size_t batchVertices, Stats* stats) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::ifstream file(fname, std::ios::binary);
+    if (!file) {
+        if (err) {
+            std::stringstream ss;
+            ss << "Cannot open file [" << fname << "]" << std::endl;
+            (*err) = ss.str();
+        }
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    const size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    StreamState state;
+    state.sink = &sink;
+    state.batchVertices = std::min(std::max(batchVertices, static_cast<size_t>(3)), DEFAULT_BATCH_VERTICES);
+    state.batchIndices = state.batchVertices * INDICES_PER_VERTEX;
+    state.material = -1;
+    state.faceCount = 0;
+    state.failedFace = 0;
+    state.stats = Stats();
+
+    // The batch's storage is allocated once and reused
+    size_t tableSize = 16;
+    while (tableSize < state.batchVertices * 2) {
+        tableSize <<= 1;
+    }
+    state.table.assign(tableSize, EMPTY);
+    state.vertices.reserve(state.batchVertices);
+    state.indices.reserve(state.batchIndices);
+
+    callback_t callbacks;
+    callbacks.vertex_cb = OnVertex;
+    callbacks.texcoord_cb = OnTexCoord;
+    callbacks.index_cb = OnFace;
+    callbacks.usemtl_cb = OnUseMaterial;
+    callbacks.mtllib_cb = OnMaterialLibrary;
+
+    MaterialFileReader materialReader(mtlBaseDir ? mtlBaseDir : "");
+    const bool parsed = LoadObjWithCallback(file, callbacks, &state, mtlBaseDir ? &materialReader : nullptr, warn, err);
+    Flush(state);
+
+    if (state.failedFace && err) {
+        std::stringstream ss;
+        ss << "Face " << state.failedFace << " references a missing vertex; the rest of the file was skipped.\n";
+        (*err) += ss.str();
+    }
+
+    if (stats) {
+        *stats = state.stats;
+        stats->bytes = fileSize;
+        stats->attributeBytes = (state.positions.capacity() + state.texCoords.capacity()) * sizeof(real_t);
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return parsed && !state.failedFace;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tiny_obj_loader.h"
+
+// Bounded-memory OBJ ingestion. The file is read line by line through
+// tinyobj::LoadObjWithCallback and faces are turned into finished vertices as
+// they arrive, so neither the whole file, tinyobj's shapes nor a per-corner
+// vertex array is ever held. Vertices and triangles are handed to a sink in
+// batches of at most batchVertices vertices.
+//
+// What stays resident is the v and vt attribute arrays, since a face may
+// reference any earlier element, plus a single batch. Those arrays grow
+// linearly with the file, at about 14% of its size for typical meshes, so the
+// footprint is smaller than a full parse but not bounded. Normals in the file
+// are ignored: like ObjLoader, every corner gets its face's normal.
+//
+// ObjLoader::Load streams through this with its STREAM_OBJ flag.
+//
+// Polygons are triangulated as fans, which is only exact for convex faces.
+class ObjStream
+{
+public:
+    // Same layout as Vertex in Mesh.h, so batches can be copied straight into
+    // vertex buffers
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    // One finished block: a triangle list over batch-local vertices, all with
+    // the same material. The pointers are only valid during OnBatch.
+    struct Batch {
+        const Vertex* vertices;
+        size_t vertexCount;
+        const uint16_t* indices;
+        size_t indexCount;
+
+        // Index into the materials passed to OnMaterials, or -1 for none
+        int material;
+    };
+
+    class Sink {
+    public:
+        virtual ~Sink() {}
+        // Called for each material library the file loads
+        virtual void OnMaterials(const std::vector<tinyobj::material_t>&) {}
+        virtual void OnBatch(const Batch& batch) = 0;
+    };
+
+    struct Stats {
+        size_t bytes;
+        size_t batches;
+        size_t vertices;
+        size_t triangles;
+
+        // Largest size the v and vt arrays reached, i.e. the part of the
+        // footprint that grows with the file
+        size_t attributeBytes;
+        double seconds;
+    };
+
+    // Batches of this size can be drawn with 16-bit indices
+    static const size_t DEFAULT_BATCH_VERTICES = 0xFFFF;
+
+    // batchVertices is clamped to [3, DEFAULT_BATCH_VERTICES]. mtlBaseDir
+    // locates mtllib files; materials aren't loaded without it. stats is
+    // optional. Returns false if the file can't be opened or a face references
+    // a missing element; batches already emitted stay emitted.
+    static bool Stream(const std::string& fname, Sink& sink, std::string* warn, std::string* err,
+        const char* mtlBaseDir = nullptr, size_t batchVertices = DEFAULT_BATCH_VERTICES, Stats* stats = nullptr);
+
+private:
+    ObjStream();
+};
@@ -0,0 +1,656 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Occluders.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // Most cells along each axis of the grid laid over a plane's triangles
+    const int GRID_SIZE = 64;
+
+    // Cells across the side of the smallest quad worth keeping. Planes too
+    // small for GRID_SIZE such cells get a coarser grid.
+    const float MIN_QUAD_CELLS = 8.f;
+
+    // Fraction of a cell by which boundary edges may graze it without
+    // uncovering it, so that rounding in the projection can't cost a cell on
+    // every side of a quad that lines up with the grid
+    const float EDGE_MARGIN = 1e-3f;
+
+    // Steps per unit of a normal component when grouping triangles by plane
+    const float NORMAL_STEPS = 128.f;
+
+    // Points IsConservative checks per occluder triangle edge, plus one
+    const int SAMPLE_STEPS = 8;
+
+    // Cells along each axis of the grid IsConservative sorts input triangles
+    // into
+    const int SEARCH_GRID_SIZE = 32;
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 operator+(Float3 a, Float3 b) {
+        return { a.x + b.x, a.y + b.y, a.z + b.z };
+    }
+
+    Float3 operator-(Float3 a, Float3 b) {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    Float3 operator*(Float3 a, float s) {
+        return { a.x * s, a.y * s, a.z * s };
+    }
+
+    float Dot(Float3 a, Float3 b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Float3 Cross(Float3 a, Float3 b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    float Length(Float3 a) {
+        return sqrtf(Dot(a, a));
+    }
+
+    float Component(Float3 a, int axis) {
+        return axis == 0 ? a.x : axis == 1 ? a.y : a.z;
+    }
+
+    Float3 LoadPosition(const float* positions, size_t stride, uint32_t index) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * stride);
+        return { p[0], p[1], p[2] };
+    }
+
+    // Quantized plane of a triangle. Triangles with the same key are
+    // candidates for one group; the group's fitted plane decides which of
+    // them really are flat enough.
+    struct PlaneKey {
+        int32_t normal[3];
+        int64_t distance;
+
+        bool operator<(const PlaneKey& other) const {
+            for (int axis = 0; axis < 3; ++axis) {
+                if (normal[axis] != other.normal[axis]) {
+                    return normal[axis] < other.normal[axis];
+                }
+            }
+            return distance < other.distance;
+        }
+
+        bool operator==(const PlaneKey& other) const {
+            return !(*this < other) && !(other < *this);
+        }
+    };
+
+    struct KeyedTriangle {
+        PlaneKey key;
+        uint32_t triangle;
+    };
+
+    struct Quad {
+        // Counterclockwise about the plane normal
+        Float3 corners[4];
+        float area;
+        float error;
+    };
+
+    // Gives corners that share a position the same id, so that neighbouring
+    // triangles split by a UV seam still share their edge
+    void AssignPositionIds(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, std::vector<uint32_t>& positionIds) {
+        std::vector<uint32_t> order(indexCount);
+        for (size_t i = 0; i < indexCount; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        auto positionOf = [&](uint32_t corner) {
+            return LoadPosition(positions, positionStride, indices[corner]);
+        };
+        std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+            const Float3 a = positionOf(lhs);
+            const Float3 b = positionOf(rhs);
+            return memcmp(&a, &b, sizeof(Float3)) < 0;
+        });
+
+        positionIds.resize(indexCount);
+        uint32_t id = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            if (i > 0) {
+                const Float3 a = positionOf(order[i - 1]);
+                const Float3 b = positionOf(order[i]);
+                id += memcmp(&a, &b, sizeof(Float3)) != 0 ? 1 : 0;
+            }
+            positionIds[order[i]] = id;
+        }
+    }
+
+    // Marks the cells whose interior, shrunk by EDGE_MARGIN, the segment from
+    // a to b touches. Coordinates are in cells.
+    void MarkSegment(float ax, float ay, float bx, float by, int width, int height, std::vector<uint8_t>& blocked) {
+        if (ay > by) {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+
+        const int rowBegin = std::max(0, static_cast<int>(floorf(ay)) - 1);
+        const int rowEnd = std::min(height - 1, static_cast<int>(floorf(by)) + 1);
+        for (int row = rowBegin; row <= rowEnd; ++row) {
+            const float y0 = std::max(ay, row + EDGE_MARGIN);
+            const float y1 = std::min(by, row + 1 - EDGE_MARGIN);
+            if (y0 > y1) {
+                continue;
+            }
+
+            // The part of the segment within the row
+            float x0 = ax;
+            float x1 = bx;
+            if (by > ay) {
+                const float slope = (bx - ax) / (by - ay);
+                x0 = ax + (y0 - ay) * slope;
+                x1 = ax + (y1 - ay) * slope;
+            }
+            if (x0 > x1) {
+                std::swap(x0, x1);
+            }
+
+            const int columnBegin = std::max(0, static_cast<int>(floorf(x0)) - 1);
+            const int columnEnd = std::min(width - 1, static_cast<int>(floorf(x1)) + 1);
+            for (int column = columnBegin; column <= columnEnd; ++column) {
+                if (x0 <= column + 1 - EDGE_MARGIN && x1 >= column + EDGE_MARGIN) {
+                    blocked[row * width + column] = 1;
+                }
+            }
+        }
+    }
+
+    // Largest rectangle of covered cells by cell count, as [x0, x1) by
+    // [y0, y1). Each row is scanned as a histogram of the covered runs ending
+    // in it.
+    int LargestRectangle(const std::vector<uint8_t>& covered, int width, int height, int rect[4]) {
+        std::vector<int> heights(width + 1, 0);
+        std::vector<int> stack;
+        int best = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                heights[x] = covered[y * width + x] ? heights[x] + 1 : 0;
+            }
+
+            stack.clear();
+            for (int x = 0; x <= width; ++x) {
+                while (!stack.empty() && heights[stack.back()] >= heights[x]) {
+                    const int top = stack.back();
+                    stack.pop_back();
+                    const int left = stack.empty() ? 0 : stack.back() + 1;
+                    const int area = heights[top] * (x - left);
+                    if (area > best) {
+                        best = area;
+                        rect[0] = left;
+                        rect[1] = y + 1 - heights[top];
+                        rect[2] = x;
+                        rect[3] = y + 1;
+                    }
+                }
+                stack.push_back(x);
+            }
+        }
+        return best;
+    }
+
+    // Finds quads on the plane shared by the given triangles, largest first
+    void ExtractQuads(const std::vector<uint32_t>& group, const uint32_t* indices, const float* positions, size_t positionStride,
+        const std::vector<Float3>& faceCrosses, const std::vector<uint32_t>& positionIds, float tolerance, float minArea, size_t maxQuads,
+        std::vector<Quad>& quads) {
+        // Fit the plane: the area-weighted normal through the area-weighted
+        // centroid
+        Float3 normal = { 0.f, 0.f, 0.f };
+        Float3 origin = { 0.f, 0.f, 0.f };
+        float totalArea = 0.f;
+        for (uint32_t t : group) {
+            const Float3 a = LoadPosition(positions, positionStride, indices[3 * t + 0]);
+            const Float3 b = LoadPosition(positions, positionStride, indices[3 * t + 1]);
+            const Float3 c = LoadPosition(positions, positionStride, indices[3 * t + 2]);
+            const float area = 0.5f * Length(faceCrosses[t]);
+            normal = normal + faceCrosses[t];
+            origin = origin + (a + b + c) * (area / 3.f);
+            totalArea += area;
+        }
+        if (totalArea < minArea || Length(normal) == 0.f) {
+            return;
+        }
+        normal = normal * (1.f / Length(normal));
+        origin = origin * (1.f / totalArea);
+
+        // Only triangles within tolerance of the plane count. The rest are
+        // left out, which only shrinks what counts as covered.
+        std::vector<uint32_t> kept;
+        float error = 0.f;
+        for (uint32_t t : group) {
+            float deviation = 0.f;
+            for (int k = 0; k < 3; ++k) {
+                const Float3 p = LoadPosition(positions, positionStride, indices[3 * t + k]);
+                deviation = std::max(deviation, fabsf(Dot(normal, p - origin)));
+            }
+            if (deviation <= tolerance) {
+                kept.push_back(t);
+                error = std::max(error, deviation);
+            }
+        }
+        if (kept.empty()) {
+            return;
+        }
+
+        // In-plane axes, aligned with the world axis the plane is most
+        // parallel to, so axis-aligned walls give axis-aligned cells
+        int axis = 0;
+        for (int a = 1; a < 3; ++a) {
+            if (fabsf(Component(normal, a)) < fabsf(Component(normal, axis))) {
+                axis = a;
+            }
+        }
+        Float3 worldAxis = { 0.f, 0.f, 0.f };
+        (axis == 0 ? worldAxis.x : axis == 1 ? worldAxis.y : worldAxis.z) = 1.f;
+        Float3 uAxis = worldAxis - normal * Dot(normal, worldAxis);
+        uAxis = uAxis * (1.f / Length(uAxis));
+        const Float3 vAxis = Cross(normal, uAxis);
+
+        // Project every kept corner into the plane
+        std::vector<float> projected(kept.size() * 6);
+        float low[2] = { FLT_MAX, FLT_MAX };
+        float high[2] = { -FLT_MAX, -FLT_MAX };
+        for (size_t i = 0; i < kept.size(); ++i) {
+            for (int k = 0; k < 3; ++k) {
+                const Float3 p = LoadPosition(positions, positionStride, indices[3 * kept[i] + k]) - origin;
+                const float uv[2] = { Dot(p, uAxis), Dot(p, vAxis) };
+                for (int d = 0; d < 2; ++d) {
+                    projected[6 * i + 2 * k + d] = uv[d];
+                    low[d] = std::min(low[d], uv[d]);
+                    high[d] = std::max(high[d], uv[d]);
+                }
+            }
+        }
+        int gridSize[2];
+        float cellSize[2];
+        for (int d = 0; d < 2; ++d) {
+            const float extent = high[d] - low[d];
+            if (!(extent > 0.f)) {
+                return;
+            }
+            gridSize[d] = static_cast<int>(std::min(ceilf(extent * MIN_QUAD_CELLS / sqrtf(minArea)), float(GRID_SIZE)));
+            cellSize[d] = extent / gridSize[d];
+        }
+        const int width = gridSize[0];
+        const int height = gridSize[1];
+        for (size_t i = 0; i < projected.size(); i += 2) {
+            projected[i + 0] = (projected[i + 0] - low[0]) / cellSize[0];
+            projected[i + 1] = (projected[i + 1] - low[1]) / cellSize[1];
+        }
+
+        // A cell is covered if its center is inside a kept triangle and no edge
+        // on the boundary of their union crosses it
+        std::vector<uint8_t> inside(width * height, 0);
+        for (size_t i = 0; i < kept.size(); ++i) {
+            const float* p = &projected[6 * i];
+            const float orientation = (p[2] - p[0]) * (p[5] - p[1]) - (p[3] - p[1]) * (p[4] - p[0]);
+            if (orientation == 0.f) {
+                continue;
+            }
+
+            const int x0 = std::max(0, static_cast<int>(floorf(std::min({ p[0], p[2], p[4] }))));
+            const int x1 = std::min(width - 1, static_cast<int>(floorf(std::max({ p[0], p[2], p[4] }))));
+            const int y0 = std::max(0, static_cast<int>(floorf(std::min({ p[1], p[3], p[5] }))));
+            const int y1 = std::min(height - 1, static_cast<int>(floorf(std::max({ p[1], p[3], p[5] }))));
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    const float cx = x + 0.5f;
+                    const float cy = y + 0.5f;
+                    bool in = true;
+                    for (int k = 0; k < 3 && in; ++k) {
+                        const float* e0 = &p[2 * k];
+                        const float* e1 = &p[2 * ((k + 1) % 3)];
+                        in = ((e1[0] - e0[0]) * (cy - e0[1]) - (e1[1] - e0[1]) * (cx - e0[0])) * orientation >= 0.f;
+                    }
+                    inside[y * width + x] |= in ? 1 : 0;
+                }
+            }
+        }
+
+        // An edge is interior when exactly one kept triangle runs along it each
+        // way; every other edge bounds the covered region
+        std::unordered_map<uint64_t, uint32_t> edgeCounts;
+        auto edgeKey = [&](size_t i, int k) {
+            const uint32_t from = positionIds[3 * kept[i] + k];
+            const uint32_t to = positionIds[3 * kept[i] + (k + 1) % 3];
+            return (uint64_t(from) << 32) | to;
+        };
+        for (size_t i = 0; i < kept.size(); ++i) {
+            for (int k = 0; k < 3; ++k) {
+                edgeCounts[edgeKey(i, k)]++;
+            }
+        }
+        std::vector<uint8_t> blocked(width * height, 0);
+        for (size_t i = 0; i < kept.size(); ++i) {
+            for (int k = 0; k < 3; ++k) {
+                const uint64_t key = edgeKey(i, k);
+                const auto reverse = edgeCounts.find((key << 32) | (key >> 32));
+                if (edgeCounts[key] == 1 && reverse != edgeCounts.end() && reverse->second == 1) {
+                    continue;
+                }
+                const float* e0 = &projected[6 * i + 2 * k];
+                const float* e1 = &projected[6 * i + 2 * ((k + 1) % 3)];
+                MarkSegment(e0[0], e0[1], e1[0], e1[1], width, height, blocked);
+            }
+        }
+
+        std::vector<uint8_t> covered(width * height);
+        for (size_t c = 0; c < covered.size(); ++c) {
+            covered[c] = inside[c] && !blocked[c];
+        }
+
+        // Greedily peel off the largest rectangle until they get too small
+        const float cellArea = cellSize[0] * cellSize[1];
+        for (size_t q = 0; q < maxQuads; ++q) {
+            int rect[4];
+            const int cells = LargestRectangle(covered, width, height, rect);
+            if (cells == 0 || cells * cellArea < minArea) {
+                break;
+            }
+            for (int y = rect[1]; y < rect[3]; ++y) {
+                std::fill(covered.begin() + y * width + rect[0], covered.begin() + y * width + rect[2], uint8_t(0));
+            }
+
+            const float u0 = low[0] + rect[0] * cellSize[0];
+            const float u1 = low[0] + rect[2] * cellSize[0];
+            const float v0 = low[1] + rect[1] * cellSize[1];
+            const float v1 = low[1] + rect[3] * cellSize[1];
+
+            Quad quad;
+            quad.corners[0] = origin + uAxis * u0 + vAxis * v0;
+            quad.corners[1] = origin + uAxis * u1 + vAxis * v0;
+            quad.corners[2] = origin + uAxis * u1 + vAxis * v1;
+            quad.corners[3] = origin + uAxis * u0 + vAxis * v1;
+            quad.area = cells * cellArea;
+            quad.error = error;
+            quads.push_back(quad);
+        }
+    }
+
+    // Closest point to p on triangle abc, after Ericson's Real-Time Collision
+    // Detection, 5.1.5
+    Float3 ClosestPointOnTriangle(Float3 p, Float3 a, Float3 b, Float3 c) {
+        const Float3 ab = b - a;
+        const Float3 ac = c - a;
+        const Float3 ap = p - a;
+        const float d1 = Dot(ab, ap);
+        const float d2 = Dot(ac, ap);
+        if (d1 <= 0.f && d2 <= 0.f) {
+            return a;
+        }
+
+        const Float3 bp = p - b;
+        const float d3 = Dot(ab, bp);
+        const float d4 = Dot(ac, bp);
+        if (d3 >= 0.f && d4 <= d3) {
+            return b;
+        }
+
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        const Float3 cp = p - c;
+        const float d5 = Dot(ab, cp);
+        const float d6 = Dot(ac, cp);
+        if (d6 >= 0.f && d5 <= d6) {
+            return c;
+        }
+
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        const float denominator = 1.f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+}
+
+namespace Occluders {
+    Occluder Build(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t triangleBudget, float tolerance,
+        float minArea, uint32_t chunk, std::vector<float>& occluderPositions, std::vector<uint32_t>& occluderIndices) {
+        Occluder occluder = {};
+        occluder.vertexStart = static_cast<uint32_t>(occluderPositions.size() / 3);
+        occluder.indexStart = static_cast<uint32_t>(occluderIndices.size());
+        occluder.chunk = chunk;
+
+        const size_t triangleCount = indexCount / 3;
+        const size_t maxQuads = triangleBudget / 2;
+        if (triangleCount == 0 || maxQuads == 0 || !(tolerance > 0.f)) {
+            return occluder;
+        }
+
+        std::vector<uint32_t> positionIds;
+        AssignPositionIds(indices, triangleCount * 3, positions, positionStride, positionIds);
+
+        // Group triangles by quantized plane
+        std::vector<Float3> faceCrosses(triangleCount);
+        std::vector<KeyedTriangle> keyed;
+        keyed.reserve(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const Float3 a = LoadPosition(positions, positionStride, indices[3 * t + 0]);
+            const Float3 b = LoadPosition(positions, positionStride, indices[3 * t + 1]);
+            const Float3 c = LoadPosition(positions, positionStride, indices[3 * t + 2]);
+            faceCrosses[t] = Cross(c - b, a - b);
+
+            const float length = Length(faceCrosses[t]);
+            if (!(length > 0.f)) {
+                continue;
+            }
+            const Float3 normal = faceCrosses[t] * (1.f / length);
+
+            KeyedTriangle entry;
+            entry.key.normal[0] = static_cast<int32_t>(lroundf(normal.x * NORMAL_STEPS));
+            entry.key.normal[1] = static_cast<int32_t>(lroundf(normal.y * NORMAL_STEPS));
+            entry.key.normal[2] = static_cast<int32_t>(lroundf(normal.z * NORMAL_STEPS));
+            entry.key.distance = static_cast<int64_t>(llround(Dot(normal, a) / tolerance));
+            entry.triangle = static_cast<uint32_t>(t);
+            keyed.push_back(entry);
+        }
+        std::sort(keyed.begin(), keyed.end(), [](const KeyedTriangle& lhs, const KeyedTriangle& rhs) {
+            return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.triangle < rhs.triangle);
+        });
+
+        // Visit the groups by area, largest first. Once the budget is full, a
+        // group's quads have to beat the smallest one kept, and groups too small
+        // to do so are skipped without rasterizing them.
+        struct Group {
+            size_t begin;
+            size_t end;
+            float area;
+        };
+        std::vector<Group> groups;
+        for (size_t begin = 0; begin < keyed.size();) {
+            Group group = { begin, begin, 0.f };
+            for (; group.end < keyed.size() && keyed[group.end].key == keyed[begin].key; ++group.end) {
+                group.area += 0.5f * Length(faceCrosses[keyed[group.end].triangle]);
+            }
+            groups.push_back(group);
+            begin = group.end;
+        }
+        std::stable_sort(groups.begin(), groups.end(), [](const Group& lhs, const Group& rhs) {
+            return lhs.area > rhs.area;
+        });
+
+        std::vector<Quad> quads;
+        std::priority_queue<float, std::vector<float>, std::greater<float>> keptAreas;
+        std::vector<uint32_t> triangles;
+        for (const Group& group : groups) {
+            const float threshold = keptAreas.size() < maxQuads ? minArea : std::max(minArea, keptAreas.top());
+            if (group.area <= threshold) {
+                continue;
+            }
+
+            triangles.clear();
+            for (size_t i = group.begin; i < group.end; ++i) {
+                triangles.push_back(keyed[i].triangle);
+            }
+            const size_t first = quads.size();
+            ExtractQuads(triangles, indices, positions, positionStride, faceCrosses, positionIds, tolerance, threshold, maxQuads, quads);
+            for (size_t q = first; q < quads.size(); ++q) {
+                keptAreas.push(quads[q].area);
+                if (keptAreas.size() > maxQuads) {
+                    keptAreas.pop();
+                }
+            }
+        }
+
+        // Keep the largest quads that fit the budget
+        std::stable_sort(quads.begin(), quads.end(), [](const Quad& lhs, const Quad& rhs) {
+            return lhs.area > rhs.area;
+        });
+        quads.resize(std::min(quads.size(), maxQuads));
+
+        for (int axis = 0; axis < 3; ++axis) {
+            occluder.min[axis] = quads.empty() ? 0.f : FLT_MAX;
+            occluder.max[axis] = quads.empty() ? 0.f : -FLT_MAX;
+        }
+        for (const Quad& quad : quads) {
+            const uint32_t base = static_cast<uint32_t>(occluderPositions.size() / 3) - occluder.vertexStart;
+            for (const Float3& corner : quad.corners) {
+                occluderPositions.insert(occluderPositions.end(), { corner.x, corner.y, corner.z });
+                for (int axis = 0; axis < 3; ++axis) {
+                    occluder.min[axis] = std::min(occluder.min[axis], Component(corner, axis));
+                    occluder.max[axis] = std::max(occluder.max[axis], Component(corner, axis));
+                }
+            }
+            occluderIndices.insert(occluderIndices.end(), { base + 0, base + 1, base + 2, base + 0, base + 2, base + 3 });
+            occluder.area += quad.area;
+            occluder.error = std::max(occluder.error, quad.error);
+        }
+
+        occluder.vertexCount = static_cast<uint32_t>(occluderPositions.size() / 3) - occluder.vertexStart;
+        occluder.indexCount = static_cast<uint32_t>(occluderIndices.size()) - occluder.indexStart;
+        return occluder;
+    }
+
+    bool IsConservative(const Occluder& occluder, const float* occluderPositions, const uint32_t* occluderIndices, const uint32_t* indices,
+        size_t indexCount, const float* positions, size_t positionStride, float maxDistance) {
+        if (occluder.indexCount == 0) {
+            return true;
+        }
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return false;
+        }
+
+        // Sort the input triangles into a grid by their bounds, so each point
+        // only looks at the triangles near it
+        Float3 low = { FLT_MAX, FLT_MAX, FLT_MAX };
+        Float3 high = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            const Float3 p = LoadPosition(positions, positionStride, indices[i]);
+            low = { std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z) };
+            high = { std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z) };
+        }
+        const Float3 margin = { maxDistance, maxDistance, maxDistance };
+        low = low - margin;
+        high = high + margin;
+        const Float3 extent = high - low;
+        auto cellOf = [&](float value, int axis) {
+            const float size = std::max(Component(extent, axis), FLT_MIN);
+            const int cell = static_cast<int>((value - Component(low, axis)) / size * SEARCH_GRID_SIZE);
+            return std::min(std::max(cell, 0), SEARCH_GRID_SIZE - 1);
+        };
+
+        // Cell range of each triangle's bounds, then a counting sort
+        std::vector<int> triangleCells(triangleCount * 6);
+        std::vector<uint32_t> cellStart(SEARCH_GRID_SIZE * SEARCH_GRID_SIZE * SEARCH_GRID_SIZE + 1, 0);
+        auto forEachCell = [&](size_t t, auto fn) {
+            const int* range = &triangleCells[6 * t];
+            for (int z = range[2]; z <= range[5]; ++z) {
+                for (int y = range[1]; y <= range[4]; ++y) {
+                    for (int x = range[0]; x <= range[3]; ++x) {
+                        fn((z * SEARCH_GRID_SIZE + y) * SEARCH_GRID_SIZE + x);
+                    }
+                }
+            }
+        };
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int axis = 0; axis < 3; ++axis) {
+                float a = FLT_MAX;
+                float b = -FLT_MAX;
+                for (int k = 0; k < 3; ++k) {
+                    const float v = Component(LoadPosition(positions, positionStride, indices[3 * t + k]), axis);
+                    a = std::min(a, v);
+                    b = std::max(b, v);
+                }
+                triangleCells[6 * t + axis] = cellOf(a, axis);
+                triangleCells[6 * t + 3 + axis] = cellOf(b, axis);
+            }
+            forEachCell(t, [&](int cell) { cellStart[cell + 1]++; });
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        std::vector<uint32_t> cellTriangles(cellStart.back());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            forEachCell(t, [&](int cell) { cellTriangles[fill[cell]++] = static_cast<uint32_t>(t); });
+        }
+
+        auto onSurface = [&](Float3 p) {
+            const int x0 = cellOf(p.x - maxDistance, 0), x1 = cellOf(p.x + maxDistance, 0);
+            const int y0 = cellOf(p.y - maxDistance, 1), y1 = cellOf(p.y + maxDistance, 1);
+            const int z0 = cellOf(p.z - maxDistance, 2), z1 = cellOf(p.z + maxDistance, 2);
+            for (int z = z0; z <= z1; ++z) {
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        const int cell = (z * SEARCH_GRID_SIZE + y) * SEARCH_GRID_SIZE + x;
+                        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                            const uint32_t t = cellTriangles[i];
+                            const Float3 a = LoadPosition(positions, positionStride, indices[3 * t + 0]);
+                            const Float3 b = LoadPosition(positions, positionStride, indices[3 * t + 1]);
+                            const Float3 c = LoadPosition(positions, positionStride, indices[3 * t + 2]);
+                            if (Length(ClosestPointOnTriangle(p, a, b, c) - p) <= maxDistance) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+            }
+            return false;
+        };
+
+        const float* vertices = occluderPositions + 3 * size_t(occluder.vertexStart);
+        for (uint32_t i = 0; i + 2 < occluder.indexCount; i += 3) {
+            Float3 corners[3];
+            for (int k = 0; k < 3; ++k) {
+                const float* p = &vertices[3 * size_t(occluderIndices[occluder.indexStart + i + k])];
+                corners[k] = { p[0], p[1], p[2] };
+            }
+            for (int s = 0; s <= SAMPLE_STEPS; ++s) {
+                for (int r = 0; r + s <= SAMPLE_STEPS; ++r) {
+                    const float u = float(s) / SAMPLE_STEPS;
+                    const float v = float(r) / SAMPLE_STEPS;
+                    const Float3 p = corners[0] + (corners[1] - corners[0]) * u + (corners[2] - corners[0]) * v;
+                    if (!onSurface(p)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Conservative occluder geometry for CPU occlusion culling. Portable; no
+// Windows or D3D dependencies.
+//
+// An occluder stands in for a mesh, or one chunk of it, when depth is
+// rasterized on the CPU, so it has to be far cheaper than the mesh and must
+// never hide anything the mesh itself wouldn't. Both follow from only keeping
+// pieces of the original surface: triangles are grouped by plane, each plane's
+// triangles are rasterized onto a grid laid in the plane, and rectangles of
+// grid cells lying entirely inside them become occluder quads. Walls, floors
+// and the flat sides of pillars turn into a few large quads, while curved or
+// finely detailed surfaces contribute nothing. The largest quads are kept, up
+// to a triangle budget.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Occluders {
+    struct Occluder {
+        // Ranges of the occluder position and index arrays. Indices are
+        // relative to vertexStart.
+        uint32_t vertexStart;
+        uint32_t vertexCount;
+        uint32_t indexStart;
+        uint32_t indexCount;
+
+        // The chunk this stands in for, or NO_CHUNK for a whole mesh
+        uint32_t chunk;
+
+        // Largest distance between the occluder and the surface it came from,
+        // left over from fitting planes to nearly flat triangles
+        float error;
+
+        // Total area of the occluder's triangles, and their bounds
+        float area;
+        float min[3];
+        float max[3];
+
+        static const uint32_t NO_CHUNK = 0xFFFFFFFF;
+    };
+
+    // Builds an occluder of at most triangleBudget triangles for the triangles
+    // indices[0, indexCount), appending its vertices (xyz) to positions and its
+    // triangles to occluderIndices. Triangles further than tolerance from their
+    // plane's best fit are left out, as are quads smaller than minArea. Quads
+    // are wound like the triangles under them, so cross(c - b, a - b) points
+    // the same way. An input with nothing flat enough gives an empty occluder.
+    Occluder Build(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t triangleBudget, float tolerance,
+        float minArea, uint32_t chunk, std::vector<float>& occluderPositions, std::vector<uint32_t>& occluderIndices);
+
+    // The validation check: true if points spread evenly over every occluder
+    // triangle all lie within maxDistance of one of the input triangles it
+    // was built from
+    bool IsConservative(const Occluder& occluder, const float* occluderPositions, const uint32_t* occluderIndices, const uint32_t* indices,
+        size_t indexCount, const float* positions, size_t positionStride, float maxDistance);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Minimal fork/join helpers shared by the asset pipeline. Portable; no Windows
+// dependencies.
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+    inline unsigned DefaultThreadCount() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count ? count : 1;
+    }
+
+    // Calls fn(i) for every i in [0, count) using up to threadCount threads
+    // (0 = one per hardware thread). Work items are handed out one at a time, so
+    // uneven items balance themselves. The calling thread participates, and the
+    // call returns once every item has completed.
+    template <typename Fn>
+    void For(size_t count, unsigned threadCount, Fn fn) {
+        if (threadCount == 0) {
+            threadCount = DefaultThreadCount();
+        }
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, count));
+
+        if (threadCount <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (unsigned t = 1; t < threadCount; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}
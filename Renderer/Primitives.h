@@ -0,0 +1,518 @@
+#pragma once
+
+// Built-in shapes generated at compile time. Header-only and portable; no
+// Windows or D3D dependencies.
+//
+// Every generator is constexpr, so a shape stored in a static constexpr
+// variable is built by the compiler and lands in read-only data: built-in
+// meshes need no file I/O and no work at startup. Tessellation levels are
+// template parameters, which fixes a shape's vertex and index counts in its
+// type.
+//
+// Shapes are centered on the origin with radius 1, except the plane, which
+// spans [-1, 1] in x and z. y is up and v runs down the texture. Triangles
+// wind so that cross(c - b, a - b) points outward, like the bundled OBJs and
+// ObjLoader's face normals. Spheres share vertices and have smooth normals;
+// the polyhedra give each face its own vertices and flat normals, and map
+// the whole texture onto every face.
+//
+// The math runs in double and is rounded to float once per vertex. The
+// series below converge far past float precision on their reduced ranges.
+// Finer tessellations than the ones the renderer uses may need a higher
+// constexpr step limit (/constexpr:steps in MSVC).
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Primitives {
+    // Laid out like the renderer's Vertex
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    template <size_t VertexCount, size_t IndexCount>
+    struct Shape {
+        // 0xFFFF is left unused since it doubles as the strip-cut value
+        static_assert(VertexCount <= 0xFFFF, "Shapes use 16-bit indices");
+
+        static const size_t VERTEX_COUNT = VertexCount;
+        static const size_t INDEX_COUNT = IndexCount;
+
+        Vertex vertices[VertexCount];
+        uint16_t indices[IndexCount];
+    };
+
+    namespace Detail {
+        constexpr double PI = 3.14159265358979323846;
+
+        // Taylor series after folding x into [-pi/2, pi/2]
+        constexpr double Sin(double x) {
+            while (x > PI) {
+                x -= 2.0 * PI;
+            }
+            while (x < -PI) {
+                x += 2.0 * PI;
+            }
+            if (x > PI / 2.0) {
+                x = PI - x;
+            } else if (x < -PI / 2.0) {
+                x = -PI - x;
+            }
+
+            const double x2 = x * x;
+            double term = x;
+            double sum = x;
+            for (int n = 1; n < 12; ++n) {
+                term *= -x2 / ((2.0 * n) * (2.0 * n + 1.0));
+                sum += term;
+            }
+            return sum;
+        }
+
+        constexpr double Cos(double x) {
+            return Sin(x + PI / 2.0);
+        }
+
+        // Newton's method from above the root, where it decreases steadily
+        // until it converges
+        constexpr double Sqrt(double x) {
+            if (!(x > 0.0)) {
+                return 0.0;
+            }
+            double root = x > 1.0 ? x : 1.0;
+            for (;;) {
+                const double next = 0.5 * (root + x / root);
+                if (!(next < root)) {
+                    return root;
+                }
+                root = next;
+            }
+        }
+
+        // Taylor series after halving the angle twice, which brings |x| under
+        // tan(pi / 16)
+        constexpr double Atan(double x) {
+            if (x < 0.0) {
+                return -Atan(-x);
+            }
+            if (x > 1.0) {
+                return PI / 2.0 - Atan(1.0 / x);
+            }
+            for (int halving = 0; halving < 2; ++halving) {
+                x = x / (1.0 + Sqrt(1.0 + x * x));
+            }
+
+            const double x2 = x * x;
+            double power = x;
+            double sum = x;
+            for (int n = 1; n < 12; ++n) {
+                power *= -x2;
+                sum += power / (2.0 * n + 1.0);
+            }
+            return 4.0 * sum;
+        }
+
+        constexpr double Atan2(double y, double x) {
+            if (x > 0.0) {
+                return Atan(y / x);
+            }
+            if (x < 0.0) {
+                return y < 0.0 ? Atan(y / x) - PI : Atan(y / x) + PI;
+            }
+            return y > 0.0 ? PI / 2.0 : (y < 0.0 ? -PI / 2.0 : 0.0);
+        }
+
+        struct Vec3 {
+            double x, y, z;
+        };
+
+        constexpr Vec3 Add(const Vec3& a, const Vec3& b) {
+            return { a.x + b.x, a.y + b.y, a.z + b.z };
+        }
+
+        constexpr Vec3 Scale(const Vec3& v, double s) {
+            return { v.x * s, v.y * s, v.z * s };
+        }
+
+        constexpr Vec3 Normalize(const Vec3& v) {
+            const double length = Sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            return length > 0.0 ? Scale(v, 1.0 / length) : v;
+        }
+
+        constexpr void SetVertex(Vertex& vertex, const Vec3& position, const Vec3& normal, double u, double v) {
+            vertex.position[0] = static_cast<float>(position.x);
+            vertex.position[1] = static_cast<float>(position.y);
+            vertex.position[2] = static_cast<float>(position.z);
+            vertex.normal[0] = static_cast<float>(normal.x);
+            vertex.normal[1] = static_cast<float>(normal.y);
+            vertex.normal[2] = static_cast<float>(normal.z);
+            vertex.texCoord[0] = static_cast<float>(u);
+            vertex.texCoord[1] = static_cast<float>(v);
+        }
+
+        // Spherical projection: u follows the longitude the UV sphere uses, v
+        // the angle down from +y
+        constexpr void SetSphereVertex(Vertex& vertex, const Vec3& unit) {
+            double u = Atan2(unit.z, unit.x) / (2.0 * PI);
+            if (u < 0.0) {
+                u += 1.0;
+            }
+            const double v = Atan2(Sqrt(unit.x * unit.x + unit.z * unit.z), unit.y) / PI;
+            SetVertex(vertex, unit, unit, u, v);
+        }
+
+        template <size_t IndexCount>
+        constexpr void SetTriangle(uint16_t (&indices)[IndexCount], size_t& next, size_t a, size_t b, size_t c) {
+            indices[next++] = static_cast<uint16_t>(a);
+            indices[next++] = static_cast<uint16_t>(b);
+            indices[next++] = static_cast<uint16_t>(c);
+        }
+
+        // A convex polyhedron's corners and faces, each face's corners
+        // counterclockwise seen from outside
+        template <size_t CornerCount, size_t FaceCount, size_t Sides>
+        struct Solid {
+            Vec3 corners[CornerCount];
+            uint8_t faces[FaceCount][Sides];
+        };
+
+        // The golden ratio
+        constexpr double PHI = 1.61803398874989484820;
+
+        constexpr Solid<4, 4, 3> Tetrahedron() {
+            return {
+                { { 1.0, 1.0, 1.0 }, { 1.0, -1.0, -1.0 }, { -1.0, 1.0, -1.0 }, { -1.0, -1.0, 1.0 } },
+                { { 1, 3, 2 }, { 0, 2, 3 }, { 0, 3, 1 }, { 0, 1, 2 } }
+            };
+        }
+
+        constexpr Solid<6, 8, 3> Octahedron() {
+            return {
+                { { 1.0, 0.0, 0.0 }, { -1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, -1.0, 0.0 }, { 0.0, 0.0, 1.0 }, { 0.0, 0.0, -1.0 } },
+                { { 0, 2, 4 }, { 0, 5, 2 }, { 0, 4, 3 }, { 0, 3, 5 }, { 1, 4, 2 }, { 1, 2, 5 }, { 1, 3, 4 }, { 1, 5, 3 } }
+            };
+        }
+
+        constexpr Solid<12, 20, 3> Icosahedron() {
+            return {
+                {
+                    { -1.0, 0.0, PHI }, { 1.0, 0.0, PHI }, { -1.0, 0.0, -PHI }, { 1.0, 0.0, -PHI },
+                    { 0.0, -PHI, -1.0 }, { 0.0, -PHI, 1.0 }, { 0.0, PHI, -1.0 }, { 0.0, PHI, 1.0 },
+                    { PHI, 1.0, 0.0 }, { PHI, -1.0, 0.0 }, { -PHI, 1.0, 0.0 }, { -PHI, -1.0, 0.0 }
+                },
+                {
+                    { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+                    { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+                    { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+                    { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+                }
+            };
+        }
+
+        // The solid whose corners are the centers of the triangles of solid
+        // and whose faces surround its corners. Sides is how many triangles
+        // meet at each corner.
+        template <size_t Sides, size_t CornerCount, size_t FaceCount>
+        constexpr Solid<FaceCount, CornerCount, Sides> Dual(const Solid<CornerCount, FaceCount, 3>& solid) {
+            Solid<FaceCount, CornerCount, Sides> dual{};
+            for (size_t f = 0; f < FaceCount; ++f) {
+                const uint8_t* face = solid.faces[f];
+                dual.corners[f] = Scale(Add(Add(solid.corners[face[0]], solid.corners[face[1]]), solid.corners[face[2]]), 1.0 / 3.0);
+            }
+
+            // Going counterclockwise around corner c, the triangle after
+            // (c, a, b) is the one that continues from edge (c, b)
+            for (size_t c = 0; c < CornerCount; ++c) {
+                size_t next = 0;
+                for (size_t f = 0; f < FaceCount; ++f) {
+                    const uint8_t* face = solid.faces[f];
+                    if (face[0] == c || face[1] == c || face[2] == c) {
+                        next = f;
+                        break;
+                    }
+                }
+                for (size_t side = 0; side < Sides; ++side) {
+                    dual.faces[c][side] = static_cast<uint8_t>(next);
+                    const uint8_t* face = solid.faces[next];
+                    const size_t at = face[0] == c ? 0 : (face[1] == c ? 1 : 2);
+                    const size_t b = face[(at + 2) % 3];
+                    for (size_t f = 0; f < FaceCount; ++f) {
+                        const uint8_t* other = solid.faces[f];
+                        if ((other[0] == c && other[1] == b) || (other[1] == c && other[2] == b) || (other[2] == c && other[0] == b)) {
+                            next = f;
+                            break;
+                        }
+                    }
+                }
+            }
+            return dual;
+        }
+
+        template <size_t FaceCount, size_t Sides>
+        using PolyhedronShape = Shape<FaceCount * Sides, FaceCount * (Sides - 2) * 3>;
+
+        // Flat-shaded solid scaled to radius 1. Each face fans out from its
+        // first corner, and its corners map onto a regular polygon stretched
+        // over the texture, bottom edge first.
+        template <size_t CornerCount, size_t FaceCount, size_t Sides>
+        constexpr PolyhedronShape<FaceCount, Sides> Polyhedron(const Solid<CornerCount, FaceCount, Sides>& solid) {
+            double u[Sides] = {};
+            double v[Sides] = {};
+            double minU = 1.0, maxU = -1.0, minV = 1.0, maxV = -1.0;
+            for (size_t i = 0; i < Sides; ++i) {
+                const double angle = -PI / 2.0 - PI / Sides + 2.0 * PI * i / Sides;
+                u[i] = Cos(angle);
+                v[i] = -Sin(angle);
+                minU = u[i] < minU ? u[i] : minU;
+                maxU = u[i] > maxU ? u[i] : maxU;
+                minV = v[i] < minV ? v[i] : minV;
+                maxV = v[i] > maxV ? v[i] : maxV;
+            }
+
+            PolyhedronShape<FaceCount, Sides> shape{};
+            size_t index = 0;
+            for (size_t f = 0; f < FaceCount; ++f) {
+                Vec3 center = { 0.0, 0.0, 0.0 };
+                for (size_t i = 0; i < Sides; ++i) {
+                    center = Add(center, solid.corners[solid.faces[f][i]]);
+                }
+                const Vec3 normal = Normalize(center);
+
+                const size_t first = f * Sides;
+                for (size_t i = 0; i < Sides; ++i) {
+                    SetVertex(shape.vertices[first + i], Normalize(solid.corners[solid.faces[f][i]]), normal,
+                        (u[i] - minU) / (maxU - minU), (v[i] - minV) / (maxV - minV));
+                }
+                for (size_t i = 1; i + 1 < Sides; ++i) {
+                    SetTriangle(shape.indices, index, first, first + i, first + i + 1);
+                }
+            }
+            return shape;
+        }
+    }
+
+    template <size_t Segments, size_t Rings>
+    using UvSphereShape = Shape<(Rings - 1) * (Segments + 1) + 2 * Segments, 6 * Segments * (Rings - 1)>;
+
+    // Sphere of Rings bands from pole to pole, each split into Segments
+    // around y. Texture u goes once around and v from pole to pole; the seam
+    // column is duplicated so u can reach 1, and each pole has one vertex per
+    // segment so its triangles get their own u. UvSphere<32, 16> has the
+    // tessellation of Resources\sphere.obj.
+    template <size_t Segments, size_t Rings>
+    constexpr UvSphereShape<Segments, Rings> UvSphere() {
+        static_assert(Segments >= 3 && Rings >= 2, "UV sphere is too coarse");
+        using namespace Detail;
+
+        double cosLongitude[Segments + 1] = {};
+        double sinLongitude[Segments + 1] = {};
+        for (size_t s = 0; s < Segments; ++s) {
+            cosLongitude[s] = Cos(2.0 * PI * s / Segments);
+            sinLongitude[s] = Sin(2.0 * PI * s / Segments);
+        }
+        cosLongitude[Segments] = cosLongitude[0];
+        sinLongitude[Segments] = sinLongitude[0];
+
+        UvSphereShape<Segments, Rings> shape{};
+        size_t vertex = 0;
+        for (size_t s = 0; s < Segments; ++s) {
+            SetVertex(shape.vertices[vertex++], { 0.0, 1.0, 0.0 }, { 0.0, 1.0, 0.0 }, (s + 0.5) / Segments, 0.0);
+        }
+        for (size_t r = 1; r < Rings; ++r) {
+            const double y = Cos(PI * r / Rings);
+            const double radius = Sin(PI * r / Rings);
+            for (size_t s = 0; s <= Segments; ++s) {
+                const Vec3 position = { radius * cosLongitude[s], y, radius * sinLongitude[s] };
+                SetVertex(shape.vertices[vertex++], position, position, double(s) / Segments, double(r) / Rings);
+            }
+        }
+        for (size_t s = 0; s < Segments; ++s) {
+            SetVertex(shape.vertices[vertex++], { 0.0, -1.0, 0.0 }, { 0.0, -1.0, 0.0 }, (s + 0.5) / Segments, 1.0);
+        }
+
+        // Ring r starts at Segments + (r - 1) * (Segments + 1); the bottom
+        // pole's vertices follow the last ring
+        size_t index = 0;
+        for (size_t s = 0; s < Segments; ++s) {
+            SetTriangle(shape.indices, index, s, Segments + s + 1, Segments + s);
+        }
+        for (size_t r = 1; r + 1 < Rings; ++r) {
+            const size_t top = Segments + (r - 1) * (Segments + 1);
+            const size_t bottom = top + Segments + 1;
+            for (size_t s = 0; s < Segments; ++s) {
+                SetTriangle(shape.indices, index, top + s, top + s + 1, bottom + s);
+                SetTriangle(shape.indices, index, top + s + 1, bottom + s + 1, bottom + s);
+            }
+        }
+        const size_t last = Segments + (Rings - 2) * (Segments + 1);
+        const size_t bottomPole = last + Segments + 1;
+        for (size_t s = 0; s < Segments; ++s) {
+            SetTriangle(shape.indices, index, last + s, last + s + 1, bottomPole + s);
+        }
+        return shape;
+    }
+
+    template <size_t Level>
+    using IcosphereShape = Shape<10 * (size_t(1) << (2 * Level)) + 2, 60 * (size_t(1) << (2 * Level))>;
+
+    // Icosahedron with every face split into 4^Level triangles, projected
+    // onto the sphere. Triangles are closer to equal in size than the UV
+    // sphere's. Tex coords are the UV sphere's projection without a seam, so
+    // the triangles that straddle u = 0 stretch across the whole texture.
+    template <size_t Level>
+    constexpr IcosphereShape<Level> Icosphere() {
+        using namespace Detail;
+        const Solid<12, 20, 3> base = Detail::Icosahedron();
+        const size_t n = size_t(1) << Level;
+
+        // Vertices are the 12 corners, then n - 1 per edge going from its
+        // lower-numbered corner, then (n - 1)(n - 2) / 2 inside each face
+        uint8_t edges[30][2] = {};
+        size_t faceEdges[20][3] = {};
+        size_t edgeCount = 0;
+        for (size_t f = 0; f < 20; ++f) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint8_t a = base.faces[f][k];
+                const uint8_t b = base.faces[f][(k + 1) % 3];
+                if (a < b) {
+                    edges[edgeCount][0] = a;
+                    edges[edgeCount][1] = b;
+                    ++edgeCount;
+                }
+            }
+        }
+        for (size_t f = 0; f < 20; ++f) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint8_t a = base.faces[f][k];
+                const uint8_t b = base.faces[f][(k + 1) % 3];
+                for (size_t e = 0; e < 30; ++e) {
+                    if ((edges[e][0] == a && edges[e][1] == b) || (edges[e][0] == b && edges[e][1] == a)) {
+                        faceEdges[f][k] = e;
+                    }
+                }
+            }
+        }
+        const size_t edgeStart = 12;
+        const size_t interiorStart = edgeStart + 30 * (n - 1);
+        const size_t interiorPerFace = (n - 1) * (n - 2) / 2;
+
+        IcosphereShape<Level> shape{};
+        for (size_t c = 0; c < 12; ++c) {
+            SetSphereVertex(shape.vertices[c], Normalize(base.corners[c]));
+        }
+        for (size_t e = 0; e < 30; ++e) {
+            for (size_t k = 1; k < n; ++k) {
+                const Vec3 p = Add(Scale(base.corners[edges[e][0]], double(n - k)), Scale(base.corners[edges[e][1]], double(k)));
+                SetSphereVertex(shape.vertices[edgeStart + e * (n - 1) + k - 1], Normalize(p));
+            }
+        }
+
+        size_t index = 0;
+        for (size_t f = 0; f < 20; ++f) {
+            const uint8_t* corners = base.faces[f];
+
+            // Point (i, j) of the face is i steps from its first corner toward
+            // the second and j toward the third
+            size_t grid[(size_t(1) << Level) + 1][(size_t(1) << Level) + 1] = {};
+            size_t interior = interiorStart + f * interiorPerFace;
+            for (size_t i = 0; i <= n; ++i) {
+                for (size_t j = 0; i + j <= n; ++j) {
+                    // Corner k and edge k (from corner k to corner k + 1),
+                    // with the steps taken along it
+                    size_t corner = 3, edge = 3, steps = 0;
+                    if (i == 0 && j == 0) {
+                        corner = 0;
+                    } else if (i == n) {
+                        corner = 1;
+                    } else if (j == n) {
+                        corner = 2;
+                    } else if (j == 0) {
+                        edge = 0;
+                        steps = i;
+                    } else if (i + j == n) {
+                        edge = 1;
+                        steps = j;
+                    } else if (i == 0) {
+                        edge = 2;
+                        steps = n - j;
+                    }
+
+                    if (corner < 3) {
+                        grid[i][j] = corners[corner];
+                    } else if (edge < 3) {
+                        const bool forward = corners[edge] < corners[(edge + 1) % 3];
+                        grid[i][j] = edgeStart + faceEdges[f][edge] * (n - 1) + (forward ? steps : n - steps) - 1;
+                    } else {
+                        const Vec3 p = Add(Add(Scale(base.corners[corners[0]], double(n - i - j)), Scale(base.corners[corners[1]], double(i))),
+                            Scale(base.corners[corners[2]], double(j)));
+                        SetSphereVertex(shape.vertices[interior], Normalize(p));
+                        grid[i][j] = interior++;
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = 0; i + j < n; ++j) {
+                    SetTriangle(shape.indices, index, grid[i][j], grid[i + 1][j], grid[i][j + 1]);
+                    if (i + j + 1 < n) {
+                        SetTriangle(shape.indices, index, grid[i + 1][j], grid[i + 1][j + 1], grid[i][j + 1]);
+                    }
+                }
+            }
+        }
+        return shape;
+    }
+
+    constexpr Detail::PolyhedronShape<4, 3> Tetrahedron() {
+        return Detail::Polyhedron(Detail::Tetrahedron());
+    }
+
+    constexpr Detail::PolyhedronShape<6, 4> Cube() {
+        return Detail::Polyhedron(Detail::Dual<4>(Detail::Octahedron()));
+    }
+
+    constexpr Detail::PolyhedronShape<8, 3> Octahedron() {
+        return Detail::Polyhedron(Detail::Octahedron());
+    }
+
+    constexpr Detail::PolyhedronShape<12, 5> Dodecahedron() {
+        return Detail::Polyhedron(Detail::Dual<5>(Detail::Icosahedron()));
+    }
+
+    constexpr Detail::PolyhedronShape<20, 3> Icosahedron() {
+        return Detail::Polyhedron(Detail::Icosahedron());
+    }
+
+    template <size_t Divisions>
+    using PlaneShape = Shape<(Divisions + 1) * (Divisions + 1), 6 * Divisions * Divisions>;
+
+    // Square in the xz plane facing +y, split into Divisions x Divisions
+    // quads. The texture covers it once, u along +x and v along -z.
+    template <size_t Divisions>
+    constexpr PlaneShape<Divisions> Plane() {
+        static_assert(Divisions >= 1, "Plane needs at least one division");
+        using namespace Detail;
+
+        PlaneShape<Divisions> shape{};
+        for (size_t j = 0; j <= Divisions; ++j) {
+            for (size_t i = 0; i <= Divisions; ++i) {
+                const double u = double(i) / Divisions;
+                const double v = double(j) / Divisions;
+                SetVertex(shape.vertices[j * (Divisions + 1) + i], { 2.0 * u - 1.0, 0.0, 1.0 - 2.0 * v }, { 0.0, 1.0, 0.0 }, u, v);
+            }
+        }
+
+        size_t index = 0;
+        for (size_t j = 0; j < Divisions; ++j) {
+            for (size_t i = 0; i < Divisions; ++i) {
+                const size_t near = j * (Divisions + 1) + i;
+                const size_t far = near + Divisions + 1;
+                SetTriangle(shape.indices, index, near, near + 1, far);
+                SetTriangle(shape.indices, index, near + 1, far + 1, far);
+            }
+        }
+        return shape;
+    }
+}
@@ -11,7 +11,10 @@
 
 #include "stdafx.h"
 #include "Renderer.h"
+#include "GltfLoader.h"
 #include "ObjLoader.h"
+#include "Parallel.h"
+#include "Primitives.h"
 #include <iostream>
 
 Renderer::Renderer(UINT width, UINT height, std::wstring name) :
@@ -20,25 +23,62 @@ Renderer::Renderer(UINT width, UINT height, std::wstring name) :
     m_rtvDescriptorSize(0),
     m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
     m_rect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
-    m_camera({ 0.f, 0.f, -5.f }) {
+    m_camera({ 0.f, 0.f, -5.f }),
+    m_spinningObject(0),
+    m_visibleChunks(0),
+    m_totalChunks(0),
+    m_visibleMeshlets(0),
+    m_totalMeshlets(0),
+    m_cullMilliseconds(0.0),
+    m_statsFrame(0) {
     Gdiplus::GdiplusStartupInput gdiplusStartupInput;
     ULONG_PTR gdiplusToken;
     // Initialize GDI+.
     Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
 
-    // Create enough space for our objects
-    m_sceneObjects.resize(2);
-
-    // Load scene object geometry
-    ObjLoader::Load("Resources\\sponza.obj", &m_sceneObjects[0].m_vertices, m_sceneObjects[0].m_vertexCount);
-    ObjLoader::Load("Resources\\dodecahedron.obj", &m_sceneObjects[1].m_vertices, m_sceneObjects[1].m_vertexCount);
+    // Load scene object geometry. Loads are independent, so meshes are
+    // parsed, optimized and simplified concurrently. Sponza comes from its
+    // binary glTF export when there is one, which maps straight into vertex
+    // and index data and carries its own node transforms; otherwise from the
+    // OBJ, placed at the origin.
+    std::vector<Mesh> sponzaMeshes;
+    std::vector<GltfLoader::Instance> sponzaInstances;
+    Mesh dodecahedron;
+    Parallel::For(2, 0, [&](size_t i) {
+        if (i == 1) {
+            // The OBJ's UV layout is the one dodecahedron.bmp is painted for.
+            // Without it, the built-in solid keeps the scene whole.
+            if (GetFileAttributesA("Resources\\dodecahedron.obj") != INVALID_FILE_ATTRIBUTES) {
+                ObjLoader::Load("Resources\\dodecahedron.obj", dodecahedron, ObjLoader::DEFAULT_FLAGS | (STREAM_OBJ_FILES ? ObjLoader::STREAM_OBJ : 0));
+            } else {
+                static constexpr auto builtIn = Primitives::Dodecahedron();
+                dodecahedron.SetPrimitive(builtIn);
+            }
+        } else if (!GltfLoader::Load("Resources\\sponza.glb", sponzaMeshes, sponzaInstances)) {
+            sponzaMeshes.resize(1);
+            ObjLoader::Load("Resources\\sponza.obj", sponzaMeshes[0], ObjLoader::DEFAULT_FLAGS | (STREAM_OBJ_FILES ? ObjLoader::STREAM_OBJ : 0));
+
+            GltfLoader::Instance instance;
+            instance.mesh = 0;
+            XMStoreFloat4x4(&instance.model, XMMatrixIdentity());
+            sponzaInstances.push_back(instance);
+        }
+    });
 
-    // Init scene object constants
-    XMMATRIX model = XMMatrixTranslation(0.f, 0.f, 0.f);
-    XMStoreFloat4x4(&m_sceneObjects[0].m_constants.model, model);
+    // One scene object per placed mesh, then the dodecahedron
+    for (const GltfLoader::Instance& instance : sponzaInstances) {
+        if (sponzaMeshes[instance.mesh].indexCount == 0) {
+            continue;
+        }
+        m_sceneObjects.push_back(SceneObject());
+        m_sceneObjects.back().m_mesh = sponzaMeshes[instance.mesh];
+        m_sceneObjects.back().SetModel(XMLoadFloat4x4(&instance.model));
+    }
 
-    model = XMMatrixTranslation(0.f, 0.f, 0.f);
-    XMStoreFloat4x4(&m_sceneObjects[1].m_constants.model, model);
+    m_spinningObject = (UINT)m_sceneObjects.size();
+    m_sceneObjects.push_back(SceneObject());
+    m_sceneObjects.back().m_mesh = dodecahedron;
+    m_sceneObjects.back().SetModel(XMMatrixIdentity());
 
     // Initialize projection matrix
     XMMATRIX proj = XMMatrixPerspectiveFovLH(XMConvertToRadians(50.f), m_aspectRatio, 0.1f, 1000.0f);
@@ -302,15 +342,29 @@ void Renderer::LoadAssets()
 
     for (int i = 0; i < m_sceneObjects.size(); ++i) {
         auto& sceneObject = m_sceneObjects[i];
-        sceneObject.UploadVertices(m_device);
+        sceneObject.UploadVertices(m_device, m_assets, PACKED_VERTICES != 0);
+        sceneObject.UploadIndices(m_device, m_assets);
     }
 
     // Create command list for recording memory uploads
     ComPtr<ID3D12GraphicsCommandList> commandList;
     ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&commandList)));
 
-    m_sceneObjects[0].LoadTexture(m_device, commandList, L"Resources\\sphere.bmp");
-    m_sceneObjects[1].LoadTexture(m_device, commandList, L"Resources\\dodecahedron.bmp");
+    // Sponza's textures come from its materials; the dodecahedron has no
+    // materials and takes its texture wholesale. Every image is decoded, with
+    // its mips, before any upload is recorded so they all load concurrently.
+    auto fallbackTexture = [&](UINT i) {
+        return std::wstring(i == m_spinningObject ? L"Resources\\dodecahedron.bmp" : L"");
+    };
+    std::vector<std::wstring> texturePaths;
+    for (UINT i = 0; i < m_sceneObjects.size(); ++i) {
+        m_sceneObjects[i].GetTexturePaths(fallbackTexture(i), texturePaths);
+    }
+    m_assets.SetTextureCompression(TEXTURE_COMPRESSION, TEXTURE_QUALITY);
+    m_assets.DecodeTextures(texturePaths, TEXTURE_THREADS);
+    for (UINT i = 0; i < m_sceneObjects.size(); ++i) {
+        m_sceneObjects[i].LoadTextures(m_device, commandList, m_assets, fallbackTexture(i));
+    }
 
     CreateGlobalConstants(m_device);
 
@@ -319,6 +373,13 @@ void Renderer::LoadAssets()
     ID3D12CommandList* ppCommandLists[] = { commandList.Get() };
     m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
     WaitForPreviousFrame();
+    m_assets.ReleaseUploads();
+
+    const AssetRegistry::Stats assetStats = m_assets.GetStats();
+    char report[256];
+    sprintf_s(report, "Assets: %u resources, %.1f MB on the GPU; %u shared requests saved %.1f MB\n",
+        assetStats.resources, assetStats.bytes / (1024.0 * 1024.0), assetStats.sharedRequests, assetStats.savedBytes / (1024.0 * 1024.0));
+    OutputDebugStringA(report);
 }
 
 void Renderer::CreateCommandList(ComPtr<ID3D12Device>& device, ComPtr<ID3D12PipelineState>& pipelineState, ComPtr<ID3D12CommandAllocator>& commandAllocator, ComPtr<ID3D12GraphicsCommandList>& commandList) {
@@ -343,7 +404,7 @@ void Renderer::CreateFence(ComPtr<ID3D12Device>& device, ComPtr<ID3D12Fence>& fe
 void Renderer::CreateRootSignature(ComPtr<ID3D12Device>& device, ComPtr<ID3D12RootSignature>& rootSignature)
 {
     CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
-    CD3DX12_ROOT_PARAMETER1 rootParameters[6];
+    CD3DX12_ROOT_PARAMETER1 rootParameters[7];
 
     // Global constants (view, projection matrices)
     rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_VERTEX);
@@ -365,11 +426,15 @@ void Renderer::CreateRootSignature(ComPtr<ID3D12Device>& device, ComPtr<ID3D12Ro
     // Light count
     rootParameters[5].InitAsConstants(1, 4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
+    // Material diffuse color
+    rootParameters[6].InitAsConstants(4, 5, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+
     D3D12_STATIC_SAMPLER_DESC sampler = {};
-    sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
-    sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-    sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-    sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+    sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+    // Material textures tile across large surfaces
+    sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
     sampler.MipLODBias = 0;
     sampler.MaxAnisotropy = 0;
     sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
@@ -413,16 +478,22 @@ void Renderer::CreatePSO(ComPtr<ID3D12Device>& device, ComPtr<ID3D12RootSignatur
     ComPtr<ID3DBlob> vertexShader;
     ComPtr<ID3DBlob> pixelShader;
 
-    CompileShader(L"shaders.hlsl", "VSMain", "vs_5_0", vertexShader);
-    CompileShader(L"shaders.hlsl", "PSMain", "ps_5_0", pixelShader);
+#if PACKED_VERTICES
+    const D3D_SHADER_MACRO defines[] = { { "PACKED_VERTICES", "1" }, { nullptr, nullptr } };
+#else
+    const D3D_SHADER_MACRO defines[] = { { "PACKED_VERTICES", "0" }, { nullptr, nullptr } };
+#endif
 
-    // Define the vertex input layout.
-    D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-    };
+    CompileShader(L"shaders.hlsl", "VSMain", "vs_5_0", defines, vertexShader);
+    CompileShader(L"shaders.hlsl", "PSMain", "ps_5_0", defines, pixelShader);
+
+    // Define the vertex input layout. VSInput in shaders.hlsl declares the
+    // same attributes.
+#if PACKED_VERTICES
+    typedef VertexFormats::Compact InputFormat;
+#else
+    typedef VertexFormats::Standard InputFormat;
+#endif
 
     CD3DX12_RASTERIZER_DESC rasterizerDesc = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     rasterizerDesc.CullMode = D3D12_CULL_MODE_BACK;
@@ -430,7 +501,7 @@ void Renderer::CreatePSO(ComPtr<ID3D12Device>& device, ComPtr<ID3D12RootSignatur
 
     // Describe and create the graphics pipeline state object (PSO).
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+    psoDesc.InputLayout = { InputFormat::InputLayout(), InputFormat::ELEMENT_COUNT };
     psoDesc.pRootSignature = rootSignature.Get();
     psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
     psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
@@ -447,7 +518,7 @@ void Renderer::CreatePSO(ComPtr<ID3D12Device>& device, ComPtr<ID3D12RootSignatur
     ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
 }
 
-void Renderer::CompileShader(const LPCWSTR fname, const LPCSTR entryPoint, const LPCSTR target, ComPtr<ID3DBlob>& compiledShader) {
+void Renderer::CompileShader(const LPCWSTR fname, const LPCSTR entryPoint, const LPCSTR target, const D3D_SHADER_MACRO* defines, ComPtr<ID3DBlob>& compiledShader) {
 #if defined(_DEBUG)
     // Enable better shader debugging with the graphics debugging tools.
     UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
@@ -456,7 +527,7 @@ void Renderer::CompileShader(const LPCWSTR fname, const LPCSTR entryPoint, const
 #endif
     // Taken from https://docs.microsoft.com/en-us/windows/desktop/direct3d11/how-to--compile-a-shader
     ID3DBlob* errorMessages;
-    HRESULT hr = D3DCompileFromFile(GetAssetFullPath(fname).c_str(), nullptr, nullptr, entryPoint, target, compileFlags, 0, &compiledShader, &errorMessages);
+    HRESULT hr = D3DCompileFromFile(GetAssetFullPath(fname).c_str(), defines, nullptr, entryPoint, target, compileFlags, 0, &compiledShader, &errorMessages);
     if (FAILED(hr)) {
         if (errorMessages) {
             OutputDebugStringA((char*)errorMessages->GetBufferPointer());
@@ -501,8 +572,17 @@ void Renderer::OnUpdate()
     //XMStoreFloat4x4(&m_sceneObjects[0].m_constants.model, model * offset);
 
     XMMATRIX rotation = XMMatrixRotationY(0.01f);
-    XMMATRIX model = XMLoadFloat4x4(&m_sceneObjects[1].m_constants.model);
-    XMStoreFloat4x4(&m_sceneObjects[1].m_constants.model, model * rotation);
+    XMMATRIX model = XMLoadFloat4x4(&m_sceneObjects[m_spinningObject].m_constants.model);
+    m_sceneObjects[m_spinningObject].SetModel(model * rotation);
+
+    // Bring the bounds of every object that moved into world space in one
+    // pass, once all of this frame's transforms are in. Static objects are
+    // only touched on their first frame.
+    for (SceneObject& sceneObject : m_sceneObjects) {
+        if (sceneObject.WorldBoundsDirty()) {
+            sceneObject.UpdateWorldBounds();
+        }
+    }
 }
 
 // Render the scene.
@@ -573,6 +653,12 @@ void Renderer::PopulateCommandList()
     // Upload lighting data
     memcpy(m_pLightBufferData, &m_lights, sizeof(m_lights));
 
+    // Culling uses the untransposed, row-vector matrices
+    const XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&m_camera.getViewMatrix()), XMLoadFloat4x4(&m_constants.proj));
+
+    // Pixels per unit length at distance 1; proj._22 is 1 / tan(fovY / 2)
+    const float projectionScale = m_constants.proj._22 * static_cast<float>(m_height) * 0.5f;
+
     for (int i = 0; i < m_sceneObjects.size(); ++i) {
         auto& sceneObject = m_sceneObjects[i];
 
@@ -581,24 +667,68 @@ void Renderer::PopulateCommandList()
         ID3D12DescriptorHeap* ppHeaps[] = { sceneObject.m_descriptorHeap.Get() };
         m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
-        int shaderFlags = 0;
-
-        if (sceneObject.m_hasTexture) {
-            shaderFlags |= 1;
-        };
-
         m_commandList->SetGraphicsRootDescriptorTable(1, sceneObject.m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
-        m_commandList->SetGraphicsRoot32BitConstant(4, shaderFlags, 0);
-        if (sceneObject.m_hasTexture) {
-            CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle(sceneObject.m_descriptorHeap->GetGPUDescriptorHandleForHeapStart(), m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
-            m_commandList->SetGraphicsRootDescriptorTable(3, srvHandle);
+
+        // Meshlets belong to the full-detail mesh; simplified LODs draw each
+        // submesh whole
+        const UINT lod = sceneObject.SelectLod(m_camera.position, projectionScale, LOD_PIXEL_ERROR);
+        LARGE_INTEGER cullStart, cullEnd, frequency;
+        QueryPerformanceCounter(&cullStart);
+        size_t visibleChunks = 0;
+        m_visibleMeshlets += sceneObject.GetDrawRanges(lod, viewProj, m_camera.position, m_drawRanges, m_drawRangeStart, &visibleChunks);
+        QueryPerformanceCounter(&cullEnd);
+        QueryPerformanceFrequency(&frequency);
+        m_visibleChunks += visibleChunks;
+        m_totalChunks += sceneObject.m_mesh.chunks.size();
+        if (lod == 0) {
+            m_cullMilliseconds += 1000.0 * (cullEnd.QuadPart - cullStart.QuadPart) / frequency.QuadPart;
+            m_totalMeshlets += sceneObject.m_mesh.meshlets.size();
         }
 
         // Record commands.
         m_commandList->IASetVertexBuffers(0, 1, &(sceneObject.m_vertexBufferView));
-        m_commandList->DrawInstanced(sceneObject.m_vertexCount, 1, 0, 0);
+        m_commandList->IASetIndexBuffer(&(sceneObject.m_indexBufferView));
+
+        // Submeshes are sorted by texture, so the texture binding only changes
+        // between runs of materials that share one
+        const Submesh* submeshes = sceneObject.m_mesh.LodSubmeshes(lod);
+        const CD3DX12_GPU_DESCRIPTOR_HANDLE heapStart(sceneObject.m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+        const UINT descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        bool textureBound = false;
+        int boundTexture = SceneObject::NO_TEXTURE;
+        for (size_t s = 0; s < sceneObject.m_mesh.submeshes.size(); ++s) {
+            const UINT first = m_drawRangeStart[s];
+            const UINT last = m_drawRangeStart[s + 1];
+            if (first == last) {
+                continue;
+            }
+
+            const UINT material = submeshes[s].material;
+            const int texture = sceneObject.m_materialTextures[material];
+            if (!textureBound || texture != boundTexture) {
+                int shaderFlags = 0;
+                if (texture != SceneObject::NO_TEXTURE) {
+                    shaderFlags |= 1;
+                    m_commandList->SetGraphicsRootDescriptorTable(3, CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, 1 + texture, descriptorSize));
+                }
+                m_commandList->SetGraphicsRoot32BitConstant(4, shaderFlags, 0);
+                textureBound = true;
+                boundTexture = texture;
+            }
+
+            const Material& properties = sceneObject.m_mesh.materials[material];
+            const XMFLOAT4 diffuse(properties.diffuse.x, properties.diffuse.y, properties.diffuse.z, properties.dissolve);
+            m_commandList->SetGraphicsRoot32BitConstants(6, 4, &diffuse, 0);
+
+            for (UINT r = first; r < last; ++r) {
+                const Meshlets::DrawRange& range = m_drawRanges[r];
+                m_commandList->DrawIndexedInstanced(range.indexCount, 1, range.indexStart, 0, 0);
+            }
+        }
     }
 
+    ReportCullStats();
+
     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_textureMSAA.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE));
     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RESOLVE_DEST));
     m_commandList->ResolveSubresource(m_renderTargets[m_frameIndex].Get(), D3D12CalcSubresource(0, 0, 0, 1, 1), m_textureMSAA.Get(), D3D12CalcSubresource(0, 0, 0, 1, 1), DXGI_FORMAT_R8G8B8A8_UNORM);
@@ -607,6 +737,28 @@ void Renderer::PopulateCommandList()
     ThrowIfFailed(m_commandList->Close());
 }
 
+// Shows chunk and meshlet culling results in the title bar, averaged over a second's
+// worth of frames at the 60 Hz present interval
+void Renderer::ReportCullStats()
+{
+    static const UINT STATS_FRAMES = 60;
+    if (++m_statsFrame < STATS_FRAMES) {
+        return;
+    }
+
+    wchar_t text[128];
+    swprintf_s(text, L"%zu / %zu chunks, %zu / %zu meshlets visible, culled in %.3f ms", m_visibleChunks / STATS_FRAMES, m_totalChunks / STATS_FRAMES,
+        m_visibleMeshlets / STATS_FRAMES, m_totalMeshlets / STATS_FRAMES, m_cullMilliseconds / STATS_FRAMES);
+    SetCustomWindowText(text);
+
+    m_visibleChunks = 0;
+    m_totalChunks = 0;
+    m_visibleMeshlets = 0;
+    m_totalMeshlets = 0;
+    m_cullMilliseconds = 0.0;
+    m_statsFrame = 0;
+}
+
 void Renderer::WaitForPreviousFrame()
 {
     // WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
@@ -17,6 +17,21 @@
 
 #define MSAA_SAMPLE_COUNT 8
 
+// Draw with 16-byte PackedVertex data instead of 32-byte Vertex data
+#define PACKED_VERTICES 1
+
+// Read OBJ files through ObjStream, holding their v and vt arrays rather than
+// the whole parse, at the cost of single-threaded parsing
+#define STREAM_OBJ_FILES 0
+
+// Threads decoding, mipping and compressing textures; 0 uses every hardware
+// thread
+static const unsigned TEXTURE_THREADS = 0;
+
+// How textures are stored on the GPU, and how hard the encoder works at it
+static const AssetRegistry::TextureCompression TEXTURE_COMPRESSION = AssetRegistry::BC1_BC3;
+static const Bc::Quality TEXTURE_QUALITY = Bc::NORMAL;
+
 using namespace DirectX;
 
 // Note that while ComPtr is used to manage the lifetime of resources on the CPU,
@@ -28,6 +43,9 @@ using Microsoft::WRL::ComPtr;
 
 static const int MAX_LIGHTS = 10;
 
+// Largest LOD error allowed on screen, in pixels
+static const float LOD_PIXEL_ERROR = 1.f;
+
 struct DirectionalLight {
     XMFLOAT4 direction;
     XMFLOAT4 color;
@@ -215,8 +233,25 @@ public:
     ComPtr<ID3D12Resource> m_lightBuffer;
     UINT8* m_pLightBufferData;
 
+    // GPU buffers and textures, shared between scene objects with the same data
+    AssetRegistry m_assets;
     std::vector<SceneObject> m_sceneObjects;
 
+    // The dodecahedron, which OnUpdate spins
+    UINT m_spinningObject;
+
+    // Chunk and meshlet culling: scratch draw ranges and their per-submesh
+    // starts, reused across objects and frames, and counters for the window
+    // title readout
+    std::vector<Meshlets::DrawRange> m_drawRanges;
+    std::vector<UINT> m_drawRangeStart;
+    size_t m_visibleChunks;
+    size_t m_totalChunks;
+    size_t m_visibleMeshlets;
+    size_t m_totalMeshlets;
+    double m_cullMilliseconds;
+    UINT m_statsFrame;
+
     void LoadPipeline();
     void CreateFactory(_Out_ ComPtr<IDXGIFactory4> &factory);
     void CreateDevice(_In_ ComPtr<IDXGIFactory4> &factory, _Out_ ComPtr<ID3D12Device>& device);
@@ -235,9 +270,10 @@ public:
     void CreateRootSignature(_In_ ComPtr<ID3D12Device>& device, _Out_ ComPtr<ID3D12RootSignature>& rootSignature);
     D3D_ROOT_SIGNATURE_VERSION GetRootSignatureVersion(_In_ const ComPtr<ID3D12Device>& device);
     void CreatePSO(_In_ ComPtr<ID3D12Device>& device, _In_ ComPtr<ID3D12RootSignature>& rootSignature, _Out_ ComPtr<ID3D12PipelineState>& pipelineState);
-    void CompileShader(_In_ const LPCWSTR fname, _In_ const LPCSTR entryPoint, _In_ const LPCSTR target, _Out_ ComPtr<ID3DBlob>& compiledShader);
+    void CompileShader(_In_ const LPCWSTR fname, _In_ const LPCSTR entryPoint, _In_ const LPCSTR target, _In_opt_ const D3D_SHADER_MACRO* defines, _Out_ ComPtr<ID3DBlob>& compiledShader);
     void CreateGlobalConstants(_In_ const ComPtr<ID3D12Device>& device);
 
     void PopulateCommandList();
+    void ReportCullStats();
     void WaitForPreviousFrame();
 };
@@ -1,43 +1,138 @@
 #include "stdafx.h"
 #include "SceneObject.h"
-#include "ImageLoader.h"
+#include "Hash.h"
+#include <algorithm>
+#include <map>
 
-SceneObject::SceneObject() : m_hasTexture(false) {};
+namespace {
+    // The box around the transformed box: its center moves with the
+    // transform, and each world axis' half extent sums the absolute
+    // contributions of the local half extents. absolute holds model's rows
+    // with their signs dropped.
+    void TransformBox(const BoundingBox& box, FXMMATRIX model, CXMMATRIX absolute, BoundingBox& out) {
+        const XMVECTOR minimum = XMLoadFloat3(&box.min);
+        const XMVECTOR maximum = XMLoadFloat3(&box.max);
+        const XMVECTOR center = XMVector3Transform(XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f), model);
+        const XMVECTOR extent = XMVector3TransformNormal(XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f), absolute);
+        XMStoreFloat3(&out.min, XMVectorSubtract(center, extent));
+        XMStoreFloat3(&out.max, XMVectorAdd(center, extent));
+    }
+
+    void TransformSphere(const BoundingSphere& sphere, FXMMATRIX model, float scale, BoundingSphere& out) {
+        XMStoreFloat3(&out.center, XMVector3Transform(XMLoadFloat3(&sphere.center), model));
+        out.radius = sphere.radius * scale;
+    }
+}
+
+SceneObject::SceneObject() :
+    m_modelScale(1.f),
+    m_worldBoundsDirty(true) {
+    XMStoreFloat4x4(&m_constants.model, XMMatrixIdentity());
+    m_constants.positionOffset = XMFLOAT4(0.f, 0.f, 0.f, 0.f);
+    m_constants.positionScale = XMFLOAT4(1.f, 1.f, 1.f, 0.f);
+    m_worldBounds.box = m_mesh.bounds;
+    m_worldBounds.sphere = m_mesh.sphere;
+};
 
 SceneObject::~SceneObject() {};
 
-void SceneObject::UploadVertices(const ComPtr<ID3D12Device>& device) {
-    const UINT bufferSize = m_vertexCount * sizeof(Vertex);
-
-    // Note: using upload heaps to transfer static data like vert buffers is not 
-    // recommended. Every time the GPU needs it, the upload heap will be marshalled 
-    // over. Please read up on Default Heap usage. An upload heap is used here for 
-    // code simplicity and because there are very few verts to actually transfer.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_vertexBuffer)
-    ));
-
-    // Copy the triangle data to the vertex buffer.
-    UINT8* pVertexDataBegin;
-    CD3DX12_RANGE readRange(0, 0);
-    ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-    memcpy(pVertexDataBegin, m_vertices, bufferSize);
-    m_vertexBuffer->Unmap(0, nullptr);
+void SceneObject::SetModel(FXMMATRIX model) {
+    XMStoreFloat4x4(&m_constants.model, model);
+    m_worldBoundsDirty = true;
+}
+
+void SceneObject::UpdateWorldBounds() {
+    // Model transforms are affine, so rows 0-2 hold the axes and row 3 the
+    // translation
+    const XMMATRIX model = XMLoadFloat4x4(&m_constants.model);
+    XMMATRIX absolute = model;
+    for (int axis = 0; axis < 3; ++axis) {
+        absolute.r[axis] = XMVectorAbs(model.r[axis]);
+    }
+
+    // A sphere stays a sphere only under uniform scale; the largest axis scale
+    // keeps it conservative otherwise
+    m_modelScale = fmaxf(XMVectorGetX(XMVector3Length(model.r[0])), fmaxf(XMVectorGetX(XMVector3Length(model.r[1])), XMVectorGetX(XMVector3Length(model.r[2]))));
+
+    TransformBox(m_mesh.bounds, model, absolute, m_worldBounds.box);
+    TransformSphere(m_mesh.sphere, model, m_modelScale, m_worldBounds.sphere);
+
+    m_submeshWorldBounds.resize(m_mesh.submeshes.size());
+    for (size_t s = 0; s < m_mesh.submeshes.size(); ++s) {
+        const Submesh& submesh = m_mesh.submeshes[s];
+        TransformBox(submesh.bounds, model, absolute, m_submeshWorldBounds[s].box);
+        TransformSphere(submesh.sphere, model, m_modelScale, m_submeshWorldBounds[s].sphere);
+    }
+
+    m_worldBoundsDirty = false;
+}
+
+void SceneObject::UploadVertices(const ComPtr<ID3D12Device>& device, AssetRegistry& assets, bool packed) {
+    const UINT stride = packed ? VertexFormats::Compact::STRIDE : VertexFormats::Standard::STRIDE;
+    const UINT bufferSize = m_mesh.vertexCount * stride;
+    const size_t sourceSize = m_mesh.vertexCount * sizeof(Vertex);
+
+    if (packed) {
+        // Packing depends on the bounds as well as the vertices, so they're
+        // part of the key. The constants are set even when the buffer is shared.
+        VertexPacker::GetDequantization(m_mesh.bounds, m_constants.positionOffset, m_constants.positionScale);
+        const UINT64 boundsHash = Hash::Hash64(&m_mesh.bounds, sizeof(m_mesh.bounds));
+        m_vertexBuffer = assets.AcquireBuffer(device, AssetRegistry::PACKED_VERTICES, m_mesh.vertices, sourceSize, bufferSize, [this](void* data) {
+            // Encode straight into the upload heap
+            PackedVertex* packedVertices = reinterpret_cast<PackedVertex*>(data);
+            VertexPacker::Pack(m_mesh.vertices, m_mesh.vertexCount, m_mesh.bounds, packedVertices);
+
+#if defined(_DEBUG)
+            // The upload heap is write-combined, so validate from a separate copy
+            std::vector<PackedVertex> encoded(m_mesh.vertexCount);
+            VertexPacker::Pack(m_mesh.vertices, m_mesh.vertexCount, m_mesh.bounds, encoded.data());
+            const VertexPacker::ErrorStats error = VertexPacker::MeasureError(m_mesh.vertices, encoded.data(), m_mesh.vertexCount, m_mesh.bounds);
+            const VertexPacker::ErrorStats bound = VertexPacker::ErrorBound(m_mesh.vertices, m_mesh.vertexCount, m_mesh.bounds);
+
+            char report[256];
+            sprintf_s(report, "Packed %u vertices: position error %g (bound %g), normal %g deg (bound %g), tex coord %g (bound %g)\n",
+                m_mesh.vertexCount, error.position, bound.position, error.normalDegrees, bound.normalDegrees, error.texCoord, bound.texCoord);
+            OutputDebugStringA(report);
+
+            assert(error.position <= bound.position && "Packed position error exceeds the format's bound");
+            assert(error.normalDegrees <= bound.normalDegrees && "Packed normal error exceeds the format's bound");
+            assert(error.texCoord <= bound.texCoord && "Packed tex coord error exceeds the format's bound");
+#endif
+        }, boundsHash);
+    } else {
+        m_constants.positionOffset = XMFLOAT4(0.f, 0.f, 0.f, 0.f);
+        m_constants.positionScale = XMFLOAT4(1.f, 1.f, 1.f, 0.f);
+        // When the mesh came from the cache this copies straight out of the
+        // mapped file
+        m_vertexBuffer = assets.AcquireBuffer(device, AssetRegistry::VERTICES, m_mesh.vertices, sourceSize, bufferSize, [this, bufferSize](void* data) {
+            memcpy(data, m_mesh.vertices, bufferSize);
+        });
+    }
 
     // Initialize the Vertex Buffer View
-    m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-    m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+    m_vertexBufferView.BufferLocation = m_vertexBuffer->resource->GetGPUVirtualAddress();
+    m_vertexBufferView.StrideInBytes = stride;
     m_vertexBufferView.SizeInBytes = bufferSize;
 }
 
+void SceneObject::UploadIndices(const ComPtr<ID3D12Device>& device, AssetRegistry& assets) {
+    const UINT bufferSize = m_mesh.indexCount * m_mesh.IndexSize();
+    const AssetRegistry::BufferKind kind = m_mesh.indexFormat == DXGI_FORMAT_R16_UINT ? AssetRegistry::INDICES_16 : AssetRegistry::INDICES_32;
+
+    m_indexBuffer = assets.AcquireBuffer(device, kind, m_mesh.indices, bufferSize, bufferSize, [this, bufferSize](void* data) {
+        memcpy(data, m_mesh.indices, bufferSize);
+    });
+
+    m_indexBufferView.BufferLocation = m_indexBuffer->resource->GetGPUVirtualAddress();
+    m_indexBufferView.Format = m_mesh.indexFormat;
+    m_indexBufferView.SizeInBytes = bufferSize;
+}
+
 void SceneObject::UploadConstants(const ComPtr<ID3D12Device>& device) {
-    CreateDescriptorHeap(device);
-    // If Constant Buffer + CBV + CBV Heap haven't been initialized, do so
+    // LoadTextures sizes the heap for the object's textures; one created here
+    // would leave them no room
+    assert(m_descriptorHeap && "SceneObject: LoadTextures must run before UploadConstants");
+    // If Constant Buffer + CBV haven't been initialized, do so
     if (!m_constantBuffer) {
         // Create the constant buffer.
         ThrowIfFailed(device->CreateCommittedResource(
@@ -61,80 +156,164 @@ void SceneObject::UploadConstants(const ComPtr<ID3D12Device>& device) {
     }
 
     // Copy constant data to constant buffer
-    Constants constants;
+    Constants constants = m_constants;
     XMMATRIX model = XMMatrixTranspose(XMLoadFloat4x4(&m_constants.model));
     XMStoreFloat4x4(&constants.model, model);
 
     memcpy(m_pConstantBufferData, &constants, sizeof(constants));
 }
 
-void SceneObject::LoadTexture(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, const std::wstring fname) {
-    CreateDescriptorHeap(device);
-    ImageLoader imageLoader(fname.c_str());
-    MipMap mip0(imageLoader.getMipMap(0));
-    m_hasTexture = true;
-
-    D3D12_RESOURCE_DESC textureDesc = {};
-    textureDesc.MipLevels = 1;
-    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    textureDesc.Width = mip0.width;
-    textureDesc.Height = mip0.height;
-    textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-    textureDesc.DepthOrArraySize = 1;
-    textureDesc.SampleDesc.Count = 1;
-    textureDesc.SampleDesc.Quality = 0;
-    textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &textureDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&m_texture)));
-
-    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(m_texture.Get(), 0, 1) * 10;
-
-    // Create the GPU upload buffer.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_textureUploadHeap)));
-
-    // Copy data to the intermediate upload heap and then schedule a copy 
-    // from the upload heap to the Texture2D.
-    D3D12_SUBRESOURCE_DATA textureData = {};
-    textureData.pData = mip0.bytes;
-    textureData.RowPitch = mip0.width * sizeof(MipMap::Pixel);
-    textureData.SlicePitch = textureData.RowPitch * mip0.height;
-
-    UpdateSubresources(commandList.Get(), m_texture.Get(), m_textureUploadHeap.Get(), 0, 0, 1, &textureData);
-    commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-
-    // Create shader resource view in descriptor heap
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Format = textureDesc.Format;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = 1;
-
-    UINT descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(m_descriptorHeap->GetCPUDescriptorHandleForHeapStart());
-    srvHandle.Offset(1, descriptorSize);
-
-    device->CreateShaderResourceView(m_texture.Get(), &srvDesc, srvHandle);
+std::wstring SceneObject::TexturePath(size_t material, const std::wstring& fallbackTexture) const {
+    const char* name = m_mesh.materials[material].diffuseTexture;
+    return name[0] ? std::wstring(name, name + strlen(name)) : fallbackTexture;
+}
+
+void SceneObject::GetTexturePaths(const std::wstring& fallbackTexture, std::vector<std::wstring>& paths) const {
+    for (size_t i = 0; i < m_mesh.materials.size(); ++i) {
+        const std::wstring path = TexturePath(i, fallbackTexture);
+        if (!path.empty() && std::find(paths.begin(), paths.end(), path) == paths.end()) {
+            paths.push_back(path);
+        }
+    }
+}
+
+void SceneObject::LoadTextures(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, AssetRegistry& assets,
+    const std::wstring& fallbackTexture) {
+    // Gather distinct texture paths so materials sharing a texture share its
+    // descriptor
+    std::vector<std::wstring> paths;
+    std::map<std::wstring, int> pathSlots;
+    m_materialTextures.assign(m_mesh.materials.size(), NO_TEXTURE);
+    for (size_t i = 0; i < m_mesh.materials.size(); ++i) {
+        const std::wstring path = TexturePath(i, fallbackTexture);
+        if (path.empty()) {
+            continue;
+        }
+
+        auto inserted = pathSlots.insert(std::make_pair(path, static_cast<int>(paths.size())));
+        if (inserted.second) {
+            paths.push_back(path);
+        }
+        m_materialTextures[i] = inserted.first->second;
+    }
+
+    CreateDescriptorHeap(device, static_cast<UINT>(paths.size()));
+    m_textures.resize(paths.size());
+
+    const UINT descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    for (size_t t = 0; t < paths.size(); ++t) {
+        m_textures[t] = assets.AcquireTexture(device, commandList, paths[t]);
+        if (!m_textures[t]) {
+            for (int& slot : m_materialTextures) {
+                if (slot == static_cast<int>(t)) {
+                    slot = NO_TEXTURE;
+                }
+            }
+            continue;
+        }
+
+        // Create shader resource view in descriptor heap, covering every level
+        // in whatever format the texture was compressed to
+        const D3D12_RESOURCE_DESC textureDesc = m_textures[t]->resource->GetDesc();
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Format = textureDesc.Format;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(m_descriptorHeap->GetCPUDescriptorHandleForHeapStart());
+        srvHandle.Offset(1 + static_cast<INT>(t), descriptorSize);
+
+        device->CreateShaderResourceView(m_textures[t]->resource.Get(), &srvDesc, srvHandle);
+    }
+}
+
+size_t SceneObject::GetDrawRanges(UINT lod, FXMMATRIX viewProj, const XMFLOAT3& cameraPosition,
+    std::vector<Meshlets::DrawRange>& ranges, std::vector<UINT>& rangeStart, size_t* visibleChunks) const {
+    ranges.clear();
+    rangeStart.clear();
+    const Submesh* submeshes = m_mesh.LodSubmeshes(lod);
+    const bool cullMeshlets = lod == 0 && !m_mesh.meshlets.empty();
+
+    // Chunks are culled at every LOD, since LOD submeshes keep their chunk
+    const bool cullChunks = !m_mesh.chunks.empty();
+
+    // Bring the frustum and camera into the mesh's space rather than moving
+    // every meshlet and chunk bound into world space
+    Meshlets::Frustum frustum;
+    float camera[3] = {};
+    if (cullMeshlets || cullChunks) {
+        const XMMATRIX model = XMLoadFloat4x4(&m_constants.model);
+        XMFLOAT4X4 modelViewProj;
+        XMStoreFloat4x4(&modelViewProj, XMMatrixMultiply(model, viewProj));
+        Meshlets::ExtractFrustum(&modelViewProj.m[0][0], frustum);
+
+        XMFLOAT3 localCamera;
+        XMStoreFloat3(&localCamera, XMVector3TransformCoord(XMLoadFloat3(&cameraPosition), XMMatrixInverse(nullptr, model)));
+        camera[0] = localCamera.x;
+        camera[1] = localCamera.y;
+        camera[2] = localCamera.z;
+    }
+
+    // Several submeshes share each chunk, so each chunk is tested once
+    m_chunkVisible.resize(m_mesh.chunks.size());
+    size_t chunksInView = 0;
+    for (size_t c = 0; c < m_mesh.chunks.size(); ++c) {
+        m_chunkVisible[c] = Chunks::IsVisible(m_mesh.chunks[c], frustum);
+        chunksInView += m_chunkVisible[c] ? 1 : 0;
+    }
+    if (visibleChunks) {
+        *visibleChunks = chunksInView;
+    }
+
+    size_t visible = 0;
+    for (size_t s = 0; s < m_mesh.submeshes.size(); ++s) {
+        const Submesh& submesh = submeshes[s];
+        rangeStart.push_back(static_cast<UINT>(ranges.size()));
+        if (cullChunks && submesh.chunk != Submesh::NO_CHUNK && !m_chunkVisible[submesh.chunk]) {
+            continue;
+        }
+        if (cullMeshlets && submesh.meshletCount > 0) {
+            visible += Meshlets::Cull(&m_mesh.meshlets[submesh.meshletStart], submesh.meshletCount, frustum, camera, ranges);
+        } else if (submesh.indexCount > 0) {
+            ranges.push_back({ submesh.indexStart, submesh.indexCount });
+        }
+    }
+    rangeStart.push_back(static_cast<UINT>(ranges.size()));
+    return visible;
+}
+
+UINT SceneObject::SelectLod(const XMFLOAT3& cameraPosition, float projectionScale, float pixelError) const {
+    if (m_mesh.lods.empty()) {
+        return 0;
+    }
+
+    // LOD errors are in mesh units, and the model transform stretches them by
+    // at most m_modelScale
+    const XMVECTOR center = XMLoadFloat3(&m_worldBounds.sphere.center);
+    const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&cameraPosition)))) - m_worldBounds.sphere.radius;
+
+    // Inside the bounds every LOD can be arbitrarily close
+    if (distance <= 0.f) {
+        return 0;
+    }
+
+    for (size_t level = m_mesh.lods.size(); level > 0; --level) {
+        if (m_mesh.lods[level - 1].error * m_modelScale * projectionScale <= pixelError * distance) {
+            return static_cast<UINT>(level);
+        }
+    }
+    return 0;
 }
 
-void SceneObject::CreateDescriptorHeap(const ComPtr<ID3D12Device>& device) {
+void SceneObject::CreateDescriptorHeap(const ComPtr<ID3D12Device>& device, UINT textureCount) {
+    assert(!m_descriptorHeap && "SceneObject: descriptor heap created twice");
     if (!m_descriptorHeap) {
         // Describe and create a descriptor heap.
         // Flags indicate that this descriptor heap can be bound to the pipeline 
         // and that descriptors contained in it can be referenced by a root table.
         D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-        heapDesc.NumDescriptors = 2;
+        heapDesc.NumDescriptors = 1 + textureCount;
         heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_descriptorHeap)));
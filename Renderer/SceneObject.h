@@ -1,47 +1,124 @@
 #include "stdafx.h"
 #pragma once
+#include "Mesh.h"
+#include "VertexPacker.h"
+#include "AssetRegistry.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 
-struct Vertex {
-    XMFLOAT3 position;
-    XMFLOAT3 normal;
-    XMFLOAT2 texCoord;
-};
-
 class SceneObject
 {
 public:
     struct Constants {
         XMFLOAT4X4 model;
+
+        // Packed positions decode as positionOffset + unorm * positionScale
+        XMFLOAT4 positionOffset;
+        XMFLOAT4 positionScale;
+    };
+
+    // World-space bounds under the current model transform
+    struct WorldBounds {
+        BoundingBox box;
+        BoundingSphere sphere;
     };
 
     SceneObject();
     ~SceneObject();
 
-    void UploadVertices(const ComPtr<ID3D12Device>& device);
+    // Sets the model transform and marks the world bounds out of date
+    void SetModel(FXMMATRIX model);
+
+    // True when the model transform changed, or the object is new, since the
+    // last UpdateWorldBounds. Replacing m_mesh doesn't set it.
+    bool WorldBoundsDirty() const { return m_worldBoundsDirty; }
+
+    // Transforms the mesh's and each submesh's box and sphere by the model
+    // transform. Boxes are refit around the transformed box, so they stay
+    // conservative under rotation. LOD submeshes are covered by the submesh
+    // they simplify, whose vertices they reuse.
+    void UpdateWorldBounds();
+
+    // packed uploads PackedVertex data for the PACKED_VERTICES pipeline instead
+    // of full-precision Vertex data. Buffers come from assets, so objects with
+    // the same geometry share them.
+    void UploadVertices(const ComPtr<ID3D12Device>& device, AssetRegistry& assets, bool packed);
+    void UploadIndices(const ComPtr<ID3D12Device>& device, AssetRegistry& assets);
+    // Needs the descriptor heap LoadTextures creates
     void UploadConstants(const ComPtr<ID3D12Device>& device);
-    void LoadTexture(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, std::wstring fname);
 
-    void CreateDescriptorHeap(const ComPtr<ID3D12Device>& device);
+    // Appends the texture paths LoadTextures would load that aren't in paths
+    // already
+    void GetTexturePaths(const std::wstring& fallbackTexture, std::vector<std::wstring>& paths) const;
+
+    // Loads each distinct diffuse texture named by the mesh's materials and
+    // records the uploads on commandList. Materials without a texture use
+    // fallbackTexture, if one is given. Textures that fail to load are skipped
+    // and their materials drawn untextured. Textures come from assets, so each
+    // distinct image is uploaded once however many objects use it.
+    void LoadTextures(const ComPtr<ID3D12Device>& device, const ComPtr<ID3D12GraphicsCommandList>& commandList, AssetRegistry& assets,
+        const std::wstring& fallbackTexture);
+
+    // Descriptor 0 is the constant buffer view; texture t's view is 1 + t.
+    // Created once, by LoadTextures, which knows the texture count.
+    void CreateDescriptorHeap(const ComPtr<ID3D12Device>& device, UINT textureCount);
+
+    // Replaces ranges with the index ranges to draw at the given LOD, grouped by
+    // submesh: submesh s draws ranges[rangeStart[s]] up to ranges[rangeStart[s + 1]].
+    // At LOD 0, meshlets outside the frustum or facing away from the camera are
+    // skipped; viewProj is row-vector (not transposed). At any LOD, submeshes
+    // whose chunk is outside the frustum are skipped. Returns the number of
+    // visible meshlets and, if visibleChunks is given, sets it to the number
+    // of chunks in view.
+    size_t GetDrawRanges(UINT lod, FXMMATRIX viewProj, const XMFLOAT3& cameraPosition,
+        std::vector<Meshlets::DrawRange>& ranges, std::vector<UINT>& rangeStart, size_t* visibleChunks = nullptr) const;
+
+    // Picks the coarsest LOD whose error, projected at the world bounding
+    // sphere's nearest distance from the camera, stays within pixelError.
+    // projectionScale turns a length at distance 1 into pixels: viewport
+    // height / (2 tan(fovY / 2)). Returns 0 for the full-detail mesh and n for
+    // m_mesh.lods[n - 1]. Needs current world bounds.
+    UINT SelectLod(const XMFLOAT3& cameraPosition, float projectionScale, float pixelError) const;
+
+    // CPU-side geometry
+    Mesh m_mesh;
 
     // Vertex-related state
-    Vertex* m_vertices;
-    UINT m_vertexCount;
-    ComPtr<ID3D12Resource> m_vertexBuffer;
+    AssetRegistry::Handle m_vertexBuffer;
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
 
-    // Constant-related state
+    // Index-related state
+    AssetRegistry::Handle m_indexBuffer;
+    D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+
+    // Kept current by UpdateWorldBounds. m_submeshWorldBounds follows
+    // m_mesh.submeshes; m_modelScale is the model transform's largest axis
+    // scale.
+    WorldBounds m_worldBounds;
+    std::vector<WorldBounds> m_submeshWorldBounds;
+    float m_modelScale;
+
+    // Constant-related state. Change the model transform through SetModel.
     Constants m_constants;
     ComPtr<ID3D12Resource> m_constantBuffer;
     UINT8* m_pConstantBufferData;
 
-    // Texture-related state
-    ComPtr<ID3D12Resource> m_textureUploadHeap;
-    ComPtr<ID3D12Resource> m_texture;
-    bool m_hasTexture;
+    // Texture-related state. m_materialTextures holds, per material, an index
+    // into m_textures or NO_TEXTURE.
+    static const int NO_TEXTURE = -1;
+    std::vector<AssetRegistry::Handle> m_textures;
+    std::vector<int> m_materialTextures;
 
     // Descriptor heap for this object
     ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+
+private:
+    // Material's diffuse texture, or fallbackTexture if it has none
+    std::wstring TexturePath(size_t material, const std::wstring& fallbackTexture) const;
+
+    bool m_worldBoundsDirty;
+
+    // Per-chunk culling results, reused across frames
+    mutable std::vector<bool> m_chunkVisible;
 };
\ No newline at end of file
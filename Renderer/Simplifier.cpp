@@ -0,0 +1,543 @@
+// Built without the precompiled header so this file stays free of D3D
+// dependencies.
+#include "Simplifier.h"
+#include "MeshWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    const uint32_t INVALID_VERTEX = 0xFFFFFFFFu;
+
+    // Weight of the planes that pin border and seam edges in place, relative to
+    // the area-weighted surface planes
+    const double EDGE_WEIGHT = 10.0;
+
+    enum VertexKind : uint8_t {
+        // Interior vertex with a unique position; can collapse anywhere
+        KIND_MANIFOLD,
+
+        // On an open border; collapses only along the border
+        KIND_BORDER,
+
+        // On an attribute seam between exactly two vertices; collapses along the
+        // seam together with its partner
+        KIND_SEAM,
+
+        // Never removed
+        KIND_LOCKED,
+    };
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 Subtract(const Float3& a, const Float3& b) {
+        Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z };
+        return r;
+    }
+
+    float Dot(const Float3& a, const Float3& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b) {
+        Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        return r;
+    }
+
+    Float3 TriangleNormal(const Float3& a, const Float3& b, const Float3& c) {
+        return Cross(Subtract(b, a), Subtract(c, a));
+    }
+
+    // Symmetric 3x3 matrix A, vector b and scalar c of the quadric
+    // x'Ax + 2b'x + c, plus the total weight of the planes summed into it
+    struct Quadric {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+    // Adds the squared distance to the plane n.x + d = 0; n must be unit length
+    void AddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight) {
+        q.a00 += weight * nx * nx;
+        q.a11 += weight * ny * ny;
+        q.a22 += weight * nz * nz;
+        q.a01 += weight * nx * ny;
+        q.a02 += weight * nx * nz;
+        q.a12 += weight * ny * nz;
+        q.b0 += weight * nx * d;
+        q.b1 += weight * ny * d;
+        q.b2 += weight * nz * d;
+        q.c += weight * d * d;
+        q.weight += weight;
+    }
+
+    void AddQuadric(Quadric& q, const Quadric& other) {
+        q.a00 += other.a00;
+        q.a11 += other.a11;
+        q.a22 += other.a22;
+        q.a01 += other.a01;
+        q.a02 += other.a02;
+        q.a12 += other.a12;
+        q.b0 += other.b0;
+        q.b1 += other.b1;
+        q.b2 += other.b2;
+        q.c += other.c;
+        q.weight += other.weight;
+    }
+
+    double Evaluate(const Quadric& q, const Float3& p) {
+        const double x = p.x, y = p.y, z = p.z;
+        const double rx = q.a00 * x + q.a01 * y + q.a02 * z;
+        const double ry = q.a01 * x + q.a11 * y + q.a12 * z;
+        const double rz = q.a02 * x + q.a12 * y + q.a22 * z;
+        const double r = rx * x + ry * y + rz * z + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+        // Rounding can push an exact fit slightly negative
+        return fabs(r);
+    }
+
+    // Half-edges leaving each vertex, with the triangle each belongs to. Also
+    // serves as the vertex to triangle map.
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> targets;
+        std::vector<uint32_t> triangles;
+    };
+
+    void BuildAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount, Adjacency& adjacency) {
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        for (size_t i = 0; i < indexCount; ++i) {
+            adjacency.offsets[indices[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacency.offsets[v + 1] += adjacency.offsets[v];
+        }
+
+        adjacency.targets.resize(indexCount);
+        adjacency.triangles.resize(indexCount);
+        std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t from = indices[i + k];
+                const uint32_t to = indices[i + (k + 1) % 3];
+                adjacency.targets[fill[from]] = to;
+                adjacency.triangles[fill[from]] = static_cast<uint32_t>(i / 3);
+                fill[from]++;
+            }
+        }
+    }
+
+    bool HasEdge(const Adjacency& adjacency, uint32_t from, uint32_t to) {
+        for (uint32_t e = adjacency.offsets[from]; e < adjacency.offsets[from + 1]; ++e) {
+            if (adjacency.targets[e] == to) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // remap[v] is the first vertex with v's position; wedge links the vertices
+    // sharing a position into a cycle
+    void BuildPositionRemap(const std::vector<Float3>& points, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge) {
+        const size_t count = points.size();
+        remap.resize(count);
+        wedge.resize(count);
+
+        size_t tableSize = 16;
+        while (tableSize < count * 2) {
+            tableSize <<= 1;
+        }
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, INVALID_VERTEX);
+
+        for (uint32_t v = 0; v < count; ++v) {
+            size_t bucket = MeshWelder::HashBytes(&points[v], sizeof(Float3)) & mask;
+            for (;;) {
+                const uint32_t slot = table[bucket];
+                if (slot == INVALID_VERTEX) {
+                    table[bucket] = v;
+                    remap[v] = v;
+                    wedge[v] = v;
+                    break;
+                }
+                if (memcmp(&points[slot], &points[v], sizeof(Float3)) == 0) {
+                    remap[v] = slot;
+                    wedge[v] = wedge[slot];
+                    wedge[slot] = v;
+                    break;
+                }
+                bucket = (bucket + 1) & mask;
+            }
+        }
+    }
+
+    // Finds each vertex's open (unpaired) half-edges. openOut/openIn hold the
+    // neighbour along the open edge when there is exactly one in that direction.
+    void ClassifyVertices(const uint32_t* indices, size_t indexCount, const Adjacency& adjacency, const std::vector<uint32_t>& remap,
+        const std::vector<uint32_t>& wedge, std::vector<uint8_t>& kinds, std::vector<uint32_t>& openOut, std::vector<uint32_t>& openIn) {
+        const size_t count = remap.size();
+        std::vector<uint32_t> openOutCount(count, 0), openInCount(count, 0);
+        openOut.assign(count, INVALID_VERTEX);
+        openIn.assign(count, INVALID_VERTEX);
+
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t from = indices[i + k];
+                const uint32_t to = indices[i + (k + 1) % 3];
+                if (!HasEdge(adjacency, to, from)) {
+                    openOutCount[from]++;
+                    openOut[from] = to;
+                    openInCount[to]++;
+                    openIn[to] = from;
+                }
+            }
+        }
+
+        kinds.resize(count);
+        for (uint32_t v = 0; v < count; ++v) {
+            const bool simpleLoop = openOutCount[v] == 1 && openInCount[v] == 1;
+
+            if (wedge[v] == v) {
+                if (openOutCount[v] == 0 && openInCount[v] == 0) {
+                    kinds[v] = KIND_MANIFOLD;
+                } else {
+                    kinds[v] = simpleLoop ? KIND_BORDER : KIND_LOCKED;
+                }
+            } else if (wedge[wedge[v]] == v) {
+                // Both sides must run along the same pair of neighbouring positions
+                // in opposite directions, i.e. the seam is closed in position
+                const uint32_t w = wedge[v];
+                const bool partnerLoop = openOutCount[w] == 1 && openInCount[w] == 1;
+                const bool matched = simpleLoop && partnerLoop &&
+                    remap[openOut[v]] == remap[openIn[w]] && remap[openIn[v]] == remap[openOut[w]];
+                kinds[v] = matched ? KIND_SEAM : KIND_LOCKED;
+            } else {
+                kinds[v] = KIND_LOCKED;
+            }
+        }
+    }
+
+    void FillQuadrics(const uint32_t* indices, size_t indexCount, const std::vector<Float3>& points, const std::vector<uint32_t>& remap,
+        const Adjacency& adjacency, std::vector<Quadric>& quadrics) {
+        quadrics.assign(points.size(), Quadric());
+
+        for (size_t i = 0; i < indexCount; i += 3) {
+            const Float3& a = points[indices[i + 0]];
+            const Float3& b = points[indices[i + 1]];
+            const Float3& c = points[indices[i + 2]];
+
+            const Float3 normal = TriangleNormal(a, b, c);
+            const double length = sqrt(double(Dot(normal, normal)));
+            if (length == 0.0) {
+                continue;
+            }
+
+            const double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+            const double d = -(nx * a.x + ny * a.y + nz * a.z);
+            const double area = length * 0.5;
+            for (size_t k = 0; k < 3; ++k) {
+                AddPlane(quadrics[remap[indices[i + k]]], nx, ny, nz, d, area);
+            }
+
+            // Open edges also get a plane through the edge, perpendicular to the
+            // triangle, so that collapses can't pull them sideways
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t from = indices[i + k];
+                const uint32_t to = indices[i + (k + 1) % 3];
+                if (HasEdge(adjacency, to, from)) {
+                    continue;
+                }
+
+                const Float3& p = points[from];
+                const Float3 edge = Subtract(points[to], p);
+                const Float3 side = Cross(edge, normal);
+                const double sideLength = sqrt(double(Dot(side, side)));
+                if (sideLength == 0.0) {
+                    continue;
+                }
+
+                const double sx = side.x / sideLength, sy = side.y / sideLength, sz = side.z / sideLength;
+                const double sd = -(sx * p.x + sy * p.y + sz * p.z);
+                const double weight = double(Dot(edge, edge)) * EDGE_WEIGHT;
+                AddPlane(quadrics[remap[from]], sx, sy, sz, sd, weight);
+                AddPlane(quadrics[remap[to]], sx, sy, sz, sd, weight);
+            }
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    // Vertex that from's seam partner has to collapse into for from -> to to keep
+    // the seam intact
+    uint32_t SeamPartnerTarget(uint32_t from, uint32_t to, const std::vector<uint32_t>& wedge, const std::vector<uint32_t>& openOut, const std::vector<uint32_t>& openIn) {
+        const uint32_t partner = wedge[from];
+        return openOut[from] == to ? openIn[partner] : openOut[partner];
+    }
+
+    bool CanCollapse(uint32_t from, uint32_t to, const std::vector<uint8_t>& kinds, const std::vector<uint32_t>& remap, const std::vector<uint32_t>& wedge,
+        const std::vector<uint32_t>& openOut, const std::vector<uint32_t>& openIn) {
+        const bool alongLoop = openOut[from] == to || openIn[from] == to;
+
+        switch (kinds[from]) {
+        case KIND_MANIFOLD:
+            return true;
+        case KIND_BORDER:
+            return (kinds[to] == KIND_BORDER || kinds[to] == KIND_LOCKED) && alongLoop;
+        case KIND_SEAM: {
+            if (!(kinds[to] == KIND_SEAM || kinds[to] == KIND_LOCKED) || !alongLoop) {
+                return false;
+            }
+            const uint32_t partnerTarget = SeamPartnerTarget(from, to, wedge, openOut, openIn);
+            return partnerTarget != INVALID_VERTEX && remap[partnerTarget] == remap[to];
+        }
+        default:
+            return false;
+        }
+    }
+
+    // True if moving from onto to's position would turn any of from's remaining
+    // triangles over
+    bool HasFlip(uint32_t from, uint32_t to, const uint32_t* indices, const Adjacency& adjacency, const std::vector<Float3>& points, const std::vector<uint32_t>& remap) {
+        const Float3& target = points[to];
+
+        for (uint32_t e = adjacency.offsets[from]; e < adjacency.offsets[from + 1]; ++e) {
+            const uint32_t* triangle = &indices[adjacency.triangles[e] * 3];
+            if (remap[triangle[0]] == remap[to] || remap[triangle[1]] == remap[to] || remap[triangle[2]] == remap[to]) {
+                // Becomes degenerate and is removed
+                continue;
+            }
+
+            Float3 corners[3] = { points[triangle[0]], points[triangle[1]], points[triangle[2]] };
+            const Float3 before = TriangleNormal(corners[0], corners[1], corners[2]);
+            if (Dot(before, before) == 0.f) {
+                continue;
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                if (triangle[k] == from) {
+                    corners[k] = target;
+                }
+            }
+            const Float3 after = TriangleNormal(corners[0], corners[1], corners[2]);
+            if (Dot(before, after) <= 0.f) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Keeps the border/seam neighbour links valid after from collapses into to
+    void UpdateLoop(uint32_t from, uint32_t to, std::vector<uint32_t>& openOut, std::vector<uint32_t>& openIn) {
+        if (openOut[from] == to) {
+            const uint32_t previous = openIn[from];
+            if (previous != INVALID_VERTEX) {
+                openOut[previous] = to;
+            }
+            openIn[to] = previous;
+        } else if (openIn[from] == to) {
+            const uint32_t next = openOut[from];
+            if (next != INVALID_VERTEX) {
+                openIn[next] = to;
+            }
+            openOut[to] = next;
+        }
+    }
+}
+
+size_t Simplifier::Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t targetIndexCount, float targetError, float* resultError) {
+    if (resultError) {
+        *resultError = 0.f;
+    }
+    if (indexCount == 0) {
+        return 0;
+    }
+
+    // Work on the referenced vertices only, so that simplifying a small submesh
+    // of a large vertex buffer stays cheap
+    std::vector<uint32_t> localToGlobal(indices, indices + indexCount);
+    std::sort(localToGlobal.begin(), localToGlobal.end());
+    localToGlobal.erase(std::unique(localToGlobal.begin(), localToGlobal.end()), localToGlobal.end());
+    const size_t count = localToGlobal.size();
+
+    std::vector<uint32_t> result(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        result[i] = static_cast<uint32_t>(std::lower_bound(localToGlobal.begin(), localToGlobal.end(), indices[i]) - localToGlobal.begin());
+    }
+
+    std::vector<Float3> points(count);
+    for (size_t v = 0; v < count; ++v) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + localToGlobal[v] * positionStride);
+        points[v].x = p[0];
+        points[v].y = p[1];
+        points[v].z = p[2];
+    }
+
+    std::vector<uint32_t> remap, wedge;
+    BuildPositionRemap(points, remap, wedge);
+
+    Adjacency adjacency;
+    BuildAdjacency(result.data(), indexCount, count, adjacency);
+
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> openOut, openIn;
+    ClassifyVertices(result.data(), indexCount, adjacency, remap, wedge, kinds, openOut, openIn);
+
+    // Indexed by position (remap), so both sides of a seam share one quadric
+    std::vector<Quadric> quadrics;
+    FillQuadrics(result.data(), indexCount, points, remap, adjacency, quadrics);
+
+    const double errorLimit = double(targetError) * double(targetError);
+    double maxError = 0.0;
+    size_t resultCount = indexCount;
+
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> collapseTo(count);
+    std::vector<uint8_t> locked(count);
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap,
+    // then rebuilds the adjacency
+    while (resultCount > targetIndexCount) {
+        BuildAdjacency(result.data(), resultCount, count, adjacency);
+
+        candidates.clear();
+        for (size_t i = 0; i < resultCount; i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t a = result[i + k];
+                const uint32_t b = result[i + (k + 1) % 3];
+                if (remap[a] == remap[b]) {
+                    continue;
+                }
+
+                // Interior edges are seen from both triangles; keep one
+                if (a > b && HasEdge(adjacency, b, a)) {
+                    continue;
+                }
+
+                const double error = Evaluate(quadrics[remap[a]], points[b]) + Evaluate(quadrics[remap[b]], points[b]);
+                const double reverseError = Evaluate(quadrics[remap[a]], points[a]) + Evaluate(quadrics[remap[b]], points[a]);
+                const double weight = quadrics[remap[a]].weight + quadrics[remap[b]].weight;
+                if (weight <= 0.0) {
+                    continue;
+                }
+
+                if (CanCollapse(a, b, kinds, remap, wedge, openOut, openIn)) {
+                    Collapse collapse = { a, b, float(error / weight) };
+                    candidates.push_back(collapse);
+                }
+                if (CanCollapse(b, a, kinds, remap, wedge, openOut, openIn)) {
+                    Collapse collapse = { b, a, float(reverseError / weight) };
+                    candidates.push_back(collapse);
+                }
+            }
+        }
+
+        if (candidates.empty()) {
+            break;
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs) {
+            return lhs.cost < rhs.cost || (lhs.cost == rhs.cost && (lhs.from < rhs.from || (lhs.from == rhs.from && lhs.to < rhs.to)));
+        });
+
+        for (uint32_t v = 0; v < count; ++v) {
+            collapseTo[v] = v;
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+
+        const size_t trianglesToRemove = std::max<size_t>((resultCount - targetIndexCount) / 3, 1);
+        size_t trianglesRemoved = 0;
+        size_t collapsed = 0;
+
+        for (const Collapse& collapse : candidates) {
+            if (collapse.cost > errorLimit) {
+                break;
+            }
+
+            const uint32_t from = collapse.from;
+            const uint32_t to = collapse.to;
+            if (locked[remap[from]] || locked[remap[to]]) {
+                continue;
+            }
+
+            uint32_t partner = INVALID_VERTEX;
+            uint32_t partnerTarget = INVALID_VERTEX;
+            if (kinds[from] == KIND_SEAM) {
+                partner = wedge[from];
+                partnerTarget = SeamPartnerTarget(from, to, wedge, openOut, openIn);
+            }
+
+            if (HasFlip(from, to, result.data(), adjacency, points, remap) ||
+                (partner != INVALID_VERTEX && HasFlip(partner, partnerTarget, result.data(), adjacency, points, remap))) {
+                continue;
+            }
+
+            const uint32_t sides[2][2] = { { from, to }, { partner, partnerTarget } };
+            for (const auto& side : sides) {
+                if (side[0] == INVALID_VERTEX) {
+                    continue;
+                }
+
+                collapseTo[side[0]] = side[1];
+                if (kinds[side[0]] != KIND_MANIFOLD) {
+                    UpdateLoop(side[0], side[1], openOut, openIn);
+                }
+
+                // Nothing else in this neighbourhood moves until the next pass
+                for (uint32_t e = adjacency.offsets[side[0]]; e < adjacency.offsets[side[0] + 1]; ++e) {
+                    const uint32_t* triangle = &result[adjacency.triangles[e] * 3];
+                    bool degenerate = false;
+                    for (size_t k = 0; k < 3; ++k) {
+                        locked[remap[triangle[k]]] = 1;
+                        degenerate |= remap[triangle[k]] == remap[side[1]];
+                    }
+                    trianglesRemoved += degenerate ? 1 : 0;
+                }
+            }
+
+            AddQuadric(quadrics[remap[to]], quadrics[remap[from]]);
+            maxError = std::max(maxError, double(collapse.cost));
+            collapsed++;
+
+            if (trianglesRemoved >= trianglesToRemove) {
+                break;
+            }
+        }
+
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < resultCount; i += 3) {
+            const uint32_t a = collapseTo[result[i + 0]];
+            const uint32_t b = collapseTo[result[i + 1]];
+            const uint32_t c = collapseTo[result[i + 2]];
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+                continue;
+            }
+            result[write + 0] = a;
+            result[write + 1] = b;
+            result[write + 2] = c;
+            write += 3;
+        }
+        resultCount = write;
+    }
+
+    for (size_t i = 0; i < resultCount; ++i) {
+        destination[i] = localToGlobal[result[i]];
+    }
+
+    if (resultError) {
+        *resultError = static_cast<float>(sqrt(maxError));
+    }
+    return resultCount;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Quadric error mesh simplification for building LOD chains. Portable; no
+// Windows or D3D dependencies.
+//
+// Simplification is by half-edge collapse: a vertex is merged into one of its
+// neighbours and never moved, so the result indexes the original vertex
+// buffer and every LOD of a mesh can share it. Collapses are ordered by
+// Garland and Heckbert's quadric error.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Simplifier {
+    // Writes a simplified copy of the triangle list to destination, which needs
+    // room for indexCount indices, and returns the number of indices written.
+    // Stops once at most targetIndexCount indices remain, when the next collapse
+    // would exceed targetError, or when nothing more can be collapsed.
+    //
+    // Vertices that share a position but differ in other attributes mark an
+    // attribute seam. Seams and open borders are kept: their vertices only
+    // collapse along the seam or border, and both sides of a seam collapse
+    // together. Positions where more than two seam edges meet, or that are
+    // otherwise non-manifold, are never removed.
+    //
+    // positions points at the first vertex's xyz; positionStride is the vertex
+    // size in bytes. If resultError is given it receives the error of the
+    // result: the quadric estimate of how far, in the same units as the
+    // positions, the simplified surface strays from the original.
+    size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+        size_t targetIndexCount, float targetError, float* resultError);
+}
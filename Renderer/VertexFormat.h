@@ -0,0 +1,315 @@
+#pragma once
+#include "Mesh.h"
+#include <DirectXPackedVector.h>
+#include <type_traits>
+#include <utility>
+
+using namespace DirectX::PackedVector;
+
+// Vertex formats described at compile time. A format is a list of attributes,
+// each pairing a semantic with an encoding. From that list the compiler
+// derives the packed vertex type, its stride, the D3D12 input layout and the
+// routines that convert between Vertex and the packed type, so a new format
+// (compact, skinned, ...) is one typedef and the CPU and GPU sides can't
+// drift apart.
+//
+// Every encoding is a multiple of 4 bytes with at most 4-byte alignment, which
+// is what D3D12 asks of element offsets. The packed type therefore has no
+// padding and each attribute's offset is the sum of the sizes before it;
+// static_asserts check both.
+
+// What an attribute means, and where Pack reads it from in a Vertex and
+// Unpack writes it to
+namespace VertexSemantics {
+    struct Position {
+        static constexpr const char* NAME = "POSITION";
+        static XMVECTOR Load(const Vertex& vertex) { return XMLoadFloat3(&vertex.position); }
+        static void Store(FXMVECTOR value, Vertex& vertex) { XMStoreFloat3(&vertex.position, value); }
+    };
+
+    struct Normal {
+        static constexpr const char* NAME = "NORMAL";
+        static XMVECTOR Load(const Vertex& vertex) { return XMLoadFloat3(&vertex.normal); }
+        static void Store(FXMVECTOR value, Vertex& vertex) { XMStoreFloat3(&vertex.normal, value); }
+    };
+
+    struct TexCoord {
+        static constexpr const char* NAME = "TEXCOORD";
+        static XMVECTOR Load(const Vertex& vertex) { return XMLoadFloat2(&vertex.texCoord); }
+        static void Store(FXMVECTOR value, Vertex& vertex) { XMStoreFloat2(&vertex.texCoord, value); }
+    };
+
+    // Vertex has no skinning data, so packing binds every vertex rigidly to
+    // bone 0 and unpacking drops the influences
+    struct BoneIndices {
+        static constexpr const char* NAME = "BLENDINDICES";
+        static XMVECTOR Load(const Vertex&) { return XMVectorZero(); }
+        static void Store(FXMVECTOR, Vertex&) {}
+    };
+
+    struct BoneWeights {
+        static constexpr const char* NAME = "BLENDWEIGHT";
+        static XMVECTOR Load(const Vertex&) { return XMVectorSet(1.f, 0.f, 0.f, 0.f); }
+        static void Store(FXMVECTOR, Vertex&) {}
+    };
+}
+
+// How an attribute is stored. Each encoding names its storage type and DXGI
+// format and converts a whole XMVECTOR at a time.
+namespace VertexEncodings {
+    // Per-mesh values encodings may depend on. Positions quantized to the mesh
+    // box decode as offset + unorm * scale.
+    struct Context {
+        XMVECTOR positionOffset;
+        XMVECTOR positionScale;
+
+        // 1 / positionScale, or 0 on flat axes so they quantize to 0
+        XMVECTOR positionInvScale;
+
+        static Context ForBounds(const BoundingBox& bounds) {
+            Context context;
+            context.positionOffset = XMLoadFloat3(&bounds.min);
+            context.positionScale = XMVectorSubtract(XMLoadFloat3(&bounds.max), context.positionOffset);
+            context.positionInvScale = XMVectorSelect(XMVectorReciprocal(context.positionScale), XMVectorZero(),
+                XMVectorEqual(context.positionScale, XMVectorZero()));
+            return context;
+        }
+    };
+
+    struct Float3 {
+        typedef XMFLOAT3 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R32G32B32_FLOAT;
+        static void Encode(FXMVECTOR value, const Context&, Type& out) { XMStoreFloat3(&out, value); }
+        static XMVECTOR Decode(const Type& in, const Context&) { return XMLoadFloat3(&in); }
+    };
+
+    struct Float2 {
+        typedef XMFLOAT2 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R32G32_FLOAT;
+        static void Encode(FXMVECTOR value, const Context&, Type& out) { XMStoreFloat2(&out, value); }
+        static XMVECTOR Decode(const Type& in, const Context&) { return XMLoadFloat2(&in); }
+    };
+
+    // Position relative to the mesh box, 16 bits per axis; w is unused
+    struct BoxUNorm16 {
+        typedef XMUSHORTN4 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R16G16B16A16_UNORM;
+
+        // XMStoreUShortN4 saturates and rounds to nearest
+        static void Encode(FXMVECTOR value, const Context& context, Type& out) {
+            XMStoreUShortN4(&out, XMVectorMultiply(XMVectorSubtract(value, context.positionOffset), context.positionInvScale));
+        }
+        static XMVECTOR Decode(const Type& in, const Context& context) {
+            return XMVectorMultiplyAdd(XMLoadUShortN4(&in), context.positionScale, context.positionOffset);
+        }
+    };
+
+    // Unit vector in two snorm16 components. The vector is projected onto the
+    // L1 unit sphere and the lower hemisphere folded over the diagonals, giving
+    // a point in [-1, 1]^2.
+    struct Octahedral16 {
+        typedef XMSHORTN2 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R16G16_SNORM;
+
+        static void Encode(FXMVECTOR value, const Context&, Type& out) {
+            const XMVECTOR zero = XMVectorZero();
+            const XMVECTOR l1 = XMVector3Dot(XMVectorAbs(value), XMVectorSplatOne());
+
+            // Degenerate vectors encode as +Z rather than NaN
+            const XMVECTOR n = XMVectorSelect(XMVectorDivide(value, l1), zero, XMVectorEqual(l1, zero));
+
+            const XMVECTOR signNotZero = XMVectorSelect(XMVectorNegate(XMVectorSplatOne()), XMVectorSplatOne(), XMVectorGreaterOrEqual(n, zero));
+            const XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(n))), signNotZero);
+            XMStoreShortN2(&out, XMVectorSelect(n, folded, XMVectorLess(XMVectorSplatZ(n), zero)));
+        }
+
+        // Mirrors DecodeOctahedral in shaders.hlsl
+        static XMVECTOR Decode(const Type& in, const Context&) {
+            const XMVECTOR encoded = XMLoadShortN2(&in);
+            const float x = XMVectorGetX(encoded);
+            const float y = XMVectorGetY(encoded);
+            XMVECTOR n = XMVectorSet(x, y, 1.f - fabsf(x) - fabsf(y), 0.f);
+
+            const float t = fmaxf(-XMVectorGetZ(n), 0.f);
+            n = XMVectorSetX(n, x >= 0.f ? x - t : x + t);
+            n = XMVectorSetY(n, y >= 0.f ? y - t : y + t);
+            return XMVector3Normalize(n);
+        }
+    };
+
+    struct Half2 {
+        typedef XMHALF2 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R16G16_FLOAT;
+        static void Encode(FXMVECTOR value, const Context&, Type& out) { XMStoreHalf2(&out, value); }
+        static XMVECTOR Decode(const Type& in, const Context&) { return XMLoadHalf2(&in); }
+    };
+
+    struct UInt8x4 {
+        typedef XMUBYTE4 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R8G8B8A8_UINT;
+        static void Encode(FXMVECTOR value, const Context&, Type& out) { XMStoreUByte4(&out, value); }
+        static XMVECTOR Decode(const Type& in, const Context&) { return XMLoadUByte4(&in); }
+    };
+
+    struct UNorm8x4 {
+        typedef XMUBYTEN4 Type;
+        static const DXGI_FORMAT FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
+        static void Encode(FXMVECTOR value, const Context&, Type& out) { XMStoreUByteN4(&out, value); }
+        static XMVECTOR Decode(const Type& in, const Context&) { return XMLoadUByteN4(&in); }
+    };
+}
+
+template <typename TSemantic, typename TEncoding, UINT SemanticIndex = 0>
+struct VertexAttribute {
+    typedef TSemantic Semantic;
+    typedef TEncoding Encoding;
+    static const UINT SEMANTIC_INDEX = SemanticIndex;
+
+    static_assert(sizeof(typename TEncoding::Type) % 4 == 0, "D3D12 element offsets must stay 4-byte aligned");
+    static_assert(alignof(typename TEncoding::Type) <= 4, "Attributes can't ask for more alignment than their offsets get");
+};
+
+namespace VertexFormatDetail {
+    // The attributes' storage in list order, nested so the layout is plain
+    // standard layout with no empty tail
+    template <typename First, typename... Rest>
+    struct Fields {
+        typename First::Encoding::Type value;
+        Fields<Rest...> rest;
+    };
+
+    template <typename Last>
+    struct Fields<Last> {
+        typename Last::Encoding::Type value;
+    };
+
+    // Storage of the attribute at index I
+    template <size_t I>
+    struct Field {
+        template <typename TFields>
+        static auto& Of(TFields& fields) { return Field<I - 1>::Of(fields.rest); }
+    };
+
+    template <>
+    struct Field<0> {
+        template <typename TFields>
+        static auto& Of(TFields& fields) { return fields.value; }
+    };
+
+    // Byte offset of the attribute at index; the stride when index is the
+    // attribute count
+    template <typename... Attributes>
+    constexpr UINT Offset(size_t index) {
+        const UINT sizes[] = { UINT(sizeof(typename Attributes::Encoding::Type))... };
+        UINT offset = 0;
+        for (size_t i = 0; i < index; ++i) {
+            offset += sizes[i];
+        }
+        return offset;
+    }
+
+    template <typename Semantic, typename... Attributes>
+    constexpr size_t IndexOf() {
+        const bool matches[] = { std::is_same<Semantic, typename Attributes::Semantic>::value... };
+        for (size_t i = 0; i < sizeof...(Attributes); ++i) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return sizeof...(Attributes);
+    }
+}
+
+template <typename... Attributes>
+class VertexFormat
+{
+public:
+    typedef VertexFormatDetail::Fields<Attributes...> Type;
+
+    static const UINT ELEMENT_COUNT = sizeof...(Attributes);
+
+    static const UINT STRIDE = VertexFormatDetail::Offset<Attributes...>(sizeof...(Attributes));
+
+    template <typename Semantic>
+    static constexpr UINT OffsetOf() {
+        static_assert(VertexFormatDetail::IndexOf<Semantic, Attributes...>() < sizeof...(Attributes), "The format has no such attribute");
+        return VertexFormatDetail::Offset<Attributes...>(VertexFormatDetail::IndexOf<Semantic, Attributes...>());
+    }
+
+    // ELEMENT_COUNT elements for D3D12_INPUT_LAYOUT_DESC, all in input slot 0
+    static const D3D12_INPUT_ELEMENT_DESC* InputLayout() {
+        return InputLayout(std::index_sequence_for<Attributes...>());
+    }
+
+    // Encodes count vertices into out, one XMVECTOR per attribute
+    static void Pack(const Vertex* vertices, size_t count, const VertexEncodings::Context& context, Type* out) {
+        for (size_t i = 0; i < count; ++i) {
+            PackVertex(vertices[i], context, out[i], std::index_sequence_for<Attributes...>());
+        }
+    }
+
+    // Decodes count vertices the way the vertex shader does. Vertex fields the
+    // format doesn't carry come out zero.
+    static void Unpack(const Type* packed, size_t count, const VertexEncodings::Context& context, Vertex* out) {
+        for (size_t i = 0; i < count; ++i) {
+            memset(&out[i], 0, sizeof(Vertex));
+            UnpackVertex(packed[i], context, out[i], std::index_sequence_for<Attributes...>());
+        }
+    }
+
+private:
+    static_assert(sizeof(Type) == STRIDE, "Packed vertices must have no padding");
+
+    template <size_t... I>
+    static const D3D12_INPUT_ELEMENT_DESC* InputLayout(std::index_sequence<I...>) {
+        static const D3D12_INPUT_ELEMENT_DESC elements[] = {
+            { Attributes::Semantic::NAME, Attributes::SEMANTIC_INDEX, Attributes::Encoding::FORMAT, 0,
+                VertexFormatDetail::Offset<Attributes...>(I), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }...
+        };
+        return elements;
+    }
+
+    // The initializer list expands to one conversion per attribute, in order
+    template <size_t... I>
+    static void PackVertex(const Vertex& vertex, const VertexEncodings::Context& context, Type& out, std::index_sequence<I...>) {
+        const int expand[] = { (Attributes::Encoding::Encode(Attributes::Semantic::Load(vertex), context, VertexFormatDetail::Field<I>::Of(out)), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    static void UnpackVertex(const Type& packed, const VertexEncodings::Context& context, Vertex& out, std::index_sequence<I...>) {
+        const int expand[] = { (Attributes::Semantic::Store(Attributes::Encoding::Decode(VertexFormatDetail::Field<I>::Of(packed), context), out), 0)... };
+        (void)expand;
+    }
+
+    VertexFormat();
+};
+
+namespace VertexFormats {
+    // Full precision, laid out exactly like Vertex so meshes upload as is
+    typedef VertexFormat<
+        VertexAttribute<VertexSemantics::Position, VertexEncodings::Float3>,
+        VertexAttribute<VertexSemantics::Normal, VertexEncodings::Float3>,
+        VertexAttribute<VertexSemantics::TexCoord, VertexEncodings::Float2>> Standard;
+
+    // 16 bytes for the PACKED_VERTICES path. Positions need the mesh's
+    // dequantization constants in the vertex shader.
+    typedef VertexFormat<
+        VertexAttribute<VertexSemantics::Position, VertexEncodings::BoxUNorm16>,
+        VertexAttribute<VertexSemantics::Normal, VertexEncodings::Octahedral16>,
+        VertexAttribute<VertexSemantics::TexCoord, VertexEncodings::Half2>> Compact;
+
+    // Compact plus up to four bone influences per vertex
+    typedef VertexFormat<
+        VertexAttribute<VertexSemantics::Position, VertexEncodings::BoxUNorm16>,
+        VertexAttribute<VertexSemantics::Normal, VertexEncodings::Octahedral16>,
+        VertexAttribute<VertexSemantics::TexCoord, VertexEncodings::Half2>,
+        VertexAttribute<VertexSemantics::BoneIndices, VertexEncodings::UInt8x4>,
+        VertexAttribute<VertexSemantics::BoneWeights, VertexEncodings::UNorm8x4>> Skinned;
+
+    static_assert(Standard::STRIDE == sizeof(Vertex), "Standard must match Vertex");
+    static_assert(Standard::OffsetOf<VertexSemantics::Normal>() == offsetof(Vertex, normal), "Standard must match Vertex");
+    static_assert(Standard::OffsetOf<VertexSemantics::TexCoord>() == offsetof(Vertex, texCoord), "Standard must match Vertex");
+    static_assert(Compact::STRIDE == 16, "Compact vertices are 16 bytes");
+    static_assert(Skinned::STRIDE == 24, "Skinned vertices are 24 bytes");
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "VertexFormat.h"
+
+// 16-byte vertex for the PACKED_VERTICES path:
+//   position  R16G16B16A16_UNORM  xyz relative to the mesh bounds, w unused
+//   normal    R16G16_SNORM        octahedral encoding
+//   texCoord  R16G16_FLOAT
+typedef VertexFormats::Compact::Type PackedVertex;
+
+// Converts full-precision vertices into PackedVertex. Positions are quantized
+// against the mesh AABB, so each mesh needs its own dequantization constants
+// (offset + unorm * scale) in the vertex shader.
+class VertexPacker
+{
+public:
+    struct ErrorStats {
+        // Largest position error, in mesh units
+        float position;
+
+        // Largest angle between original and decoded normal, in degrees
+        float normalDegrees;
+
+        // Largest per-component texture coordinate error
+        float texCoord;
+    };
+
+    static void GetDequantization(const BoundingBox& bounds, XMFLOAT4& offset, XMFLOAT4& scale);
+
+    static void Pack(const Vertex* vertices, size_t count, const BoundingBox& bounds, PackedVertex* out);
+
+    // Decodes the packed vertices the way VSMain does and compares them with
+    // the originals
+    static ErrorStats MeasureError(const Vertex* vertices, const PackedVertex* packed, size_t count, const BoundingBox& bounds);
+
+    // Worst-case error the format allows for this data; MeasureError must stay
+    // within it
+    static ErrorStats ErrorBound(const Vertex* vertices, size_t count, const BoundingBox& bounds);
+
+private:
+    VertexPacker();
+};
@@ -19,6 +19,10 @@ cbuffer GlobalConstants : register(b0) {
 
 cbuffer SceneObjectConstants : register(b1) {
     float4x4 model;
+
+    // Packed positions decode as positionOffset + unorm * positionScale
+    float4 positionOffset;
+    float4 positionScale;
 };
 
 struct DirectionalLight {
@@ -38,6 +42,11 @@ cbuffer ShaderFlags : register(b3) {
     int flags;
 };
 
+cbuffer MaterialConstants : register(b5) {
+    // rgb diffuse, a dissolve
+    float4 diffuse;
+};
+
 struct PSInput
 {
     float4 position : SV_POSITION;
@@ -46,10 +55,44 @@ struct PSInput
     float4 wsNormal : TEXCOORD2;
 };
 
-PSInput VSMain(float3 position : POSITION, float3 normal : NORMAL, float2 texCoord : TEXCOORD)
+#if PACKED_VERTICES
+// Matches PackedVertex in VertexPacker.h
+struct VSInput
+{
+    float4 position : POSITION;     // R16G16B16A16_UNORM, relative to the mesh bounds
+    float2 normal : NORMAL;         // R16G16_SNORM, octahedral
+    float2 texCoord : TEXCOORD;     // R16G16_FLOAT
+};
+
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.f ? -t : t;
+    return normalize(n);
+}
+#else
+struct VSInput
+{
+    float3 position : POSITION;
+    float3 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+};
+#endif
+
+PSInput VSMain(VSInput input)
 {
     PSInput result;
 
+#if PACKED_VERTICES
+    float3 position = positionOffset.xyz + input.position.xyz * positionScale.xyz;
+    float3 normal = DecodeOctahedral(input.normal);
+#else
+    float3 position = input.position;
+    float3 normal = input.normal;
+#endif
+    float2 texCoord = input.texCoord;
+
     float4x4 mvMatrix = mul(model, view);
     float4x4 mvpMatrix = mul(mvMatrix, proj);
     result.position = mul(float4(position, 1.f), mvpMatrix);
@@ -88,7 +131,10 @@ float4 PSMain(PSInput input) : SV_TARGET
         result = result + radianceFromLight;
     }
 
-    float4 surfaceColor = float4(1.f, 1.f, 1.f, 0.f);
+    float4 surfaceColor = diffuse;
+    if (flags & SHADER_FLAGS_HAS_TEXTURE) {
+        surfaceColor *= g_texture.Sample(g_sampler, input.texCoord);
+    }
 
     return result * surfaceColor;
 
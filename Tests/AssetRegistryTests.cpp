@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "Check.h"
+#include "AssetRegistry.h"
+#include "Mips.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+    const wchar_t* COPY = L"AssetRegistryTests.bmp";
+    const wchar_t* ODD = L"AssetRegistryTestsOdd.bmp";
+
+    // WARP, so the test needs no GPU. Null if D3D12 isn't available.
+    ComPtr<ID3D12Device> CreateDevice() {
+        ComPtr<IDXGIFactory4> factory;
+        ComPtr<IDXGIAdapter> adapter;
+        ComPtr<ID3D12Device> device;
+        if (FAILED(CreateDXGIFactory2(0, IID_PPV_ARGS(&factory))) || FAILED(factory->EnumWarpAdapter(IID_PPV_ARGS(&adapter))) ||
+            FAILED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device)))) {
+            return nullptr;
+        }
+        return device;
+    }
+
+    std::wstring Widen(const std::string& path) {
+        std::wstring wide(MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, nullptr, 0), L'\0');
+        MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, &wide[0], static_cast<int>(wide.size()));
+        wide.pop_back();
+        return wide;
+    }
+
+    void Put16(std::ofstream& file, uint32_t value) {
+        file.put(char(value & 0xFF));
+        file.put(char(value >> 8));
+    }
+
+    void Put32(std::ofstream& file, uint32_t value) {
+        Put16(file, value & 0xFFFF);
+        Put16(file, value >> 16);
+    }
+
+    // A 6x6 24-bit bitmap, too small on each side for block compression
+    void WriteOddBitmap() {
+        const uint32_t size = 6, stride = 20;
+        std::ofstream file(ODD, std::ios::binary | std::ios::trunc);
+        file.put('B');
+        file.put('M');
+        Put32(file, 54 + stride * size);
+        Put32(file, 0);
+        Put32(file, 54);
+        Put32(file, 40);
+        Put32(file, size);
+        Put32(file, size);
+        Put16(file, 1);
+        Put16(file, 24);
+        for (int field = 0; field < 6; ++field) {
+            Put32(file, 0);
+        }
+        for (uint32_t i = 0; i < stride * size; ++i) {
+            file.put(char(i * 7));
+        }
+    }
+
+    // Requests for the same kind, data and seed share one buffer, filled once;
+    // anything else gets its own, and a buffer goes with its last Handle
+    void TestBuffers(const ComPtr<ID3D12Device>& device) {
+        AssetRegistry assets;
+        const std::vector<float> data = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+        const std::vector<float> copy = data;
+        const UINT bytes = static_cast<UINT>(data.size() * sizeof(float));
+        int fills = 0;
+        auto acquire = [&](AssetRegistry::BufferKind kind, const std::vector<float>& source, UINT64 seed) {
+            return assets.AcquireBuffer(device, kind, source.data(), source.size() * sizeof(float), bytes, [&](void* mapped) {
+                ++fills;
+                memcpy(mapped, source.data(), bytes);
+            }, seed);
+        };
+
+        AssetRegistry::Handle first = acquire(AssetRegistry::VERTICES, data, 0);
+        AssetRegistry::Handle second = acquire(AssetRegistry::VERTICES, copy, 0);
+        CHECK(first && first == second);
+        CHECK(fills == 1);
+        AssetRegistry::Stats stats = assets.GetStats();
+        CHECK(stats.resources == 1 && stats.bytes == bytes);
+        CHECK(stats.sharedRequests == 1 && stats.savedBytes == bytes);
+
+        AssetRegistry::Handle packed = acquire(AssetRegistry::PACKED_VERTICES, data, 0);
+        AssetRegistry::Handle seeded = acquire(AssetRegistry::VERTICES, data, 1);
+        CHECK(packed && seeded && packed != first && seeded != first && packed != seeded);
+        CHECK(fills == 3);
+        stats = assets.GetStats();
+        CHECK(stats.resources == 3 && stats.bytes == 3 * bytes);
+        CHECK(stats.sharedRequests == 1);
+
+        first.reset();
+        CHECK(assets.GetStats().resources == 3);
+        second.reset();
+        stats = assets.GetStats();
+        CHECK(stats.resources == 2 && stats.bytes == 2 * bytes);
+
+        // Created again, not counted as shared
+        AssetRegistry::Handle again = acquire(AssetRegistry::VERTICES, data, 0);
+        CHECK(again && fills == 4);
+        stats = assets.GetStats();
+        CHECK(stats.resources == 3 && stats.sharedRequests == 1 && stats.savedBytes == bytes);
+        printf("Buffers: %u resources, %u shared requests\n", stats.resources, stats.sharedRequests);
+    }
+
+    // Identical images under different paths share a texture, but only with
+    // requests made under the same compression and quality
+    void TestTextures(const ComPtr<ID3D12Device>& device) {
+        ComPtr<ID3D12CommandAllocator> allocator;
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+        ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+
+        const std::wstring sphere = Widen(Check::Resource("sphere.bmp"));
+        if (!CHECK(CopyFileW(sphere.c_str(), COPY, FALSE))) {
+            return;
+        }
+        AssetRegistry assets;
+        auto acquire = [&](const std::wstring& path) { return assets.AcquireTexture(device, commandList, path); };
+        auto format = [](const AssetRegistry::Handle& texture) { return texture->resource->GetDesc().Format; };
+
+        AssetRegistry::Handle original = acquire(sphere);
+        AssetRegistry::Handle copied = acquire(COPY);
+        if (!CHECK(original && original == copied)) {
+            return;
+        }
+        CHECK(format(original) == DXGI_FORMAT_R8G8B8A8_UNORM);
+        CHECK(original->bytes == Mips::ChainPixels(1024, 1024) * 4);
+        AssetRegistry::Stats stats = assets.GetStats();
+        CHECK(stats.resources == 1 && stats.sharedRequests == 1 && stats.savedBytes == original->bytes);
+
+        assets.SetTextureCompression(AssetRegistry::BC7, Bc::FAST);
+        AssetRegistry::Handle bc7 = acquire(sphere);
+        CHECK(bc7 && bc7 != original && format(bc7) == DXGI_FORMAT_BC7_UNORM);
+        CHECK(bc7 && bc7->bytes < original->bytes);
+        CHECK(acquire(COPY) == bc7);
+
+        assets.SetTextureCompression(AssetRegistry::BC1_BC3, Bc::FAST);
+        AssetRegistry::Handle bc1 = acquire(sphere);
+        CHECK(bc1 && bc1 != bc7 && format(bc1) == DXGI_FORMAT_BC1_UNORM);
+        assets.SetTextureCompression(AssetRegistry::BC1_BC3, Bc::NORMAL);
+        AssetRegistry::Handle normal = acquire(sphere);
+        CHECK(normal && normal != bc1 && format(normal) == DXGI_FORMAT_BC1_UNORM);
+
+        // Going back to earlier settings finds their textures again
+        assets.SetTextureCompression(AssetRegistry::BC7, Bc::FAST);
+        CHECK(acquire(COPY) == bc7);
+        assets.SetTextureCompression(AssetRegistry::UNCOMPRESSED, Bc::FAST);
+        CHECK(acquire(COPY) == original);
+        stats = assets.GetStats();
+        CHECK(stats.resources == 4);
+
+        // Images compressed ahead under other settings are decoded again
+        assets.SetTextureCompression(AssetRegistry::BC7, Bc::FAST);
+        assets.DecodeTextures({ COPY }, 1);
+        assets.SetTextureCompression(AssetRegistry::UNCOMPRESSED, Bc::FAST);
+        original.reset();
+        copied.reset();
+        AssetRegistry::Handle reloaded = acquire(COPY);
+        CHECK(reloaded && format(reloaded) == DXGI_FORMAT_R8G8B8A8_UNORM);
+
+        // Images that are never compressed share across every setting
+        WriteOddBitmap();
+        AssetRegistry::Handle odd = acquire(ODD);
+        assets.SetTextureCompression(AssetRegistry::BC7, Bc::HIGH);
+        CHECK(odd && acquire(ODD) == odd && format(odd) == DXGI_FORMAT_R8G8B8A8_UNORM);
+
+        stats = assets.GetStats();
+        printf("Textures: %u resources, %.2f MB, %u shared requests saving %.2f MB\n", stats.resources, stats.bytes / (1024.0 * 1024.0),
+            stats.sharedRequests, stats.savedBytes / (1024.0 * 1024.0));
+        ThrowIfFailed(commandList->Close());
+    }
+}
+
+int main() {
+    const ComPtr<ID3D12Device> device = CreateDevice();
+    if (!device) {
+        printf("No D3D12 WARP device; skipped\n");
+        return Check::Exit();
+    }
+    TestBuffers(device);
+    TestTextures(device);
+    DeleteFileW(COPY);
+    DeleteFileW(ODD);
+    return Check::Exit();
+}
@@ -0,0 +1,70 @@
+// Encodes the bundled textures in every format at every quality, with each
+// implementation this CPU has, and prints the encode rate and the RGB PSNR
+// of the decoded result.
+//
+//   BcBench [threads]
+
+#include "Check.h"
+#include "Bc.h"
+#include "Bmp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+    const int REPEATS = 3;
+
+    double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        double squares = 0.0;
+        size_t count = 0;
+        for (size_t i = 0; i < a.size(); i += 4) {
+            for (int c = 0; c < 3; ++c) {
+                const double difference = double(a[i + c]) - b[i + c];
+                squares += difference * difference;
+                ++count;
+            }
+        }
+        return squares == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 * count / squares);
+    }
+
+    void Bench(const char* name, unsigned threadCount) {
+        Bmp::Image image;
+        if (!Bmp::Load(Check::Resource(name), image)) {
+            printf("%s: failed to load\n", name);
+            return;
+        }
+        printf("%s: %u x %u\n", name, image.width, image.height);
+        const double megapixels = double(image.width) * image.height / 1e6;
+        for (Bc::Format format : { Bc::BC1, Bc::BC3, Bc::BC7 }) {
+            for (Bc::Quality quality : { Bc::FAST, Bc::NORMAL, Bc::HIGH }) {
+                std::vector<uint8_t> blocks(Bc::EncodedBytes(format, image.width, image.height)), decoded(image.pixels.size());
+                printf("  %s %-6s", Bc::Name(format), Bc::Name(quality));
+                for (int implementation = Bc::SCALAR; implementation <= Bc::Fastest(); ++implementation) {
+                    double best = 0.0;
+                    for (int repeat = 0; repeat < REPEATS; ++repeat) {
+                        const auto start = std::chrono::steady_clock::now();
+                        Bc::Encode(format, quality, image.pixels.data(), image.width, image.height, blocks.data(), threadCount,
+                            Bc::Implementation(implementation));
+                        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        best = repeat == 0 || seconds < best ? seconds : best;
+                    }
+                    printf("  %s %7.2f MP/s", Bc::Name(Bc::Implementation(implementation)), megapixels / best);
+                }
+                Bc::Decode(format, blocks.data(), image.width, image.height, decoded.data());
+                printf("  PSNR %.2f dB\n", Psnr(image.pixels, decoded));
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const unsigned threadCount = argc > 1 ? static_cast<unsigned>(std::max(0, atoi(argv[1]))) : 1;
+    printf("%u thread(s), 0 = one per hardware thread\n", threadCount);
+    Bench("sphere.bmp", threadCount);
+    Bench("dodecahedron.bmp", threadCount);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "Check.h"
+#include "Bc.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    const Bc::Format FORMATS[] = { Bc::BC1, Bc::BC3, Bc::BC7 };
+    const Bc::Quality QUALITIES[] = { Bc::FAST, Bc::NORMAL, Bc::HIGH };
+
+    // Largest difference between any channel of a and b, or only their alpha
+    int WorstDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, bool alphaOnly = false) {
+        int worst = 0;
+        for (size_t i = alphaOnly ? 3 : 0; i < a.size(); i += alphaOnly ? 4 : 1) {
+            worst = std::max(worst, abs(int(a[i]) - int(b[i])));
+        }
+        return worst;
+    }
+
+    // Every implementation and thread count writes the blocks the scalar
+    // code does, byte for byte, at sizes with partial edge blocks and with
+    // mostly opaque pixels so every alpha mode is reached
+    void TestImplementations() {
+        std::mt19937 rng(1);
+        const uint32_t sizes[][2] = { { 1, 1 }, { 2, 3 }, { 5, 7 }, { 13, 4 }, { 64, 64 }, { 37, 71 } };
+        for (Bc::Format format : FORMATS) {
+            for (Bc::Quality quality : QUALITIES) {
+                bool identical = true;
+                for (const uint32_t* size : sizes) {
+                    std::vector<uint8_t> pixels(size_t(size[0]) * size[1] * 4);
+                    for (size_t i = 0; i < pixels.size(); ++i) {
+                        pixels[i] = i % 4 == 3 && rng() % 3 ? 255 : uint8_t(rng());
+                    }
+                    std::vector<uint8_t> scalar(Bc::EncodedBytes(format, size[0], size[1]));
+                    Bc::Encode(format, quality, pixels.data(), size[0], size[1], scalar.data(), 1, Bc::SCALAR);
+                    for (int implementation = Bc::SCALAR; implementation <= Bc::Fastest(); ++implementation) {
+                        std::vector<uint8_t> blocks(scalar.size());
+                        Bc::Encode(format, quality, pixels.data(), size[0], size[1], blocks.data(), 3, Bc::Implementation(implementation));
+                        identical = identical && blocks == scalar;
+                    }
+                }
+                printf("%s %s: %s\n", Bc::Name(format), Bc::Name(quality), identical ? "identical with every implementation" : "FAILED");
+                CHECK(identical);
+            }
+        }
+    }
+
+    // A block of one color decodes to within the endpoint precision of it:
+    // 7 bits plus a p-bit for BC7, interpolated RGB565 for BC3, and BC3's
+    // alpha exactly
+    void TestSolid() {
+        std::mt19937 rng(2);
+        int worstBc3 = 0, worstBc7 = 0, worstAlpha = 0;
+        for (int t = 0; t < 200; ++t) {
+            const uint8_t color[4] = { uint8_t(rng()), uint8_t(rng()), uint8_t(rng()), uint8_t(t % 2 ? 255 : rng()) };
+            std::vector<uint8_t> pixels(16 * 4);
+            for (int i = 0; i < 16; ++i) {
+                memcpy(&pixels[4 * i], color, 4);
+            }
+            for (Bc::Format format : { Bc::BC3, Bc::BC7 }) {
+                std::vector<uint8_t> blocks(Bc::BlockBytes(format)), decoded(pixels.size());
+                Bc::Encode(format, Bc::HIGH, pixels.data(), 4, 4, blocks.data(), 1);
+                Bc::Decode(format, blocks.data(), 4, 4, decoded.data());
+                int& worst = format == Bc::BC7 ? worstBc7 : worstBc3;
+                worst = std::max(worst, WorstDifference(pixels, decoded));
+                if (format == Bc::BC3) {
+                    worstAlpha = std::max(worstAlpha, WorstDifference(pixels, decoded, true));
+                }
+            }
+        }
+        printf("Solid blocks: worst difference %d for BC3, %d for BC7\n", worstBc3, worstBc7);
+        CHECK(worstBc3 <= 4);
+        CHECK(worstAlpha == 0);
+        CHECK(worstBc7 <= 1);
+    }
+
+    // BC3's 6-level alpha mode keeps a cutout's 0 and 255 exact, along with
+    // one value in between
+    void TestCutout() {
+        std::vector<uint8_t> pixels(16 * 4, 128);
+        for (int i = 0; i < 16; ++i) {
+            pixels[4 * i + 3] = i < 6 ? 0 : (i < 12 ? 255 : 100);
+        }
+        std::vector<uint8_t> blocks(Bc::BlockBytes(Bc::BC3)), decoded(pixels.size());
+        Bc::Encode(Bc::BC3, Bc::NORMAL, pixels.data(), 4, 4, blocks.data(), 1);
+        Bc::Decode(Bc::BC3, blocks.data(), 4, 4, decoded.data());
+        CHECK(WorstDifference(pixels, decoded, true) == 0);
+    }
+
+    void TestOpaque() {
+        std::vector<uint8_t> pixels(33 * 4, 255);
+        CHECK(Bc::IsOpaque(pixels.data(), 33));
+        pixels[32 * 4 + 3] = 254;
+        CHECK(!Bc::IsOpaque(pixels.data(), 33));
+        CHECK(Bc::IsOpaque(pixels.data(), 32));
+        CHECK(Bc::EncodedBytes(Bc::BC1, 5, 4) == 2 * 8 && Bc::EncodedBytes(Bc::BC7, 5, 5) == 4 * 16);
+    }
+}
+
+int main() {
+    TestImplementations();
+    TestSolid();
+    TestCutout();
+    TestOpaque();
+    return Check::Exit();
+}
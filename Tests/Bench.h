@@ -0,0 +1,136 @@
+#pragma once
+
+// Helpers shared by the benchmarks: best-of timing, the thread counts to
+// sweep, and meshes to run on. Assets the checkout only has as stubs, such as
+// sponza.obj, can be passed on the command line; generated grids stand in for
+// them otherwise.
+
+#include "Check.h"
+#include "Parallel.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Bench {
+    // Seconds the fastest of repeats calls to fn took
+    template <typename Fn>
+    double Seconds(int repeats, Fn fn) {
+        double best = 0.0;
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = repeat == 0 || seconds < best ? seconds : best;
+        }
+        return best;
+    }
+
+    // 1, 2, 4, ... up to and including the hardware thread count
+    inline std::vector<unsigned> ThreadCounts() {
+        const unsigned hardwareThreads = Parallel::DefaultThreadCount();
+        std::vector<unsigned> counts;
+        for (unsigned count = 1; count < hardwareThreads; count *= 2) {
+            counts.push_back(count);
+        }
+        counts.push_back(hardwareThreads);
+        return counts;
+    }
+
+    struct Mesh {
+        std::string name;
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::vector<uint32_t> indices;
+    };
+
+    // An OBJ's corners indexing its positions, with the tex coords of the
+    // last corner to use each position
+    inline bool LoadObj(const std::string& path, Mesh& mesh) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        const std::string baseDir = path.substr(0, path.find_last_of("\\/") + 1);
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), baseDir.c_str())) {
+            printf("%s: %s", path.c_str(), err.c_str());
+            return false;
+        }
+
+        mesh.name = path.substr(path.find_last_of("\\/") + 1);
+        mesh.positions = attrib.vertices;
+        mesh.texCoords.assign(attrib.vertices.size() / 3 * 2, 0.f);
+        mesh.indices.clear();
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                mesh.indices.push_back(index.vertex_index);
+                if (index.texcoord_index >= 0) {
+                    mesh.texCoords[2 * index.vertex_index] = attrib.texcoords[2 * index.texcoord_index];
+                    mesh.texCoords[2 * index.vertex_index + 1] = attrib.texcoords[2 * index.texcoord_index + 1];
+                }
+            }
+        }
+        return true;
+    }
+
+    // A wavy size x size quad grid, rows of triangles in order
+    inline Mesh Grid(int size) {
+        Mesh mesh;
+        mesh.name = "grid " + std::to_string(size) + "x" + std::to_string(size);
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                mesh.positions.insert(mesh.positions.end(), { x * 0.01f, y * 0.01f, 0.1f * sinf(x * 0.05f) * cosf(y * 0.07f) });
+                mesh.texCoords.insert(mesh.texCoords.end(), { x / float(size), y / float(size) });
+            }
+        }
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        return mesh;
+    }
+
+    // The bundled sphere, a grid of gridSize quads a side, and every OBJ named
+    // on the command line
+    inline std::vector<Mesh> Meshes(int argc, char** argv, int gridSize) {
+        std::vector<Mesh> meshes(1);
+        if (!LoadObj(Check::Resource("sphere.obj"), meshes[0])) {
+            meshes.clear();
+        }
+        meshes.push_back(Grid(gridSize));
+        for (int i = 1; i < argc; ++i) {
+            Mesh mesh;
+            if (LoadObj(argv[i], mesh)) {
+                meshes.push_back(mesh);
+            }
+        }
+        return meshes;
+    }
+
+    // Writes mesh as OBJ text with v, vt and f records, every corner
+    // referencing the position and tex coord of the same number. Returns the
+    // file size, or 0 if it couldn't be written.
+    inline size_t WriteObj(const char* path, const Mesh& mesh) {
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            return 0;
+        }
+        for (size_t v = 0; v < mesh.positions.size() / 3; ++v) {
+            fprintf(file, "v %.6f %.6f %.6f\n", mesh.positions[3 * v], mesh.positions[3 * v + 1], mesh.positions[3 * v + 2]);
+            fprintf(file, "vt %.6f %.6f\n", mesh.texCoords[2 * v], mesh.texCoords[2 * v + 1]);
+        }
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const uint32_t a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+            fprintf(file, "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+        }
+        const long bytes = ftell(file);
+        return fclose(file) == 0 && bytes > 0 ? size_t(bytes) : 0;
+    }
+}
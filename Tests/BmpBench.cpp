@@ -0,0 +1,109 @@
+// Decodes generated 4K bitmaps in the common uncompressed formats, the bundled
+// textures and any .bmp files named on the command line with each Bmp
+// implementation the CPU supports, and prints megapixels and MB of file per
+// second. Files are read into memory first, so only decoding is timed.
+//
+//   BmpBench [file.bmp ...]
+
+#include "Bench.h"
+#include "Bmp.h"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+    const int REPEATS = 3;
+    const uint32_t SIZE = 4096;
+
+    struct Input {
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+
+    void Put16(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(uint8_t(value));
+        out.push_back(uint8_t(value >> 8));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t value) {
+        Put16(out, value & 0xFFFF);
+        Put16(out, value >> 16);
+    }
+
+    // A bottom-up BITMAPINFOHEADER bitmap of random pixels, with a full
+    // palette when bits is 8
+    Input Generate(uint16_t bits) {
+        const uint32_t paletteBytes = bits == 8 ? 256 * 4 : 0;
+        const uint32_t pixelOffset = 14 + 40 + paletteBytes;
+        const uint32_t stride = (SIZE * bits + 31) / 32 * 4;
+
+        Input input;
+        input.name = std::to_string(SIZE) + "x" + std::to_string(SIZE) + " " + std::to_string(bits) + "-bit";
+        std::vector<uint8_t>& out = input.data;
+        out = { 'B', 'M' };
+        Put32(out, pixelOffset + stride * SIZE);
+        Put32(out, 0);
+        Put32(out, pixelOffset);
+        Put32(out, 40);
+        Put32(out, SIZE);
+        Put32(out, SIZE);
+        Put16(out, 1);
+        Put16(out, bits);
+        for (int field = 0; field < 6; ++field) {
+            Put32(out, 0);
+        }
+
+        std::mt19937 rng(bits);
+        out.resize(size_t(pixelOffset) + size_t(stride) * SIZE);
+        for (size_t i = 54; i < out.size(); ++i) {
+            out[i] = uint8_t(rng());
+        }
+        return input;
+    }
+
+    bool Read(const std::string& path, Input& input) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        input.data.resize(size_t(ftell(file)));
+        fseek(file, 0, SEEK_SET);
+        const bool read = fread(input.data.data(), 1, input.data.size(), file) == input.data.size();
+        fclose(file);
+        input.name = path.substr(path.find_last_of("\\/") + 1);
+        return read;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<Input> inputs = { Generate(8), Generate(24), Generate(32) };
+    std::vector<std::string> paths = { Check::Resource("sphere.bmp"), Check::Resource("dodecahedron.bmp") };
+    paths.insert(paths.end(), argv + 1, argv + argc);
+    for (const std::string& path : paths) {
+        Input input;
+        if (Read(path, input)) {
+            inputs.push_back(input);
+        } else {
+            printf("%s: can't be read\n", path.c_str());
+        }
+    }
+
+    for (const Input& input : inputs) {
+        printf("%s: %.2f MB\n", input.name.c_str(), input.data.size() / (1024.0 * 1024.0));
+        for (Bmp::Implementation implementation : { Bmp::SCALAR, Bmp::SSSE3, Bmp::AVX2 }) {
+            if (implementation > Bmp::Fastest()) {
+                break;
+            }
+            Bmp::Image image = {};
+            bool decoded = true;
+            const double seconds = Bench::Seconds(REPEATS, [&]() {
+                decoded = Bmp::Decode(input.data.data(), input.data.size(), image, implementation) && decoded;
+            });
+            const double pixels = double(image.width) * image.height;
+            printf("  %-6s %8.1f M pixels/s, %8.1f MB/s%s\n", Bmp::Name(implementation), pixels / seconds / 1e6,
+                input.data.size() / (1024.0 * 1024.0) / seconds, decoded ? "" : " (failed)");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "Check.h"
+#include "Bmp.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    const uint32_t CORE_HEADER_SIZE = 12;
+    const uint32_t INFO_HEADER_SIZE = 40;
+    const uint32_t V5_HEADER_SIZE = 124;
+
+    // How a generated bitmap is stored
+    struct Layout {
+        uint16_t bits;
+        uint32_t headerSize;
+        bool topDown;
+        // 32-bit only: BI_BITFIELDS with the channels in RGBA byte order,
+        // and an alpha mask if the header has room for one
+        bool bitfields;
+        // Palette entries the header declares, 0 for all of them
+        uint32_t paletteCount;
+    };
+
+    void Put16(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(uint8_t(value));
+        out.push_back(uint8_t(value >> 8));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t value) {
+        Put16(out, value & 0xFFFF);
+        Put16(out, value >> 16);
+    }
+
+    // A random bitmap in the given layout, and the RGBA8 pixels it should
+    // decode to, top row first
+    std::vector<uint8_t> Encode(const Layout& layout, uint32_t width, uint32_t height, std::mt19937& rng, std::vector<uint8_t>& expected) {
+        const bool palettized = layout.bits <= 8;
+        const uint32_t entries = palettized ? (layout.paletteCount ? layout.paletteCount : 1u << layout.bits) : 0;
+        const uint32_t entrySize = layout.headerSize == CORE_HEADER_SIZE ? 3 : 4;
+        const bool masks = layout.bitfields && layout.headerSize == INFO_HEADER_SIZE;
+        const bool alpha = layout.bitfields && layout.headerSize >= V5_HEADER_SIZE;
+        const uint32_t pixelOffset = 14 + layout.headerSize + (masks ? 12 : 0) + entries * entrySize;
+        const uint32_t stride = (width * layout.bits + 31) / 32 * 4;
+
+        std::vector<uint8_t> out = { 'B', 'M' };
+        Put32(out, pixelOffset + stride * height);
+        Put32(out, 0);
+        Put32(out, pixelOffset);
+        Put32(out, layout.headerSize);
+        if (layout.headerSize == CORE_HEADER_SIZE) {
+            Put16(out, width);
+            Put16(out, height);
+            Put16(out, 1);
+            Put16(out, layout.bits);
+        } else {
+            Put32(out, width);
+            Put32(out, layout.topDown ? uint32_t(-int32_t(height)) : height);
+            Put16(out, 1);
+            Put16(out, layout.bits);
+            Put32(out, layout.bitfields ? 3 : 0);
+            Put32(out, stride * height);
+            Put32(out, 2835);
+            Put32(out, 2835);
+            Put32(out, layout.paletteCount);
+            Put32(out, 0);
+            if (layout.bitfields) {
+                for (uint32_t mask : { 0x000000FFu, 0x0000FF00u, 0x00FF0000u }) {
+                    Put32(out, mask);
+                }
+                if (alpha) {
+                    Put32(out, 0xFF000000u);
+                }
+            }
+            out.resize(14 + layout.headerSize + (masks ? 12 : 0), 0);
+        }
+
+        std::vector<uint8_t> palette(4 * entries);
+        for (uint32_t i = 0; i < entries; ++i) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                palette[4 * i + c] = uint8_t(rng());
+            }
+            // Stored as BGR(X)
+            out.insert(out.end(), { palette[4 * i + 2], palette[4 * i + 1], palette[4 * i] });
+            if (entrySize == 4) {
+                out.push_back(uint8_t(rng()));
+            }
+        }
+
+        expected.assign(size_t(width) * height * 4, 0);
+        for (uint32_t row = 0; row < height; ++row) {
+            const uint32_t y = layout.topDown ? row : height - 1 - row;
+            uint8_t* pixels = &expected[size_t(y) * width * 4];
+            std::vector<uint8_t> bytes(stride, 0);
+            for (uint32_t x = 0; x < width; ++x) {
+                uint8_t* rgba = pixels + 4 * x;
+                if (palettized) {
+                    const uint32_t index = rng() % entries;
+                    const uint32_t bit = x * layout.bits;
+                    bytes[bit / 8] |= uint8_t(index << (8 - layout.bits - bit % 8));
+                    memcpy(rgba, &palette[4 * index], 3);
+                    rgba[3] = 0xFF;
+                    continue;
+                }
+                for (int c = 0; c < 4; ++c) {
+                    rgba[c] = uint8_t(rng());
+                }
+                uint8_t* stored = &bytes[x * layout.bits / 8];
+                if (layout.bitfields) {
+                    memcpy(stored, rgba, 4);
+                } else {
+                    stored[0] = rgba[2];
+                    stored[1] = rgba[1];
+                    stored[2] = rgba[0];
+                    if (layout.bits == 32) {
+                        stored[3] = rgba[3];
+                    }
+                }
+                if (!alpha) {
+                    rgba[3] = 0xFF;
+                }
+            }
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        }
+        return out;
+    }
+
+    const Layout LAYOUTS[] = {
+        { 1, INFO_HEADER_SIZE, false, false, 0 },
+        { 1, CORE_HEADER_SIZE, false, false, 0 },
+        { 4, INFO_HEADER_SIZE, true, false, 0 },
+        { 4, INFO_HEADER_SIZE, false, false, 11 },
+        { 8, INFO_HEADER_SIZE, false, false, 0 },
+        { 8, INFO_HEADER_SIZE, true, false, 200 },
+        { 8, CORE_HEADER_SIZE, false, false, 0 },
+        { 24, INFO_HEADER_SIZE, false, false, 0 },
+        { 24, INFO_HEADER_SIZE, true, false, 0 },
+        { 24, CORE_HEADER_SIZE, false, false, 0 },
+        { 32, INFO_HEADER_SIZE, false, false, 0 },
+        { 32, INFO_HEADER_SIZE, true, true, 0 },
+        { 32, V5_HEADER_SIZE, false, true, 0 },
+        { 32, V5_HEADER_SIZE, true, true, 0 },
+    };
+
+    // Every format at widths that leave partial SIMD groups and odd row
+    // padding decodes to the pixels it was written from, with every
+    // implementation
+    void TestFormats() {
+        std::mt19937 rng(1);
+        for (const Layout& layout : LAYOUTS) {
+            bool decoded = true, exact = true, unpadded = true, truncated = true;
+            for (uint32_t width : { 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 64, 67 }) {
+                const uint32_t height = 1 + width % 5;
+                std::vector<uint8_t> expected;
+                const std::vector<uint8_t> file = Encode(layout, width, height, rng, expected);
+                for (int implementation = Bmp::SCALAR; implementation <= Bmp::Fastest(); ++implementation) {
+                    Bmp::Image image;
+                    decoded = decoded && Bmp::Decode(file.data(), file.size(), image, Bmp::Implementation(implementation));
+                    exact = exact && image.width == width && image.height == height && image.pixels == expected;
+
+                    // The last row's padding may be missing, but no more
+                    const size_t padding = (width * layout.bits + 31) / 32 * 4 - (width * layout.bits + 7) / 8;
+                    unpadded = unpadded && Bmp::Decode(file.data(), file.size() - padding, image, Bmp::Implementation(implementation));
+                    truncated = truncated && !Bmp::Decode(file.data(), file.size() - padding - 1, image, Bmp::Implementation(implementation));
+                }
+            }
+            printf("%u-bit, %u-byte header%s%s: %s\n", layout.bits, layout.headerSize, layout.topDown ? ", top-down" : "",
+                layout.bitfields ? ", bitfields" : "", decoded && exact && unpadded && truncated ? "ok" : "FAILED");
+            CHECK(decoded);
+            CHECK(exact);
+            CHECK(unpadded);
+            CHECK(truncated);
+        }
+    }
+
+    // The bundled textures decode, identically with every implementation
+    void TestBundled(const char* name) {
+        Bmp::Image scalar;
+        if (!CHECK(Bmp::Load(Check::Resource(name), scalar, Bmp::SCALAR))) {
+            return;
+        }
+        printf("%s: %u x %u\n", name, scalar.width, scalar.height);
+        for (int implementation = Bmp::SSSE3; implementation <= Bmp::Fastest(); ++implementation) {
+            Bmp::Image image;
+            CHECK(Bmp::Load(Check::Resource(name), image, Bmp::Implementation(implementation)));
+            CHECK(image.width == scalar.width && image.height == scalar.height && image.pixels == scalar.pixels);
+        }
+    }
+
+    void TestRejected() {
+        std::mt19937 rng(2);
+        std::vector<uint8_t> expected;
+        const Layout layout = { 24, INFO_HEADER_SIZE, false, false, 0 };
+        const std::vector<uint8_t> file = Encode(layout, 4, 4, rng, expected);
+        Bmp::Image image;
+
+        std::vector<uint8_t> damaged = file;
+        damaged[0] = 'X';
+        CHECK(!Bmp::Decode(damaged.data(), damaged.size(), image));
+        // RLE compression
+        damaged = file;
+        damaged[14 + 16] = 1;
+        CHECK(!Bmp::Decode(damaged.data(), damaged.size(), image));
+        // 16-bit pixels
+        damaged = file;
+        damaged[14 + 14] = 16;
+        CHECK(!Bmp::Decode(damaged.data(), damaged.size(), image));
+        // Zero width
+        damaged = file;
+        memset(&damaged[14 + 4], 0, 4);
+        CHECK(!Bmp::Decode(damaged.data(), damaged.size(), image));
+        CHECK(!Bmp::Decode(file.data(), 20, image));
+    }
+}
+
+int main() {
+    TestFormats();
+    TestBundled("sphere.bmp");
+    TestBundled("dodecahedron.bmp");
+    TestRejected();
+    return Check::Exit();
+}
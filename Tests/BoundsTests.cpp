@@ -0,0 +1,134 @@
+#include "Check.h"
+#include "Bounds.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    enum Shape {
+        CUBE,
+        SPHERE_SURFACE,
+        // Nearly flat, so one axis barely contributes
+        SLAB,
+    };
+
+    // count positions positionStride bytes apart, starting offset bytes into
+    // the buffer, so they can sit at any float-aligned address
+    struct Positions {
+        std::vector<float> buffer;
+        size_t offset;
+        size_t stride;
+
+        const float* First() const {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(buffer.data()) + offset);
+        }
+
+        const float* operator[](size_t i) const {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(First()) + i * stride);
+        }
+    };
+
+    Positions RandomPositions(size_t count, size_t stride, size_t offset, Shape shape, std::mt19937& rng) {
+        std::uniform_real_distribution<float> coordinate(-5.f, 5.f);
+        Positions positions;
+        positions.offset = offset;
+        positions.stride = stride;
+        positions.buffer.assign((offset + count * stride) / sizeof(float) + 1, NAN);
+        for (size_t i = 0; i < count; ++i) {
+            float p[3] = { coordinate(rng), coordinate(rng), coordinate(rng) };
+            if (shape == SPHERE_SURFACE) {
+                const float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) + 1e-6f;
+                p[0] /= length;
+                p[1] /= length;
+                p[2] /= length;
+            } else if (shape == SLAB) {
+                p[1] *= 0.01f;
+            }
+            memcpy(const_cast<float*>(positions[i]), p, sizeof(p));
+        }
+        return positions;
+    }
+
+    // The box is exact and the sphere holds every point, allowing for
+    // rounding relative to its size
+    template <typename Fetch>
+    bool Encloses(Fetch fetch, size_t count, const Bounds::Volume& volume) {
+        float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        double worst = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            const float* p = fetch(i);
+            for (int axis = 0; axis < 3; ++axis) {
+                min[axis] = fminf(min[axis], p[axis]);
+                max[axis] = fmaxf(max[axis], p[axis]);
+            }
+            const double dx = p[0] - volume.center[0], dy = p[1] - volume.center[1], dz = p[2] - volume.center[2];
+            worst = fmax(worst, sqrt(dx * dx + dy * dy + dz * dz) - volume.radius);
+        }
+        if (count == 0) {
+            const Bounds::Volume zero = {};
+            return memcmp(&volume, &zero, sizeof(zero)) == 0;
+        }
+        return memcmp(min, volume.min, sizeof(min)) == 0 && memcmp(max, volume.max, sizeof(max)) == 0 && worst <= 1e-5 * fmax(1.0, volume.radius);
+    }
+
+    // Every count up to a few SIMD groups, for tightly packed positions and
+    // vertex-sized strides, including ones whose xy pairs aren't 8-byte
+    // aligned
+    void TestCompute() {
+        std::mt19937 rng(1);
+        bool sequential = true, indexed16 = true, indexed32 = true;
+        for (size_t stride : { 12, 16, 20, 32 }) {
+            for (size_t offset : { 0, 4 }) {
+                for (size_t count = 0; count < 100; ++count) {
+                    for (Shape shape : { CUBE, SPHERE_SURFACE, SLAB }) {
+                        const Positions positions = RandomPositions(count, stride, offset, shape, rng);
+                        Bounds::Volume volume;
+                        Bounds::Compute(positions.First(), count, stride, volume);
+                        sequential = sequential && Encloses([&](size_t i) { return positions[i]; }, count, volume);
+                        if (count == 0) {
+                            continue;
+                        }
+
+                        std::vector<uint16_t> indices16(2 * count);
+                        std::vector<uint32_t> indices32(2 * count);
+                        for (size_t i = 0; i < indices16.size(); ++i) {
+                            indices32[i] = indices16[i] = uint16_t(rng() % count);
+                        }
+                        Bounds::Compute(indices16.data(), indices16.size(), positions.First(), stride, volume);
+                        indexed16 = indexed16 && Encloses([&](size_t i) { return positions[indices16[i]]; }, indices16.size(), volume);
+                        Bounds::Compute(indices32.data(), indices32.size(), positions.First(), stride, volume);
+                        indexed32 = indexed32 && Encloses([&](size_t i) { return positions[indices32[i]]; }, indices32.size(), volume);
+                    }
+                }
+            }
+        }
+        CHECK(sequential);
+        CHECK(indexed16);
+        CHECK(indexed32);
+    }
+
+    // The sphere is never looser than the one around the box
+    void TestTightness() {
+        std::mt19937 rng(2);
+        bool tight = true;
+        for (Shape shape : { CUBE, SPHERE_SURFACE, SLAB }) {
+            const Positions positions = RandomPositions(10000, 32, 4, shape, rng);
+            Bounds::Volume volume;
+            Bounds::Compute(positions.First(), 10000, 32, volume);
+            const float dx = volume.max[0] - volume.min[0], dy = volume.max[1] - volume.min[1], dz = volume.max[2] - volume.min[2];
+            const float halfDiagonal = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz);
+            printf("Shape %d: radius %.4f, box half-diagonal %.4f\n", shape, volume.radius, halfDiagonal);
+            tight = tight && volume.radius <= halfDiagonal * (1.f + 1e-5f);
+        }
+        CHECK(tight);
+    }
+}
+
+int main() {
+    TestCompute();
+    TestTightness();
+    return Check::Exit();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Assertions shared by the test executables. A failed CHECK prints its
+// expression and location and the test carries on, so one run reports every
+// failure; main returns Check::Exit() so ctest sees the result.
+
+#include <cstdio>
+#include <string>
+
+namespace Check {
+    inline int& Failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    // Returns passed, so callers can print context when a check fails
+    inline bool Report(bool passed, const char* expression, const char* file, int line) {
+        if (!passed) {
+            ++Failures();
+            printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+        }
+        return passed;
+    }
+
+    inline int Exit() {
+        if (Failures()) {
+            printf("%d check(s) failed\n", Failures());
+            return 1;
+        }
+        printf("All checks passed\n");
+        return 0;
+    }
+
+    // Path of a file bundled in Renderer/Resources
+    inline std::string Resource(const char* name) {
+        return std::string(RESOURCES_DIR) + name;
+    }
+}
+
+#define CHECK(expression) Check::Report(!!(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,195 @@
+#include "Check.h"
+#include "Chunks.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+    const size_t POSITION_STRIDE = 3 * sizeof(float);
+
+    typedef std::array<uint32_t, 3> Triangle;
+
+    struct Mesh {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // A wavy size x size grid with its triangles shuffled, so every chunk has
+    // to be gathered from all over the index buffer
+    Mesh Grid(int size, std::mt19937& rng) {
+        Mesh mesh;
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                mesh.positions.insert(mesh.positions.end(), { x * 0.1f, 0.5f * sinf(x * 0.3f) * cosf(y * 0.2f), y * 0.1f });
+            }
+        }
+        std::vector<Triangle> triangles;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                triangles.push_back({ { a, c, b } });
+                triangles.push_back({ { b, c, d } });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        for (const Triangle& triangle : triangles) {
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+
+    Triangle TriangleAt(const std::vector<uint32_t>& indices, size_t t) {
+        return { { indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] } };
+    }
+
+    // Every triangle is in exactly one chunk, no chunk is over the target,
+    // the counts add up and each chunk's box holds its triangles
+    void TestPartition(const Mesh& mesh, size_t target) {
+        std::vector<uint32_t> triangleChunks;
+        std::vector<Chunks::Chunk> chunks;
+        Chunks::Partition(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), POSITION_STRIDE, target, triangleChunks, chunks);
+
+        const size_t triangleCount = mesh.indices.size() / 3;
+        printf("%zu triangles, target %zu: %zu chunks\n", triangleCount, target, chunks.size());
+        if (!CHECK(triangleChunks.size() == triangleCount) || !CHECK(!chunks.empty())) {
+            return;
+        }
+
+        std::vector<uint32_t> counts(chunks.size(), 0);
+        bool assigned = true, contained = true;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const uint32_t c = triangleChunks[t];
+            if (c >= chunks.size()) {
+                assigned = false;
+                continue;
+            }
+            ++counts[c];
+            for (int k = 0; k < 3; ++k) {
+                const float* p = &mesh.positions[3 * mesh.indices[3 * t + k]];
+                for (int axis = 0; axis < 3; ++axis) {
+                    contained = contained && p[axis] >= chunks[c].min[axis] && p[axis] <= chunks[c].max[axis];
+                }
+            }
+        }
+        CHECK(assigned);
+        CHECK(contained);
+
+        bool counted = true, withinTarget = true;
+        size_t total = 0;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            counted = counted && chunks[c].triangleCount == counts[c];
+            withinTarget = withinTarget && chunks[c].triangleCount > 0 && chunks[c].triangleCount <= std::max<size_t>(target, 1);
+            total += chunks[c].triangleCount;
+        }
+        CHECK(counted);
+        CHECK(withinTarget);
+        CHECK(total == triangleCount);
+        CHECK(triangleCount > std::max<size_t>(target, 1) || chunks.size() == 1);
+    }
+
+    // Splitting material ranges by chunk keeps every triangle inside its own
+    // range, makes each piece a single chunk, and covers each range exactly
+    void TestSplit(const Mesh& mesh, size_t target, size_t materialCount) {
+        std::vector<uint32_t> triangleChunks;
+        std::vector<Chunks::Chunk> chunks;
+        Chunks::Partition(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), POSITION_STRIDE, target, triangleChunks, chunks);
+
+        // Contiguous runs of uneven length, each spread over the whole grid
+        const size_t triangleCount = mesh.indices.size() / 3;
+        std::vector<Chunks::Range> ranges;
+        uint32_t start = 0;
+        for (size_t m = 0; m < materialCount; ++m) {
+            const size_t share = triangleCount * (m + 1) * (m + 2) / (materialCount * (materialCount + 1));
+            const uint32_t end = uint32_t(m + 1 == materialCount ? triangleCount : share);
+            ranges.push_back({ 3 * start, 3 * (end - start) });
+            start = end;
+        }
+
+        std::map<Triangle, uint32_t> chunkOf;
+        std::vector<std::vector<Triangle>> before(materialCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            chunkOf[TriangleAt(mesh.indices, t)] = triangleChunks[t];
+        }
+        for (size_t m = 0; m < materialCount; ++m) {
+            for (uint32_t t = ranges[m].indexStart / 3; t < (ranges[m].indexStart + ranges[m].indexCount) / 3; ++t) {
+                before[m].push_back(TriangleAt(mesh.indices, t));
+            }
+            std::sort(before[m].begin(), before[m].end());
+        }
+
+        std::vector<uint32_t> indices = mesh.indices;
+        std::vector<Chunks::Piece> pieces;
+        Chunks::Split(indices.data(), ranges.data(), ranges.size(), triangleChunks, chunks.size(), pieces);
+        printf("%zu materials over %zu chunks: %zu pieces\n", materialCount, chunks.size(), pieces.size());
+
+        bool kept = true, ordered = true, covered = true, singleChunk = true;
+        for (size_t m = 0; m < materialCount; ++m) {
+            std::vector<Triangle> after;
+            for (uint32_t t = ranges[m].indexStart / 3; t < (ranges[m].indexStart + ranges[m].indexCount) / 3; ++t) {
+                after.push_back(TriangleAt(indices, t));
+            }
+            std::sort(after.begin(), after.end());
+            kept = kept && after == before[m];
+        }
+
+        uint32_t next = 0;
+        for (size_t p = 0; p < pieces.size(); ++p) {
+            const Chunks::Piece& piece = pieces[p];
+            const Chunks::Range& range = ranges[piece.range];
+            if (p > 0) {
+                const Chunks::Piece& previous = pieces[p - 1];
+                ordered = ordered && (previous.range < piece.range || (previous.range == piece.range && previous.chunk < piece.chunk));
+            }
+            if (p == 0 || pieces[p - 1].range != piece.range) {
+                covered = covered && piece.indexStart == range.indexStart;
+            } else {
+                covered = covered && piece.indexStart == next;
+            }
+            next = piece.indexStart + piece.indexCount;
+            if (p + 1 == pieces.size() || pieces[p + 1].range != piece.range) {
+                covered = covered && next == range.indexStart + range.indexCount;
+            }
+            covered = covered && piece.indexCount > 0 && piece.indexCount % 3 == 0;
+
+            for (uint32_t t = piece.indexStart / 3; t < (piece.indexStart + piece.indexCount) / 3; ++t) {
+                singleChunk = singleChunk && chunkOf[TriangleAt(indices, t)] == piece.chunk;
+            }
+        }
+        CHECK(kept);
+        CHECK(ordered);
+        CHECK(covered);
+        CHECK(singleChunk);
+    }
+
+    void TestEmpty() {
+        std::vector<uint32_t> triangleChunks(5, 7);
+        std::vector<Chunks::Chunk> chunks(2);
+        const float position[3] = {};
+        Chunks::Partition(nullptr, 0, position, POSITION_STRIDE, 100, triangleChunks, chunks);
+        CHECK(triangleChunks.empty());
+        CHECK(chunks.empty());
+    }
+}
+
+int main() {
+    std::mt19937 rng(5);
+    const Mesh small = Grid(4, rng);
+    const Mesh large = Grid(60, rng);
+
+    for (size_t target : { 0, 1, 7, 32, 1000 }) {
+        TestPartition(small, target);
+    }
+    for (size_t target : { 64, 500, 4096, 100000 }) {
+        TestPartition(large, target);
+    }
+    TestSplit(large, 500, 1);
+    TestSplit(large, 500, 4);
+    TestSplit(large, 64, 9);
+    TestSplit(small, 1000, 3);
+    TestEmpty();
+    return Check::Exit();
+}
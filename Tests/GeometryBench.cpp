@@ -0,0 +1,57 @@
+// Times face normals, smooth normals and tangents for the sphere, a large
+// generated grid and any OBJs named on the command line, at every kernel width
+// the CPU supports and 1, 2, 4, ... hardware threads, and prints millions of
+// triangles per second.
+//
+//   GeometryBench [file.obj ...]
+
+#include "Bench.h"
+#include "Geometry.h"
+
+#include <cstdio>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 1000;
+
+    // Position and tex coord interleaved, as Tangents reads them
+    const size_t STRIDE = 5 * sizeof(float);
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        const size_t vertexCount = mesh.positions.size() / 3;
+        const double triangles = double(mesh.indices.size() / 3);
+        std::vector<float> vertices(vertexCount * 5);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            std::copy(&mesh.positions[3 * v], &mesh.positions[3 * v] + 3, &vertices[5 * v]);
+            std::copy(&mesh.texCoords[2 * v], &mesh.texCoords[2 * v] + 2, &vertices[5 * v + 3]);
+        }
+        printf("%s: %zu vertices, %.0f triangles\n", mesh.name.c_str(), vertexCount, triangles);
+
+        Geometry::Vectors normals;
+        Geometry::SmoothNormals(mesh.indices.data(), mesh.indices.size(), vertices.data(), vertexCount, STRIDE, normals);
+        for (Geometry::Width width : { Geometry::SCALAR, Geometry::SSE2, Geometry::AVX2 }) {
+            if (width > Geometry::BestWidth()) {
+                break;
+            }
+            for (unsigned threads : Bench::ThreadCounts()) {
+                Geometry::Vectors faceNormals, smoothNormals, tangents;
+                std::vector<float> signs;
+                const double face = Bench::Seconds(REPEATS, [&]() {
+                    Geometry::FaceNormals(mesh.indices.data(), mesh.indices.size(), vertices.data(), vertexCount, STRIDE, faceNormals, width, threads);
+                });
+                const double smooth = Bench::Seconds(REPEATS, [&]() {
+                    Geometry::SmoothNormals(mesh.indices.data(), mesh.indices.size(), vertices.data(), vertexCount, STRIDE, smoothNormals, width, threads);
+                });
+                const double tangent = Bench::Seconds(REPEATS, [&]() {
+                    Geometry::Tangents(mesh.indices.data(), mesh.indices.size(), vertices.data(), vertices.data() + 3, vertexCount, STRIDE, normals,
+                        tangents, signs, width, threads);
+                });
+                printf("  %-6s %2u threads: face normals %8.1f, smooth normals %8.1f, tangents %8.1f M triangles/s\n", Geometry::Name(width),
+                    threads, triangles / face / 1e6, triangles / smooth / 1e6, triangles / tangent / 1e6);
+            }
+        }
+    }
+    return 0;
+}
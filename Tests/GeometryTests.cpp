@@ -0,0 +1,156 @@
+#include "Check.h"
+#include "Geometry.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    struct PositionTexCoord {
+        float position[3];
+        float texCoord[2];
+    };
+
+    struct Mesh {
+        std::vector<PositionTexCoord> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // A wavy size x size grid with its tex coords mirrored along the middle
+    // column, so some triangles flip the tangent sign, and an unused vertex
+    // at the end
+    Mesh Grid(int size) {
+        Mesh mesh;
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                const float u = fabsf(x - size * 0.5f) / size;
+                const PositionTexCoord vertex = { { x * 0.1f, y * 0.1f, 0.3f * sinf(x * 0.4f) * cosf(y * 0.3f) }, { u, y / float(size) } };
+                mesh.vertices.push_back(vertex);
+            }
+        }
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        mesh.vertices.push_back(mesh.vertices.back());
+        return mesh;
+    }
+
+    // A bundled mesh's corners, unwelded, as ObjLoader sees them
+    Mesh Corners(const char* name) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        Mesh mesh;
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource(name).c_str(), RESOURCES_DIR))) {
+            return mesh;
+        }
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                PositionTexCoord vertex = {};
+                for (int k = 0; k < 3; ++k) {
+                    vertex.position[k] = attrib.vertices[3 * index.vertex_index + k];
+                }
+                if (index.texcoord_index >= 0) {
+                    vertex.texCoord[0] = attrib.texcoords[2 * index.texcoord_index];
+                    vertex.texCoord[1] = attrib.texcoords[2 * index.texcoord_index + 1];
+                }
+                mesh.vertices.push_back(vertex);
+            }
+        }
+        return mesh;
+    }
+
+    struct Results {
+        Geometry::Vectors faceNormals;
+        Geometry::Vectors normals;
+        Geometry::Vectors tangents;
+        std::vector<float> signs;
+    };
+
+    Results Compute(const Mesh& mesh, bool indexed, Geometry::Width width, unsigned threadCount) {
+        const uint32_t* indices = indexed ? mesh.indices.data() : nullptr;
+        const size_t indexCount = indexed ? mesh.indices.size() : mesh.vertices.size() / 3 * 3;
+        const float* positions = mesh.vertices[0].position;
+        const float* texCoords = mesh.vertices[0].texCoord;
+        const size_t stride = sizeof(PositionTexCoord);
+
+        Results results;
+        Geometry::FaceNormals(indices, indexCount, positions, mesh.vertices.size(), stride, results.faceNormals, width, threadCount);
+        Geometry::SmoothNormals(indices, indexCount, positions, mesh.vertices.size(), stride, results.normals, width, threadCount);
+        Geometry::Tangents(indices, indexCount, positions, texCoords, mesh.vertices.size(), stride, results.normals, results.tangents, results.signs,
+            width, threadCount);
+        return results;
+    }
+
+    // Normals and tangents are unit length or zero, tangents are orthogonal
+    // to their normals, and signs are +-1
+    bool IsOrthonormal(const Results& results) {
+        bool valid = true;
+        for (size_t i = 0; i < results.normals.x.size(); ++i) {
+            const float n[3] = { results.normals.x[i], results.normals.y[i], results.normals.z[i] };
+            const float t[3] = { results.tangents.x[i], results.tangents.y[i], results.tangents.z[i] };
+            const float normalLength = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const float tangentLength = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+            if (normalLength == 0.f) {
+                valid = valid && tangentLength == 0.f;
+                continue;
+            }
+            valid = valid && fabsf(normalLength - 1.f) < 1e-5f && fabsf(tangentLength - 1.f) < 1e-5f;
+            valid = valid && fabsf(n[0] * t[0] + n[1] * t[1] + n[2] * t[2]) < 1e-5f;
+            valid = valid && (results.signs[i] == 1.f || results.signs[i] == -1.f);
+        }
+        return valid;
+    }
+
+    float MaxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+        float difference = a.size() == b.size() ? 0.f : INFINITY;
+        for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+            difference = fmaxf(difference, fabsf(a[i] - b[i]));
+        }
+        return difference;
+    }
+
+    // Every width and thread count does the scalar arithmetic, so their
+    // results must match it exactly
+    void TestWidths(const char* name, const Mesh& mesh, bool indexed) {
+        const Results scalar = Compute(mesh, indexed, Geometry::SCALAR, 1);
+        CHECK(IsOrthonormal(scalar));
+        for (Geometry::Width width : { Geometry::SCALAR, Geometry::SSE2, Geometry::AVX2 }) {
+            if (width > Geometry::BestWidth()) {
+                continue;
+            }
+            for (unsigned threadCount : { 1, 3 }) {
+                const Results results = Compute(mesh, indexed, width, threadCount);
+                const float difference = std::max({ Geometry::MaxDifference(results.faceNormals, scalar.faceNormals),
+                    Geometry::MaxDifference(results.normals, scalar.normals), Geometry::MaxDifference(results.tangents, scalar.tangents),
+                    MaxDifference(results.signs, scalar.signs) });
+                printf("%s%s, %s, %u threads: largest difference from scalar %g\n", name, indexed ? "" : " (unindexed)", Geometry::Name(width),
+                    threadCount, difference);
+                CHECK(difference == 0.f);
+            }
+        }
+    }
+}
+
+int main() {
+    // Counts that leave a partial SIMD group at the end
+    TestWidths("Grid", Grid(37), true);
+    TestWidths("sphere.obj", Corners("sphere.obj"), false);
+    TestWidths("dodecahedron.obj", Corners("dodecahedron.obj"), false);
+
+    // MaxDifference itself
+    Geometry::Vectors a, b;
+    a.x = { 1.f, 2.f };
+    a.y = { 0.f, 0.f };
+    a.z = { -1.f, 5.f };
+    b = a;
+    CHECK(Geometry::MaxDifference(a, b) == 0.f);
+    b.z[1] = 5.25f;
+    CHECK(Geometry::MaxDifference(a, b) == 0.25f);
+    return Check::Exit();
+}
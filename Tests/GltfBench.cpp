@@ -0,0 +1,141 @@
+// Writes the sphere, a generated grid and any OBJs named on the command line
+// both as OBJ text and as GLB, then times getting positions, tex coords and
+// indices out of each: ObjParser on every hardware thread with the fastest
+// SIMD numbers, and Gltf::Open plus a copy out of its accessors.
+//
+//   GltfBench [file.obj ...]
+
+#include "Bench.h"
+#include "Gltf.h"
+#include "ObjParser.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 500;
+
+    const char* OBJ_PATH = "GltfBench.obj";
+    const char* GLB_PATH = "GltfBench.glb";
+
+    double Megabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    void Append(std::string& bytes, const void* data, size_t size) {
+        bytes.append(static_cast<const char*>(data), size);
+    }
+
+    void AppendU32(std::string& bytes, uint32_t value) {
+        Append(bytes, &value, sizeof(value));
+    }
+
+    // One mesh with one primitive: positions, tex coords and 32-bit indices
+    // in three buffer views of the BIN chunk. Returns the file size, or 0 if
+    // it couldn't be written.
+    size_t WriteGlb(const char* path, const Bench::Mesh& mesh) {
+        const size_t vertexCount = mesh.positions.size() / 3;
+        const size_t positionBytes = mesh.positions.size() * sizeof(float);
+        const size_t texCoordBytes = mesh.texCoords.size() * sizeof(float);
+        const size_t indexBytes = mesh.indices.size() * sizeof(uint32_t);
+        std::string bin;
+        Append(bin, mesh.positions.data(), positionBytes);
+        Append(bin, mesh.texCoords.data(), texCoordBytes);
+        Append(bin, mesh.indices.data(), indexBytes);
+
+        float min[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+        float max[3] = { min[0], min[1], min[2] };
+        for (size_t i = 0; i < mesh.positions.size(); ++i) {
+            min[i % 3] = std::min(min[i % 3], mesh.positions[i]);
+            max[i % 3] = std::max(max[i % 3], mesh.positions[i]);
+        }
+
+        char json[2048];
+        snprintf(json, sizeof(json),
+            "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}],"
+            "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]},"
+            "{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+            "{\"bufferView\":2,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+            "\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+            "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+            "\"buffers\":[{\"byteLength\":%zu}]}",
+            vertexCount, min[0], min[1], min[2], max[0], max[1], max[2], vertexCount, mesh.indices.size(), positionBytes, positionBytes,
+            texCoordBytes, positionBytes + texCoordBytes, indexBytes, bin.size());
+        std::string jsonChunk = json;
+        jsonChunk.append((4 - jsonChunk.size() % 4) % 4, ' ');
+        bin.append((4 - bin.size() % 4) % 4, '\0');
+
+        std::string glb;
+        AppendU32(glb, 0x46546C67);
+        AppendU32(glb, 2);
+        AppendU32(glb, uint32_t(12 + 8 + jsonChunk.size() + 8 + bin.size()));
+        AppendU32(glb, uint32_t(jsonChunk.size()));
+        AppendU32(glb, 0x4E4F534A);
+        glb += jsonChunk;
+        AppendU32(glb, uint32_t(bin.size()));
+        AppendU32(glb, 0x004E4942);
+        glb += bin;
+
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            return 0;
+        }
+        const bool written = fwrite(glb.data(), 1, glb.size(), file) == glb.size();
+        return fclose(file) == 0 && written ? glb.size() : 0;
+    }
+
+    // The primitive's vertices as position and tex coord, and its indices
+    bool LoadGlb(std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+        Gltf gltf;
+        std::string warn, err;
+        if (!gltf.Open(GLB_PATH, &warn, &err) || gltf.Meshes().empty() || gltf.Meshes()[0].primitives.empty()) {
+            return false;
+        }
+        const Gltf::Primitive& primitive = gltf.Meshes()[0].primitives[0];
+        const Gltf::Accessor& positions = gltf.Accessors()[primitive.position];
+        const Gltf::Accessor& texCoords = gltf.Accessors()[primitive.texCoord];
+        const Gltf::Accessor& source = gltf.Accessors()[primitive.indices];
+        vertices.resize(positions.count * 5);
+        for (size_t v = 0; v < positions.count; ++v) {
+            memcpy(&vertices[5 * v], positions.data + v * positions.stride, 3 * sizeof(float));
+            memcpy(&vertices[5 * v + 3], texCoords.data + v * texCoords.stride, 2 * sizeof(float));
+        }
+        indices.resize(source.count);
+        memcpy(indices.data(), source.data, source.count * sizeof(uint32_t));
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        const size_t objBytes = Bench::WriteObj(OBJ_PATH, mesh);
+        const size_t glbBytes = WriteGlb(GLB_PATH, mesh);
+        if (!objBytes || !glbBytes) {
+            printf("%s: can't write the OBJ or GLB\n", mesh.name.c_str());
+            continue;
+        }
+        printf("%s: %zu triangles, OBJ %.2f MB, GLB %.2f MB\n", mesh.name.c_str(), mesh.indices.size() / 3, Megabytes(objBytes), Megabytes(glbBytes));
+
+        const double obj = Bench::Seconds(REPEATS, [&]() {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            ObjParser::Parse(OBJ_PATH, &attrib, &shapes, &materials, &warn, &err, "", true, 0, NumberParser::Fastest());
+        });
+        bool loaded = true;
+        const double glb = Bench::Seconds(REPEATS, [&]() {
+            std::vector<float> vertices;
+            std::vector<uint32_t> indices;
+            loaded = LoadGlb(vertices, indices) && loaded;
+        });
+        printf("  OBJ %8.2f ms (%7.1f MB/s), GLB %8.2f ms (%7.1f MB/s)%s, GLB %.1fx faster\n", obj * 1000.0, Megabytes(objBytes) / obj, glb * 1000.0,
+            Megabytes(glbBytes) / glb, loaded ? "" : " (failed)", obj / glb);
+    }
+
+    remove(OBJ_PATH);
+    remove(GLB_PATH);
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "Check.h"
+#include "Gltf.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    const char* PATH = "GltfTests.glb";
+
+    const uint32_t MAGIC = 0x46546C67;
+    const uint32_t CHUNK_JSON = 0x4E4F534A;
+    const uint32_t CHUNK_BIN = 0x004E4942;
+
+    void Put32(std::string& out, uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void PutChunk(std::string& out, uint32_t type, std::string data, char padding) {
+        data.append((4 - data.size() % 4) % 4, padding);
+        Put32(out, uint32_t(data.size()));
+        Put32(out, type);
+        out += data;
+    }
+
+    // A GLB with the given JSON and, unless bin is empty, a BIN chunk
+    std::string Glb(const std::string& json, const std::string& bin, uint32_t version = 2) {
+        std::string chunks;
+        PutChunk(chunks, CHUNK_JSON, json, ' ');
+        if (!bin.empty()) {
+            PutChunk(chunks, CHUNK_BIN, bin, '\0');
+        }
+        std::string out;
+        Put32(out, MAGIC);
+        Put32(out, version);
+        Put32(out, uint32_t(12 + chunks.size()));
+        return out + chunks;
+    }
+
+    bool Open(const std::string& contents, Gltf& gltf, std::string& warn, std::string& err) {
+        FILE* file = fopen(PATH, "wb");
+        if (!file) {
+            return false;
+        }
+        fwrite(contents.data(), 1, contents.size(), file);
+        fclose(file);
+        warn.clear();
+        err.clear();
+        return gltf.Open(PATH, &warn, &err);
+    }
+
+    template <typename T>
+    void Put(std::string& bin, const std::vector<T>& values) {
+        bin.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // A quad with positions and normals interleaved in one buffer view, tex
+    // coords in a second and 16-bit indices in a third
+    std::string QuadBin() {
+        std::string bin;
+        Put(bin, std::vector<float>{
+            0.f, 0.f, 0.f, 0.f, 0.f, -1.f,
+            1.f, 0.f, 0.f, 0.f, 0.f, -1.f,
+            0.f, 1.f, 0.f, 0.f, 0.f, -1.f,
+            1.f, 1.f, 0.f, 0.f, 0.f, -1.f,
+        });
+        Put(bin, std::vector<float>{ 0.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, 0.f });
+        Put(bin, std::vector<uint16_t>{ 0, 2, 1, 1, 2, 3 });
+        return bin;
+    }
+
+    const char* QUAD_JSON = R"({
+        "asset": { "version": "2.0" },
+        "scene": 0,
+        "scenes": [ { "nodes": [ 0 ] } ],
+        "nodes": [
+            { "children": [ 1 ], "translation": [ 1, 2, 3 ] },
+            { "mesh": 0, "scale": [ 2, 2, 2 ] }
+        ],
+        "meshes": [ { "name": "quad", "primitives": [
+            { "attributes": { "POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2 }, "indices": 3, "material": 0 },
+            { "attributes": { "POSITION": 0 }, "mode": 1 }
+        ] } ],
+        "materials": [ { "name": "red", "pbrMetallicRoughness": { "baseColorFactor": [ 1, 0, 0, 0.5 ], "baseColorTexture": { "index": 0 } } } ],
+        "textures": [ { "source": 0 } ],
+        "images": [ { "uri": "red%20brick.bmp" } ],
+        "accessors": [
+            { "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3", "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] },
+            { "bufferView": 0, "byteOffset": 12, "componentType": 5126, "count": 4, "type": "VEC3" },
+            { "bufferView": 1, "componentType": 5126, "count": 4, "type": "VEC2" },
+            { "bufferView": 2, "componentType": 5123, "count": 6, "type": "SCALAR" }
+        ],
+        "bufferViews": [
+            { "buffer": 0, "byteLength": 96, "byteStride": 24 },
+            { "buffer": 0, "byteOffset": 96, "byteLength": 32 },
+            { "buffer": 0, "byteOffset": 128, "byteLength": 12 }
+        ],
+        "buffers": [ { "byteLength": 140 } ]
+    })";
+
+    float Component(const Gltf::Accessor& accessor, size_t e, int c) {
+        float value;
+        memcpy(&value, accessor.data + e * accessor.stride + c * sizeof(float), sizeof(value));
+        return value;
+    }
+
+    // Strided accessors into the BIN chunk, materials and the node transforms
+    void TestQuad() {
+        Gltf gltf;
+        std::string warn, err;
+        if (!CHECK(Open(Glb(QUAD_JSON, QuadBin()), gltf, warn, err))) {
+            printf("%s", err.c_str());
+            return;
+        }
+
+        const std::vector<Gltf::Accessor>& accessors = gltf.Accessors();
+        if (!CHECK(accessors.size() == 4) || !CHECK(accessors[0].data && accessors[1].data && accessors[2].data && accessors[3].data)) {
+            return;
+        }
+        CHECK(accessors[0].stride == 24 && accessors[1].stride == 24);
+        CHECK(accessors[1].data == accessors[0].data + 12);
+        CHECK(accessors[2].stride == 8 && accessors[3].stride == 2);
+        CHECK(accessors[0].hasBounds && accessors[0].max[0] == 1.f && accessors[0].max[2] == 0.f);
+        CHECK(!accessors[1].hasBounds);
+        CHECK(Component(accessors[0], 3, 0) == 1.f && Component(accessors[0], 3, 1) == 1.f);
+        CHECK(Component(accessors[1], 2, 2) == -1.f);
+        CHECK(Component(accessors[2], 1, 0) == 1.f && Component(accessors[2], 1, 1) == 1.f);
+        uint16_t indices[6];
+        memcpy(indices, accessors[3].data, sizeof(indices));
+        CHECK(indices[1] == 2 && indices[5] == 3);
+
+        // The line primitive is dropped with a warning
+        if (CHECK(gltf.Meshes().size() == 1) && CHECK(gltf.Meshes()[0].primitives.size() == 1)) {
+            const Gltf::Primitive& primitive = gltf.Meshes()[0].primitives[0];
+            CHECK(gltf.Meshes()[0].name == "quad");
+            CHECK(primitive.position == 0 && primitive.normal == 1 && primitive.texCoord == 2 && primitive.indices == 3 && primitive.material == 0);
+        }
+        CHECK(warn.find("triangle list") != std::string::npos);
+
+        if (CHECK(gltf.Materials().size() == 1)) {
+            const Gltf::Material& material = gltf.Materials()[0];
+            CHECK(material.name == "red");
+            CHECK(material.baseColor[0] == 1.f && material.baseColor[1] == 0.f && material.baseColor[3] == 0.5f);
+            CHECK(material.baseColorTexture == "red brick.bmp");
+        }
+
+        // Scaled by the child, then translated by the parent
+        if (CHECK(gltf.Instances().size() == 1)) {
+            const float* model = gltf.Instances()[0].model;
+            CHECK(gltf.Instances()[0].mesh == 0);
+            CHECK(model[0] == 2.f && model[5] == 2.f && model[10] == 2.f && model[15] == 1.f);
+            CHECK(model[12] == 1.f && model[13] == 2.f && model[14] == 3.f);
+        }
+
+        CHECK(gltf.GetStats().binBytes == 140);
+    }
+
+    // Replaces the first occurrence of from in the quad's JSON
+    std::string QuadWith(const std::string& from, const std::string& to) {
+        std::string json = QUAD_JSON;
+        const size_t at = json.find(from);
+        CHECK(at != std::string::npos);
+        return at == std::string::npos ? json : json.replace(at, from.size(), to);
+    }
+
+    // Accessors that don't fit their view, and sparse ones, have no data, and
+    // a primitive whose positions or indices are unusable is dropped
+    void TestUnusableAccessors() {
+        const std::string cases[] = {
+            // One element too many for the interleaved view
+            QuadWith(R"("count": 4, "type": "VEC3", "min")", R"("count": 5, "type": "VEC3", "min")"),
+            // Runs past the end of the view
+            QuadWith(R"("byteOffset": 12, "componentType": 5126, "count": 4)", R"("byteOffset": 88, "componentType": 5126, "count": 4)"),
+            // Index view past the end of the BIN chunk
+            QuadWith(R"("byteOffset": 128, "byteLength": 12)", R"("byteOffset": 132, "byteLength": 12)"),
+            // Sparse indices
+            QuadWith(R"("count": 6, "type": "SCALAR")", R"("count": 6, "type": "SCALAR", "sparse": { "count": 1 })"),
+        };
+        const bool positionsUnusable[] = { true, false, false, false };
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+            Gltf gltf;
+            std::string warn, err;
+            if (!CHECK(Open(Glb(cases[i], QuadBin()), gltf, warn, err))) {
+                printf("case %zu: %s", i, err.c_str());
+                continue;
+            }
+            const std::vector<Gltf::Accessor>& accessors = gltf.Accessors();
+            const bool normalsUnusable = i == 1;
+            CHECK((accessors[0].data == nullptr) == positionsUnusable[i]);
+            CHECK((accessors[1].data == nullptr) == normalsUnusable);
+            if (normalsUnusable) {
+                // Optional attributes are dropped, not the primitive
+                CHECK(gltf.Meshes()[0].primitives.size() == 1 && gltf.Meshes()[0].primitives[0].normal == -1);
+            } else {
+                CHECK(gltf.Meshes()[0].primitives.empty());
+                CHECK(warn.find("unusable positions or indices") != std::string::npos);
+            }
+        }
+    }
+
+    // Files that aren't valid GLB or whose JSON doesn't parse fail to open
+    // with an error
+    void TestRejected() {
+        std::string truncated = Glb(QUAD_JSON, QuadBin());
+        truncated.resize(truncated.size() - 8);
+
+        std::string badMagic = Glb(QUAD_JSON, QuadBin());
+        badMagic[0] = 'X';
+
+        const std::string cases[] = {
+            Glb(R"({ "asset": { "version": "2.0" }, )", ""),
+            Glb(R"({ "asset": { "version": "2.0" } "meshes": [] })", ""),
+            Glb(R"({ "asset": { "version": "2.0" }, "meshes": [ } ])", ""),
+            Glb(R"({ "asset": { "version": "2.0", "generator": "unterminated } })", ""),
+            Glb(R"({ "asset": { "version": 2.0e } })", ""),
+            Glb(R"({ "asset": { "version": "2.0" } } trailing)", ""),
+            Glb(R"([ "not", "an", "object" ])", ""),
+            Glb(R"({ "asset": { "version": "1.0" } })", ""),
+            Glb(R"({ "meshes": [] })", ""),
+            Glb(QUAD_JSON, QuadBin(), 1),
+            truncated,
+            badMagic,
+            std::string("glTF"),
+        };
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+            Gltf gltf;
+            std::string warn, err;
+            CHECK(!Open(cases[i], gltf, warn, err));
+            if (!CHECK(!err.empty())) {
+                printf("case %zu was accepted\n", i);
+            }
+        }
+
+        Gltf gltf;
+        std::string warn, err;
+        CHECK(!gltf.Open("missing.glb", &warn, &err) && !err.empty());
+    }
+}
+
+int main() {
+    TestQuad();
+    TestUnusableAccessors();
+    TestRejected();
+    remove(PATH);
+    return Check::Exit();
+}
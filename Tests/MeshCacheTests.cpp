@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "Check.h"
+#include "MeshCache.h"
+#include "Primitives.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+    constexpr auto icosphere = Primitives::Icosphere<2>();
+
+    const char* SOURCE = "MeshCacheTests.obj";
+    const UINT BUILD_FLAGS = 0x5;
+
+    std::vector<char> ReadFile(const std::string& fname) {
+        std::ifstream file(fname, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // The cache only fingerprints the source, so any bytes stand in for an OBJ
+    void WriteSource(const char* contents) {
+        std::ofstream file(SOURCE, std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+
+    // Moves the source's last write time by seconds without changing it
+    bool Touch(int seconds) {
+        HANDLE file = CreateFileA(SOURCE, FILE_WRITE_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        FILETIME time;
+        bool touched = GetFileTime(file, nullptr, nullptr, &time) != 0;
+        ULARGE_INTEGER ticks;
+        ticks.LowPart = time.dwLowDateTime;
+        ticks.HighPart = time.dwHighDateTime;
+        ticks.QuadPart += seconds * 10000000LL;
+        time.dwLowDateTime = ticks.LowPart;
+        time.dwHighDateTime = ticks.HighPart;
+        touched = touched && SetFileTime(file, nullptr, nullptr, &time) != 0;
+        CloseHandle(file);
+        return touched;
+    }
+
+    bool SameMesh(const Mesh& a, const Mesh& b) {
+        return a.vertexCount == b.vertexCount && a.indexCount == b.indexCount && a.indexFormat == b.indexFormat &&
+            memcmp(a.vertices, b.vertices, a.vertexCount * sizeof(Vertex)) == 0 &&
+            memcmp(a.indices, b.indices, a.indexCount * a.IndexSize()) == 0 &&
+            a.submeshes.size() == b.submeshes.size() &&
+            memcmp(a.submeshes.data(), b.submeshes.data(), a.submeshes.size() * sizeof(Submesh)) == 0 &&
+            a.materials.size() == b.materials.size() && strcmp(a.materials[0].name, b.materials[0].name) == 0 &&
+            memcmp(&a.bounds, &b.bounds, sizeof(a.bounds)) == 0 && memcmp(&a.sphere, &b.sphere, sizeof(a.sphere)) == 0;
+    }
+
+    // Saves and loads the mesh as is and compressed
+    void TestRoundTrip(const Mesh& mesh) {
+        for (bool compress : { false, true }) {
+            WriteSource("v 0 0 0\n");
+            CHECK(MeshCache::Save(SOURCE, BUILD_FLAGS, mesh, compress));
+
+            Mesh loaded;
+            const bool ok = CHECK(MeshCache::Load(SOURCE, BUILD_FLAGS, loaded));
+            printf("round trip, %s: %u vertices, %u indices, cache %zu bytes\n", compress ? "compressed" : "mapped", loaded.vertexCount,
+                loaded.indexCount, ReadFile(MeshCache::CachePath(SOURCE)).size());
+            CHECK(ok && SameMesh(mesh, loaded));
+            CHECK(compress || loaded.storage);
+
+            Mesh other;
+            CHECK(!MeshCache::Load(SOURCE, BUILD_FLAGS | 0x100, other));
+        }
+    }
+
+    // A new timestamp over the same content keeps the cache and records the
+    // timestamp once; changed content rejects it
+    void TestStaleness(const Mesh& mesh) {
+        WriteSource("v 0 0 0\n");
+        CHECK(MeshCache::Save(SOURCE, BUILD_FLAGS, mesh));
+        const std::vector<char> saved = ReadFile(MeshCache::CachePath(SOURCE));
+
+        CHECK(Touch(60));
+        {
+            Mesh loaded;
+            const bool ok = CHECK(MeshCache::Load(SOURCE, BUILD_FLAGS, loaded));
+            CHECK(ok && SameMesh(mesh, loaded));
+        }
+        const std::vector<char> refreshed = ReadFile(MeshCache::CachePath(SOURCE));
+        CHECK(refreshed.size() == saved.size() && refreshed != saved);
+        {
+            Mesh loaded;
+            CHECK(MeshCache::Load(SOURCE, BUILD_FLAGS, loaded));
+        }
+        CHECK(ReadFile(MeshCache::CachePath(SOURCE)) == refreshed);
+
+        // Same size, different bytes
+        WriteSource("v 0 0 1\n");
+        CHECK(Touch(120));
+        Mesh modified;
+        CHECK(!MeshCache::Load(SOURCE, BUILD_FLAGS, modified));
+
+        WriteSource("v 0 0 0\nv 1 0 0\n");
+        Mesh grown;
+        CHECK(!MeshCache::Load(SOURCE, BUILD_FLAGS, grown));
+
+        remove(MeshCache::CachePath(SOURCE).c_str());
+        Mesh missing;
+        CHECK(!MeshCache::Load(SOURCE, BUILD_FLAGS, missing));
+    }
+}
+
+int main() {
+    Mesh mesh;
+    mesh.SetPrimitive(icosphere);
+
+    TestRoundTrip(mesh);
+    TestStaleness(mesh);
+
+    remove(MeshCache::CachePath(SOURCE).c_str());
+    remove(SOURCE);
+    return Check::Exit();
+}
@@ -0,0 +1,82 @@
+// Compresses the vertex and index arrays of the sphere, a large generated grid
+// and any OBJs named on the command line, laid out and reordered the way
+// ObjLoader writes them to a mesh cache, and prints the compression ratio,
+// encode MB/s and decode MB/s at 1, 2, 4, ... hardware threads.
+//
+//   MeshCodecBench [file.obj ...]
+
+#include "Bench.h"
+#include "Geometry.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+
+#include <cstdio>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 1000;
+
+    // Laid out like the renderer's Vertex
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    double Megabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    // Encodes an array and times decoding it back
+    void Run(const char* name, const void* elements, size_t count, size_t stride) {
+        const size_t bytes = count * stride;
+        std::vector<uint8_t> encoded;
+        const double encode = Bench::Seconds(REPEATS, [&]() {
+            encoded.clear();
+            MeshCodec::Encode(elements, count, stride, encoded);
+        });
+        printf("  %s: %.2f MB to %.2f MB (%.2fx), encode %.1f MB/s\n", name, Megabytes(bytes), Megabytes(encoded.size()),
+            double(bytes) / encoded.size(), Megabytes(bytes) / encode);
+
+        std::vector<uint8_t> decoded(bytes);
+        for (unsigned threads : Bench::ThreadCounts()) {
+            bool ok = true;
+            const double decode = Bench::Seconds(REPEATS, [&]() {
+                ok = MeshCodec::Decode(encoded.data(), encoded.size(), decoded.data(), count, stride, threads) && ok;
+            });
+            printf("    %2u threads: decode %8.1f MB/s%s\n", threads, Megabytes(bytes) / decode, ok ? "" : " (failed)");
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        const size_t vertexCount = mesh.positions.size() / 3;
+        Geometry::Vectors normals;
+        Geometry::SmoothNormals(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), vertexCount, 3 * sizeof(float), normals);
+        std::vector<Vertex> vertices(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            Vertex& vertex = vertices[v];
+            std::copy(&mesh.positions[3 * v], &mesh.positions[3 * v] + 3, vertex.position);
+            vertex.normal[0] = normals.x[v];
+            vertex.normal[1] = normals.y[v];
+            vertex.normal[2] = normals.z[v];
+            std::copy(&mesh.texCoords[2 * v], &mesh.texCoords[2 * v] + 2, vertex.texCoord);
+        }
+
+        std::vector<uint32_t> indices = mesh.indices;
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size());
+        std::vector<Vertex> fetched(vertexCount);
+        fetched.resize(MeshOptimizer::OptimizeVertexFetch(fetched.data(), indices.data(), indices.size(), vertices.data(), vertexCount, sizeof(Vertex)));
+        printf("%s: %zu vertices, %zu indices\n", mesh.name.c_str(), fetched.size(), indices.size());
+
+        Run("vertices", fetched.data(), fetched.size(), sizeof(Vertex));
+        if (fetched.size() <= 0x10000) {
+            std::vector<uint16_t> narrow(indices.begin(), indices.end());
+            Run("16-bit indices", narrow.data(), narrow.size(), sizeof(uint16_t));
+        } else {
+            Run("32-bit indices", indices.data(), indices.size(), sizeof(uint32_t));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "Check.h"
+#include "MeshCodec.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    // Written past the decoded elements to catch overruns
+    const uint8_t GUARD = 0xCD;
+    const size_t GUARD_BYTES = 64;
+
+    enum Content {
+        RANDOM,
+        ZEROS,
+        // Slowly changing elements, as after vertex reordering
+        STRUCTURED,
+    };
+
+    std::vector<uint8_t> Elements(size_t count, size_t stride, Content content, std::mt19937& rng) {
+        std::vector<uint8_t> elements(count * stride);
+        for (size_t i = 0; i < elements.size(); ++i) {
+            elements[i] = content == RANDOM ? uint8_t(rng()) : content == ZEROS ? 0 : uint8_t((i / stride) * 7 + i % stride);
+        }
+        return elements;
+    }
+
+    // Decodes into a buffer with guard bytes and checks they survive
+    bool Decode(const std::vector<uint8_t>& data, size_t size, size_t count, size_t stride, unsigned threadCount, std::vector<uint8_t>& elements,
+        bool* guarded) {
+        elements.assign(count * stride + GUARD_BYTES, GUARD);
+        const bool decoded = MeshCodec::Decode(data.data(), size, elements.data(), count, stride, threadCount);
+        *guarded = true;
+        for (size_t i = count * stride; i < elements.size(); ++i) {
+            *guarded = *guarded && elements[i] == GUARD;
+        }
+        elements.resize(count * stride);
+        return decoded;
+    }
+
+    bool RoundTrips(const std::vector<uint8_t>& elements, size_t count, size_t stride, unsigned threadCount) {
+        std::vector<uint8_t> data;
+        MeshCodec::Encode(elements.data(), count, stride, data);
+        std::vector<uint8_t> decoded;
+        bool guarded;
+        return Decode(data, data.size(), count, stride, threadCount, decoded, &guarded) && guarded && decoded == elements;
+    }
+
+    // Every stride at the counts around a 16-element boundary, and a few
+    // counts that span several blocks
+    void TestRoundTrip() {
+        std::mt19937 rng(1);
+        bool small = true, large = true;
+        for (size_t stride = 1; stride <= MeshCodec::MAX_STRIDE; ++stride) {
+            for (size_t count : { 0, 1, 15, 16, 17 }) {
+                for (Content content : { RANDOM, ZEROS, STRUCTURED }) {
+                    if (!RoundTrips(Elements(count, stride, content, rng), count, stride, 1)) {
+                        small = false;
+                        printf("Round trip failed: stride %zu, count %zu, content %d\n", stride, count, content);
+                    }
+                }
+            }
+        }
+        for (size_t stride : { 1, 2, 4, 12, 32, 36, 256 }) {
+            const size_t count = 300000 / stride + 3;
+            for (Content content : { RANDOM, STRUCTURED }) {
+                const std::vector<uint8_t> elements = Elements(count, stride, content, rng);
+                for (unsigned threadCount : { 1, 3 }) {
+                    if (!RoundTrips(elements, count, stride, threadCount)) {
+                        large = false;
+                        printf("Round trip failed: stride %zu, count %zu, content %d, %u threads\n", stride, count, content, threadCount);
+                    }
+                }
+            }
+        }
+        CHECK(small);
+        CHECK(large);
+    }
+
+    // Damaged data must be rejected, or at least decoded without writing past
+    // the elements or crashing
+    void TestCorruption() {
+        std::vector<float> positions(3 * 40000);
+        for (size_t i = 0; i < positions.size(); ++i) {
+            positions[i] = sinf(i * 0.01f) * 10.f;
+        }
+        const size_t stride = 12, count = positions.size() / 3;
+        std::vector<uint8_t> data;
+        MeshCodec::Encode(positions.data(), count, stride, data);
+        std::vector<uint8_t> decoded;
+        bool guarded;
+
+        // Every truncation is detected
+        bool truncationsRejected = true, truncationsGuarded = true;
+        for (size_t size = 0; size < data.size(); size += size < 256 ? 1 : 61) {
+            truncationsRejected = truncationsRejected && !Decode(data, size, count, stride, 1, decoded, &guarded);
+            truncationsGuarded = truncationsGuarded && guarded;
+        }
+        CHECK(truncationsRejected);
+        CHECK(truncationsGuarded);
+
+        // There's no checksum, so a flipped bit in the payload may decode to
+        // different elements, but never past them
+        std::mt19937 rng(2);
+        bool flipsGuarded = true;
+        size_t rejected = 0;
+        const int flips = 5000;
+        for (int i = 0; i < flips; ++i) {
+            std::vector<uint8_t> flipped = data;
+            flipped[rng() % flipped.size()] ^= uint8_t(1 << (rng() % 8));
+            rejected += !Decode(flipped, flipped.size(), count, stride, i % 2 ? 1 : 4, decoded, &guarded);
+            flipsGuarded = flipsGuarded && guarded;
+        }
+        printf("Bit flips: %zu of %d rejected\n", rejected, flips);
+        CHECK(flipsGuarded);
+
+        // Data for a different count or stride is rejected
+        CHECK(!Decode(data, data.size(), count + 1, stride, 1, decoded, &guarded));
+        CHECK(!Decode(data, data.size(), count - 1, stride, 1, decoded, &guarded));
+        CHECK(!Decode(data, data.size(), count / 2, stride * 2, 1, decoded, &guarded));
+        CHECK(!Decode(data, data.size(), count, 4, 1, decoded, &guarded));
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestCorruption();
+    return Check::Exit();
+}
@@ -0,0 +1,76 @@
+// Runs ObjLoader's reordering passes over the sphere, a generated grid and any
+// OBJs named on the command line (sponza.obj, say), with the triangles first
+// shuffled so the input has no locality. Prints the time of each pass and the
+// ACMR, ATVR and overdraw it leaves behind.
+//
+//   MeshOptimizerBench [file.obj ...]
+
+#include "Bench.h"
+#include "MeshOptimizer.h"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 300;
+
+    // ObjLoader's OVERDRAW_THRESHOLD
+    const float OVERDRAW_THRESHOLD = 1.05f;
+
+    const size_t POSITION_STRIDE = 3 * sizeof(float);
+
+    // seconds is the time the stage took, or negative for the input
+    void PrintStats(const char* stage, const std::vector<uint32_t>& indices, const std::vector<float>& positions, double seconds) {
+        const MeshOptimizer::VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size());
+        const MeshOptimizer::OverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw(indices.data(), indices.size(), positions.data(),
+            positions.size() / 3, POSITION_STRIDE);
+        char time[32] = "";
+        if (seconds >= 0.0) {
+            snprintf(time, sizeof(time), "%8.2f ms", seconds * 1000.0);
+        }
+        printf("  %-14s %11s: ACMR %.3f, ATVR %.3f, overdraw %.3f\n", stage, time, cache.acmr, cache.atvr, overdraw.overdraw);
+    }
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        const size_t triangleCount = mesh.indices.size() / 3;
+        std::vector<size_t> order(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            order[t] = t;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        std::vector<uint32_t> shuffled(mesh.indices.size());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            std::copy(&mesh.indices[3 * order[t]], &mesh.indices[3 * order[t]] + 3, &shuffled[3 * t]);
+        }
+        printf("%s: %zu vertices, %zu triangles\n", mesh.name.c_str(), mesh.positions.size() / 3, triangleCount);
+        PrintStats("shuffled", shuffled, mesh.positions, -1.0);
+
+        std::vector<uint32_t> indices;
+        const double cache = Bench::Seconds(REPEATS, [&]() {
+            indices = shuffled;
+            MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size());
+        });
+        PrintStats("vertex cache", indices, mesh.positions, cache);
+
+        const std::vector<uint32_t> cacheOptimized = indices;
+        const double overdraw = Bench::Seconds(REPEATS, [&]() {
+            indices = cacheOptimized;
+            MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), mesh.positions.data(), POSITION_STRIDE, OVERDRAW_THRESHOLD);
+        });
+        PrintStats("overdraw", indices, mesh.positions, overdraw);
+
+        const std::vector<uint32_t> overdrawOptimized = indices;
+        std::vector<float> positions(mesh.positions.size());
+        const double fetch = Bench::Seconds(REPEATS, [&]() {
+            indices = overdrawOptimized;
+            positions.resize(mesh.positions.size());
+            positions.resize(3 * MeshOptimizer::OptimizeVertexFetch(positions.data(), indices.data(), indices.size(), mesh.positions.data(),
+                mesh.positions.size() / 3, POSITION_STRIDE));
+        });
+        PrintStats("vertex fetch", indices, positions, fetch);
+    }
+    return 0;
+}
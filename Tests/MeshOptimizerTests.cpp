@@ -0,0 +1,182 @@
+#include "Check.h"
+#include "MeshOptimizer.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+    typedef std::array<uint32_t, 3> Triangle;
+
+    struct Mesh {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // A wavy size x size quad grid, its triangles shuffled so nothing about
+    // the order helps the cache
+    Mesh Grid(int size, unsigned seed) {
+        Mesh mesh;
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                mesh.positions.push_back(x * 0.1f);
+                mesh.positions.push_back(y * 0.1f);
+                mesh.positions.push_back(0.3f * sinf(x * 0.2f) * cosf(y * 0.15f));
+            }
+        }
+
+        std::vector<Triangle> triangles;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                triangles.push_back({ { a, c, b } });
+                triangles.push_back({ { b, c, d } });
+            }
+        }
+        std::mt19937 rng(seed);
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        for (const Triangle& triangle : triangles) {
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+
+    // The bundled sphere, its corners indexing positions
+    Mesh Sphere() {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        Mesh mesh;
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource("sphere.obj").c_str(), RESOURCES_DIR))) {
+            return mesh;
+        }
+
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                mesh.indices.push_back(index.vertex_index);
+            }
+        }
+        mesh.positions = attrib.vertices;
+        return mesh;
+    }
+
+    // Triangles rotated to start at their smallest index, which keeps their
+    // winding, so two lists compare equal if they hold the same triangles
+    // facing the same way in any order
+    std::multiset<Triangle> Triangles(const std::vector<uint32_t>& indices) {
+        std::multiset<Triangle> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Triangle triangle = { { indices[i], indices[i + 1], indices[i + 2] } };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.insert(triangle);
+        }
+        return triangles;
+    }
+
+    void TestVertexCache() {
+        const Mesh grid = Grid(120, 1);
+        std::vector<uint32_t> indices = grid.indices;
+        const MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size());
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size());
+        const MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size());
+        printf("Grid of %zu triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", indices.size() / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+
+        CHECK(Triangles(indices) == Triangles(grid.indices));
+        // A shuffled grid misses on almost every corner; Forsyth's ordering
+        // gets a regular grid close to its 0.5 bound
+        CHECK(before.acmr > 2.f);
+        CHECK(after.acmr < 0.8f);
+        CHECK(after.acmr < before.acmr);
+
+        // The output depends only on the input
+        std::vector<uint32_t> again = grid.indices;
+        MeshOptimizer::OptimizeVertexCache(again.data(), again.size());
+        CHECK(again == indices);
+    }
+
+    void TestVertexCacheEdgeCases() {
+        std::vector<uint32_t> empty;
+        MeshOptimizer::OptimizeVertexCache(empty.data(), 0);
+        CHECK(MeshOptimizer::AnalyzeVertexCache(empty.data(), 0).transformed == 0);
+
+        std::vector<uint32_t> one = { 2, 0, 1 };
+        MeshOptimizer::OptimizeVertexCache(one.data(), one.size());
+        CHECK(Triangles(one) == Triangles({ 2, 0, 1 }));
+
+        // Degenerate and repeated triangles are kept as they are
+        const std::vector<uint32_t> odd = { 0, 0, 1, 1, 2, 3, 1, 2, 3, 5, 5, 5 };
+        std::vector<uint32_t> indices = odd;
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size());
+        CHECK(Triangles(indices) == Triangles(odd));
+    }
+
+    // ObjLoader's OVERDRAW_THRESHOLD, and looser and stricter ones
+    const float THRESHOLDS[] = { 1.f, 1.05f, 1.25f };
+
+    // Overdraw ordering may only give up threshold of the vertex cache
+    // ordering's ACMR, and must keep every triangle
+    void TestOverdraw(const char* name, const Mesh& mesh) {
+        std::vector<uint32_t> cacheOrder = mesh.indices;
+        MeshOptimizer::OptimizeVertexCache(cacheOrder.data(), cacheOrder.size());
+        const float cacheAcmr = MeshOptimizer::AnalyzeVertexCache(cacheOrder.data(), cacheOrder.size()).acmr;
+        const size_t vertexCount = mesh.positions.size() / 3;
+        const float cacheOverdraw = MeshOptimizer::AnalyzeOverdraw(cacheOrder.data(), cacheOrder.size(), mesh.positions.data(), vertexCount, 12).overdraw;
+
+        for (float threshold : THRESHOLDS) {
+            std::vector<uint32_t> indices = cacheOrder;
+            MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), mesh.positions.data(), 12, threshold);
+            const float acmr = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size()).acmr;
+            const float overdraw = MeshOptimizer::AnalyzeOverdraw(indices.data(), indices.size(), mesh.positions.data(), vertexCount, 12).overdraw;
+            printf("%s, threshold %.2f: ACMR %.3f -> %.3f, overdraw %.3f -> %.3f\n", name, threshold, cacheAcmr, acmr, cacheOverdraw, overdraw);
+
+            CHECK(Triangles(indices) == Triangles(mesh.indices));
+            CHECK(acmr <= cacheAcmr * threshold);
+        }
+    }
+
+    void TestVertexFetch() {
+        const Mesh grid = Grid(40, 2);
+        std::vector<uint32_t> indices = grid.indices;
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size());
+        const std::vector<uint32_t> cacheOrder = indices;
+
+        // Two vertices no triangle uses, which must be dropped
+        std::vector<float> positions = grid.positions;
+        positions.insert(positions.end(), { 9.f, 9.f, 9.f, 8.f, 8.f, 8.f });
+        const size_t vertexCount = positions.size() / 3;
+
+        std::vector<float> fetched(positions.size());
+        const size_t written = MeshOptimizer::OptimizeVertexFetch(fetched.data(), indices.data(), indices.size(), positions.data(), vertexCount, 12);
+        CHECK(written == vertexCount - 2);
+
+        // Every corner still reaches the same position, and vertices appear in
+        // the order the index buffer first uses them
+        bool same = true;
+        uint32_t nextNew = 0;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            same = same && indices[i] < written && memcmp(&fetched[3 * indices[i]], &positions[3 * cacheOrder[i]], 12) == 0;
+            if (indices[i] == nextNew) {
+                ++nextNew;
+            } else {
+                same = same && indices[i] < nextNew;
+            }
+        }
+        CHECK(same);
+        CHECK(nextNew == written);
+    }
+}
+
+int main() {
+    TestVertexCache();
+    TestVertexCacheEdgeCases();
+    TestOverdraw("Grid", Grid(120, 3));
+    TestOverdraw("sphere.obj", Sphere());
+    TestVertexFetch();
+    return Check::Exit();
+}
@@ -0,0 +1,174 @@
+#include "Check.h"
+#include "Geometry.h"
+#include "MeshWelder.h"
+#include "tiny_obj_loader.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+    // Same layout as the renderer's Vertex
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    struct Position {
+        float xyz[3];
+    };
+
+    void SetNormal(Vertex& vertex, const Geometry::Vectors& normals, size_t i) {
+        vertex.normal[0] = normals.x[i];
+        vertex.normal[1] = normals.y[i];
+        vertex.normal[2] = normals.z[i];
+    }
+
+    // One vertex per face corner, in face order, with normals generated the
+    // way ObjLoader::GenerateNormals does before it welds them
+    bool LoadCorners(const char* name, bool smooth, std::vector<Vertex>& corners) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        const std::string path = Check::Resource(name);
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), RESOURCES_DIR, true))) {
+            return false;
+        }
+
+        corners.clear();
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                Vertex vertex = {};
+                memcpy(vertex.position, &attrib.vertices[3 * index.vertex_index], sizeof(vertex.position));
+                if (index.texcoord_index >= 0) {
+                    memcpy(vertex.texCoord, &attrib.texcoords[2 * index.texcoord_index], sizeof(vertex.texCoord));
+                }
+                corners.push_back(vertex);
+            }
+        }
+
+        Geometry::Vectors normals;
+        if (smooth) {
+            std::vector<Position> positions(corners.size()), welded;
+            for (size_t c = 0; c < corners.size(); ++c) {
+                memcpy(positions[c].xyz, corners[c].position, sizeof(Position));
+            }
+            std::vector<uint32_t> positionOf;
+            MeshWelder::Weld(positions.data(), positions.size(), welded, positionOf);
+            Geometry::SmoothNormals(positionOf.data(), positionOf.size(), welded[0].xyz, welded.size(), sizeof(Position), normals);
+            for (size_t c = 0; c < corners.size(); ++c) {
+                SetNormal(corners[c], normals, positionOf[c]);
+            }
+        } else {
+            Geometry::FaceNormals(nullptr, corners.size(), corners[0].position, corners.size(), sizeof(Vertex), normals);
+            for (size_t c = 0; c < corners.size(); ++c) {
+                SetNormal(corners[c], normals, c / 3);
+            }
+        }
+        return true;
+    }
+
+    // minRatio is the least face corners per welded vertex the mesh must reach
+    void TestBundledMesh(const char* name, bool smooth, double minRatio) {
+        std::vector<Vertex> corners;
+        if (!LoadCorners(name, smooth, corners)) {
+            return;
+        }
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        MeshWelder::Weld(corners.data(), corners.size(), vertices, indices);
+
+        const double ratio = double(indices.size()) / vertices.size();
+        printf("%s, %s normals: %zu corners welded to %zu vertices (%.2f indices per vertex)\n", name, smooth ? "smooth" : "flat", corners.size(),
+            vertices.size(), ratio);
+
+        CHECK(indices.size() == corners.size());
+        CHECK(ratio >= minRatio);
+        CHECK(MeshWelder::FitsIn16BitIndices(vertices.size()));
+
+        // Every index reproduces its corner exactly
+        bool exact = true;
+        for (size_t i = 0; i < corners.size(); ++i) {
+            exact = exact && indices[i] < vertices.size() && memcmp(&vertices[indices[i]], &corners[i], sizeof(Vertex)) == 0;
+        }
+        CHECK(exact);
+
+        // No two output vertices are the same, so welding again changes nothing
+        std::vector<Vertex> rewelded;
+        std::vector<uint32_t> identity;
+        MeshWelder::Weld(vertices.data(), vertices.size(), rewelded, identity);
+        CHECK(rewelded.size() == vertices.size());
+
+        // Narrowing keeps every index
+        std::vector<uint16_t> narrow(indices.size());
+        MeshWelder::NarrowIndices(indices, narrow.data());
+        bool narrowed = true;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            narrowed = narrowed && narrow[i] == indices[i];
+        }
+        CHECK(narrowed);
+    }
+
+    void TestFirstSeenOrder() {
+        const float values[] = { 3.f, 1.f, 3.f, 2.f, 1.f, 3.f };
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        MeshWelder::Weld(values, 6, vertices, indices);
+
+        CHECK(vertices == std::vector<float>({ 3.f, 1.f, 2.f }));
+        CHECK(indices == std::vector<uint32_t>({ 0, 1, 0, 2, 1, 0 }));
+    }
+
+    // Welding compares bytes, so -0 and 0 stay apart
+    void TestBitwiseEquality() {
+        const float values[] = { 0.f, -0.f, 0.f };
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        MeshWelder::Weld(values, 3, vertices, indices);
+
+        CHECK(vertices.size() == 2);
+        CHECK(indices == std::vector<uint32_t>({ 0, 1, 0 }));
+    }
+
+    void TestEmpty() {
+        std::vector<float> vertices(1, 1.f);
+        std::vector<uint32_t> indices(1, 1);
+        MeshWelder::Weld(static_cast<const float*>(nullptr), 0, vertices, indices);
+
+        CHECK(vertices.empty());
+        CHECK(indices.empty());
+    }
+
+    void Test16BitLimit() {
+        CHECK(MeshWelder::FitsIn16BitIndices(0xFFFF));
+        CHECK(!MeshWelder::FitsIn16BitIndices(0x10000));
+
+        // Distinct values past the limit are all kept
+        std::vector<uint32_t> values(0x10000);
+        for (uint32_t i = 0; i < values.size(); ++i) {
+            values[i] = i * 2654435761u;
+        }
+        std::vector<uint32_t> vertices, indices;
+        MeshWelder::Weld(values.data(), values.size(), vertices, indices);
+        CHECK(vertices.size() == values.size());
+        CHECK(!MeshWelder::FitsIn16BitIndices(vertices.size()));
+    }
+}
+
+int main() {
+    // Smooth normals leave one vertex per position and tex coord pair: 514 on
+    // the sphere, 26 on the dodecahedron. Flat normals differ in their last
+    // bits even between the coplanar triangles of a pentagon, so every corner
+    // stays its own vertex.
+    TestBundledMesh("sphere.obj", true, 5.5);
+    TestBundledMesh("dodecahedron.obj", true, 4.0);
+    TestBundledMesh("sphere.obj", false, 1.0);
+    TestBundledMesh("dodecahedron.obj", false, 1.0);
+    TestFirstSeenOrder();
+    TestBitwiseEquality();
+    TestEmpty();
+    Test16BitLimit();
+    return Check::Exit();
+}
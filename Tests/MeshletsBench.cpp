@@ -0,0 +1,92 @@
+// Builds meshlets for the sphere, a generated grid and any OBJs named on the
+// command line, after the vertex cache pass as ObjLoader runs them, and prints
+// the build time, how full the meshlets are, and how fast and how much Cull
+// culls from a camera in front of the mesh, far and near.
+//
+//   MeshletsBench [file.obj ...]
+
+#include "Bench.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+
+#include <cstdio>
+
+namespace {
+    const int REPEATS = 3;
+    const int CULL_REPEATS = 100;
+    const int GRID_SIZE = 300;
+
+    const size_t POSITION_STRIDE = 3 * sizeof(float);
+
+    // Row-vector transform of a 60 degree perspective camera at eye looking
+    // down +z, with D3D's 0 <= z <= w clip range
+    void LookDownZ(const float eye[3], float nearZ, float farZ, float matrix[16]) {
+        const float scale = 1.f / tanf(0.5236f);
+        const float q = farZ / (farZ - nearZ);
+        const float transform[16] = {
+            scale, 0.f, 0.f, 0.f,
+            0.f, scale, 0.f, 0.f,
+            0.f, 0.f, q, 1.f,
+            -eye[0] * scale, -eye[1] * scale, -(eye[2] + nearZ) * q, -eye[2],
+        };
+        std::copy(transform, transform + 16, matrix);
+    }
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        std::vector<uint32_t> optimized = mesh.indices;
+        MeshOptimizer::OptimizeVertexCache(optimized.data(), optimized.size());
+
+        std::vector<uint32_t> indices;
+        std::vector<Meshlets::Meshlet> meshlets;
+        const double build = Bench::Seconds(REPEATS, [&]() {
+            indices = optimized;
+            meshlets.clear();
+            Meshlets::Build(indices.data(), indices.size(), 0, mesh.positions.data(), POSITION_STRIDE, meshlets);
+        });
+
+        size_t cullable = 0;
+        for (const Meshlets::Meshlet& meshlet : meshlets) {
+            cullable += meshlet.coneCutoff < 1.f;
+        }
+        const double triangles = double(indices.size() / 3);
+        printf("%s: %.0f triangles into %zu meshlets (%.1f triangles each, %.0f%% with a usable cone) in %.2f ms (%.1f M triangles/s)\n",
+            mesh.name.c_str(), triangles, meshlets.size(), triangles / meshlets.size(), 100.0 * cullable / meshlets.size(), build * 1000.0,
+            triangles / build / 1e6);
+
+        // From in front of the mesh, far enough back to see all of it, and
+        // close enough that the sides fall outside the frustum
+        const size_t vertexCount = mesh.positions.size() / 3;
+        float center[3] = {};
+        for (size_t v = 0; v < vertexCount; ++v) {
+            for (int k = 0; k < 3; ++k) {
+                center[k] += mesh.positions[3 * v + k] / vertexCount;
+            }
+        }
+        float radius = 0.f;
+        for (size_t v = 0; v < vertexCount; ++v) {
+            const float dx = mesh.positions[3 * v] - center[0], dy = mesh.positions[3 * v + 1] - center[1], dz = mesh.positions[3 * v + 2] - center[2];
+            radius = std::max(radius, sqrtf(dx * dx + dy * dy + dz * dz));
+        }
+        for (float distance : { 2.5f, 1.1f }) {
+            const float eye[3] = { center[0], center[1], center[2] - distance * radius };
+            float matrix[16];
+            LookDownZ(eye, 0.01f * radius, 5.f * radius, matrix);
+            Meshlets::Frustum frustum;
+            Meshlets::ExtractFrustum(matrix, frustum);
+
+            std::vector<Meshlets::DrawRange> ranges;
+            size_t visible = 0;
+            const double cull = Bench::Seconds(REPEATS, [&]() {
+                for (int repeat = 0; repeat < CULL_REPEATS; ++repeat) {
+                    ranges.clear();
+                    visible = Meshlets::Cull(meshlets.data(), meshlets.size(), frustum, eye, ranges);
+                }
+            }) / CULL_REPEATS;
+            printf("  cull from %.1f radii: %zu of %zu meshlets visible in %zu ranges, %.1f us (%.1f M meshlets/s)\n", distance, visible,
+                meshlets.size(), ranges.size(), cull * 1e6, meshlets.size() / cull / 1e6);
+        }
+    }
+    return 0;
+}
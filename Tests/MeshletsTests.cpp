@@ -0,0 +1,142 @@
+#include "Check.h"
+#include "Meshlets.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <set>
+#include <vector>
+
+namespace {
+    typedef std::array<uint32_t, 3> Triangle;
+
+    struct Mesh {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // A bumpy size x size quad grid, so meshlets see a range of normals
+    Mesh Grid(int size) {
+        Mesh mesh;
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                mesh.positions.push_back(x * 0.1f);
+                mesh.positions.push_back(y * 0.1f);
+                mesh.positions.push_back(0.3f * sinf(x * 0.4f) * cosf(y * 0.3f));
+            }
+        }
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        return mesh;
+    }
+
+    // The bundled sphere, its corners indexing positions
+    Mesh Sphere() {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        Mesh mesh;
+        if (CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource("sphere.obj").c_str(), RESOURCES_DIR))) {
+            for (const tinyobj::shape_t& shape : shapes) {
+                for (const tinyobj::index_t& index : shape.mesh.indices) {
+                    mesh.indices.push_back(index.vertex_index);
+                }
+            }
+            mesh.positions = attrib.vertices;
+        }
+        return mesh;
+    }
+
+    std::multiset<Triangle> Triangles(const uint32_t* indices, size_t indexCount) {
+        std::multiset<Triangle> triangles;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            Triangle triangle = { { indices[i], indices[i + 1], indices[i + 2] } };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.insert(triangle);
+        }
+        return triangles;
+    }
+
+    const float* Position(const Mesh& mesh, uint32_t index) {
+        return &mesh.positions[3 * index];
+    }
+
+    // Builds meshlets over the index range [first, first + count), as
+    // ObjLoader does per submesh, and checks every property they promise
+    void TestBuild(const char* name, const Mesh& mesh, size_t first, size_t count) {
+        std::vector<uint32_t> indices = mesh.indices;
+        std::vector<Meshlets::Meshlet> meshlets;
+        Meshlets::Build(&indices[first], count, uint32_t(first), mesh.positions.data(), 12, meshlets);
+        printf("%s: %zu triangles in %zu meshlets\n", name, count / 3, meshlets.size());
+
+        // Only the range is reordered, and it keeps its triangles
+        CHECK(Triangles(&indices[first], count) == Triangles(&mesh.indices[first], count));
+        CHECK(std::equal(indices.begin(), indices.begin() + first, mesh.indices.begin()));
+        CHECK(std::equal(indices.begin() + first + count, indices.end(), mesh.indices.begin() + first + count));
+
+        size_t next = first;
+        bool contiguous = true, withinLimits = true, enclosed = true, coned = true;
+        for (const Meshlets::Meshlet& meshlet : meshlets) {
+            contiguous = contiguous && meshlet.indexStart == next && meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0;
+            next = meshlet.indexStart + meshlet.indexCount;
+
+            const uint32_t* begin = &indices[meshlet.indexStart];
+            const std::set<uint32_t> vertices(begin, begin + meshlet.indexCount);
+            withinLimits = withinLimits && vertices.size() <= Meshlets::MAX_VERTICES && meshlet.indexCount / 3 <= Meshlets::MAX_TRIANGLES;
+
+            // Rounding allowance relative to the radius
+            const float slack = meshlet.radius * 1e-5f + 1e-6f;
+            for (uint32_t vertex : vertices) {
+                const float* p = Position(mesh, vertex);
+                const float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+                enclosed = enclosed && sqrtf(dx * dx + dy * dy + dz * dz) <= meshlet.radius + slack;
+            }
+
+            // Every normal lies within the cone: its cosine to the axis is at
+            // least cos(half angle)
+            if (meshlet.coneCutoff < 1.f) {
+                const float minCosine = sqrtf(1.f - meshlet.coneCutoff * meshlet.coneCutoff) - 1e-4f;
+                for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+                    const float* a = Position(mesh, begin[i]);
+                    const float* b = Position(mesh, begin[i + 1]);
+                    const float* c = Position(mesh, begin[i + 2]);
+                    const float e[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                    const float f[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                    const float n[3] = { e[1] * f[2] - e[2] * f[1], e[2] * f[0] - e[0] * f[2], e[0] * f[1] - e[1] * f[0] };
+                    const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length > 0.f) {
+                        const float cosine = (n[0] * meshlet.coneAxis[0] + n[1] * meshlet.coneAxis[1] + n[2] * meshlet.coneAxis[2]) / length;
+                        coned = coned && cosine >= minCosine;
+                    }
+                }
+            }
+        }
+        CHECK(contiguous);
+        CHECK(next == first + count);
+        CHECK(withinLimits);
+        CHECK(enclosed);
+        CHECK(coned);
+    }
+}
+
+int main() {
+    const Mesh grid = Grid(100);
+    TestBuild("Grid", grid, 0, grid.indices.size());
+    // A submesh in the middle of the index buffer
+    TestBuild("Grid, offset range", grid, 3 * 1001, 3 * 5000);
+
+    const Mesh sphere = Sphere();
+    TestBuild("sphere.obj", sphere, 0, sphere.indices.size());
+    TestBuild("Single triangle", sphere, 0, 3);
+
+    std::vector<Meshlets::Meshlet> meshlets;
+    Meshlets::Build(nullptr, 0, 0, nullptr, 12, meshlets);
+    CHECK(meshlets.empty());
+    return Check::Exit();
+}
@@ -0,0 +1,77 @@
+// Times full mip chains for a batch of 4K textures the way
+// AssetRegistry::DecodeTextures builds them: the batch spread over up to
+// cap threads, and each texture's levels banded over cap / batch of them.
+// Sweeps the cap over powers of two up to the hardware thread count.
+//
+//   MipsBench [textures]
+
+#include "Mips.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+    const uint32_t SIZE = 4096;
+    const size_t DEFAULT_TEXTURES = 8;
+    const int REPEATS = 3;
+
+    // Fills in the levels below the base of one texture's chain, all its
+    // levels packed back to back
+    void BuildChain(std::vector<uint8_t>& chain, unsigned bandThreads) {
+        const uint8_t* source = chain.data();
+        uint8_t* destination = chain.data() + size_t(SIZE) * SIZE * 4;
+        for (uint32_t width = SIZE, height = SIZE; width > 1 || height > 1;) {
+            Mips::DownsampleBanded(source, width, height, destination, bandThreads);
+            source = destination;
+            width = Mips::Next(width);
+            height = Mips::Next(height);
+            destination += size_t(width) * height * 4;
+        }
+    }
+
+    // Milliseconds for the whole batch, the best of a few runs
+    double Time(std::vector<std::vector<uint8_t>>& chains, unsigned cap) {
+        const unsigned bandThreads = std::max<unsigned>(1, cap / static_cast<unsigned>(chains.size()));
+        double best = 0.0;
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            const auto start = std::chrono::steady_clock::now();
+            Parallel::For(chains.size(), cap, [&](size_t i) {
+                BuildChain(chains[i], bandThreads);
+            });
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = repeat == 0 || ms < best ? ms : best;
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    const size_t textures = argc > 1 ? std::max(1, atoi(argv[1])) : DEFAULT_TEXTURES;
+
+    std::mt19937 rng(1);
+    std::vector<std::vector<uint8_t>> chains(textures);
+    for (std::vector<uint8_t>& chain : chains) {
+        chain.resize(Mips::ChainPixels(SIZE, SIZE) * 4);
+        for (size_t i = 0; i < size_t(SIZE) * SIZE * 4; ++i) {
+            chain[i] = uint8_t(rng());
+        }
+    }
+
+    const unsigned hardwareThreads = Parallel::DefaultThreadCount();
+    printf("%zu textures of %u x %u, %s, %u hardware threads\n", textures, SIZE, SIZE, Mips::Name(Mips::Fastest()), hardwareThreads);
+    const double megapixels = double(textures) * (Mips::ChainPixels(SIZE, SIZE) - size_t(SIZE) * SIZE) / 1e6;
+    for (unsigned cap = 1;; cap = std::min(2 * cap, hardwareThreads)) {
+        const double ms = Time(chains, cap);
+        printf("cap %3u: %4u band threads per texture, %8.2f ms, %8.1f MP/s\n", cap, std::max<unsigned>(1, cap / static_cast<unsigned>(textures)),
+            ms, megapixels / (ms / 1000.0));
+        if (cap == hardwareThreads) {
+            break;
+        }
+    }
+    return 0;
+}
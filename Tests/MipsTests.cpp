@@ -0,0 +1,126 @@
+#include "Check.h"
+#include "Mips.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    // Scalar and every SIMD implementation this CPU has
+    std::vector<Mips::Implementation> Implementations() {
+        std::vector<Mips::Implementation> implementations = { Mips::SCALAR };
+        if (Mips::Fastest() == Mips::AVX2) {
+            implementations.push_back(Mips::SSE2);
+        }
+        if (Mips::Fastest() != Mips::SCALAR) {
+            implementations.push_back(Mips::Fastest());
+        }
+        return implementations;
+    }
+
+    // Written past the destination to catch overruns
+    const uint8_t GUARD = 0xCD;
+    const size_t GUARD_BYTES = 64;
+
+    // The box filter as the header describes it, one pixel at a time: each
+    // destination pixel averages the 2x2 block under it, widened to 3 on the
+    // last row or column of an odd side, rounding halves up
+    std::vector<uint8_t> Reference(const std::vector<uint8_t>& source, uint32_t width, uint32_t height) {
+        const uint32_t nextWidth = Mips::Next(width), nextHeight = Mips::Next(height);
+        std::vector<uint8_t> destination(size_t(nextWidth) * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; ++y) {
+            const uint32_t y0 = height == 1 ? 0 : 2 * y;
+            const uint32_t y1 = height == 1 ? 0 : (y + 1 == nextHeight ? height - 1 : 2 * y + 1);
+            for (uint32_t x = 0; x < nextWidth; ++x) {
+                const uint32_t x0 = width == 1 ? 0 : 2 * x;
+                const uint32_t x1 = width == 1 ? 0 : (x + 1 == nextWidth ? width - 1 : 2 * x + 1);
+                for (int c = 0; c < 4; ++c) {
+                    uint32_t sum = 0, count = 0;
+                    for (uint32_t sy = y0; sy <= y1; ++sy) {
+                        for (uint32_t sx = x0; sx <= x1; ++sx) {
+                            sum += source[(size_t(sy) * width + sx) * 4 + c];
+                            ++count;
+                        }
+                    }
+                    destination[(size_t(y) * nextWidth + x) * 4 + c] = uint8_t((2 * sum + count) / (2 * count));
+                }
+            }
+        }
+        return destination;
+    }
+
+    // Every width and height up to a few SIMD groups, odd and even, with
+    // random pixels and with pixels whose block sums land on halves
+    void TestAgainstReference() {
+        std::mt19937 rng(1);
+        for (Mips::Implementation implementation : Implementations()) {
+            bool exact = true, guarded = true;
+            for (uint32_t height = 1; height <= 9; ++height) {
+                for (uint32_t width = 1; width <= 41; ++width) {
+                    for (int content = 0; content < 2; ++content) {
+                        std::vector<uint8_t> source(size_t(width) * height * 4);
+                        for (size_t i = 0; i < source.size(); ++i) {
+                            source[i] = content == 0 ? uint8_t(rng()) : uint8_t(i & 1 ? 255 : 254 + (i >> 2 & 1));
+                        }
+                        const std::vector<uint8_t> expected = Reference(source, width, height);
+
+                        std::vector<uint8_t> destination(expected.size() + GUARD_BYTES, GUARD);
+                        Mips::Downsample(source.data(), width, height, destination.data(), implementation);
+                        exact = exact && std::equal(expected.begin(), expected.end(), destination.begin());
+                        for (size_t i = expected.size(); i < destination.size(); ++i) {
+                            guarded = guarded && destination[i] == GUARD;
+                        }
+                    }
+                }
+            }
+            printf("%s: %s\n", Mips::Name(implementation), exact && guarded ? "matches the reference" : "FAILED");
+            CHECK(exact);
+            CHECK(guarded);
+        }
+    }
+
+    // Splitting a level into bands across threads changes nothing: wide,
+    // tall and odd levels, and a 4K one with many bands, come out as
+    // Downsample makes them with any thread count
+    void TestBanded() {
+        std::mt19937 rng(2);
+        const uint32_t sizes[][2] = { { 1, 1 }, { 7, 5 }, { 131071, 3 }, { 3, 70001 }, { 1025, 777 }, { 4096, 4096 } };
+        bool exact = true;
+        for (const uint32_t* size : sizes) {
+            std::vector<uint8_t> source(size_t(size[0]) * size[1] * 4);
+            for (uint8_t& byte : source) {
+                byte = uint8_t(rng());
+            }
+            const size_t bytes = size_t(Mips::Next(size[0])) * Mips::Next(size[1]) * 4;
+            std::vector<uint8_t> expected(bytes);
+            Mips::Downsample(source.data(), size[0], size[1], expected.data());
+            for (unsigned threadCount : { 1, 2, 3, 0 }) {
+                std::vector<uint8_t> destination(bytes + GUARD_BYTES, GUARD);
+                Mips::DownsampleBanded(source.data(), size[0], size[1], destination.data(), threadCount);
+                exact = exact && std::equal(expected.begin(), expected.end(), destination.begin());
+                exact = exact && size_t(std::count(destination.begin() + bytes, destination.end(), GUARD)) == GUARD_BYTES;
+            }
+        }
+        printf("Banded: %s\n", exact ? "matches Downsample" : "FAILED");
+        CHECK(exact);
+    }
+
+    void TestChainSizes() {
+        CHECK(Mips::Next(1) == 1 && Mips::Next(2) == 1 && Mips::Next(3) == 1 && Mips::Next(5) == 2);
+        CHECK(Mips::LevelCount(1, 1) == 1);
+        CHECK(Mips::LevelCount(1024, 1024) == 11);
+        CHECK(Mips::LevelCount(512, 256) == 10);
+        CHECK(Mips::LevelCount(5, 3) == 3);
+        CHECK(Mips::ChainPixels(1, 1) == 1);
+        CHECK(Mips::ChainPixels(4, 4) == 16 + 4 + 1);
+        CHECK(Mips::ChainPixels(5, 3) == 15 + 2 + 1);
+        CHECK(Mips::ChainPixels(8, 1) == 8 + 4 + 2 + 1);
+    }
+}
+
+int main() {
+    TestAgainstReference();
+    TestBanded();
+    TestChainSizes();
+    return Check::Exit();
+}
@@ -0,0 +1,110 @@
+// Parses a million v records' worth of printf %f values and a million face
+// indices with each NumberParser implementation the CPU supports, next to
+// strtod and atoi, and prints millions of numbers per second.
+//
+//   NumberParserBench [records]
+
+#include "Bench.h"
+#include "NumberParser.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+    const int REPEATS = 3;
+    const size_t DEFAULT_RECORDS = 1000000;
+
+    // Records of text back to back, each NUL-terminated, with PADDING bytes
+    // after the last
+    struct Text {
+        std::string text;
+        std::vector<size_t> starts;
+    };
+
+    // " x y z" as exporters write positions
+    Text Reals(size_t records) {
+        std::mt19937_64 rng(1);
+        std::uniform_real_distribution<double> distribution(-100.0, 100.0);
+        Text text;
+        char record[128];
+        for (size_t r = 0; r < records; ++r) {
+            snprintf(record, sizeof(record), " %f %f %f", distribution(rng), distribution(rng), distribution(rng));
+            text.starts.push_back(text.text.size());
+            text.text.append(record);
+            text.text.push_back('\0');
+        }
+        text.text.append(NumberParser::PADDING, '\0');
+        return text;
+    }
+
+    // Vertex indices as they appear in "f a/b/c" corners
+    Text Ints(size_t records) {
+        std::mt19937_64 rng(2);
+        Text text;
+        for (size_t r = 0; r < records; ++r) {
+            text.starts.push_back(text.text.size());
+            text.text.append(std::to_string(1 + rng() % 1000000) + "/");
+            text.text.push_back('\0');
+        }
+        text.text.append(NumberParser::PADDING, '\0');
+        return text;
+    }
+}
+
+int main(int argc, char** argv) {
+    const size_t records = argc > 1 ? strtoul(argv[1], nullptr, 10) : DEFAULT_RECORDS;
+    const Text reals = Reals(records);
+    const Text ints = Ints(records);
+    const double realCount = 3.0 * records;
+    printf("%zu reals, %zu ints\n", 3 * records, records);
+
+    // Keep the parsed values observable so the loops aren't optimized away
+    volatile float sink = 0.f;
+    const double strtodSeconds = Bench::Seconds(REPEATS, [&]() {
+        for (size_t start : reals.starts) {
+            char* token = const_cast<char*>(&reals.text[start]);
+            for (int v = 0; v < 3; ++v) {
+                sink += float(strtod(token, &token));
+            }
+        }
+    });
+    volatile long long intSink = 0;
+    const double atoiSeconds = Bench::Seconds(REPEATS, [&]() {
+        for (size_t start : ints.starts) {
+            intSink += atoi(&ints.text[start]);
+        }
+    });
+    printf("strtod: %8.1f M reals/s, atoi: %8.1f M ints/s\n", realCount / strtodSeconds / 1e6, records / atoiSeconds / 1e6);
+
+    for (NumberParser::Implementation implementation : { NumberParser::SSE42, NumberParser::AVX2 }) {
+        if (implementation > NumberParser::Fastest()) {
+            break;
+        }
+        size_t fast = 0;
+        const double realSeconds = Bench::Seconds(REPEATS, [&]() {
+            fast = 0;
+            for (size_t start : reals.starts) {
+                const char* token = &reals.text[start];
+                float values[3] = {};
+                fast += NumberParser::ParseReals(implementation, &token, values, 3);
+                sink += values[0];
+            }
+        });
+        size_t fastInts = 0;
+        const double intSeconds = Bench::Seconds(REPEATS, [&]() {
+            fastInts = 0;
+            for (size_t start : ints.starts) {
+                int value;
+                if (NumberParser::ParseInt(implementation, &ints.text[start], &value)) {
+                    intSink += value;
+                    ++fastInts;
+                }
+            }
+        });
+        printf("%-6s: %8.1f M reals/s (%zu on the fast path), %8.1f M ints/s (%zu on the fast path)\n", NumberParser::Name(implementation),
+            realCount / realSeconds / 1e6, fast, records / intSeconds / 1e6, fastInts);
+    }
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "Check.h"
+#include "NumberParser.h"
+#include "tiny_obj_loader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+    // A "v" record's values, with where each one's text ends
+    struct Record {
+        std::string text;
+        std::vector<size_t> ends;
+        std::vector<float> expected;
+    };
+
+    // Mostly what exporters write, plus the forms the fast paths must hand
+    // back: long integer parts, long fractions, exponents, trailing garbage,
+    // explicit plus signs and bare signs or points
+    std::string RandomNumber(std::mt19937_64& rng) {
+        std::string number;
+        const int form = rng() % 20;
+        if (rng() % 2) {
+            number += '-';
+        } else if (rng() % 10 == 0) {
+            number += '+';
+        }
+        const int integerDigits = form == 0 ? 0 : 1 + rng() % (form == 1 ? 18 : 4);
+        for (int i = 0; i < integerDigits; ++i) {
+            number += char('0' + rng() % 10);
+        }
+        if (rng() % 8) {
+            number += '.';
+            const int fractionDigits = rng() % (form == 2 ? 12 : 8);
+            for (int i = 0; i < fractionDigits; ++i) {
+                number += char('0' + rng() % 10);
+            }
+        }
+        if (form == 3) {
+            number += "e-0" + std::to_string(rng() % 5);
+        }
+        if (form == 4) {
+            number += 'x';
+        }
+        // An empty token would make parseReal read the next one
+        return number.empty() ? "-" : number;
+    }
+
+    void OnVertex(void* user, float x, float y, float z, float w) {
+        std::vector<float>& values = *static_cast<std::vector<float>*>(user);
+        values.insert(values.end(), { x, y, z, w });
+    }
+
+    // Random "v" records with 3 or 4 values, their expected values read by
+    // tinyobj itself, which parses each one with parseReal
+    std::vector<Record> RandomRecords(size_t count, unsigned seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<Record> records(count);
+        std::string file;
+        for (Record& record : records) {
+            const int values = 3 + rng() % 2;
+            for (int i = 0; i < values; ++i) {
+                record.text += rng() % 5 ? " " : "\t ";
+                record.text += RandomNumber(rng);
+                record.ends.push_back(record.text.size());
+            }
+            file += "v" + record.text + (rng() % 4 ? "\n" : "\r\n");
+        }
+
+        std::vector<float> parsed;
+        tinyobj::callback_t callback;
+        callback.vertex_cb = OnVertex;
+        std::istringstream stream(file);
+        std::string warn, err;
+        tinyobj::LoadObjWithCallback(stream, callback, &parsed, nullptr, &warn, &err);
+        for (size_t i = 0; i < count; ++i) {
+            records[i].expected.assign(parsed.begin() + 4 * i, parsed.begin() + 4 * i + records[i].ends.size());
+        }
+        return records;
+    }
+
+    // Every value the fast path takes is bit-identical to tinyobj's and
+    // leaves the token where parseReal would
+    void TestReals(NumberParser::Implementation implementation, const std::vector<Record>& records) {
+        size_t values = 0, fast = 0;
+        bool identical = true, positioned = true;
+        for (const Record& record : records) {
+            std::string text = record.text;
+            text.append(NumberParser::PADDING + 1, '\0');
+            const char* token = text.c_str();
+            float parsed[4];
+            const size_t count = NumberParser::ParseReals(implementation, &token, parsed, record.ends.size());
+            identical = identical && memcmp(parsed, record.expected.data(), count * sizeof(float)) == 0;
+            positioned = positioned && token == text.c_str() + (count ? record.ends[count - 1] : 0);
+            values += record.ends.size();
+            fast += count;
+        }
+        printf("%s: %zu of %zu values on the fast path\n", NumberParser::Name(implementation), fast, values);
+        CHECK(identical);
+        CHECK(positioned);
+        if (implementation == NumberParser::SCALAR) {
+            CHECK(fast == 0);
+        } else {
+            // Most of the random forms are within the fast path
+            CHECK(fast * 2 > values);
+        }
+    }
+
+    // What exporters write: printf's %f, which the fast paths must take
+    // entirely
+    void TestExporterOutput(NumberParser::Implementation implementation) {
+        std::mt19937_64 rng(7);
+        std::uniform_real_distribution<double> distribution(-1000.0, 1000.0);
+        bool complete = true;
+        for (int i = 0; i < 10000 && implementation != NumberParser::SCALAR; ++i) {
+            char text[128 + NumberParser::PADDING] = {};
+            snprintf(text, 128, " %f %f %f", distribution(rng), distribution(rng), distribution(rng));
+            const char* token = text;
+            float parsed[3];
+            complete = complete && NumberParser::ParseReals(implementation, &token, parsed, 3) == 3 && *token == '\0';
+        }
+        CHECK(complete);
+    }
+
+    void TestInts(NumberParser::Implementation implementation) {
+        std::mt19937_64 rng(3);
+        bool identical = true;
+        for (int i = 0; i < 200000; ++i) {
+            std::string text = (rng() % 3 == 0 ? "-" : "") + std::to_string(rng() % (rng() % 2 ? 100000000ull : 100)) + (rng() % 2 ? "/" : "");
+            if (rng() % 20 == 0) {
+                text = rng() % 2 ? " 5" : "+7";
+            } else if (rng() % 30 == 0) {
+                text.clear();
+            }
+            text.append(NumberParser::PADDING + 1, '\0');
+            int value;
+            if (NumberParser::ParseInt(implementation, text.c_str(), &value)) {
+                identical = identical && value == atoi(text.c_str());
+            }
+        }
+        CHECK(identical);
+    }
+}
+
+int main() {
+    const std::vector<Record> records = RandomRecords(300000, 42);
+    for (int implementation = NumberParser::SCALAR; implementation <= NumberParser::Fastest(); ++implementation) {
+        TestReals(NumberParser::Implementation(implementation), records);
+        TestExporterOutput(NumberParser::Implementation(implementation));
+        TestInts(NumberParser::Implementation(implementation));
+    }
+    return Check::Exit();
+}
@@ -0,0 +1,74 @@
+// Parses an OBJ with ObjParser on 1, 2, 4, ... hardware threads, with
+// tinyobj's number parsing and with the fastest SIMD numbers, and prints MB/s
+// next to tinyobj::LoadObj's. Without an argument the OBJ is a generated grid
+// about the size of sponza.obj.
+//
+//   ObjParserBench [file.obj]
+
+#include "Bench.h"
+#include "ObjParser.h"
+
+#include <cstdio>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 250;
+
+    double Megabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* generated = "ObjParserBench.obj";
+    std::string path = argc > 1 ? argv[1] : generated;
+    size_t bytes = 0;
+    if (argc > 1) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            bytes = size_t(ftell(file));
+            fclose(file);
+        }
+    } else {
+        bytes = Bench::WriteObj(generated, Bench::Grid(GRID_SIZE));
+    }
+    if (bytes == 0) {
+        printf("%s: can't be read\n", path.c_str());
+        return 1;
+    }
+    const std::string baseDir = path.substr(0, path.find_last_of("\\/") + 1);
+    printf("%s: %.2f MB\n", path.c_str(), Megabytes(bytes));
+
+    const double loadObj = Bench::Seconds(REPEATS, [&]() {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), baseDir.c_str());
+    });
+    printf("tinyobj::LoadObj: %8.1f MB/s\n", Megabytes(bytes) / loadObj);
+
+    for (NumberParser::Implementation numbers : { NumberParser::SCALAR, NumberParser::Fastest() }) {
+        for (unsigned threads : Bench::ThreadCounts()) {
+            ObjParser::Stats stats = {};
+            const double seconds = Bench::Seconds(REPEATS, [&]() {
+                tinyobj::attrib_t attrib;
+                std::vector<tinyobj::shape_t> shapes;
+                std::vector<tinyobj::material_t> materials;
+                std::string warn, err;
+                ObjParser::Parse(path, &attrib, &shapes, &materials, &warn, &err, baseDir.c_str(), true, threads, numbers, &stats);
+            });
+            printf("ObjParser, %-6s numbers, %2u threads: %8.1f MB/s, %6.1f M numbers/s, %zu chunks\n", NumberParser::Name(numbers), threads,
+                Megabytes(bytes) / seconds, stats.numbers / seconds / 1e6, stats.chunks);
+        }
+        if (numbers == NumberParser::Fastest()) {
+            break;
+        }
+    }
+
+    if (argc <= 1) {
+        remove(generated);
+    }
+    return 0;
+}
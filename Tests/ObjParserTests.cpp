@@ -0,0 +1,128 @@
+#include "Check.h"
+#include "ObjParser.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+    struct Obj {
+        bool loaded;
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+    };
+
+    template <typename T>
+    bool SameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    bool SameIndices(const std::vector<tinyobj::index_t>& a, const std::vector<tinyobj::index_t>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index || a[i].texcoord_index != b[i].texcoord_index) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Everything ObjLoader reads, compared bit for bit
+    bool Same(const Obj& a, const Obj& b) {
+        if (a.loaded != b.loaded || !SameBytes(a.attrib.vertices, b.attrib.vertices) || !SameBytes(a.attrib.normals, b.attrib.normals) ||
+            !SameBytes(a.attrib.texcoords, b.attrib.texcoords) || a.shapes.size() != b.shapes.size() || a.materials.size() != b.materials.size()) {
+            return false;
+        }
+        for (size_t s = 0; s < a.shapes.size(); ++s) {
+            const tinyobj::mesh_t& m = a.shapes[s].mesh;
+            const tinyobj::mesh_t& n = b.shapes[s].mesh;
+            if (a.shapes[s].name != b.shapes[s].name || !SameIndices(m.indices, n.indices) || m.num_face_vertices != n.num_face_vertices ||
+                m.material_ids != n.material_ids || m.smoothing_group_ids != n.smoothing_group_ids) {
+                return false;
+            }
+        }
+        for (size_t m = 0; m < a.materials.size(); ++m) {
+            if (a.materials[m].name != b.materials[m].name || a.materials[m].diffuse_texname != b.materials[m].diffuse_texname) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Files bigger than a chunk must be parsed in several on more than one
+    // thread, or the stitching goes untested. Chunks are only cut at line
+    // feeds, so files ending lines in a bare CR stay whole.
+    void TestMatchesLoadObj(const std::string& path, bool chunked) {
+        Obj expected;
+        expected.loaded = tinyobj::LoadObj(&expected.attrib, &expected.shapes, &expected.materials, &expected.warn, &expected.err, path.c_str(), RESOURCES_DIR);
+        CHECK(expected.loaded);
+
+        for (unsigned threads : { 1u, 2u, 7u }) {
+            for (NumberParser::Implementation numbers : { NumberParser::SCALAR, NumberParser::Fastest() }) {
+                Obj parsed;
+                ObjParser::Stats stats;
+                parsed.loaded = ObjParser::Parse(path, &parsed.attrib, &parsed.shapes, &parsed.materials, &parsed.warn, &parsed.err, RESOURCES_DIR,
+                    true, threads, numbers, &stats);
+                if (!CHECK(Same(expected, parsed))) {
+                    printf("  %s differs from tinyobj::LoadObj on %u threads with %s numbers\n", path.c_str(), threads, NumberParser::Name(numbers));
+                }
+                CHECK(!chunked || threads == 1 || stats.chunks > 1);
+            }
+        }
+        printf("%s: %zu positions, %zu shapes\n", path.c_str(), expected.attrib.vertices.size() / 3, expected.shapes.size());
+    }
+
+    // Records exercising every number form, relative indices, faces with
+    // and without tex coords, quads to triangulate and groups, with lines
+    // ending in eol. Long enough to be cut into several chunks.
+    std::string GenerateObj(const char* eol, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::string obj = "# generated";
+        obj += eol;
+        char line[128];
+        const int VERTICES = 3000;
+        for (int i = 0; i < VERTICES; ++i) {
+            snprintf(line, sizeof(line), "v %.6f %g -%.3e", (rng() % 100000) / 997.0, (rng() % 1000) / 7.0, (rng() % 1000) / 3.0);
+            obj += line;
+            obj += eol;
+            snprintf(line, sizeof(line), "vt %f\t%f", (rng() % 1000) / 1000.0, (rng() % 1000) / 1000.0);
+            obj += line;
+            obj += eol;
+        }
+        obj += "o thing";
+        obj += eol;
+        for (int i = 0; i < 4000; ++i) {
+            const int a = 1 + rng() % VERTICES, b = 1 + rng() % VERTICES, c = 1 + rng() % VERTICES, d = 1 + rng() % VERTICES;
+            if (i % 3 == 0) {
+                snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d", a, a, b, b, c, c, d, d);
+            } else {
+                snprintf(line, sizeof(line), "f -%d -%d -%d", 1 + int(rng() % 100), 1 + int(rng() % 100), 1 + int(rng() % 100));
+            }
+            obj += line;
+            obj += eol;
+            if (i % 500 == 0) {
+                obj += "g group" + std::to_string(i);
+                obj += eol;
+            }
+        }
+        return obj;
+    }
+}
+
+int main() {
+    TestMatchesLoadObj(Check::Resource("sphere.obj"), false);
+    TestMatchesLoadObj(Check::Resource("dodecahedron.obj"), false);
+
+    const char* const endings[][2] = { { "\n", "lf" }, { "\r\n", "crlf" }, { "\r", "cr" } };
+    for (const auto& ending : endings) {
+        const std::string path = std::string("generated_") + ending[1] + ".obj";
+        std::ofstream(path, std::ios::binary) << GenerateObj(ending[0], 5);
+        TestMatchesLoadObj(path, strchr(ending[0], '\n') != nullptr);
+        remove(path.c_str());
+    }
+    return Check::Exit();
+}
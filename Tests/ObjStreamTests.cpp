@@ -0,0 +1,134 @@
+#include "Check.h"
+#include "ObjStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // Streaming keeps the v and vt arrays and one batch. In this file those
+    // come to about a fifth of the text, so a third leaves room for vector
+    // growth while still failing if the file, tinyobj's shapes or a
+    // per-corner array were ever held: loading it whole takes about three
+    // times the file size.
+    const double MAX_RSS_PER_FILE_BYTE = 1.0 / 3.0;
+
+    // Fixed costs independent of the file: one batch of vertices and
+    // indices, and the iostream buffers
+    const size_t RSS_ALLOWANCE = 8 << 20;
+
+    size_t PeakRss() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters = {};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return counters.PeakWorkingSetSize;
+#else
+        struct rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return size_t(usage.ru_maxrss);
+#else
+        return size_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    // Writes a size x size quad grid with positions, tex coords, one shared
+    // normal and a material change every 512 rows, without holding any of it
+    // in memory. Returns the file size, or 0 if it can't be written.
+    size_t WriteGrid(const char* fname, int size) {
+        FILE* file = fopen(fname, "wb");
+        if (!file) {
+            return 0;
+        }
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                fprintf(file, "v %.6f %.6f %.6f\n", x * 0.01f, y * 0.01f, 0.1f * sinf(x * 0.05f) * cosf(y * 0.07f));
+                fprintf(file, "vt %.6f %.6f\n", x / float(size), y / float(size));
+            }
+        }
+        fprintf(file, "vn 0 0 1\n");
+        for (int y = 0; y < size; ++y) {
+            if (y % 512 == 0) {
+                fprintf(file, "usemtl m%d\n", y / 512);
+            }
+            for (int x = 0; x < size; ++x) {
+                const int a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 1, d = c + 1;
+                fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, d, d, c, c);
+            }
+        }
+        const long bytes = ftell(file);
+        return fclose(file) == 0 && bytes > 0 ? size_t(bytes) : 0;
+    }
+
+    // Keeps nothing but counts, so the peak RSS is the stream's own
+    class CountingSink : public ObjStream::Sink {
+    public:
+        size_t batches = 0;
+        size_t triangles = 0;
+        size_t largestBatch = 0;
+        bool indicesValid = true;
+        bool normalsValid = true;
+
+        void OnBatch(const ObjStream::Batch& batch) override {
+            ++batches;
+            triangles += batch.indexCount / 3;
+            largestBatch = std::max(largestBatch, batch.vertexCount);
+            indicesValid = indicesValid && batch.indexCount % 3 == 0;
+            for (size_t i = 0; i < batch.indexCount; ++i) {
+                indicesValid = indicesValid && batch.indices[i] < batch.vertexCount;
+            }
+            // Face normals, unnormalized, all facing the same side of the
+            // gently sloped grid
+            for (size_t i = 0; i < batch.vertexCount; ++i) {
+                const float* n = batch.vertices[i].normal;
+                normalsValid = normalsValid && fabsf(n[2]) > 0.8f * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            }
+        }
+    };
+}
+
+// Takes an optional grid size, so far larger files can be tried by hand
+int main(int argc, char** argv) {
+    const int size = argc > 1 ? atoi(argv[1]) : 800;
+    const char* fname = "ObjStreamTests.obj";
+    const size_t fileBytes = WriteGrid(fname, size);
+    if (!CHECK(fileBytes > 0)) {
+        return Check::Exit();
+    }
+
+    const size_t baseline = PeakRss();
+    CountingSink sink;
+    ObjStream::Stats stats = {};
+    std::string warn, err;
+    const bool streamed = ObjStream::Stream(fname, sink, &warn, &err, nullptr, ObjStream::DEFAULT_BATCH_VERTICES, &stats);
+    const size_t growth = PeakRss() - baseline;
+    remove(fname);
+
+    printf("%d x %d grid, %.1f MB: %zu triangles in %zu batches, attributes %.1f MB, peak RSS grew %.1f MB (%.1f%% of the file), %.2f s\n", size, size,
+        fileBytes / 1048576.0, stats.triangles, stats.batches, stats.attributeBytes / 1048576.0, growth / 1048576.0, 100.0 * growth / fileBytes,
+        stats.seconds);
+
+    CHECK(streamed);
+    CHECK(stats.bytes == fileBytes);
+    CHECK(stats.triangles == size_t(2) * size * size);
+    CHECK(sink.triangles == stats.triangles);
+    CHECK(sink.batches == stats.batches);
+    CHECK(sink.batches > 1);
+    CHECK(sink.largestBatch <= ObjStream::DEFAULT_BATCH_VERTICES);
+    CHECK(sink.indicesValid);
+    CHECK(sink.normalsValid);
+    // Only v and vt are kept: 5 floats per grid vertex
+    CHECK(stats.attributeBytes >= size_t(size + 1) * (size + 1) * 5 * sizeof(float));
+    CHECK(growth <= size_t(MAX_RSS_PER_FILE_BYTE * fileBytes) + RSS_ALLOWANCE);
+    return Check::Exit();
+}
@@ -0,0 +1,213 @@
+#include "Check.h"
+#include "Occluders.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Mesh {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // cells1 x cells2 unwelded quads from origin along edge1 and edge2, so
+    // there are seams everywhere, skipping the cells in [skip1, skip2).
+    // Corners are jittered by up to noise.
+    void AddGrid(Mesh& mesh, const float origin[3], const float edge1[3], const float edge2[3], int cells1, int cells2, const int skip1[2],
+        const int skip2[2], float noise, std::mt19937& rng) {
+        std::uniform_real_distribution<float> jitter(-noise, noise);
+        for (int i = 0; i < cells1; ++i) {
+            for (int j = 0; j < cells2; ++j) {
+                if (i >= skip1[0] && i < skip1[1] && j >= skip2[0] && j < skip2[1]) {
+                    continue;
+                }
+                const uint32_t base = uint32_t(mesh.positions.size() / 3);
+                const int corners[4][2] = { { i, j }, { i + 1, j }, { i + 1, j + 1 }, { i, j + 1 } };
+                for (const int* corner : corners) {
+                    for (int k = 0; k < 3; ++k) {
+                        mesh.positions.push_back(origin[k] + edge1[k] * corner[0] / cells1 + edge2[k] * corner[1] / cells2 + (noise > 0.f ? jitter(rng) : 0.f));
+                    }
+                }
+                mesh.indices.insert(mesh.indices.end(), { base, base + 2, base + 1, base, base + 3, base + 2 });
+            }
+        }
+    }
+
+    // A 10 x 4 x 8 room: floor, a wall with a door, a plain wall, a slightly
+    // uneven ceiling, and two round pillars
+    Mesh Room() {
+        std::mt19937 rng(1);
+        Mesh mesh;
+        const float zero[3] = { 0.f, 0.f, 0.f }, top[3] = { 0.f, 4.f, 0.f }, back[3] = { 0.f, 0.f, 8.f };
+        const float x[3] = { 10.f, 0.f, 0.f }, y[3] = { 0.f, 4.f, 0.f }, z[3] = { 0.f, 0.f, 8.f };
+        const int none[2] = { 0, 0 }, doorX[2] = { 20, 26 }, doorY[2] = { 0, 10 };
+        AddGrid(mesh, zero, z, x, 40, 50, none, none, 0.f, rng);
+        AddGrid(mesh, zero, x, y, 50, 20, doorX, doorY, 0.f, rng);
+        AddGrid(mesh, back, y, x, 20, 50, none, none, 0.f, rng);
+        AddGrid(mesh, top, x, z, 50, 40, none, none, 0.02f, rng);
+
+        const float pillars[2][2] = { { 3.f, 4.f }, { 7.f, 4.f } };
+        const int sides = 16, stacks = 8;
+        const float radius = 0.4f, height = 4.f, pi = 3.14159265f;
+        for (const float* pillar : pillars) {
+            for (int s = 0; s < sides; ++s) {
+                for (int k = 0; k < stacks; ++k) {
+                    const float a0 = 2.f * pi * s / sides, a1 = 2.f * pi * (s + 1) / sides;
+                    const float y0 = height * k / stacks, y1 = height * (k + 1) / stacks;
+                    const uint32_t base = uint32_t(mesh.positions.size() / 3);
+                    mesh.positions.insert(mesh.positions.end(), { pillar[0] + radius * cosf(a0), y0, pillar[1] + radius * sinf(a0),
+                        pillar[0] + radius * cosf(a1), y0, pillar[1] + radius * sinf(a1), pillar[0] + radius * cosf(a1), y1,
+                        pillar[1] + radius * sinf(a1), pillar[0] + radius * cosf(a0), y1, pillar[1] + radius * sinf(a0) });
+                    mesh.indices.insert(mesh.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+                }
+            }
+        }
+        return mesh;
+    }
+
+    // Room-sized tolerances, as ObjLoader scales them by the bounds diagonal
+    const float DIAGONAL = sqrtf(10.f * 10.f + 4.f * 4.f + 8.f * 8.f);
+    const float TOLERANCE = DIAGONAL * 1e-4f;
+    const float MIN_AREA = DIAGONAL * DIAGONAL * 1e-4f;
+    const size_t TRIANGLE_BUDGET = 128;
+
+    void Normal(const float* a, const float* b, const float* c, float normal[3]) {
+        const float e[3] = { c[0] - b[0], c[1] - b[1], c[2] - b[2] };
+        const float f[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+        normal[0] = e[1] * f[2] - e[2] * f[1];
+        normal[1] = e[2] * f[0] - e[0] * f[2];
+        normal[2] = e[0] * f[1] - e[1] * f[0];
+    }
+
+    float Dot(const float a[3], const float b[3]) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // Winding of the input triangle p lies on relative to normal, or 0 if p
+    // isn't on any
+    float WindingAt(const Mesh& mesh, const float p[3], const float normal[3]) {
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            const float* corners[3] = { &mesh.positions[3 * mesh.indices[i]], &mesh.positions[3 * mesh.indices[i + 1]],
+                &mesh.positions[3 * mesh.indices[i + 2]] };
+            float faceNormal[3];
+            Normal(corners[0], corners[1], corners[2], faceNormal);
+            const float length = sqrtf(Dot(faceNormal, faceNormal));
+            const float offset[3] = { p[0] - corners[0][0], p[1] - corners[0][1], p[2] - corners[0][2] };
+            if (length == 0.f || fabsf(Dot(offset, faceNormal)) > TOLERANCE * length) {
+                continue;
+            }
+            // Inside every edge, seen along the face normal
+            bool inside = true;
+            for (int k = 0; k < 3; ++k) {
+                float edgeNormal[3];
+                Normal(p, corners[k], corners[(k + 1) % 3], edgeNormal);
+                inside = inside && Dot(edgeNormal, faceNormal) >= 0.f;
+            }
+            if (inside) {
+                return Dot(normal, faceNormal);
+            }
+        }
+        return 0.f;
+    }
+
+    void TestRoom() {
+        const Mesh room = Room();
+        std::vector<float> positions = { 1.f, 2.f, 3.f };
+        std::vector<uint32_t> indices = { 0, 0, 0 };
+        const Occluders::Occluder occluder = Occluders::Build(room.indices.data(), room.indices.size(), room.positions.data(), 12, TRIANGLE_BUDGET,
+            TOLERANCE, MIN_AREA, 7, positions, indices);
+        printf("Room of %zu triangles: occluder of %u triangles, %u vertices, area %g, error %g\n", room.indices.size() / 3, occluder.indexCount / 3,
+            occluder.vertexCount, occluder.area, occluder.error);
+
+        // Appended after what was there, and within budget
+        CHECK(occluder.chunk == 7);
+        CHECK(occluder.vertexStart == 1 && occluder.indexStart == 3);
+        CHECK(positions.size() == 3 * (occluder.vertexStart + occluder.vertexCount));
+        CHECK(indices.size() == occluder.indexStart + occluder.indexCount);
+        CHECK(occluder.indexCount > 0 && occluder.indexCount % 3 == 0 && occluder.indexCount / 3 <= TRIANGLE_BUDGET);
+        CHECK(occluder.error <= TOLERANCE);
+
+        // Nearly all of the floor and the walls less the door, which are flat,
+        // makes it in; the pillars' sides and the uneven ceiling's triangles
+        // are too small to add much
+        const float flatArea = 80.f + 40.f - 1.2f * 2.f + 40.f;
+        CHECK(occluder.area > 0.95f * flatArea && occluder.area < 1.2f * flatArea);
+
+        bool inRange = true, inBounds = true, wound = true;
+        for (uint32_t i = 0; i < occluder.indexCount; ++i) {
+            inRange = inRange && indices[occluder.indexStart + i] < occluder.vertexCount;
+        }
+        const float* occluderPositions = &positions[3 * occluder.vertexStart];
+        for (uint32_t i = 0; inRange && i < occluder.indexCount; i += 3) {
+            const uint32_t* triangle = &indices[occluder.indexStart + i];
+            const float* a = &occluderPositions[3 * triangle[0]];
+            const float* b = &occluderPositions[3 * triangle[1]];
+            const float* c = &occluderPositions[3 * triangle[2]];
+            float normal[3];
+            Normal(a, b, c, normal);
+            const float centroid[3] = { (a[0] + b[0] + c[0]) / 3.f, (a[1] + b[1] + c[1]) / 3.f, (a[2] + b[2] + c[2]) / 3.f };
+            wound = wound && WindingAt(room, centroid, normal) > 0.f;
+        }
+        for (uint32_t i = 0; i < occluder.vertexCount; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                const float p = occluderPositions[3 * i + k];
+                inBounds = inBounds && p >= occluder.min[k] && p <= occluder.max[k];
+            }
+        }
+        CHECK(inRange);
+        CHECK(inBounds);
+        CHECK(wound);
+
+        CHECK(Occluders::IsConservative(occluder, positions.data(), indices.data(), room.indices.data(), room.indices.size(), room.positions.data(), 12,
+            occluder.error + TOLERANCE));
+
+        // The check catches an occluder pulled off the surface, or covering
+        // triangles that aren't there
+        std::vector<float> lifted = positions;
+        for (size_t i = 3 * occluder.vertexStart; i < lifted.size(); i += 3) {
+            lifted[i + 1] += 0.5f;
+        }
+        CHECK(!Occluders::IsConservative(occluder, lifted.data(), indices.data(), room.indices.data(), room.indices.size(), room.positions.data(), 12,
+            occluder.error + TOLERANCE));
+        Mesh floorless;
+        for (size_t i = 0; i < room.indices.size(); i += 3) {
+            const float* a = &room.positions[3 * room.indices[i]];
+            const float* b = &room.positions[3 * room.indices[i + 1]];
+            const float* c = &room.positions[3 * room.indices[i + 2]];
+            if (a[1] != 0.f || b[1] != 0.f || c[1] != 0.f) {
+                floorless.indices.insert(floorless.indices.end(), room.indices.begin() + i, room.indices.begin() + i + 3);
+            }
+        }
+        CHECK(!Occluders::IsConservative(occluder, positions.data(), indices.data(), floorless.indices.data(), floorless.indices.size(),
+            room.positions.data(), 12, occluder.error + TOLERANCE));
+    }
+
+    // Triangles too small to hold a quad of MIN_AREA, each in its own plane,
+    // give an empty occluder, and so does no input
+    void TestEmpty() {
+        std::mt19937 rng(2);
+        Mesh rough;
+        const float origin[3] = { 0.f, 0.f, 0.f }, x[3] = { 10.f, 0.f, 0.f }, z[3] = { 0.f, 0.f, 10.f };
+        const int none[2] = { 0, 0 };
+        AddGrid(rough, origin, z, x, 100, 100, none, none, 0.05f, rng);
+
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        const Occluders::Occluder occluder = Occluders::Build(rough.indices.data(), rough.indices.size(), rough.positions.data(), 12, TRIANGLE_BUDGET,
+            TOLERANCE, MIN_AREA, Occluders::Occluder::NO_CHUNK, positions, indices);
+        printf("Rough grid: occluder of %u triangles\n", occluder.indexCount / 3);
+        CHECK(occluder.indexCount == 0 && occluder.area == 0.f);
+        CHECK(indices.empty());
+
+        const Occluders::Occluder nothing = Occluders::Build(nullptr, 0, nullptr, 12, TRIANGLE_BUDGET, TOLERANCE, MIN_AREA,
+            Occluders::Occluder::NO_CHUNK, positions, indices);
+        CHECK(nothing.indexCount == 0 && nothing.vertexCount == 0);
+    }
+}
+
+int main() {
+    TestRoom();
+    TestEmpty();
+    return Check::Exit();
+}
@@ -0,0 +1,216 @@
+#include "Check.h"
+#include "Primitives.h"
+#include "tiny_obj_loader.h"
+
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace {
+    // Built by the compiler: none of these may need any work at startup
+    constexpr auto uvSphere = Primitives::UvSphere<32, 16>();
+    constexpr auto smallUvSphere = Primitives::UvSphere<3, 2>();
+    constexpr auto icosphere0 = Primitives::Icosphere<0>();
+    constexpr auto icosphere1 = Primitives::Icosphere<1>();
+    constexpr auto icosphere2 = Primitives::Icosphere<2>();
+    constexpr auto tetrahedron = Primitives::Tetrahedron();
+    constexpr auto cube = Primitives::Cube();
+    constexpr auto octahedron = Primitives::Octahedron();
+    constexpr auto dodecahedron = Primitives::Dodecahedron();
+    constexpr auto icosahedron = Primitives::Icosahedron();
+    constexpr auto plane = Primitives::Plane<4>();
+
+    // Same layout as the renderer's Vertex, so shapes copy straight into
+    // vertex buffers
+    static_assert(sizeof(Primitives::Vertex) == 32, "Vertex layout");
+
+    // Sizes fixed by the tessellation parameters. The UV sphere has one row
+    // per inner ring, each with a duplicated seam vertex, plus a vertex per
+    // segment at each pole.
+    static_assert(decltype(uvSphere)::VERTEX_COUNT == 15 * 33 + 2 * 32, "UvSphere<32, 16> vertices");
+    static_assert(decltype(uvSphere)::INDEX_COUNT == 3 * 32 * (2 * 14 + 2), "UvSphere<32, 16> indices");
+    static_assert(decltype(smallUvSphere)::VERTEX_COUNT == 1 * 4 + 2 * 3, "UvSphere<3, 2> vertices");
+    static_assert(decltype(icosphere0)::VERTEX_COUNT == 12 && decltype(icosphere0)::INDEX_COUNT == 3 * 20, "Icosphere<0>");
+    static_assert(decltype(icosphere1)::VERTEX_COUNT == 12 + 30 && decltype(icosphere1)::INDEX_COUNT == 3 * 80, "Icosphere<1>");
+    // 12 corners, 3 per edge, 3 inside each face
+    static_assert(decltype(icosphere2)::VERTEX_COUNT == 12 + 30 * 3 + 20 * 3, "Icosphere<2> vertices");
+    static_assert(decltype(icosphere2)::INDEX_COUNT == 3 * 20 * 16, "Icosphere<2> indices");
+    static_assert(decltype(tetrahedron)::VERTEX_COUNT == 4 * 3 && decltype(tetrahedron)::INDEX_COUNT == 3 * 4, "Tetrahedron");
+    static_assert(decltype(cube)::VERTEX_COUNT == 6 * 4 && decltype(cube)::INDEX_COUNT == 3 * 12, "Cube");
+    static_assert(decltype(octahedron)::VERTEX_COUNT == 8 * 3 && decltype(octahedron)::INDEX_COUNT == 3 * 8, "Octahedron");
+    static_assert(decltype(dodecahedron)::VERTEX_COUNT == 12 * 5 && decltype(dodecahedron)::INDEX_COUNT == 3 * 36, "Dodecahedron");
+    static_assert(decltype(icosahedron)::VERTEX_COUNT == 20 * 3 && decltype(icosahedron)::INDEX_COUNT == 3 * 20, "Icosahedron");
+    static_assert(decltype(plane)::VERTEX_COUNT == 25 && decltype(plane)::INDEX_COUNT == 6 * 16, "Plane<4>");
+    static_assert(sizeof(dodecahedron) == 60 * sizeof(Primitives::Vertex) + 108 * sizeof(uint16_t), "Shapes hold nothing but their arrays");
+
+    // Values are available to the compiler too
+    static_assert(plane.vertices[0].position[0] == -1.f && plane.vertices[24].texCoord[1] == 1.f, "Plane corners");
+    static_assert(cube.vertices[0].normal[0] * cube.vertices[0].normal[0] + cube.vertices[0].normal[1] * cube.vertices[0].normal[1] +
+        cube.vertices[0].normal[2] * cube.vertices[0].normal[2] > 0.99f, "Cube normals are unit length");
+
+    struct Vector {
+        double x, y, z;
+    };
+
+    Vector Position(const Primitives::Vertex& vertex) {
+        return { vertex.position[0], vertex.position[1], vertex.position[2] };
+    }
+
+    Vector Normal(const Primitives::Vertex& vertex) {
+        return { vertex.normal[0], vertex.normal[1], vertex.normal[2] };
+    }
+
+    Vector Subtract(Vector a, Vector b) {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    Vector Cross(Vector a, Vector b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    double Dot(Vector a, Vector b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    double Length(Vector a) {
+        return sqrt(Dot(a, a));
+    }
+
+    enum Kind {
+        // Smooth, with normals equal to positions
+        SPHERE,
+        // Flat faces with their own vertices
+        POLYHEDRON,
+        PLANE,
+    };
+
+    // Indices in range; unit normals and radius; tex coords in [0, 1];
+    // triangles facing outward with flat normals where the shape is flat;
+    // closed shapes are watertight by position with Euler characteristic 2
+    template <typename Shape>
+    void TestShape(const char* name, const Shape& shape, Kind kind) {
+        bool indicesValid = true, verticesValid = true, facesValid = true;
+        for (size_t i = 0; i < Shape::INDEX_COUNT; ++i) {
+            indicesValid = indicesValid && shape.indices[i] < Shape::VERTEX_COUNT;
+        }
+        if (!CHECK(indicesValid)) {
+            return;
+        }
+
+        // Vertices with the same position get the same id
+        std::map<std::tuple<float, float, float>, size_t> ids;
+        std::vector<size_t> id(Shape::VERTEX_COUNT);
+        for (size_t i = 0; i < Shape::VERTEX_COUNT; ++i) {
+            const Primitives::Vertex& vertex = shape.vertices[i];
+            const Vector p = Position(vertex), n = Normal(vertex);
+            verticesValid = verticesValid && fabs(Length(n) - 1.0) < 1e-6;
+            if (kind != PLANE) {
+                verticesValid = verticesValid && fabs(Length(p) - 1.0) < 1e-6;
+            }
+            if (kind == SPHERE) {
+                verticesValid = verticesValid && Length(Subtract(n, p)) < 1e-6;
+            }
+            for (float t : vertex.texCoord) {
+                verticesValid = verticesValid && t >= 0.f && t <= 1.f;
+            }
+            id[i] = ids.emplace(std::make_tuple(vertex.position[0], vertex.position[1], vertex.position[2]), ids.size()).first->second;
+        }
+
+        // Directed edges between position ids
+        std::map<std::pair<size_t, size_t>, int> edges;
+        double area = 0.0;
+        for (size_t i = 0; i < Shape::INDEX_COUNT; i += 3) {
+            const Primitives::Vertex* corners[3] = { &shape.vertices[shape.indices[i]], &shape.vertices[shape.indices[i + 1]],
+                &shape.vertices[shape.indices[i + 2]] };
+            const Vector a = Position(*corners[0]), b = Position(*corners[1]), c = Position(*corners[2]);
+            const Vector normal = Cross(Subtract(c, b), Subtract(a, b));
+            const double length = Length(normal);
+            area += 0.5 * length;
+
+            const Vector outward = kind == PLANE ? Vector{ 0.0, 1.0, 0.0 } : Vector{ a.x + b.x + c.x, a.y + b.y + c.y, a.z + b.z + c.z };
+            facesValid = facesValid && length > 0.0 && Dot(normal, outward) > 0.0;
+            if (kind != SPHERE) {
+                for (const Primitives::Vertex* corner : corners) {
+                    facesValid = facesValid && Length(Subtract(Normal(*corner), { normal.x / length, normal.y / length, normal.z / length })) < 1e-5;
+                }
+            }
+            for (size_t k = 0; k < 3; ++k) {
+                edges[std::make_pair(id[shape.indices[i + k]], id[shape.indices[i + (k + 1) % 3]])]++;
+            }
+        }
+        printf("%s: %zu vertices, %zu triangles, %zu positions, area %.5f\n", name, Shape::VERTEX_COUNT, Shape::INDEX_COUNT / 3, ids.size(), area);
+        CHECK(verticesValid);
+        CHECK(facesValid);
+
+        if (kind != PLANE) {
+            bool manifold = true;
+            for (const auto& edge : edges) {
+                const auto opposite = edges.find(std::make_pair(edge.first.second, edge.first.first));
+                manifold = manifold && edge.second == 1 && opposite != edges.end() && opposite->second == 1;
+            }
+            CHECK(manifold);
+            CHECK(ids.size() + Shape::INDEX_COUNT / 3 == edges.size() / 2 + 2);
+        }
+    }
+
+    double NearestDistance(Vector p, const std::vector<Vector>& candidates) {
+        double nearest = INFINITY;
+        for (const Vector& candidate : candidates) {
+            nearest = fmin(nearest, Length(Subtract(p, candidate)));
+        }
+        return nearest;
+    }
+
+    // UvSphere<32, 16> has the bundled sphere's tessellation: the same
+    // positions and triangle count, though quads may be split along the
+    // other diagonal
+    void TestMatchesSphereObj() {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource("sphere.obj").c_str(), RESOURCES_DIR))) {
+            return;
+        }
+
+        size_t triangles = 0;
+        for (const tinyobj::shape_t& shape : shapes) {
+            triangles += shape.mesh.indices.size() / 3;
+        }
+        std::vector<Vector> objPositions, shapePositions;
+        for (size_t i = 0; i + 2 < attrib.vertices.size(); i += 3) {
+            objPositions.push_back({ attrib.vertices[i], attrib.vertices[i + 1], attrib.vertices[i + 2] });
+        }
+        for (const Primitives::Vertex& vertex : uvSphere.vertices) {
+            shapePositions.push_back(Position(vertex));
+        }
+
+        double worst = 0.0;
+        for (const Vector& p : objPositions) {
+            worst = fmax(worst, NearestDistance(p, shapePositions));
+        }
+        for (const Vector& p : shapePositions) {
+            worst = fmax(worst, NearestDistance(p, objPositions));
+        }
+        printf("sphere.obj: %zu triangles, farthest position from the other mesh's nearest %g\n", triangles, worst);
+        CHECK(triangles == uvSphere.INDEX_COUNT / 3);
+        CHECK(worst < 1e-5);
+    }
+}
+
+int main() {
+    TestShape("UvSphere<32, 16>", uvSphere, SPHERE);
+    TestShape("UvSphere<3, 2>", smallUvSphere, SPHERE);
+    TestShape("Icosphere<0>", icosphere0, SPHERE);
+    TestShape("Icosphere<1>", icosphere1, SPHERE);
+    TestShape("Icosphere<2>", icosphere2, SPHERE);
+    TestShape("Tetrahedron", tetrahedron, POLYHEDRON);
+    TestShape("Cube", cube, POLYHEDRON);
+    TestShape("Octahedron", octahedron, POLYHEDRON);
+    TestShape("Dodecahedron", dodecahedron, POLYHEDRON);
+    TestShape("Icosahedron", icosahedron, POLYHEDRON);
+    TestShape("Plane<4>", plane, PLANE);
+    TestMatchesSphereObj();
+    return Check::Exit();
+}
@@ -0,0 +1,42 @@
+// Simplifies the sphere, a generated grid and any OBJs named on the command
+// line to each of ObjLoader's default LOD ratios, each from the full mesh as
+// ObjLoader does, and prints the time, the triangles left and the error.
+//
+//   SimplifierBench [file.obj ...]
+
+#include "Bench.h"
+#include "Simplifier.h"
+
+#include <cfloat>
+#include <cstdio>
+
+namespace {
+    const int REPEATS = 3;
+    const int GRID_SIZE = 300;
+
+    // ObjLoader::DefaultLodRatios()
+    const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f };
+
+    const size_t POSITION_STRIDE = 3 * sizeof(float);
+}
+
+int main(int argc, char** argv) {
+    for (const Bench::Mesh& mesh : Bench::Meshes(argc, argv, GRID_SIZE)) {
+        const size_t triangles = mesh.indices.size() / 3;
+        printf("%s: %zu vertices, %zu triangles\n", mesh.name.c_str(), mesh.positions.size() / 3, triangles);
+
+        std::vector<uint32_t> result(mesh.indices.size());
+        for (float ratio : LOD_RATIOS) {
+            const size_t target = size_t(triangles * ratio) * 3;
+            size_t count = 0;
+            float error = 0.f;
+            const double seconds = Bench::Seconds(REPEATS, [&]() {
+                count = Simplifier::Simplify(result.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), POSITION_STRIDE, target,
+                    FLT_MAX, &error);
+            });
+            printf("  ratio %.3f: %zu triangles (%.3f of the input), error %g, %.2f ms (%.1f M input triangles/s)\n", ratio, count / 3, double(count) / mesh.indices.size(),
+                error, seconds * 1000.0, triangles / seconds / 1e6);
+        }
+    }
+    return 0;
+}
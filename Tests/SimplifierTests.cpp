@@ -0,0 +1,156 @@
+#include "Check.h"
+#include "MeshWelder.h"
+#include "Simplifier.h"
+#include "tiny_obj_loader.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+    // What ObjLoader simplifies: position and tex coord, so UV seams are
+    // attribute seams
+    struct PositionTexCoord {
+        float position[3];
+        float texCoord[2];
+    };
+
+    struct Mesh {
+        std::vector<PositionTexCoord> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // A size x size quad grid, flat if amplitude is 0
+    Mesh Grid(int size, float amplitude) {
+        Mesh mesh;
+        for (int y = 0; y <= size; ++y) {
+            for (int x = 0; x <= size; ++x) {
+                const PositionTexCoord vertex = { { x * 0.1f, y * 0.1f, amplitude * sinf(x * 0.3f) * cosf(y * 0.2f) }, { x / float(size), y / float(size) } };
+                mesh.vertices.push_back(vertex);
+            }
+        }
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        return mesh;
+    }
+
+    Mesh Sphere() {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        Mesh mesh;
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource("sphere.obj").c_str(), RESOURCES_DIR))) {
+            return mesh;
+        }
+
+        std::vector<PositionTexCoord> corners;
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                PositionTexCoord corner = {};
+                for (int k = 0; k < 3; ++k) {
+                    corner.position[k] = attrib.vertices[3 * index.vertex_index + k];
+                }
+                if (index.texcoord_index >= 0) {
+                    corner.texCoord[0] = attrib.texcoords[2 * index.texcoord_index];
+                    corner.texCoord[1] = attrib.texcoords[2 * index.texcoord_index + 1];
+                }
+                corners.push_back(corner);
+            }
+        }
+        MeshWelder::Weld(corners.data(), corners.size(), mesh.vertices, mesh.indices);
+        return mesh;
+    }
+
+    size_t Simplify(std::vector<uint32_t>& result, const Mesh& mesh, size_t target, float targetError, float* error) {
+        return Simplifier::Simplify(result.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices[0].position, sizeof(PositionTexCoord), target,
+            targetError, error);
+    }
+
+    // Indices in range and no triangle repeating a vertex or position
+    bool IsValid(const Mesh& mesh, const std::vector<uint32_t>& result, size_t count) {
+        bool valid = count % 3 == 0 && count <= mesh.indices.size();
+        for (size_t i = 0; valid && i < count; i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                valid = valid && result[i + k] < mesh.vertices.size();
+            }
+            if (!valid) {
+                break;
+            }
+            const float* a = mesh.vertices[result[i]].position;
+            const float* b = mesh.vertices[result[i + 1]].position;
+            const float* c = mesh.vertices[result[i + 2]].position;
+            valid = result[i] != result[i + 1] && result[i + 1] != result[i + 2] && result[i] != result[i + 2] && memcmp(a, b, 12) != 0 &&
+                memcmp(b, c, 12) != 0 && memcmp(a, c, 12) != 0;
+        }
+        return valid;
+    }
+
+    // LODs are each simplified from the full mesh, as ObjLoader builds them,
+    // with ever smaller targets; their errors must not decrease
+    void TestLodChain(const char* name, const Mesh& mesh) {
+        const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.05f, 0.01f };
+        float lastError = 0.f;
+        size_t lastCount = mesh.indices.size();
+        for (float ratio : ratios) {
+            const size_t target = size_t(mesh.indices.size() / 3 * ratio) * 3;
+            std::vector<uint32_t> result(mesh.indices.size());
+            float error = -1.f;
+            const size_t count = Simplify(result, mesh, target, FLT_MAX, &error);
+            printf("%s, %.0f%%: %zu -> %zu triangles (target %zu), error %g\n", name, ratio * 100.f, mesh.indices.size() / 3, count / 3, target / 3, error);
+
+            CHECK(IsValid(mesh, result, count));
+            CHECK(count <= lastCount);
+            CHECK(error >= lastError);
+            lastError = error;
+            lastCount = count;
+        }
+        // The coarsest level still has triangles, and actually simplified
+        CHECK(lastCount > 0);
+        CHECK(lastCount < mesh.indices.size());
+    }
+
+    // An error bound stops collapses early, and the result stays within it
+    void TestErrorLimit(const char* name, const Mesh& mesh, float targetError) {
+        std::vector<uint32_t> result(mesh.indices.size());
+        float error = -1.f;
+        const size_t count = Simplify(result, mesh, 0, targetError, &error);
+        printf("%s, error limit %g: %zu -> %zu triangles, error %g\n", name, targetError, mesh.indices.size() / 3, count / 3, error);
+
+        CHECK(IsValid(mesh, result, count));
+        CHECK(error <= targetError);
+    }
+}
+
+int main() {
+    TestLodChain("Bumpy grid", Grid(80, 0.3f));
+    TestLodChain("sphere.obj", Sphere());
+    TestErrorLimit("Bumpy grid", Grid(80, 0.3f), 1e-3f);
+    TestErrorLimit("sphere.obj", Sphere(), 1e-3f);
+
+    // Collapsing inside a plane, or along a straight border, costs nothing,
+    // so a flat grid loses most of its triangles at zero error but still
+    // covers the same square
+    const Mesh flat = Grid(40, 0.f);
+    std::vector<uint32_t> result(flat.indices.size());
+    float error = -1.f;
+    const size_t count = Simplify(result, flat, 0, 0.f, &error);
+    printf("Flat grid, zero error: %zu -> %zu triangles\n", flat.indices.size() / 3, count / 3);
+    CHECK(IsValid(flat, result, count));
+    CHECK(error == 0.f);
+    CHECK(count * 4 < flat.indices.size());
+    float area = 0.f;
+    for (size_t i = 0; i < count; i += 3) {
+        const float* a = flat.vertices[result[i]].position;
+        const float* b = flat.vertices[result[i + 1]].position;
+        const float* c = flat.vertices[result[i + 2]].position;
+        area += 0.5f * fabsf((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]));
+    }
+    CHECK(fabsf(area - 16.f) < 1e-3f);
+    return Check::Exit();
+}
@@ -0,0 +1,169 @@
+#include "stdafx.h"
+#include "Check.h"
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    struct ExpectedElement {
+        const char* name;
+        DXGI_FORMAT format;
+        UINT offset;
+    };
+
+    // Random positions in a box that is flat along z, unit normals and tex
+    // coords that wrap past [0, 1]
+    std::vector<Vertex> RandomVertices(size_t count, BoundingBox& bounds) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::vector<Vertex> vertices(count);
+        for (Vertex& vertex : vertices) {
+            vertex.position = XMFLOAT3(10.f * unit(rng), 0.5f + 0.25f * unit(rng), 3.f);
+            XMVECTOR normal;
+            do {
+                normal = XMVectorSet(unit(rng), unit(rng), unit(rng), 0.f);
+            } while (XMVectorGetX(XMVector3LengthSq(normal)) < 1e-4f);
+            XMStoreFloat3(&vertex.normal, XMVector3Normalize(normal));
+            vertex.texCoord = XMFLOAT2(2.f * unit(rng) + 0.5f, unit(rng));
+        }
+        // Exact axis-aligned normals, which sit on the octahedron's folds
+        vertices[0].normal = XMFLOAT3(0.f, 0.f, -1.f);
+        vertices[1].normal = XMFLOAT3(0.f, 1.f, 0.f);
+        vertices[2].normal = XMFLOAT3(-1.f, 0.f, 0.f);
+
+        bounds.min = bounds.max = vertices[0].position;
+        for (const Vertex& vertex : vertices) {
+            XMStoreFloat3(&bounds.min, XMVectorMin(XMLoadFloat3(&bounds.min), XMLoadFloat3(&vertex.position)));
+            XMStoreFloat3(&bounds.max, XMVectorMax(XMLoadFloat3(&bounds.max), XMLoadFloat3(&vertex.position)));
+        }
+        return vertices;
+    }
+
+    template <typename TFormat>
+    void TestInputLayout(const char* name, const std::vector<ExpectedElement>& expected) {
+        bool matches = CHECK(TFormat::ELEMENT_COUNT == expected.size());
+        const D3D12_INPUT_ELEMENT_DESC* elements = TFormat::InputLayout();
+        for (size_t i = 0; matches && i < expected.size(); ++i) {
+            const D3D12_INPUT_ELEMENT_DESC& element = elements[i];
+            matches = CHECK(strcmp(element.SemanticName, expected[i].name) == 0) && CHECK(element.SemanticIndex == 0) &&
+                CHECK(element.Format == expected[i].format) && CHECK(element.InputSlot == 0) && CHECK(element.AlignedByteOffset == expected[i].offset) &&
+                CHECK(element.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA) && CHECK(element.InstanceDataStepRate == 0);
+        }
+        if (!matches) {
+            printf("%s: input layout differs from the hand-computed one\n", name);
+        }
+    }
+
+    // Largest position error per axis, normal error in degrees and tex coord
+    // error relative to the value's magnitude, after a round trip
+    template <typename TFormat>
+    void RoundTrip(const std::vector<Vertex>& vertices, const BoundingBox& bounds, std::vector<typename TFormat::Type>& packed, float& positionError,
+        float& normalDegrees, float& texCoordError) {
+        const VertexEncodings::Context context = VertexEncodings::Context::ForBounds(bounds);
+        packed.resize(vertices.size());
+        std::vector<Vertex> decoded(vertices.size());
+        TFormat::Pack(vertices.data(), vertices.size(), context, packed.data());
+        TFormat::Unpack(packed.data(), packed.size(), context, decoded.data());
+
+        positionError = normalDegrees = texCoordError = 0.f;
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const XMVECTOR position = XMVectorAbs(XMVectorSubtract(XMLoadFloat3(&vertices[i].position), XMLoadFloat3(&decoded[i].position)));
+            positionError = fmaxf(positionError, fmaxf(XMVectorGetX(position), fmaxf(XMVectorGetY(position), XMVectorGetZ(position))));
+
+            // atan2 rather than acos, which can't resolve angles this small
+            const XMVECTOR original = XMLoadFloat3(&vertices[i].normal);
+            const XMVECTOR normal = XMLoadFloat3(&decoded[i].normal);
+            const float angle = atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(original, normal))), XMVectorGetX(XMVector3Dot(original, normal)));
+            normalDegrees = fmaxf(normalDegrees, XMConvertToDegrees(angle));
+
+            const float u = fabsf(vertices[i].texCoord.x - decoded[i].texCoord.x) / fmaxf(fabsf(vertices[i].texCoord.x), 1e-3f);
+            const float v = fabsf(vertices[i].texCoord.y - decoded[i].texCoord.y) / fmaxf(fabsf(vertices[i].texCoord.y), 1e-3f);
+            texCoordError = fmaxf(texCoordError, fmaxf(u, v));
+        }
+    }
+
+    void TestStandard(const std::vector<Vertex>& vertices, const BoundingBox& bounds) {
+        std::vector<VertexFormats::Standard::Type> packed;
+        float position, normal, texCoord;
+        RoundTrip<VertexFormats::Standard>(vertices, bounds, packed, position, normal, texCoord);
+        printf("Standard: position error %g, normal %g degrees, tex coord %g\n", position, normal, texCoord);
+
+        // Laid out exactly like Vertex, so it packs as a copy
+        CHECK(memcmp(packed.data(), vertices.data(), vertices.size() * sizeof(Vertex)) == 0);
+        CHECK(position == 0.f && texCoord == 0.f);
+        CHECK(normal < 0.01f);
+
+        TestInputLayout<VertexFormats::Standard>("Standard", {
+            { "POSITION", DXGI_FORMAT_R32G32B32_FLOAT, 0 },
+            { "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, 12 },
+            { "TEXCOORD", DXGI_FORMAT_R32G32_FLOAT, 24 },
+        });
+    }
+
+    // Half a 16-bit step of the box along each axis plus float rounding,
+    // 16-bit octahedral normals, and half floats' 11-bit significands
+    template <typename TFormat>
+    void TestQuantized(const char* name, const std::vector<Vertex>& vertices, const BoundingBox& bounds, std::vector<typename TFormat::Type>& packed) {
+        float position, normal, texCoord;
+        RoundTrip<TFormat>(vertices, bounds, packed, position, normal, texCoord);
+        printf("%s: position error %g, normal %g degrees, tex coord %g\n", name, position, normal, texCoord);
+
+        const float extent = fmaxf(bounds.max.x - bounds.min.x, fmaxf(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z));
+        const XMVECTOR magnitudes = XMVectorMax(XMVectorAbs(XMLoadFloat3(&bounds.min)), XMVectorAbs(XMLoadFloat3(&bounds.max)));
+        const float magnitude = fmaxf(XMVectorGetX(magnitudes), fmaxf(XMVectorGetY(magnitudes), XMVectorGetZ(magnitudes)));
+        CHECK(position <= 0.5f * extent / 65535.f + magnitude / (1 << 20));
+        CHECK(normal < 0.01f);
+        CHECK(texCoord <= 1.f / 2048.f);
+    }
+
+    void TestCompact(const std::vector<Vertex>& vertices, const BoundingBox& bounds) {
+        std::vector<VertexFormats::Compact::Type> packed;
+        TestQuantized<VertexFormats::Compact>("Compact", vertices, bounds, packed);
+
+        TestInputLayout<VertexFormats::Compact>("Compact", {
+            { "POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, 0 },
+            { "NORMAL", DXGI_FORMAT_R16G16_SNORM, 8 },
+            { "TEXCOORD", DXGI_FORMAT_R16G16_FLOAT, 12 },
+        });
+    }
+
+    // Vertex has no influences, so every vertex is bound to bone 0 with full
+    // weight, after the same 16 bytes as Compact
+    void TestSkinned(const std::vector<Vertex>& vertices, const BoundingBox& bounds) {
+        std::vector<VertexFormats::Skinned::Type> packed;
+        TestQuantized<VertexFormats::Skinned>("Skinned", vertices, bounds, packed);
+
+        std::vector<VertexFormats::Compact::Type> compact(vertices.size());
+        VertexFormats::Compact::Pack(vertices.data(), vertices.size(), VertexEncodings::Context::ForBounds(bounds), compact.data());
+        bool sharesCompact = true, rigid = true;
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const BYTE* bytes = reinterpret_cast<const BYTE*>(&packed[i]);
+            sharesCompact = sharesCompact && memcmp(bytes, &compact[i], VertexFormats::Compact::STRIDE) == 0;
+            const BYTE* indices = bytes + VertexFormats::Skinned::OffsetOf<VertexSemantics::BoneIndices>();
+            const BYTE* weights = bytes + VertexFormats::Skinned::OffsetOf<VertexSemantics::BoneWeights>();
+            rigid = rigid && indices[0] == 0 && indices[1] == 0 && indices[2] == 0 && indices[3] == 0;
+            rigid = rigid && weights[0] == 255 && weights[1] == 0 && weights[2] == 0 && weights[3] == 0;
+        }
+        CHECK(sharesCompact);
+        CHECK(rigid);
+
+        TestInputLayout<VertexFormats::Skinned>("Skinned", {
+            { "POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, 0 },
+            { "NORMAL", DXGI_FORMAT_R16G16_SNORM, 8 },
+            { "TEXCOORD", DXGI_FORMAT_R16G16_FLOAT, 12 },
+            { "BLENDINDICES", DXGI_FORMAT_R8G8B8A8_UINT, 16 },
+            { "BLENDWEIGHT", DXGI_FORMAT_R8G8B8A8_UNORM, 20 },
+        });
+    }
+}
+
+int main() {
+    BoundingBox bounds;
+    const std::vector<Vertex> vertices = RandomVertices(10000, bounds);
+    TestStandard(vertices, bounds);
+    TestCompact(vertices, bounds);
+    TestSkinned(vertices, bounds);
+    return Check::Exit();
+}
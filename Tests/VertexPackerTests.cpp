@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "Check.h"
+#include "VertexPacker.h"
+#include "tiny_obj_loader.h"
+
+#include <random>
+
+namespace {
+    BoundingBox Bounds(const std::vector<Vertex>& vertices) {
+        BoundingBox bounds = { vertices[0].position, vertices[0].position };
+        for (const Vertex& vertex : vertices) {
+            bounds.min.x = fminf(bounds.min.x, vertex.position.x);
+            bounds.min.y = fminf(bounds.min.y, vertex.position.y);
+            bounds.min.z = fminf(bounds.min.z, vertex.position.z);
+            bounds.max.x = fmaxf(bounds.max.x, vertex.position.x);
+            bounds.max.y = fmaxf(bounds.max.y, vertex.position.y);
+            bounds.max.z = fmaxf(bounds.max.z, vertex.position.z);
+        }
+        return bounds;
+    }
+
+    // Packs vertices and checks the decoded error against ErrorBound
+    void TestWithinBound(const char* name, const std::vector<Vertex>& vertices) {
+        const BoundingBox bounds = Bounds(vertices);
+        std::vector<PackedVertex> packed(vertices.size());
+        VertexPacker::Pack(vertices.data(), vertices.size(), bounds, packed.data());
+
+        const VertexPacker::ErrorStats error = VertexPacker::MeasureError(vertices.data(), packed.data(), vertices.size(), bounds);
+        const VertexPacker::ErrorStats bound = VertexPacker::ErrorBound(vertices.data(), vertices.size(), bounds);
+        printf("%s: %zu vertices, position error %g (bound %g), normal %g degrees (bound %g), tex coord %g (bound %g)\n", name, vertices.size(),
+            error.position, bound.position, error.normalDegrees, bound.normalDegrees, error.texCoord, bound.texCoord);
+
+        CHECK(error.position <= bound.position);
+        CHECK(error.normalDegrees <= bound.normalDegrees);
+        CHECK(error.texCoord <= bound.texCoord);
+    }
+
+    // The bundled meshes' corners with the normals and tex coords they ship
+    // with
+    std::vector<Vertex> LoadCorners(const char* name) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        std::vector<Vertex> corners;
+        if (!CHECK(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, Check::Resource(name).c_str(), RESOURCES_DIR))) {
+            return corners;
+        }
+
+        for (const tinyobj::shape_t& shape : shapes) {
+            for (const tinyobj::index_t& index : shape.mesh.indices) {
+                Vertex vertex = {};
+                const float* p = &attrib.vertices[3 * index.vertex_index];
+                vertex.position = XMFLOAT3(p[0], p[1], p[2]);
+                if (index.normal_index >= 0) {
+                    const float* n = &attrib.normals[3 * index.normal_index];
+                    vertex.normal = XMFLOAT3(n[0], n[1], n[2]);
+                }
+                if (index.texcoord_index >= 0) {
+                    const float* t = &attrib.texcoords[2 * index.texcoord_index];
+                    vertex.texCoord = XMFLOAT2(t[0], t[1]);
+                }
+                corners.push_back(vertex);
+            }
+        }
+        return corners;
+    }
+
+    // Uniform unit normals, positions spread over a box far from the origin
+    // and tex coords tiling well past [0, 1]
+    std::vector<Vertex> RandomVertices(size_t count, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> gaussian;
+        std::uniform_real_distribution<float> position(-50.f, 150.f);
+        std::uniform_real_distribution<float> texCoord(-8.f, 8.f);
+
+        std::vector<Vertex> vertices(count);
+        for (Vertex& vertex : vertices) {
+            vertex.position = XMFLOAT3(1000.f + position(rng), position(rng), -position(rng) * 0.01f);
+            XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVectorSet(gaussian(rng), gaussian(rng), gaussian(rng), 0.f)));
+            vertex.texCoord = XMFLOAT2(texCoord(rng), texCoord(rng));
+        }
+        return vertices;
+    }
+
+    // The octahedral seams and poles, unnormalized normals, and a zero normal
+    // MeasureError skips. The mesh is flat in z, so that axis has no extent
+    // to quantize against.
+    std::vector<Vertex> EdgeCaseVertices() {
+        const XMFLOAT3 normals[] = {
+            XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(-1.f, 0.f, 0.f), XMFLOAT3(0.f, 1.f, 0.f), XMFLOAT3(0.f, -1.f, 0.f),
+            XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT3(0.f, 0.f, -1.f), XMFLOAT3(1.f, 1.f, -1e-7f), XMFLOAT3(-1.f, 1e-7f, -1.f),
+            XMFLOAT3(3.f, -4.f, 12.f), XMFLOAT3(1e-20f, 1e-20f, -1e-20f), XMFLOAT3(0.f, 0.f, 0.f),
+        };
+        std::vector<Vertex> vertices;
+        for (size_t i = 0; i < sizeof(normals) / sizeof(normals[0]); ++i) {
+            Vertex vertex;
+            vertex.position = XMFLOAT3(float(i), -float(i) * 0.5f, 2.f);
+            vertex.normal = normals[i];
+            vertex.texCoord = XMFLOAT2(i * 1e-6f, 1.f - i * 0.125f);
+            vertices.push_back(vertex);
+        }
+        return vertices;
+    }
+}
+
+int main() {
+    TestWithinBound("sphere.obj", LoadCorners("sphere.obj"));
+    TestWithinBound("dodecahedron.obj", LoadCorners("dodecahedron.obj"));
+    TestWithinBound("Random", RandomVertices(1000000, 1));
+    TestWithinBound("Edge cases", EdgeCaseVertices());
+    return Check::Exit();
+}